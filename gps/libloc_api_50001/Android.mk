@@ -24,6 +24,8 @@ LOCAL_SHARED_LIBRARIES := \
 
 LOCAL_SRC_FILES += \
     loc_eng_log.cpp \
+    loc_eng_msg_pool.cpp \
+    loc_eng_trace.cpp \
     LocApiAdapter.cpp
 
 LOCAL_CFLAGS += \
@@ -44,7 +46,8 @@ LOCAL_COPY_HEADERS:= \
    loc_eng_agps.h \
    loc_eng_msg.h \
    loc_eng_msg_id.h \
-   loc_eng_log.h
+   loc_eng_log.h \
+   loc_eng_trace.h
 
 include $(BUILD_SHARED_LIBRARY)
 
@@ -66,7 +69,8 @@ LOCAL_SRC_FILES += \
     loc_eng_xtra.cpp \
     loc_eng_ni.cpp \
     loc_eng_log.cpp \
-	loc_eng_nmea.cpp
+	loc_eng_nmea.cpp \
+    loc_eng_stats.cpp
 
 ifeq ($(FEATURE_GNSS_BIT_API), true)
 LOCAL_CFLAGS += -DFEATURE_GNSS_BIT_API
@@ -102,6 +106,7 @@ LOCAL_SHARED_LIBRARIES := \
     libutils \
     libcutils \
     libloc_eng \
+    libloc_adapter \
     libgps.utils \
     libdl
 
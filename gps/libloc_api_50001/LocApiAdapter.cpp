@@ -34,6 +34,9 @@
 #include "loc_eng_msg.h"
 #include "loc_log.h"
 #include "loc_eng_ni.h"
+#include "loc_eng_trace.h"
+
+static LocApiAdapter* (*adapterFactory)(LocEng &locEng) = NULL;
 
 static void* noProc(void* data)
 {
@@ -73,6 +76,11 @@ LocApiAdapter* LocApiAdapter::getLocApiAdapter(LocEng &locEng)
     void* handle;
     LocApiAdapter* adapter = NULL;
 
+    if (NULL != adapterFactory) {
+        LOC_LOGI("%s: constructing adapter from installed factory", __FUNCTION__);
+        return adapterFactory(locEng);
+    }
+
     handle = dlopen ("libloc_api_v02.so", RTLD_NOW);
 
     if (!handle) {
@@ -97,6 +105,21 @@ LocApiAdapter* LocApiAdapter::getLocApiAdapter(LocEng &locEng)
     return adapter;
 }
 
+void LocApiAdapter::setLocApiAdapterFactory(LocApiAdapter* (*factory)(LocEng &locEng))
+{
+    adapterFactory = factory;
+}
+
+bool LocApiAdapter::startRecording(const char* path)
+{
+    return loc_eng_trace_start(path);
+}
+
+void LocApiAdapter::stopRecording()
+{
+    loc_eng_trace_stop();
+}
+
 int LocApiAdapter::hexcode(char *hexstring, int string_size,
                         const char *data, int data_size)
 {
@@ -148,6 +171,9 @@ void LocApiAdapter::reportPosition(GpsLocation &location,
                                    enum loc_sess_status status,
                                    LocPosTechMask loc_technology_mask )
 {
+    if (loc_eng_trace_recording()) {
+        loc_eng_trace_position(location, locationExtended, status, loc_technology_mask);
+    }
     loc_eng_msg_report_position *msg(new loc_eng_msg_report_position(locEngHandle.owner,
                                                                      location,
                                                                      locationExtended,
@@ -163,7 +189,17 @@ void LocApiAdapter::reportPosition(GpsLocation &location,
 
 void LocApiAdapter::reportSv(GpsSvStatus &svStatus, GpsLocationExtended &locationExtended, void* svExt)
 {
-    loc_eng_msg_report_sv *msg(new loc_eng_msg_report_sv(locEngHandle.owner, svStatus, locationExtended, svExt));
+    reportSv(svStatus, locationExtended, svExt, 0);
+}
+
+void LocApiAdapter::reportSv(GpsSvStatus &svStatus, GpsLocationExtended &locationExtended, void* svExt,
+                             uint32_t gloUsedInFixMask)
+{
+    if (loc_eng_trace_recording()) {
+        loc_eng_trace_sv(svStatus, locationExtended, gloUsedInFixMask);
+    }
+    loc_eng_msg_report_sv *msg(new loc_eng_msg_report_sv(locEngHandle.owner, svStatus, locationExtended, svExt,
+                                                         gloUsedInFixMask));
 
     //We want to send SV info to ULP to help it in determining GNSS signal strength
     //ULP will forward the SV reports to HAL without any modifications
@@ -176,24 +212,47 @@ void LocApiAdapter::reportSv(GpsSvStatus &svStatus, GpsLocationExtended &locatio
 
 void LocApiAdapter::reportStatus(GpsStatusValue status)
 {
+    if (loc_eng_trace_recording()) {
+        loc_eng_trace_status(status);
+    }
     loc_eng_msg_report_status *msg(new loc_eng_msg_report_status(locEngHandle.owner, status));
     locEngHandle.sendMsge(locEngHandle.owner, msg);
 }
 
 void LocApiAdapter::reportNmea(const char* nmea, int length)
 {
+    if (loc_eng_trace_recording()) {
+        loc_eng_trace_nmea(nmea, length);
+    }
     loc_eng_msg_report_nmea *msg(new loc_eng_msg_report_nmea(locEngHandle.owner, nmea, length));
     locEngHandle.sendMsge(locEngHandle.owner, msg);
 }
 
+// The message takes its own reference; the caller still drops its own, so a
+// buffer filled in for this report alone is handed off without a copy.
+void LocApiAdapter::reportNmea(LocEngBuffer* nmea)
+{
+    if (loc_eng_trace_recording()) {
+        loc_eng_trace_nmea(nmea->data, nmea->length);
+    }
+    loc_eng_msg_report_nmea *msg(new loc_eng_msg_report_nmea(locEngHandle.owner, nmea));
+    locEngHandle.sendMsge(locEngHandle.owner, msg);
+}
+
 void LocApiAdapter::requestATL(int connHandle, AGpsType agps_type)
 {
+    if (loc_eng_trace_recording()) {
+        loc_eng_trace_atl(LOC_ENG_TRACE_REQUEST_ATL, connHandle, agps_type);
+    }
     loc_eng_msg_request_atl *msg(new loc_eng_msg_request_atl(locEngHandle.owner, connHandle, agps_type));
     locEngHandle.sendMsge(locEngHandle.owner, msg);
 }
 
 void LocApiAdapter::releaseATL(int connHandle)
 {
+    if (loc_eng_trace_recording()) {
+        loc_eng_trace_atl(LOC_ENG_TRACE_RELEASE_ATL, connHandle, AGPS_TYPE_INVALID);
+    }
     loc_eng_msg_release_atl *msg(new loc_eng_msg_release_atl(locEngHandle.owner, connHandle));
     locEngHandle.sendMsge(locEngHandle.owner, msg);
 }
@@ -201,6 +260,9 @@ void LocApiAdapter::releaseATL(int connHandle)
 void LocApiAdapter::requestXtraData()
 {
     LOC_LOGD("XTRA download request");
+    if (loc_eng_trace_recording()) {
+        loc_eng_trace_event(LOC_ENG_TRACE_REQUEST_XTRA_DATA);
+    }
 
     loc_eng_msg *msg(new loc_eng_msg(locEngHandle.owner, LOC_ENG_MSG_REQUEST_XTRA_DATA));
     locEngHandle.sendMsge(locEngHandle.owner, msg);
@@ -209,6 +271,9 @@ void LocApiAdapter::requestXtraData()
 void LocApiAdapter::requestTime()
 {
     LOC_LOGD("loc_event_cb: XTRA time download request");
+    if (loc_eng_trace_recording()) {
+        loc_eng_trace_event(LOC_ENG_TRACE_REQUEST_TIME);
+    }
     loc_eng_msg *msg(new loc_eng_msg(locEngHandle.owner, LOC_ENG_MSG_REQUEST_TIME));
     locEngHandle.sendMsge(locEngHandle.owner, msg);
 }
@@ -216,6 +281,9 @@ void LocApiAdapter::requestTime()
 void LocApiAdapter::requestLocation()
 {
     LOC_LOGD("loc_event_cb: XTRA time download request... not supported");
+    if (loc_eng_trace_recording()) {
+        loc_eng_trace_event(LOC_ENG_TRACE_REQUEST_LOCATION);
+    }
     // loc_eng_msg *msg(new loc_eng_msg(locEngHandle.owner, LOC_ENG_MSG_REQUEST_POSITION));
     // locEngHandle.sendMsge(locEngHandle.owner, msg);
 }
@@ -224,6 +292,9 @@ void LocApiAdapter::requestNiNotify(GpsNiNotification &notif, const void* data)
 {
     notif.size = sizeof(notif);
     notif.timeout     = LOC_NI_NO_RESPONSE_TIME;
+    if (loc_eng_trace_recording()) {
+        loc_eng_trace_ni(notif);
+    }
 
     loc_eng_msg_request_ni *msg(new loc_eng_msg_request_ni(locEngHandle.owner, notif, data));
     locEngHandle.sendMsge(locEngHandle.owner, msg);
@@ -231,12 +302,18 @@ void LocApiAdapter::requestNiNotify(GpsNiNotification &notif, const void* data)
 
 void LocApiAdapter::handleEngineDownEvent()
 {
+    if (loc_eng_trace_recording()) {
+        loc_eng_trace_event(LOC_ENG_TRACE_ENGINE_DOWN);
+    }
     loc_eng_msg *msg(new loc_eng_msg(locEngHandle.owner, LOC_ENG_MSG_ENGINE_DOWN));
     locEngHandle.sendMsge(locEngHandle.owner, msg);
 }
 
 void LocApiAdapter::handleEngineUpEvent()
 {
+    if (loc_eng_trace_recording()) {
+        loc_eng_trace_event(LOC_ENG_TRACE_ENGINE_UP);
+    }
     loc_eng_msg *msg(new loc_eng_msg(locEngHandle.owner, LOC_ENG_MSG_ENGINE_UP));
     locEngHandle.sendMsge(locEngHandle.owner, msg);
 }
@@ -116,6 +116,14 @@ public:
     virtual ~LocApiAdapter();
 
     static LocApiAdapter* getLocApiAdapter(LocEng &locEng);
+    // Makes getLocApiAdapter() construct adapters with factory instead of
+    // loading the modem adapter library; NULL restores the default.
+    static void setLocApiAdapterFactory(LocApiAdapter* (*factory)(LocEng &locEng));
+
+    // Records every upcall below, from any adapter, to a trace file for
+    // later replay; see loc_eng_trace.h for the format.
+    static bool startRecording(const char* path);
+    static void stopRecording();
 
     static int hexcode(char *hexstring, int string_size,
                        const char *data, int data_size);
@@ -130,8 +138,15 @@ public:
     void reportSv(GpsSvStatus &svStatus,
                   GpsLocationExtended &locationExtended,
                   void* svExt);
+    // gloUsedInFixMask has bit 0 for GLONASS PRN 65; a separate overload so
+    // prebuilt adapters keep linking against the three argument one.
+    void reportSv(GpsSvStatus &svStatus,
+                  GpsLocationExtended &locationExtended,
+                  void* svExt,
+                  uint32_t gloUsedInFixMask);
     void reportStatus(GpsStatusValue status);
     void reportNmea(const char* nmea, int length);
+    void reportNmea(LocEngBuffer* nmea);
     void reportAgpsStatus(AGpsStatus &agpsStatus);
     void requestXtraData();
     void requestTime();
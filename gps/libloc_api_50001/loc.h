@@ -61,6 +61,10 @@ typedef enum loc_position_mode_type {
 typedef void (*loc_location_cb_ext) (GpsLocation* location, void* locExt);
 typedef void (*loc_sv_status_cb_ext) (GpsSvStatus* sv_status, void* svExt);
 typedef void* (*loc_ext_parser)(void* data);
+/* All the NMEA sentences of one fix in a single buffer; offsets[i] is
+ * where sentence i starts. */
+typedef void (*loc_nmea_burst_cb) (GpsUtcTime timestamp, const char* nmea, int length,
+                                   const int* offsets, int count);
 
 typedef struct {
     loc_location_cb_ext location_cb;
@@ -74,6 +78,7 @@ typedef struct {
     loc_ext_parser location_ext_parser;
     loc_ext_parser sv_ext_parser;
     gps_request_utc_time request_utc_time_cb;
+    loc_nmea_burst_cb nmea_burst_cb;
 } LocCallbacks;
 
 enum loc_sess_status {
@@ -58,6 +58,8 @@
 #include <loc_eng_msg.h>
 #include <loc_eng_msg_id.h>
 #include <loc_eng_nmea.h>
+#include <loc_eng_stats.h>
+#include <loc_eng_trace.h>
 #include <msg_q.h>
 #include <loc.h>
 
@@ -67,9 +69,18 @@
 #define SUCCESS TRUE
 #define FAILURE FALSE
 
+/* max number of msgs the deferred action thread takes off its q at once */
+#define LOC_ENG_MSG_BATCH_SIZE 16
+
 static void loc_eng_deferred_action_thread(void* context);
-static void* loc_eng_create_msg_q();
+static void loc_eng_report_action_thread(void* context);
+static void* loc_eng_create_msg_q(unsigned long ring_size,
+                                  msg_q_lane_type (*lane_func)(void*),
+                                  msg_q_coalesce_type (*coalesce_func)(void*, msg_q_coalesce_key_type*));
+static msg_q_lane_type loc_eng_msg_lane(void* msg);
+static msg_q_coalesce_type loc_eng_msg_coalesce(void* msg, msg_q_coalesce_key_type* key);
 static void loc_eng_free_msg(void* msg);
+static void loc_eng_free_report(void* msg);
 
 pthread_mutex_t LocEngContext::lock = PTHREAD_MUTEX_INITIALIZER;
 pthread_cond_t LocEngContext::cond = PTHREAD_COND_INITIALIZER;
@@ -105,6 +116,15 @@ static loc_param_s_type loc_parameter_table[] =
   {"SENSOR_ALGORITHM_CONFIG_MASK",   &gps_conf.SENSOR_ALGORITHM_CONFIG_MASK,   NULL, 'n'},
   {"QUIPC_ENABLED",                  &gps_conf.QUIPC_ENABLED,                  NULL, 'n'},
   {"LPP_PROFILE",                    &gps_conf.LPP_PROFILE,                    NULL, 'n'},
+  {"DEFERRED_Q_RING_SIZE",           &gps_conf.DEFERRED_Q_RING_SIZE,           NULL, 'n'},
+  {"REPORT_THREAD",                  &gps_conf.REPORT_THREAD,                  NULL, 'n'},
+  {"TRACE_FILE",                     &gps_conf.TRACE_FILE,                     NULL, 's'},
+  {"NMEA_SENTENCE_MASK",             &gps_conf.NMEA_SENTENCE_MASK,             NULL, 'n'},
+  {"NMEA_GSV_DIVIDER",               &gps_conf.NMEA_GSV_DIVIDER,               NULL, 'n'},
+  {"NMEA_GSA_DIVIDER",               &gps_conf.NMEA_GSA_DIVIDER,               NULL, 'n'},
+  {"NMEA_VTG_DIVIDER",               &gps_conf.NMEA_VTG_DIVIDER,               NULL, 'n'},
+  {"NMEA_RMC_DIVIDER",               &gps_conf.NMEA_RMC_DIVIDER,               NULL, 'n'},
+  {"NMEA_GGA_DIVIDER",               &gps_conf.NMEA_GGA_DIVIDER,               NULL, 'n'},
 };
 
 static void loc_default_parameters(void)
@@ -116,6 +136,15 @@ static void loc_default_parameters(void)
    gps_conf.NMEA_PROVIDER = 0;
    gps_conf.SUPL_VER = 0x10000;
    gps_conf.CAPABILITIES = 0x7;
+   gps_conf.DEFERRED_Q_RING_SIZE = 0; /* linked list queue */
+   gps_conf.REPORT_THREAD = 0; /* reports delivered by deferred action thread */
+   gps_conf.TRACE_FILE[0] = '\0'; /* upcalls not recorded */
+   gps_conf.NMEA_SENTENCE_MASK = LOC_ENG_NMEA_MASK_ALL;
+   gps_conf.NMEA_GSV_DIVIDER = 1; /* every report */
+   gps_conf.NMEA_GSA_DIVIDER = 1;
+   gps_conf.NMEA_VTG_DIVIDER = 1;
+   gps_conf.NMEA_RMC_DIVIDER = 1;
+   gps_conf.NMEA_GGA_DIVIDER = 1;
 
    gps_conf.GYRO_BIAS_RANDOM_WALK = 0;
    gps_conf.SENSOR_ACCEL_BATCHES_PER_SEC = 2;
@@ -148,10 +177,23 @@ static void loc_default_parameters(void)
 }
 
 LocEngContext::LocEngContext(gps_create_thread threadCreator) :
-    deferred_q((const void*)loc_eng_create_msg_q()),
+    deferred_q((const void*)loc_eng_create_msg_q(gps_conf.DEFERRED_Q_RING_SIZE,
+                                                 loc_eng_msg_lane, loc_eng_msg_coalesce)),
     //TODO: should we conditionally create ulp msg q?
-    ulp_q((const void*)loc_eng_create_msg_q()),
+    ulp_q((const void*)loc_eng_create_msg_q(0, NULL, NULL)),
+    overflow_q(gps_conf.DEFERRED_Q_RING_SIZE ?
+               (const void*)loc_eng_create_msg_q(0, NULL, NULL) :
+               NULL),
+    overflow_pending(0),
+    report_q(gps_conf.REPORT_THREAD ?
+             (const void*)loc_eng_create_msg_q(gps_conf.DEFERRED_Q_RING_SIZE,
+                                               NULL, loc_eng_msg_coalesce) :
+             NULL),
     deferred_action_thread(threadCreator("loc_eng",loc_eng_deferred_action_thread, this)),
+    report_action_thread(NULL != report_q ?
+                         threadCreator("loc_eng_report", loc_eng_report_action_thread, this) :
+                         0),
+    report_action_done(false),
     counter(0)
 {
     LOC_LOGV("LocEngContext %d : %d pthread_id %ld\n",
@@ -178,8 +220,19 @@ void LocEngContext::drop()
         pthread_mutex_lock(&lock);
         counter--;
         if (counter == 0) {
-            loc_eng_msg *msg(new loc_eng_msg(this, LOC_ENG_MSG_QUIT));
-            msg_q_snd((void*)deferred_q, msg, loc_eng_free_msg);
+            loc_eng_msg *msg;
+            if (NULL != report_q) {
+                // stop report delivery first, nothing else waits on it
+                msg = new loc_eng_msg(this, LOC_ENG_MSG_QUIT);
+                msg_q_snd_wait((void*)report_q, msg, loc_eng_free_msg);
+                while (!report_action_done) {
+                    pthread_cond_wait(&cond, &lock);
+                }
+            }
+
+            msg = new loc_eng_msg(this, LOC_ENG_MSG_QUIT);
+            // QUIT must get through, even if a bounded deferred_q is full
+            msg_q_snd_wait((void*)deferred_q, msg, loc_eng_free_msg);
 
             // I am not sure if this is going to be hazardous. The calling thread
             // might be blocked for a while, if the q is loaded.  I am wondering
@@ -188,6 +241,12 @@ void LocEngContext::drop()
 
             msg_q_destroy((void**)&deferred_q);
             msg_q_destroy((void**)&ulp_q);
+            if (NULL != overflow_q) {
+                msg_q_destroy((void**)&overflow_q);
+            }
+            if (NULL != report_q) {
+                msg_q_destroy((void**)&report_q);
+            }
             delete me;
             me = NULL;
         }
@@ -229,27 +288,157 @@ static char extra_data[100];
   }
 #define INIT_CHECK(ctx, ret) STATE_CHECK(ctx, "instance not initialized", ret)
 
+// Reports that end in a framework callback. A full bounded deferred_q may
+// drop them, the next report supersedes them anyway.
+static bool loc_eng_msg_is_report(int msgid)
+{
+    return LOC_ENG_MSG_REPORT_POSITION == msgid ||
+           LOC_ENG_MSG_REPORT_SV == msgid ||
+           LOC_ENG_MSG_REPORT_STATUS == msgid ||
+           LOC_ENG_MSG_REPORT_NMEA == msgid;
+}
+
+// Sends a msg to the thread handling it. With a bounded deferred_q only
+// reports may be dropped, the next one supersedes them anyway; control
+// messages wait for room, or, sent by the deferred action thread itself,
+// which cannot wait for itself, go to overflow_q.
 void loc_eng_msg_sender(void* loc_eng_data_p, void* msg)
 {
     LocEngContext* loc_eng_context = (LocEngContext*)((loc_eng_data_s_type*)loc_eng_data_p)->context;
-    msg_q_snd((void*)loc_eng_context->deferred_q, msg, loc_eng_free_msg);
+    msq_q_err_type result;
+    if (NULL == msg) {
+        // the msg pool ran out of memory
+        LOC_LOGE("loc_eng_msg_sender got no msg");
+        return;
+    }
+    if (loc_eng_msg_is_report(((loc_eng_msg*)msg)->msgid)) {
+        result = msg_q_snd((void*)loc_eng_context->deferred_q, msg, loc_eng_free_msg);
+    } else if (pthread_self() != loc_eng_context->deferred_action_thread) {
+        result = msg_q_snd_wait((void*)loc_eng_context->deferred_q, msg, loc_eng_free_msg);
+    } else {
+        // once one msg overflowed, the ones after it must follow it there
+        result = eMSG_Q_UNAVAILABLE_RESOURCE;
+        if (0 == loc_eng_context->overflow_pending) {
+            result = msg_q_snd((void*)loc_eng_context->deferred_q, msg, loc_eng_free_msg);
+        }
+        if (eMSG_Q_UNAVAILABLE_RESOURCE == result && NULL != loc_eng_context->overflow_q) {
+            result = msg_q_snd((void*)loc_eng_context->overflow_q, msg, loc_eng_free_msg);
+            if (eMSG_Q_SUCCESS == result) {
+                loc_eng_context->overflow_pending++;
+            }
+        }
+    }
+    if (eMSG_Q_SUCCESS != result) {
+        // the msg would otherwise leak
+        LOC_LOGE("loc_eng_msg_sender dropped msg %p", msg);
+        loc_eng_free_msg(msg);
+    }
 }
 
-static void* loc_eng_create_msg_q()
+// ring_size of 0 selects the unbounded list backed queue; only that one
+// can coalesce
+static void* loc_eng_create_msg_q(unsigned long ring_size,
+                                  msg_q_lane_type (*lane_func)(void*),
+                                  msg_q_coalesce_type (*coalesce_func)(void*, msg_q_coalesce_key_type*))
 {
     void* q = NULL;
-    if (eMSG_Q_SUCCESS != msg_q_init(&q)) {
+    msg_q_backend_type backend = ring_size ? eMSG_Q_BACKEND_RING : eMSG_Q_BACKEND_LIST;
+    if (eMSG_Q_SUCCESS != msg_q_init2(&q, backend, ring_size)) {
         LOC_LOGE("loc_eng_create_msg_q Q init failed.");
         q = NULL;
+    } else {
+        msg_q_set_lane_func(q, lane_func);
+        if (0 == ring_size) {
+            msg_q_set_coalesce_func(q, coalesce_func);
+        } else if (NULL != coalesce_func) {
+            // a backlog of reports is then worked off one by one
+            LOC_LOGW("%s: DEFERRED_Q_RING_SIZE=%lu, queued reports are not coalesced",
+                     __func__, ring_size);
+        }
     }
     return q;
 }
 
+// Picks the deferred_q lane of a msg. Messages only keep their relative
+// order within a lane, so anything whose order matters to another msg
+// must share its lane; e.g. position mode / start / stop, aiding data
+// deletion and injection around them, or a fix and the session status
+// that follows it.
+static msg_q_lane_type loc_eng_msg_lane(void* msg)
+{
+    switch (((loc_eng_msg*)msg)->msgid) {
+    // report floods from the modem
+    case LOC_ENG_MSG_REPORT_POSITION:
+    case LOC_ENG_MSG_REPORT_SV:
+    case LOC_ENG_MSG_REPORT_STATUS:
+    case LOC_ENG_MSG_REPORT_NMEA:
+    // behind the reports whose sentences it delivers
+    case LOC_ENG_MSG_FLUSH_NMEA:
+        return eMSG_Q_LANE_LOW;
+
+    // modem requests for assistance and context; nothing the framework
+    // sends depends on their order
+    case LOC_ENG_MSG_REQUEST_XTRA_DATA:
+    case LOC_ENG_MSG_REQUEST_TIME:
+    case LOC_ENG_MSG_REQUEST_POSITION:
+    case LOC_ENG_MSG_REQUEST_PHONE_CONTEXT:
+    case LOC_ENG_MSG_REQUEST_NETWORK_POSIITON:
+        return eMSG_Q_LANE_NORMAL;
+
+    // session control, aiding data deletion and injection (delete then
+    // start must cold start), AGPS data calls, NI and configuration
+    default:
+        return eMSG_Q_LANE_HIGH;
+    }
+}
+
+// Lets a newer SV report, or a newer final fix, take the place of one the
+// deferred action thread has not gotten to yet. Session status must not be
+// overtaken, and neither may intermediate / failed fixes, since a single
+// shot session ends on the first good fix it reports. A fix builds its
+// GSA / GGA from the SV report before it, which therefore goes with it.
+static msg_q_coalesce_type loc_eng_msg_coalesce(void* msg, msg_q_coalesce_key_type* key)
+{
+    loc_eng_msg* engMsg = (loc_eng_msg*)msg;
+    key->owner = engMsg->owner;
+    key->id = engMsg->msgid;
+    key->needs_id = -1;
+
+    switch (engMsg->msgid) {
+    case LOC_ENG_MSG_REPORT_SV:
+        return eMSG_Q_COALESCE_REPLACE;
+
+    case LOC_ENG_MSG_REPORT_POSITION:
+    {
+        loc_eng_msg_report_position *rpMsg = (loc_eng_msg_report_position*)msg;
+        // rawData is only released by the handler, so it has to run
+        if (LOC_SESS_SUCCESS == rpMsg->status && NULL == rpMsg->location.rawData) {
+            key->needs_id = LOC_ENG_MSG_REPORT_SV;
+            return eMSG_Q_COALESCE_REPLACE;
+        }
+        return eMSG_Q_COALESCE_BARRIER;
+    }
+
+    case LOC_ENG_MSG_REPORT_STATUS:
+        return eMSG_Q_COALESCE_BARRIER;
+
+    default:
+        return eMSG_Q_COALESCE_NONE;
+    }
+}
+
 static void loc_eng_free_msg(void* msg)
 {
     delete (loc_eng_msg*)msg;
 }
 
+static void loc_eng_free_msgs(void** msgs, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        loc_eng_free_msg(msgs[i]);
+    }
+}
+
 /*===========================================================================
 FUNCTION    loc_eng_init
 
@@ -299,6 +488,7 @@ int loc_eng_init(loc_eng_data_s_type &loc_eng_data, LocCallbacks* callbacks,
     loc_eng_data.acquire_wakelock_cb = callbacks->acquire_wakelock_cb;
     loc_eng_data.release_wakelock_cb = callbacks->release_wakelock_cb;
     loc_eng_data.request_utc_time_cb = callbacks->request_utc_time_cb;
+    loc_eng_data.nmea_burst_cb = callbacks->nmea_burst_cb;
     loc_eng_data.intermediateFix = gps_conf.INTERMEDIATE_POS;
 
     // initial states taken care of by the memset above
@@ -316,6 +506,10 @@ int loc_eng_init(loc_eng_data_s_type &loc_eng_data, LocCallbacks* callbacks,
         loc_eng_data.generateNmea = false;
     }
 
+    if ('\0' != gps_conf.TRACE_FILE[0] && !loc_eng_trace_recording()) {
+        LocApiAdapter::startRecording(gps_conf.TRACE_FILE);
+    }
+
     LocEng locEngHandle(&loc_eng_data, event, loc_eng_data.acquire_wakelock_cb,
                         loc_eng_data.release_wakelock_cb, loc_eng_msg_sender, loc_external_msg_sender,
                         callbacks->location_ext_parser, callbacks->sv_ext_parser);
@@ -353,18 +547,15 @@ static int loc_eng_reinit(loc_eng_data_s_type &loc_eng_data)
 
         loc_eng_msg_suple_version *supl_msg(new loc_eng_msg_suple_version(&loc_eng_data,
                                                                           gps_conf.SUPL_VER));
-        msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-                  supl_msg, loc_eng_free_msg);
+        loc_eng_msg_sender(&loc_eng_data, supl_msg);
 
         loc_eng_msg_lpp_config *lpp_msg(new loc_eng_msg_lpp_config(&loc_eng_data,
                                                                           gps_conf.LPP_PROFILE));
-        msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-                  lpp_msg, loc_eng_free_msg);
+        loc_eng_msg_sender(&loc_eng_data, lpp_msg);
 
         loc_eng_msg_sensor_control_config *sensor_control_config_msg(
             new loc_eng_msg_sensor_control_config(&loc_eng_data, gps_conf.SENSOR_USAGE));
-        msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-                  sensor_control_config_msg, loc_eng_free_msg);
+        loc_eng_msg_sender(&loc_eng_data, sensor_control_config_msg);
 
         /* Make sure at least one of the sensor property is specified by the user in the gps.conf file. */
         if( gps_conf.GYRO_BIAS_RANDOM_WALK_VALID ||
@@ -385,8 +576,7 @@ static int loc_eng_reinit(loc_eng_data_s_type &loc_eng_data)
                                                    gps_conf.RATE_RANDOM_WALK_SPECTRAL_DENSITY,
                                                    gps_conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY_VALID,
                                                    gps_conf.VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY));
-            msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-                      sensor_properties_msg, loc_eng_free_msg);
+            loc_eng_msg_sender(&loc_eng_data, sensor_properties_msg);
         }
 
         loc_eng_msg_sensor_perf_control_config *sensor_perf_control_conf_msg(
@@ -401,8 +591,7 @@ static int loc_eng_reinit(loc_eng_data_s_type &loc_eng_data)
                                                        gps_conf.SENSOR_GYRO_SAMPLES_PER_BATCH_HIGH,
                                                        gps_conf.SENSOR_GYRO_BATCHES_PER_SEC_HIGH,
                                                        gps_conf.SENSOR_ALGORITHM_CONFIG_MASK));
-        msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-                  sensor_perf_control_conf_msg, loc_eng_free_msg);
+        loc_eng_msg_sender(&loc_eng_data, sensor_perf_control_conf_msg);
     }
 
     EXIT_LOG(%d, ret_val);
@@ -450,6 +639,13 @@ void loc_eng_cleanup(loc_eng_data_s_type &loc_eng_data)
         loc_eng_stop(loc_eng_data);
     }
 
+    // reports that came in after the stop may have left sentences behind
+    if (NULL != loc_eng_data.nmea_burst_cb)
+    {
+        loc_eng_msg *msg(new loc_eng_msg(&loc_eng_data, LOC_ENG_MSG_FLUSH_NMEA));
+        loc_eng_msg_sender(&loc_eng_data, msg);
+    }
+
 #if 0 // can't afford to actually clean up, for many reason.
 
     ((LocEngContext*)(loc_eng_data.context))->drop();
@@ -517,8 +713,7 @@ int loc_eng_start(loc_eng_data_s_type &loc_eng_data)
    }else
    {
        loc_eng_msg *msg(new loc_eng_msg(&loc_eng_data, LOC_ENG_MSG_START_FIX));
-       msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-                 msg, loc_eng_free_msg);
+       loc_eng_msg_sender(&loc_eng_data, msg);
    }
    EXIT_LOG(%d, 0);
    return 0;
@@ -574,8 +769,7 @@ int loc_eng_stop(loc_eng_data_s_type &loc_eng_data)
     }else
     {
         loc_eng_msg *msg(new loc_eng_msg(&loc_eng_data, LOC_ENG_MSG_STOP_FIX));
-        msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-                  msg, loc_eng_free_msg);
+        loc_eng_msg_sender(&loc_eng_data, msg);
     }
 
     EXIT_LOG(%d, 0);
@@ -587,6 +781,9 @@ static int loc_eng_stop_handler(loc_eng_data_s_type &loc_eng_data)
    ENTRY_LOG();
    int ret_val = LOC_API_ADAPTER_ERR_SUCCESS;
 
+   // the last fix's sentences go out before its session ends
+   loc_eng_nmea_flush(&loc_eng_data);
+
    if (loc_eng_data.client_handle->isInSession()) {
 
        ret_val = loc_eng_data.client_handle->stopFix();
@@ -648,8 +845,7 @@ int loc_eng_set_position_mode(loc_eng_data_s_type &loc_eng_data,
     INIT_CHECK(loc_eng_data.context, return -1);
     loc_eng_msg_position_mode *msg(
         new loc_eng_msg_position_mode(&loc_eng_data, params));
-    msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-              msg, loc_eng_free_msg);
+    loc_eng_msg_sender(&loc_eng_data, msg);
 
     EXIT_LOG(%d, 0);
     return 0;
@@ -681,8 +877,7 @@ int loc_eng_inject_time(loc_eng_data_s_type &loc_eng_data, GpsUtcTime time,
                                  time,
                                  timeReference,
                                  uncertainty));
-    msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-              msg, loc_eng_free_msg);
+    loc_eng_msg_sender(&loc_eng_data, msg);
     EXIT_LOG(%d, 0);
     return 0;
 }
@@ -714,8 +909,7 @@ int loc_eng_inject_location(loc_eng_data_s_type &loc_eng_data, double latitude,
                                         latitude,
                                         longitude,
                                         accuracy));
-    msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-              msg, loc_eng_free_msg);
+    loc_eng_msg_sender(&loc_eng_data, msg);
 
     EXIT_LOG(%d, 0);
     return 0;
@@ -750,8 +944,7 @@ void loc_eng_delete_aiding_data(loc_eng_data_s_type &loc_eng_data, GpsAidingData
     loc_eng_msg_delete_aiding_data *msg(
         new loc_eng_msg_delete_aiding_data(&loc_eng_data,
                                            f));
-    msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-              msg, loc_eng_free_msg);
+    loc_eng_msg_sender(&loc_eng_data, msg);
 
     EXIT_LOG(%s, VOID_RET);
 }
@@ -917,8 +1110,7 @@ int loc_eng_agps_open(loc_eng_data_s_type &loc_eng_data, AGpsType agpsType,
     loc_eng_msg_atl_open_success *msg(
         new loc_eng_msg_atl_open_success(&loc_eng_data, agpsType, apn,
                                         apn_len, bearerType));
-    msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-              msg, loc_eng_free_msg);
+    loc_eng_msg_sender(&loc_eng_data, msg);
 
     EXIT_LOG(%d, 0);
     return 0;
@@ -948,8 +1140,7 @@ int loc_eng_agps_closed(loc_eng_data_s_type &loc_eng_data, AGpsType agpsType)
                return -1);
 
     loc_eng_msg_atl_closed *msg(new loc_eng_msg_atl_closed(&loc_eng_data, agpsType));
-    msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-              msg, loc_eng_free_msg);
+    loc_eng_msg_sender(&loc_eng_data, msg);
 
     EXIT_LOG(%d, 0);
     return 0;
@@ -979,8 +1170,7 @@ int loc_eng_agps_open_failed(loc_eng_data_s_type &loc_eng_data, AGpsType agpsTyp
                return -1);
 
     loc_eng_msg_atl_open_failed *msg(new loc_eng_msg_atl_open_failed(&loc_eng_data, agpsType));
-    msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-              msg, loc_eng_free_msg);
+    loc_eng_msg_sender(&loc_eng_data, msg);
 
     EXIT_LOG(%d, 0);
     return 0;
@@ -1059,8 +1249,7 @@ static int loc_eng_set_server(loc_eng_data_s_type &loc_eng_data,
         if (sizeof(url) > len) {
             loc_eng_msg_set_server_url *msg(new loc_eng_msg_set_server_url(&loc_eng_data,
                                                                            url, len));
-            msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-                      msg, loc_eng_free_msg);
+            loc_eng_msg_sender(&loc_eng_data, msg);
         }
     } else if (LOC_AGPS_CDMA_PDE_SERVER == type ||
                LOC_AGPS_CUSTOM_PDE_SERVER == type ||
@@ -1076,8 +1265,7 @@ static int loc_eng_set_server(loc_eng_data_s_type &loc_eng_data,
                                                                              ip,
                                                                              port,
                                                                              type));
-            msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-                      msg, loc_eng_free_msg);
+            loc_eng_msg_sender(&loc_eng_data, msg);
         }
     } else {
         LOC_LOGE("loc_eng_set_server, type %d cannot be resolved.\n", type);
@@ -1169,8 +1357,7 @@ void loc_eng_agps_ril_update_network_availability(loc_eng_data_s_type &loc_eng_d
         int apn_len = smaller_of(strlen (apn), MAX_APN_LEN);
         loc_eng_msg_set_data_enable *msg(new loc_eng_msg_set_data_enable(&loc_eng_data, apn,
                                                                          apn_len, available));
-        msg_q_snd((void*)((LocEngContext*)(loc_eng_data.context))->deferred_q,
-                  msg, loc_eng_free_msg);
+        loc_eng_msg_sender(&loc_eng_data, msg);
     }
     EXIT_LOG(%s, VOID_RET);
 }
@@ -1194,6 +1381,14 @@ SIDE EFFECTS
 static void loc_eng_report_status (loc_eng_data_s_type &loc_eng_data, GpsStatusValue status)
 {
     ENTRY_LOG();
+    // a held back burst belongs to the session or engine run this ends, or
+    // to the one before the one this begins
+    if (status == GPS_STATUS_SESSION_BEGIN || status == GPS_STATUS_SESSION_END ||
+        status == GPS_STATUS_ENGINE_ON || status == GPS_STATUS_ENGINE_OFF)
+    {
+        loc_eng_nmea_flush(&loc_eng_data);
+    }
+
     // Switch from WAIT to MUTE, for "engine on" or "session begin" event
     if (status == GPS_STATUS_SESSION_BEGIN || status == GPS_STATUS_ENGINE_ON)
     {
@@ -1294,10 +1489,11 @@ void loc_eng_handle_engine_up(loc_eng_data_s_type &loc_eng_data)
 }
 
 /*===========================================================================
-FUNCTION loc_eng_deferred_action_thread
+FUNCTION loc_eng_handle_*_msg
 
 DESCRIPTION
-   Main routine for the thread to execute loc_eng commands.
+   Default handlers of the messages taken off deferred_q, one per msgid,
+   run by loc_eng_deferred_action_thread through the dispatch table below.
 
 DEPENDENCIES
    None
@@ -1309,520 +1505,810 @@ SIDE EFFECTS
    N/A
 
 ===========================================================================*/
-static void loc_eng_deferred_action_thread(void* arg)
+static void loc_eng_handle_request_ni_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
 {
-    ENTRY_LOG();
-    loc_eng_msg *msg;
-    static int cnt = 0;
-    LocEngContext* context = (LocEngContext*)arg;
+    loc_eng_msg_request_ni *niMsg = (loc_eng_msg_request_ni*)msg;
+    loc_eng_ni_request_handler(*loc_eng_data_p, &niMsg->notify, niMsg->passThroughData);
+}
 
-    // make sure we do not run in background scheduling group
-    set_sched_policy(gettid(), SP_FOREGROUND);
+static void loc_eng_handle_inform_ni_response_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    loc_eng_msg_inform_ni_response *nrMsg = (loc_eng_msg_inform_ni_response*)msg;
+    loc_eng_data_p->client_handle->informNiResponse(nrMsg->response,
+                                                    nrMsg->passThroughData);
+}
 
-    while (1)
+static void loc_eng_handle_start_fix_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    loc_eng_start_handler(*loc_eng_data_p);
+}
+
+static void loc_eng_handle_stop_fix_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    if (loc_eng_data_p->agps_request_pending)
     {
-        LOC_LOGD("%s:%d] %d listening ...\n", __func__, __LINE__, cnt++);
+        // the fix is over for the framework, even if the modem is not yet
+        loc_eng_nmea_flush(loc_eng_data_p);
+        loc_eng_data_p->stop_request_pending = true;
+        LOC_LOGD("loc_eng_stop - deferring stop until AGPS data call is finished\n");
+    } else {
+        loc_eng_stop_handler(*loc_eng_data_p);
+    }
+}
 
-        // we are only sending / receiving msg pointers
-        msq_q_err_type result = msg_q_rcv((void*)context->deferred_q, (void **) &msg);
-        if (eMSG_Q_SUCCESS != result) {
-            LOC_LOGE("%s:%d] fail receiving msg: %s\n", __func__, __LINE__,
-                     loc_get_msg_q_status(result));
-            return;
-        }
+static void loc_eng_handle_set_position_mode_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    loc_eng_msg_position_mode *pmMsg = (loc_eng_msg_position_mode*)msg;
+    loc_eng_data_p->client_handle->setPositionMode(&(pmMsg->pMode));
+}
 
-        loc_eng_data_s_type* loc_eng_data_p = (loc_eng_data_s_type*)msg->owner;
+static void loc_eng_handle_set_time_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    loc_eng_msg_set_time *tMsg = (loc_eng_msg_set_time*)msg;
+    loc_eng_data_p->client_handle->setTime(tMsg->time, tMsg->timeReference,
+                                           tMsg->uncertainty);
+}
 
-        LOC_LOGD("%s:%d] received msg_id = %s context = %p\n",
-                 __func__, __LINE__, loc_get_msg_name(msg->msgid), loc_eng_data_p->context);
+static void loc_eng_handle_inject_location_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    loc_eng_msg_inject_location *ilMsg = (loc_eng_msg_inject_location*) msg;
+    loc_eng_data_p->client_handle->injectPosition(ilMsg->latitude, ilMsg->longitude,
+                                                  ilMsg->accuracy);
+}
 
-        // need to ensure the instance data is valid
-        STATE_CHECK(NULL != loc_eng_data_p->context,
-                    "instance cleanup happened",
-                    delete msg; return);
+static void loc_eng_handle_set_server_ipv4_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    loc_eng_msg_set_server_ipv4 *ssiMsg = (loc_eng_msg_set_server_ipv4*)msg;
+    loc_eng_data_p->client_handle->setServer(ssiMsg->nl_addr,
+                                             ssiMsg->port,
+                                             ssiMsg->serverType);
+}
 
-        switch(msg->msgid) {
-        case LOC_ENG_MSG_QUIT:
-        {
-            LocEngContext* context = (LocEngContext*)loc_eng_data_p->context;
-            pthread_mutex_lock(&(context->lock));
-            pthread_cond_signal(&(context->cond));
-            pthread_mutex_unlock(&(context->lock));
-            EXIT_LOG(%s, "LOC_ENG_MSG_QUIT, signal the main thread and return");
-        }
-        return;
+static void loc_eng_handle_set_server_url_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    loc_eng_msg_set_server_url *ssuMsg = (loc_eng_msg_set_server_url*)msg;
+    loc_eng_data_p->client_handle->setServer(ssuMsg->url, ssuMsg->len);
+}
 
-        case LOC_ENG_MSG_REQUEST_NI:
-        {
-            loc_eng_msg_request_ni *niMsg = (loc_eng_msg_request_ni*)msg;
-            loc_eng_ni_request_handler(*loc_eng_data_p, &niMsg->notify, niMsg->passThroughData);
-        }
-        break;
+static void loc_eng_handle_supl_version_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    loc_eng_msg_suple_version *svMsg = (loc_eng_msg_suple_version*)msg;
+    loc_eng_data_p->client_handle->setSUPLVersion(svMsg->supl_version);
+}
 
-        case LOC_ENG_MSG_INFORM_NI_RESPONSE:
-        {
-            loc_eng_msg_inform_ni_response *nrMsg = (loc_eng_msg_inform_ni_response*)msg;
-            loc_eng_data_p->client_handle->informNiResponse(nrMsg->response,
-                                                            nrMsg->passThroughData);
-        }
-        break;
+static void loc_eng_handle_lpp_config_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    loc_eng_msg_lpp_config *svMsg = (loc_eng_msg_lpp_config*)msg;
+    loc_eng_data_p->client_handle->setLPPConfig(svMsg->lpp_config);
+}
 
-        case LOC_ENG_MSG_START_FIX:
-            loc_eng_start_handler(*loc_eng_data_p);
-            break;
+static void loc_eng_handle_set_sensor_control_config_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    loc_eng_msg_sensor_control_config *sccMsg = (loc_eng_msg_sensor_control_config*)msg;
+    loc_eng_data_p->client_handle->setSensorControlConfig(sccMsg->sensorsDisabled);
+}
 
-        case LOC_ENG_MSG_STOP_FIX:
-            if (loc_eng_data_p->agps_request_pending)
-            {
-                loc_eng_data_p->stop_request_pending = true;
-                LOC_LOGD("loc_eng_stop - deferring stop until AGPS data call is finished\n");
-            } else {
-                loc_eng_stop_handler(*loc_eng_data_p);
-            }
-            break;
+static void loc_eng_handle_set_sensor_properties_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    loc_eng_msg_sensor_properties *spMsg = (loc_eng_msg_sensor_properties*)msg;
+    loc_eng_data_p->client_handle->setSensorProperties(spMsg->gyroBiasVarianceRandomWalk_valid,
+                                                       spMsg->gyroBiasVarianceRandomWalk,
+                                                       spMsg->accelRandomWalk_valid,
+                                                       spMsg->accelRandomWalk,
+                                                       spMsg->angleRandomWalk_valid,
+                                                       spMsg->angleRandomWalk,
+                                                       spMsg->rateRandomWalk_valid,
+                                                       spMsg->rateRandomWalk,
+                                                       spMsg->velocityRandomWalk_valid,
+                                                       spMsg->velocityRandomWalk);
+}
 
-        case LOC_ENG_MSG_SET_POSITION_MODE:
-        {
-            loc_eng_msg_position_mode *pmMsg = (loc_eng_msg_position_mode*)msg;
-            loc_eng_data_p->client_handle->setPositionMode(&(pmMsg->pMode));
-        }
-        break;
+static void loc_eng_handle_set_sensor_perf_control_config_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    loc_eng_msg_sensor_perf_control_config *spccMsg = (loc_eng_msg_sensor_perf_control_config*)msg;
+    loc_eng_data_p->client_handle->setSensorPerfControlConfig(spccMsg->controlMode, spccMsg->accelSamplesPerBatch, spccMsg->accelBatchesPerSec,
+                                                              spccMsg->gyroSamplesPerBatch, spccMsg->gyroBatchesPerSec,
+                                                              spccMsg->accelSamplesPerBatchHigh, spccMsg->accelBatchesPerSecHigh,
+                                                              spccMsg->gyroSamplesPerBatchHigh, spccMsg->gyroBatchesPerSecHigh,
+                                                              spccMsg->algorithmConfig);
+}
 
-        case LOC_ENG_MSG_SET_TIME:
-        {
-            loc_eng_msg_set_time *tMsg = (loc_eng_msg_set_time*)msg;
-            loc_eng_data_p->client_handle->setTime(tMsg->time, tMsg->timeReference,
-                                                   tMsg->uncertainty);
-        }
-        break;
+static void loc_eng_handle_ext_power_config_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    loc_eng_msg_ext_power_config *pwrMsg = (loc_eng_msg_ext_power_config*)msg;
+    loc_eng_data_p->client_handle->setExtPowerConfig(pwrMsg->isBatteryCharging);
+}
 
-        case LOC_ENG_MSG_INJECT_LOCATION:
-        {
-            loc_eng_msg_inject_location *ilMsg = (loc_eng_msg_inject_location*) msg;
-            loc_eng_data_p->client_handle->injectPosition(ilMsg->latitude, ilMsg->longitude,
-                                                          ilMsg->accuracy);
-        }
-        break;
+// Deletes a report copy along with the rawData it owns; the dealloc of
+// report_q, so copies still queued at cleanup do not leak it either
+static void loc_eng_free_report(void* msg)
+{
+    loc_eng_msg* engMsg = (loc_eng_msg*)msg;
+    if (LOC_ENG_MSG_REPORT_POSITION == engMsg->msgid) {
+        GpsLocation* gp = (GpsLocation*)&(((loc_eng_msg_report_position*)engMsg)->location);
+        delete (char*)gp->rawData;
+    }
+    delete engMsg;
+}
 
-        case LOC_ENG_MSG_SET_SERVER_IPV4:
-        {
-            loc_eng_msg_set_server_ipv4 *ssiMsg = (loc_eng_msg_set_server_ipv4*)msg;
-            loc_eng_data_p->client_handle->setServer(ssiMsg->nl_addr,
-                                                     ssiMsg->port,
-                                                     ssiMsg->serverType);
+// Runs the framework callback of a position, SV or NMEA report.
+static void loc_eng_msg_deliver(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    switch (msg->msgid) {
+    case LOC_ENG_MSG_REPORT_POSITION:
+    {
+        loc_eng_msg_report_position *rpMsg = (loc_eng_msg_report_position*)msg;
+        if (LOC_SESS_FAILURE == rpMsg->status) {
+            loc_eng_data_p->location_cb(NULL, NULL);
+        } else {
+            loc_eng_data_p->location_cb((GpsLocation*)&(rpMsg->location),
+                                        (void*)rpMsg->locationExt);
         }
         break;
+    }
+    case LOC_ENG_MSG_REPORT_SV:
+    {
+        loc_eng_msg_report_sv *rsMsg = (loc_eng_msg_report_sv*)msg;
+        loc_eng_data_p->sv_status_cb((GpsSvStatus*)&(rsMsg->svStatus),
+                                     (void*)rsMsg->svExt);
+        break;
+    }
+    case LOC_ENG_MSG_REPORT_NMEA:
+    {
+        loc_eng_msg_report_nmea* nmMsg = (loc_eng_msg_report_nmea*)msg;
+        int64_t now = loc_get_realtime_ms();
+        CALLBACK_LOG_CALLFLOW("nmea_cb", %p, nmMsg->nmea);
+        loc_eng_data_p->nmea_cb(now, nmMsg->nmea, nmMsg->length);
+        break;
+    }
+    default:
+        LOC_LOGE("%s: msg_id = %s has no callback", __func__, loc_get_msg_name(msg->msgid));
+        break;
+    }
+}
 
-        case LOC_ENG_MSG_SET_SERVER_URL:
-        {
-            loc_eng_msg_set_server_url *ssuMsg = (loc_eng_msg_set_server_url*)msg;
-            loc_eng_data_p->client_handle->setServer(ssuMsg->url, ssuMsg->len);
+/*===========================================================================
+FUNCTION    loc_eng_deliver_report
+
+DESCRIPTION
+   Gets the framework callback of a position, SV or NMEA report run. The
+   caller keeps msg. Without REPORT_THREAD the callback runs right away.
+   With it, the report action thread runs the callback off a copy of msg,
+   so a slow callback does not hold up deferred_q. Everything else about a
+   report, session state, single shot completion, NMEA generation, stays
+   with the caller on the deferred action thread.
+
+DEPENDENCIES
+   Must be called on the deferred action thread.
+
+RETURN VALUE
+   N/A
+
+SIDE EFFECTS
+   The rawData of a position report moves to the copy.
+
+===========================================================================*/
+void loc_eng_deliver_report(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    LocEngContext* context = (LocEngContext*)loc_eng_data_p->context;
+    if (NULL == context->report_q) {
+        loc_eng_msg_deliver(loc_eng_data_p, msg);
+        return;
+    }
+
+    loc_eng_msg* copy = NULL;
+    switch (msg->msgid) {
+    case LOC_ENG_MSG_REPORT_POSITION:
+    {
+        loc_eng_msg_report_position *rpMsg = (loc_eng_msg_report_position*)msg;
+        copy = new loc_eng_msg_report_position(*rpMsg);
+        if (NULL != copy) {
+            // freed by the report action thread once location_cb returned
+            GpsLocation* gp = (GpsLocation*)&(rpMsg->location);
+            gp->rawData = NULL;
+            gp->rawDataSize = 0;
         }
         break;
+    }
+    case LOC_ENG_MSG_REPORT_SV:
+        copy = new loc_eng_msg_report_sv(*(loc_eng_msg_report_sv*)msg);
+        break;
+    case LOC_ENG_MSG_REPORT_NMEA:
+        copy = new loc_eng_msg_report_nmea(loc_eng_data_p,
+                                           ((loc_eng_msg_report_nmea*)msg)->buf);
+        break;
+    default:
+        LOC_LOGE("%s: msg_id = %s has no callback", __func__, loc_get_msg_name(msg->msgid));
+        return;
+    }
 
-        case LOC_ENG_MSG_SUPL_VERSION:
-        {
-            loc_eng_msg_suple_version *svMsg = (loc_eng_msg_suple_version*)msg;
-            loc_eng_data_p->client_handle->setSUPLVersion(svMsg->supl_version);
+    if (NULL == copy) {
+        LOC_LOGE("%s: no memory for msg_id = %s", __func__, loc_get_msg_name(msg->msgid));
+    } else if (eMSG_Q_SUCCESS != msg_q_snd((void*)context->report_q, copy, loc_eng_free_report)) {
+        LOC_LOGE("%s: dropped msg_id = %s", __func__, loc_get_msg_name(msg->msgid));
+        loc_eng_free_report(copy);
+    }
+}
+
+static void loc_eng_handle_report_position_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    if (loc_eng_data_p->mute_session_state != LOC_MUTE_SESS_IN_SESSION)
+    {
+        bool reported = false;
+        loc_eng_msg_report_position *rpMsg = (loc_eng_msg_report_position*)msg;
+        if (loc_eng_data_p->location_cb != NULL) {
+            if (LOC_SESS_FAILURE == rpMsg->status) {
+                // in case we want to handle the failure case
+                loc_eng_deliver_report(loc_eng_data_p, msg);
+                reported = true;
+            }
+            // what's in the else if is... (line by line)
+            // 1. this is a good fix; or
+            //   1.1 there is source info; or
+            //   1.1.1 this is from hybrid provider;
+            //   1.2 it is a Satellite fix; or
+            //   1.2.1 it is a sensor fix
+            // 2. (must be intermediate fix... implicit)
+            //   2.1 we accepte intermediate; and
+            //   2.2 it is NOT the case that
+            //   2.2.1 there is inaccuracy; and
+            //   2.2.2 we care about inaccuracy; and
+            //   2.2.3 the inaccuracy exceeds our tolerance
+            else if ((LOC_SESS_SUCCESS == rpMsg->status &&
+                      (((LOCATION_HAS_SOURCE_INFO & rpMsg->location.flags) &&
+                        ULP_LOCATION_IS_FROM_HYBRID == rpMsg->location.position_source) ||
+                       ((LOC_POS_TECH_MASK_SATELLITE & rpMsg->technology_mask) ||
+                        (LOC_POS_TECH_MASK_SENSORS & rpMsg->technology_mask)))) ||
+                     (LOC_SESS_INTERMEDIATE == loc_eng_data_p->intermediateFix &&
+                      !((rpMsg->location.flags & GPS_LOCATION_HAS_ACCURACY) &&
+                        (gps_conf.ACCURACY_THRES != 0) &&
+                        (rpMsg->location.accuracy > gps_conf.ACCURACY_THRES)))) {
+                loc_eng_deliver_report(loc_eng_data_p, msg);
+                reported = true;
+            }
         }
-        break;
 
-        case LOC_ENG_MSG_LPP_CONFIG:
-        {
-            loc_eng_msg_lpp_config *svMsg = (loc_eng_msg_lpp_config*)msg;
-            loc_eng_data_p->client_handle->setLPPConfig(svMsg->lpp_config);
+        // if we have reported this fix
+        if (reported &&
+            // and if this is a singleshot
+            GPS_POSITION_RECURRENCE_SINGLE ==
+            loc_eng_data_p->client_handle->getPositionMode().recurrence) {
+            if (LOC_SESS_INTERMEDIATE == rpMsg->status) {
+                // modem could be still working for a final fix,
+                // although we no longer need it.  So stopFix().
+                loc_eng_data_p->client_handle->stopFix();
+            }
+            // turn off the session flag.
+            loc_eng_data_p->client_handle->setInSession(false);
         }
-        break;
 
-        case LOC_ENG_MSG_SET_SENSOR_CONTROL_CONFIG:
+        if (loc_eng_data_p->generateNmea && rpMsg->location.position_source == ULP_LOCATION_IS_FROM_GNSS)
         {
-            loc_eng_msg_sensor_control_config *sccMsg = (loc_eng_msg_sensor_control_config*)msg;
-            loc_eng_data_p->client_handle->setSensorControlConfig(sccMsg->sensorsDisabled);
+            loc_eng_nmea_generate_pos(loc_eng_data_p, rpMsg->location, rpMsg->locationExtended);
         }
-        break;
 
-        case LOC_ENG_MSG_SET_SENSOR_PROPERTIES:
+        // Free the allocated memory for rawData
+        GpsLocation* gp = (GpsLocation*)&(rpMsg->location);
+        if (gp != NULL && gp->rawData != NULL)
         {
-            loc_eng_msg_sensor_properties *spMsg = (loc_eng_msg_sensor_properties*)msg;
-            loc_eng_data_p->client_handle->setSensorProperties(spMsg->gyroBiasVarianceRandomWalk_valid,
-                                                               spMsg->gyroBiasVarianceRandomWalk,
-                                                               spMsg->accelRandomWalk_valid,
-                                                               spMsg->accelRandomWalk,
-                                                               spMsg->angleRandomWalk_valid,
-                                                               spMsg->angleRandomWalk,
-                                                               spMsg->rateRandomWalk_valid,
-                                                               spMsg->rateRandomWalk,
-                                                               spMsg->velocityRandomWalk_valid,
-                                                               spMsg->velocityRandomWalk);
+            delete (char*)gp->rawData;
+            gp->rawData = NULL;
+            gp->rawDataSize = 0;
         }
-        break;
+    }
+}
 
-        case LOC_ENG_MSG_SET_SENSOR_PERF_CONTROL_CONFIG:
-        {
-            loc_eng_msg_sensor_perf_control_config *spccMsg = (loc_eng_msg_sensor_perf_control_config*)msg;
-            loc_eng_data_p->client_handle->setSensorPerfControlConfig(spccMsg->controlMode, spccMsg->accelSamplesPerBatch, spccMsg->accelBatchesPerSec,
-                                                                      spccMsg->gyroSamplesPerBatch, spccMsg->gyroBatchesPerSec,
-                                                                      spccMsg->accelSamplesPerBatchHigh, spccMsg->accelBatchesPerSecHigh,
-                                                                      spccMsg->gyroSamplesPerBatchHigh, spccMsg->gyroBatchesPerSecHigh,
-                                                                      spccMsg->algorithmConfig);
+static void loc_eng_handle_report_sv_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    if (loc_eng_data_p->mute_session_state != LOC_MUTE_SESS_IN_SESSION)
+    {
+        loc_eng_msg_report_sv *rsMsg = (loc_eng_msg_report_sv*)msg;
+        if (loc_eng_data_p->sv_status_cb != NULL) {
+            loc_eng_deliver_report(loc_eng_data_p, msg);
         }
-        break;
 
-        case LOC_ENG_MSG_EXT_POWER_CONFIG:
+        if (loc_eng_data_p->generateNmea)
         {
-            loc_eng_msg_ext_power_config *pwrMsg = (loc_eng_msg_ext_power_config*)msg;
-            loc_eng_data_p->client_handle->setExtPowerConfig(pwrMsg->isBatteryCharging);
+            loc_eng_nmea_generate_sv(loc_eng_data_p, rsMsg->svStatus, rsMsg->locationExtended,
+                                     rsMsg->gloUsedInFixMask);
         }
-        break;
 
-        case LOC_ENG_MSG_REPORT_POSITION:
-            if (loc_eng_data_p->mute_session_state != LOC_MUTE_SESS_IN_SESSION)
-            {
-                bool reported = false;
-                loc_eng_msg_report_position *rpMsg = (loc_eng_msg_report_position*)msg;
-                if (loc_eng_data_p->location_cb != NULL) {
-                    if (LOC_SESS_FAILURE == rpMsg->status) {
-                        // in case we want to handle the failure case
-                        loc_eng_data_p->location_cb(NULL, NULL);
-                        reported = true;
-                    }
-                    // what's in the else if is... (line by line)
-                    // 1. this is a good fix; or
-                    //   1.1 there is source info; or
-                    //   1.1.1 this is from hybrid provider;
-                    //   1.2 it is a Satellite fix; or
-                    //   1.2.1 it is a sensor fix
-                    // 2. (must be intermediate fix... implicit)
-                    //   2.1 we accepte intermediate; and
-                    //   2.2 it is NOT the case that
-                    //   2.2.1 there is inaccuracy; and
-                    //   2.2.2 we care about inaccuracy; and
-                    //   2.2.3 the inaccuracy exceeds our tolerance
-                    else if ((LOC_SESS_SUCCESS == rpMsg->status &&
-                              (((LOCATION_HAS_SOURCE_INFO & rpMsg->location.flags) &&
-                                ULP_LOCATION_IS_FROM_HYBRID == rpMsg->location.position_source) ||
-                               ((LOC_POS_TECH_MASK_SATELLITE & rpMsg->technology_mask) ||
-                                (LOC_POS_TECH_MASK_SENSORS & rpMsg->technology_mask)))) ||
-                             (LOC_SESS_INTERMEDIATE == loc_eng_data_p->intermediateFix &&
-                              !((rpMsg->location.flags & GPS_LOCATION_HAS_ACCURACY) &&
-                                (gps_conf.ACCURACY_THRES != 0) &&
-                                (rpMsg->location.accuracy > gps_conf.ACCURACY_THRES)))) {
-                        loc_eng_data_p->location_cb((GpsLocation*)&(rpMsg->location),
-                                                    (void*)rpMsg->locationExt);
-                        reported = true;
-                    }
-                }
+    }
+}
 
-                // if we have reported this fix
-                if (reported &&
-                    // and if this is a singleshot
-                    GPS_POSITION_RECURRENCE_SINGLE ==
-                    loc_eng_data_p->client_handle->getPositionMode().recurrence) {
-                    if (LOC_SESS_INTERMEDIATE == rpMsg->status) {
-                        // modem could be still working for a final fix,
-                        // although we no longer need it.  So stopFix().
-                        loc_eng_data_p->client_handle->stopFix();
-                    }
-                    // turn off the session flag.
-                    loc_eng_data_p->client_handle->setInSession(false);
-                }
+static void loc_eng_handle_report_status_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    loc_eng_report_status(*loc_eng_data_p, ((loc_eng_msg_report_status*)msg)->status);
+}
 
-                if (loc_eng_data_p->generateNmea && rpMsg->location.position_source == ULP_LOCATION_IS_FROM_GNSS)
-                {
-                    loc_eng_nmea_generate_pos(loc_eng_data_p, rpMsg->location, rpMsg->locationExtended);
-                }
+static void loc_eng_handle_report_nmea_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    if (NULL != loc_eng_data_p->nmea_cb &&
+        NULL != ((loc_eng_msg_report_nmea*)msg)->nmea) {
+        loc_eng_deliver_report(loc_eng_data_p, msg);
+    }
+}
 
-                // Free the allocated memory for rawData
-                GpsLocation* gp = (GpsLocation*)&(rpMsg->location);
-                if (gp != NULL && gp->rawData != NULL)
-                {
-                    delete (char*)gp->rawData;
-                    gp->rawData = NULL;
-                    gp->rawDataSize = 0;
-                }
-            }
+static void loc_eng_handle_request_bit_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    AgpsStateMachine* stateMachine;
+    loc_eng_msg_request_bit* brqMsg = (loc_eng_msg_request_bit*)msg;
+    if (brqMsg->ifType == LOC_ENG_IF_REQUEST_TYPE_SUPL) {
+        stateMachine = loc_eng_data_p->agnss_nif;
+    } else if (brqMsg->ifType == LOC_ENG_IF_REQUEST_TYPE_ANY) {
+        stateMachine = loc_eng_data_p->internet_nif;
+    } else {
+        LOC_LOGD("%s]%d: unknown I/F request type = 0x%x\n", __func__, __LINE__, brqMsg->ifType);
+        return;
+    }
+    BITSubscriber subscriber(stateMachine, brqMsg->ipv4Addr, brqMsg->ipv6Addr);
 
-            break;
+    stateMachine->subscribeRsrc((Subscriber*)&subscriber);
+}
 
-        case LOC_ENG_MSG_REPORT_SV:
-            if (loc_eng_data_p->mute_session_state != LOC_MUTE_SESS_IN_SESSION)
-            {
-                loc_eng_msg_report_sv *rsMsg = (loc_eng_msg_report_sv*)msg;
-                if (loc_eng_data_p->sv_status_cb != NULL) {
-                    loc_eng_data_p->sv_status_cb((GpsSvStatus*)&(rsMsg->svStatus),
-                                                 (void*)rsMsg->svExt);
-                }
+static void loc_eng_handle_release_bit_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    AgpsStateMachine* stateMachine;
+    loc_eng_msg_release_bit* brlMsg = (loc_eng_msg_release_bit*)msg;
+    if (brlMsg->ifType == LOC_ENG_IF_REQUEST_TYPE_SUPL) {
+        stateMachine = loc_eng_data_p->agnss_nif;
+    } else if (brlMsg->ifType == LOC_ENG_IF_REQUEST_TYPE_ANY) {
+        stateMachine = loc_eng_data_p->internet_nif;
+    } else {
+        LOC_LOGD("%s]%d: unknown I/F request type = 0x%x\n", __func__, __LINE__, brlMsg->ifType);
+        return;
+    }
+    BITSubscriber subscriber(stateMachine, brlMsg->ipv4Addr, brlMsg->ipv6Addr);
 
-                if (loc_eng_data_p->generateNmea)
-                {
-                    loc_eng_nmea_generate_sv(loc_eng_data_p, rsMsg->svStatus, rsMsg->locationExtended);
-                }
+    stateMachine->unsubscribeRsrc((Subscriber*)&subscriber);
+}
 
-            }
-            break;
+static void loc_eng_handle_request_atl_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    loc_eng_msg_request_atl* arqMsg = (loc_eng_msg_request_atl*)msg;
+    boolean backwardCompatibleMode = AGPS_TYPE_INVALID == arqMsg->type;
+    AgpsStateMachine* stateMachine = (AGPS_TYPE_SUPL == arqMsg->type ||
+                                      backwardCompatibleMode) ?
+                                     loc_eng_data_p->agnss_nif :
+                                     loc_eng_data_p->internet_nif;
+    ATLSubscriber subscriber(arqMsg->handle,
+                             stateMachine,
+                             loc_eng_data_p->client_handle,
+                             backwardCompatibleMode);
 
-        case LOC_ENG_MSG_REPORT_STATUS:
-            loc_eng_report_status(*loc_eng_data_p, ((loc_eng_msg_report_status*)msg)->status);
-            break;
+    stateMachine->subscribeRsrc((Subscriber*)&subscriber);
+}
 
-        case LOC_ENG_MSG_REPORT_NMEA:
-            if (NULL != loc_eng_data_p->nmea_cb) {
-                loc_eng_msg_report_nmea* nmMsg = (loc_eng_msg_report_nmea*)msg;
-                struct timeval tv;
-                gettimeofday(&tv, (struct timezone *) NULL);
-                int64_t now = tv.tv_sec * 1000LL + tv.tv_usec / 1000;
-                CALLBACK_LOG_CALLFLOW("nmea_cb", %p, nmMsg->nmea);
-                loc_eng_data_p->nmea_cb(now, nmMsg->nmea, nmMsg->length);
-            }
-            break;
+static void loc_eng_handle_release_atl_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    loc_eng_msg_release_atl* arlMsg = (loc_eng_msg_release_atl*)msg;
+    ATLSubscriber s1(arlMsg->handle,
+                     loc_eng_data_p->agnss_nif,
+                     loc_eng_data_p->client_handle,
+                     false);
+    // attempt to unsubscribe from agnss_nif first
+    if (! loc_eng_data_p->agnss_nif->unsubscribeRsrc((Subscriber*)&s1)) {
+        ATLSubscriber s2(arlMsg->handle,
+                         loc_eng_data_p->internet_nif,
+                         loc_eng_data_p->client_handle,
+                         false);
+        // if unsuccessful, try internet_nif
+        loc_eng_data_p->internet_nif->unsubscribeRsrc((Subscriber*)&s2);
+    }
+}
 
-        case LOC_ENG_MSG_REQUEST_BIT:
-        {
-            AgpsStateMachine* stateMachine;
-            loc_eng_msg_request_bit* brqMsg = (loc_eng_msg_request_bit*)msg;
-            if (brqMsg->ifType == LOC_ENG_IF_REQUEST_TYPE_SUPL) {
-                stateMachine = loc_eng_data_p->agnss_nif;
-            } else if (brqMsg->ifType == LOC_ENG_IF_REQUEST_TYPE_ANY) {
-                stateMachine = loc_eng_data_p->internet_nif;
-            } else {
-                LOC_LOGD("%s]%d: unknown I/F request type = 0x%x\n", __func__, __LINE__, brqMsg->ifType);
-                break;
-            }
-            BITSubscriber subscriber(stateMachine, brqMsg->ipv4Addr, brqMsg->ipv6Addr);
+static void loc_eng_handle_request_wifi_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    loc_eng_msg_request_wifi *wrqMsg = (loc_eng_msg_request_wifi *)msg;
+    if (wrqMsg->senderId == LOC_ENG_IF_REQUEST_SENDER_ID_QUIPC ||
+        wrqMsg->senderId == LOC_ENG_IF_REQUEST_SENDER_ID_MSAPM) {
+      AgpsStateMachine* stateMachine = loc_eng_data_p->wifi_nif;
+      WIFISubscriber subscriber(stateMachine, wrqMsg->ssid, wrqMsg->password, wrqMsg->senderId);
+      stateMachine->subscribeRsrc((Subscriber*)&subscriber);
+    } else {
+      LOC_LOGE("%s]%d ERROR: unknown sender ID", __func__, __LINE__);
+    }
+}
 
-            stateMachine->subscribeRsrc((Subscriber*)&subscriber);
-        }
-        break;
+static void loc_eng_handle_release_wifi_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    AgpsStateMachine* stateMachine = loc_eng_data_p->wifi_nif;
+    loc_eng_msg_release_wifi* wrlMsg = (loc_eng_msg_release_wifi*)msg;
+    WIFISubscriber subscriber(stateMachine, wrlMsg->ssid, wrlMsg->password, wrlMsg->senderId);
+    stateMachine->unsubscribeRsrc((Subscriber*)&subscriber);
+}
 
-        case LOC_ENG_MSG_RELEASE_BIT:
-        {
-            AgpsStateMachine* stateMachine;
-            loc_eng_msg_release_bit* brlMsg = (loc_eng_msg_release_bit*)msg;
-            if (brlMsg->ifType == LOC_ENG_IF_REQUEST_TYPE_SUPL) {
-                stateMachine = loc_eng_data_p->agnss_nif;
-            } else if (brlMsg->ifType == LOC_ENG_IF_REQUEST_TYPE_ANY) {
-                stateMachine = loc_eng_data_p->internet_nif;
-            } else {
-                LOC_LOGD("%s]%d: unknown I/F request type = 0x%x\n", __func__, __LINE__, brlMsg->ifType);
-                break;
-            }
-            BITSubscriber subscriber(stateMachine, brlMsg->ipv4Addr, brlMsg->ipv6Addr);
+static void loc_eng_handle_request_xtra_data_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    if (loc_eng_data_p->xtra_module_data.download_request_cb != NULL)
+    {
+        loc_eng_data_p->xtra_module_data.download_request_cb();
+    }
+}
 
-            stateMachine->unsubscribeRsrc((Subscriber*)&subscriber);
-        }
-        break;
+static void loc_eng_handle_request_time_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    if (loc_eng_data_p->request_utc_time_cb != NULL)
+    {
+        loc_eng_data_p->request_utc_time_cb();
+    }
+    else
+    {
+        LOC_LOGE("%s] ERROR: Callback function for request_time is NULL", __func__);
+    }
+}
 
-        case LOC_ENG_MSG_REQUEST_ATL:
-        {
-            loc_eng_msg_request_atl* arqMsg = (loc_eng_msg_request_atl*)msg;
-            boolean backwardCompatibleMode = AGPS_TYPE_INVALID == arqMsg->type;
-            AgpsStateMachine* stateMachine = (AGPS_TYPE_SUPL == arqMsg->type ||
-                                              backwardCompatibleMode) ?
-                                             loc_eng_data_p->agnss_nif :
-                                             loc_eng_data_p->internet_nif;
-            ATLSubscriber subscriber(arqMsg->handle,
-                                     stateMachine,
-                                     loc_eng_data_p->client_handle,
-                                     backwardCompatibleMode);
-
-            stateMachine->subscribeRsrc((Subscriber*)&subscriber);
-        }
-        break;
+static void loc_eng_handle_request_position_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    // accepted, but nothing to do
+}
 
-        case LOC_ENG_MSG_RELEASE_ATL:
-        {
-            loc_eng_msg_release_atl* arlMsg = (loc_eng_msg_release_atl*)msg;
-            ATLSubscriber s1(arlMsg->handle,
-                             loc_eng_data_p->agnss_nif,
-                             loc_eng_data_p->client_handle,
-                             false);
-            // attempt to unsubscribe from agnss_nif first
-            if (! loc_eng_data_p->agnss_nif->unsubscribeRsrc((Subscriber*)&s1)) {
-                ATLSubscriber s2(arlMsg->handle,
-                                 loc_eng_data_p->internet_nif,
-                                 loc_eng_data_p->client_handle,
-                                 false);
-                // if unsuccessful, try internet_nif
-                loc_eng_data_p->internet_nif->unsubscribeRsrc((Subscriber*)&s2);
-            }
-        }
+static void loc_eng_handle_delete_aiding_data_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    loc_eng_data_p->aiding_data_for_deletion |= ((loc_eng_msg_delete_aiding_data*)msg)->type;
+}
+
+static void loc_eng_handle_enable_data_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    loc_eng_msg_set_data_enable *unaMsg = (loc_eng_msg_set_data_enable*)msg;
+    loc_eng_data_p->client_handle->enableData(unaMsg->enable);
+    loc_eng_data_p->client_handle->setAPN(unaMsg->apn, unaMsg->length);
+}
+
+static void loc_eng_handle_inject_xtra_data_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    loc_eng_msg_inject_xtra_data *xdMsg = (loc_eng_msg_inject_xtra_data*)msg;
+    // the buffer for the copy could not be allocated
+    if (NULL == xdMsg->data) {
+        LOC_LOGE("%s: no XTRA data to inject", __func__);
+        return;
+    }
+    loc_eng_data_p->client_handle->setXtraData(xdMsg->data, xdMsg->length);
+}
+
+static void loc_eng_handle_atl_open_success_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    loc_eng_msg_atl_open_success *aosMsg = (loc_eng_msg_atl_open_success*)msg;
+    AgpsStateMachine* stateMachine;
+    switch (aosMsg->agpsType) {
+      case AGPS_TYPE_WIFI: {
+        stateMachine = loc_eng_data_p->wifi_nif;
+        break;
+      }
+      case AGPS_TYPE_SUPL: {
+        stateMachine = loc_eng_data_p->agnss_nif;
         break;
+      }
+      default: {
+        stateMachine  = loc_eng_data_p->internet_nif;
+      }
+    }
 
-        case LOC_ENG_MSG_REQUEST_WIFI:
-        {
-            loc_eng_msg_request_wifi *wrqMsg = (loc_eng_msg_request_wifi *)msg;
-            if (wrqMsg->senderId == LOC_ENG_IF_REQUEST_SENDER_ID_QUIPC ||
-                wrqMsg->senderId == LOC_ENG_IF_REQUEST_SENDER_ID_MSAPM) {
-              AgpsStateMachine* stateMachine = loc_eng_data_p->wifi_nif;
-              WIFISubscriber subscriber(stateMachine, wrqMsg->ssid, wrqMsg->password, wrqMsg->senderId);
-              stateMachine->subscribeRsrc((Subscriber*)&subscriber);
-            } else {
-              LOC_LOGE("%s]%d ERROR: unknown sender ID", __func__, __LINE__);
-              break;
-            }
-        }
+    stateMachine->setBearer(aosMsg->bearerType);
+    stateMachine->setAPN(aosMsg->apn, aosMsg->length);
+    stateMachine->onRsrcEvent(RSRC_GRANTED);
+}
+
+static void loc_eng_handle_atl_closed_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    loc_eng_msg_atl_closed *acsMsg = (loc_eng_msg_atl_closed*)msg;
+    AgpsStateMachine* stateMachine;
+    switch (acsMsg->agpsType) {
+      case AGPS_TYPE_WIFI: {
+        stateMachine = loc_eng_data_p->wifi_nif;
         break;
+      }
+      case AGPS_TYPE_SUPL: {
+        stateMachine = loc_eng_data_p->agnss_nif;
+        break;
+      }
+      default: {
+        stateMachine  = loc_eng_data_p->internet_nif;
+      }
+    }
 
-        case LOC_ENG_MSG_RELEASE_WIFI:
-        {
-            AgpsStateMachine* stateMachine = loc_eng_data_p->wifi_nif;
-            loc_eng_msg_release_wifi* wrlMsg = (loc_eng_msg_release_wifi*)msg;
-            WIFISubscriber subscriber(stateMachine, wrlMsg->ssid, wrlMsg->password, wrlMsg->senderId);
-            stateMachine->unsubscribeRsrc((Subscriber*)&subscriber);
-        }
+    stateMachine->onRsrcEvent(RSRC_RELEASED);
+}
+
+static void loc_eng_handle_atl_open_failed_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    loc_eng_msg_atl_open_failed *aofMsg = (loc_eng_msg_atl_open_failed*)msg;
+    AgpsStateMachine* stateMachine;
+    switch (aofMsg->agpsType) {
+      case AGPS_TYPE_WIFI: {
+        stateMachine = loc_eng_data_p->wifi_nif;
         break;
+      }
+      case AGPS_TYPE_SUPL: {
+        stateMachine = loc_eng_data_p->agnss_nif;
+        break;
+      }
+      default: {
+        stateMachine  = loc_eng_data_p->internet_nif;
+      }
+    }
 
-        case LOC_ENG_MSG_REQUEST_XTRA_DATA:
-            if (loc_eng_data_p->xtra_module_data.download_request_cb != NULL)
-            {
-                loc_eng_data_p->xtra_module_data.download_request_cb();
-            }
-            break;
+    stateMachine->onRsrcEvent(RSRC_DENIED);
+}
 
-        case LOC_ENG_MSG_REQUEST_TIME:
-            if (loc_eng_data_p->request_utc_time_cb != NULL)
-            {
-                loc_eng_data_p->request_utc_time_cb();
-            }
-            else
-            {
-                LOC_LOGE("%s] ERROR: Callback function for request_time is NULL", __func__);
-            }
-            break;
+static void loc_eng_handle_engine_down_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    loc_eng_handle_engine_down(*loc_eng_data_p);
+}
 
-        case LOC_ENG_MSG_REQUEST_POSITION:
-            break;
+static void loc_eng_handle_engine_up_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    loc_eng_handle_engine_up(*loc_eng_data_p);
+}
 
-        case LOC_ENG_MSG_DELETE_AIDING_DATA:
-            loc_eng_data_p->aiding_data_for_deletion |= ((loc_eng_msg_delete_aiding_data*)msg)->type;
-            break;
+static void loc_eng_handle_request_network_posiiton_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    loc_eng_msg_request_network_position *nlprequestmsg = (loc_eng_msg_request_network_position*)msg;
+    //loc_eng_handle_request_network_position(nlprequestmsg );
+    LOC_LOGD("Received n/w position request from ULP.Request type %d Periodicity: %d\n",
+             nlprequestmsg->networkPosRequest.request_type,
+              nlprequestmsg->networkPosRequest.interval_ms);
+    if(loc_eng_data_p->ulp_network_callback != NULL)
+    {
+        loc_eng_data_p->ulp_network_callback((UlpNetworkRequestPos*)&(nlprequestmsg->networkPosRequest));
+    }
+    else
+        LOC_LOGE("Ulp Network call back not initialized");
+}
 
-        case LOC_ENG_MSG_ENABLE_DATA:
-        {
-            loc_eng_msg_set_data_enable *unaMsg = (loc_eng_msg_set_data_enable*)msg;
-            loc_eng_data_p->client_handle->enableData(unaMsg->enable);
-            loc_eng_data_p->client_handle->setAPN(unaMsg->apn, unaMsg->length);
-        }
-        break;
+static void loc_eng_handle_request_phone_context_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    loc_eng_msg_request_phone_context *contextReqMsg = (loc_eng_msg_request_phone_context*)msg;
+    LOC_LOGD("Received phone context request from ULP.context_type 0x%x,request_type 0x%x  ",
+             contextReqMsg->contextRequest.context_type,contextReqMsg->contextRequest.request_type);
+    if(loc_eng_data_p->ulp_phone_context_req_cb != NULL)
+    {
+        loc_eng_data_p->ulp_phone_context_req_cb((UlpPhoneContextRequest*)&(contextReqMsg->contextRequest));
+    }
+    else
+        LOC_LOGE("Ulp Phone context request call back not initialized");
+}
 
-        case LOC_ENG_MSG_INJECT_XTRA_DATA:
-        {
-            loc_eng_msg_inject_xtra_data *xdMsg = (loc_eng_msg_inject_xtra_data*)msg;
-            loc_eng_data_p->client_handle->setXtraData(xdMsg->data, xdMsg->length);
-        }
-        break;
+static void loc_eng_handle_flush_nmea_msg(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    loc_eng_nmea_flush(loc_eng_data_p);
+}
 
-        case LOC_ENG_MSG_ATL_OPEN_SUCCESS:
-        {
-            loc_eng_msg_atl_open_success *aosMsg = (loc_eng_msg_atl_open_success*)msg;
-            AgpsStateMachine* stateMachine;
-            switch (aosMsg->agpsType) {
-              case AGPS_TYPE_WIFI: {
-                stateMachine = loc_eng_data_p->wifi_nif;
-                break;
-              }
-              case AGPS_TYPE_SUPL: {
-                stateMachine = loc_eng_data_p->agnss_nif;
-                break;
-              }
-              default: {
-                stateMachine  = loc_eng_data_p->internet_nif;
-              }
-            }
+// Dispatch table entry of one msgid
+struct loc_eng_msg_dispatch_entry {
+    loc_eng_msg_handler handler;
+    bool enabled;
+};
 
-            stateMachine->setBearer(aosMsg->bearerType);
-            stateMachine->setAPN(aosMsg->apn, aosMsg->length);
-            stateMachine->onRsrcEvent(RSRC_GRANTED);
-        }
-        break;
+// Indexed by msgid - LOC_ENG_MSG_QUIT. The ULP range goes to ulp_q, so
+// only the msgids after ULP_MSG_LAST get a second table.
+static loc_eng_msg_dispatch_entry
+    loc_eng_msg_handlers[LOC_ENG_MSG_REQUEST_NETWORK_POSIITON - LOC_ENG_MSG_QUIT + 1];
+static loc_eng_msg_dispatch_entry
+    loc_eng_ext_msg_handlers[LOC_ENG_MSG_FLUSH_NMEA - ULP_MSG_LAST];
+static pthread_once_t loc_eng_msg_handlers_once = PTHREAD_ONCE_INIT;
+static loc_eng_msg_timing_hook loc_eng_msg_timing = loc_eng_stats_record;
+
+static const struct {
+    int msgid;
+    loc_eng_msg_handler handler;
+} loc_eng_default_msg_handlers[] = {
+    { LOC_ENG_MSG_REQUEST_NI, loc_eng_handle_request_ni_msg },
+    { LOC_ENG_MSG_INFORM_NI_RESPONSE, loc_eng_handle_inform_ni_response_msg },
+    { LOC_ENG_MSG_START_FIX, loc_eng_handle_start_fix_msg },
+    { LOC_ENG_MSG_STOP_FIX, loc_eng_handle_stop_fix_msg },
+    { LOC_ENG_MSG_SET_POSITION_MODE, loc_eng_handle_set_position_mode_msg },
+    { LOC_ENG_MSG_SET_TIME, loc_eng_handle_set_time_msg },
+    { LOC_ENG_MSG_INJECT_LOCATION, loc_eng_handle_inject_location_msg },
+    { LOC_ENG_MSG_SET_SERVER_IPV4, loc_eng_handle_set_server_ipv4_msg },
+    { LOC_ENG_MSG_SET_SERVER_URL, loc_eng_handle_set_server_url_msg },
+    { LOC_ENG_MSG_SUPL_VERSION, loc_eng_handle_supl_version_msg },
+    { LOC_ENG_MSG_LPP_CONFIG, loc_eng_handle_lpp_config_msg },
+    { LOC_ENG_MSG_SET_SENSOR_CONTROL_CONFIG, loc_eng_handle_set_sensor_control_config_msg },
+    { LOC_ENG_MSG_SET_SENSOR_PROPERTIES, loc_eng_handle_set_sensor_properties_msg },
+    { LOC_ENG_MSG_SET_SENSOR_PERF_CONTROL_CONFIG, loc_eng_handle_set_sensor_perf_control_config_msg },
+    { LOC_ENG_MSG_EXT_POWER_CONFIG, loc_eng_handle_ext_power_config_msg },
+    { LOC_ENG_MSG_REPORT_POSITION, loc_eng_handle_report_position_msg },
+    { LOC_ENG_MSG_REPORT_SV, loc_eng_handle_report_sv_msg },
+    { LOC_ENG_MSG_REPORT_STATUS, loc_eng_handle_report_status_msg },
+    { LOC_ENG_MSG_REPORT_NMEA, loc_eng_handle_report_nmea_msg },
+    { LOC_ENG_MSG_REQUEST_BIT, loc_eng_handle_request_bit_msg },
+    { LOC_ENG_MSG_RELEASE_BIT, loc_eng_handle_release_bit_msg },
+    { LOC_ENG_MSG_REQUEST_ATL, loc_eng_handle_request_atl_msg },
+    { LOC_ENG_MSG_RELEASE_ATL, loc_eng_handle_release_atl_msg },
+    { LOC_ENG_MSG_REQUEST_WIFI, loc_eng_handle_request_wifi_msg },
+    { LOC_ENG_MSG_RELEASE_WIFI, loc_eng_handle_release_wifi_msg },
+    { LOC_ENG_MSG_REQUEST_XTRA_DATA, loc_eng_handle_request_xtra_data_msg },
+    { LOC_ENG_MSG_REQUEST_TIME, loc_eng_handle_request_time_msg },
+    { LOC_ENG_MSG_REQUEST_POSITION, loc_eng_handle_request_position_msg },
+    { LOC_ENG_MSG_DELETE_AIDING_DATA, loc_eng_handle_delete_aiding_data_msg },
+    { LOC_ENG_MSG_ENABLE_DATA, loc_eng_handle_enable_data_msg },
+    { LOC_ENG_MSG_INJECT_XTRA_DATA, loc_eng_handle_inject_xtra_data_msg },
+    { LOC_ENG_MSG_ATL_OPEN_SUCCESS, loc_eng_handle_atl_open_success_msg },
+    { LOC_ENG_MSG_ATL_CLOSED, loc_eng_handle_atl_closed_msg },
+    { LOC_ENG_MSG_ATL_OPEN_FAILED, loc_eng_handle_atl_open_failed_msg },
+    { LOC_ENG_MSG_ENGINE_DOWN, loc_eng_handle_engine_down_msg },
+    { LOC_ENG_MSG_ENGINE_UP, loc_eng_handle_engine_up_msg },
+    { LOC_ENG_MSG_REQUEST_NETWORK_POSIITON, loc_eng_handle_request_network_posiiton_msg },
+    { LOC_ENG_MSG_REQUEST_PHONE_CONTEXT, loc_eng_handle_request_phone_context_msg },
+    { LOC_ENG_MSG_FLUSH_NMEA, loc_eng_handle_flush_nmea_msg },
+};
 
-        case LOC_ENG_MSG_ATL_CLOSED:
-        {
-            loc_eng_msg_atl_closed *acsMsg = (loc_eng_msg_atl_closed*)msg;
-            AgpsStateMachine* stateMachine;
-            switch (acsMsg->agpsType) {
-              case AGPS_TYPE_WIFI: {
-                stateMachine = loc_eng_data_p->wifi_nif;
-                break;
-              }
-              case AGPS_TYPE_SUPL: {
-                stateMachine = loc_eng_data_p->agnss_nif;
-                break;
-              }
-              default: {
-                stateMachine  = loc_eng_data_p->internet_nif;
-              }
-            }
+// QUIT ends the deferred action thread itself, so it has no entry
+static loc_eng_msg_dispatch_entry* loc_eng_msg_dispatch_entry_of(int msgid)
+{
+    if (msgid > LOC_ENG_MSG_QUIT && msgid <= LOC_ENG_MSG_REQUEST_NETWORK_POSIITON) {
+        return &loc_eng_msg_handlers[msgid - LOC_ENG_MSG_QUIT];
+    }
+    if (msgid > ULP_MSG_LAST && msgid <= LOC_ENG_MSG_FLUSH_NMEA) {
+        return &loc_eng_ext_msg_handlers[msgid - ULP_MSG_LAST - 1];
+    }
+    return NULL;
+}
 
-            stateMachine->onRsrcEvent(RSRC_RELEASED);
-        }
-        break;
+static void loc_eng_register_default_msg_handlers()
+{
+    for (unsigned int i = 0;
+         i < sizeof(loc_eng_default_msg_handlers) / sizeof(loc_eng_default_msg_handlers[0]);
+         i++) {
+        loc_eng_msg_dispatch_entry* entry =
+            loc_eng_msg_dispatch_entry_of(loc_eng_default_msg_handlers[i].msgid);
+        entry->handler = loc_eng_default_msg_handlers[i].handler;
+        entry->enabled = true;
+    }
+}
 
-        case LOC_ENG_MSG_ATL_OPEN_FAILED:
-        {
-            loc_eng_msg_atl_open_failed *aofMsg = (loc_eng_msg_atl_open_failed*)msg;
-            AgpsStateMachine* stateMachine;
-            switch (aofMsg->agpsType) {
-              case AGPS_TYPE_WIFI: {
-                stateMachine = loc_eng_data_p->wifi_nif;
-                break;
-              }
-              case AGPS_TYPE_SUPL: {
-                stateMachine = loc_eng_data_p->agnss_nif;
-                break;
-              }
-              default: {
-                stateMachine  = loc_eng_data_p->internet_nif;
-              }
-            }
+loc_eng_msg_handler loc_eng_register_msg_handler(int msgid,
+                                                 loc_eng_msg_handler handler)
+{
+    pthread_once(&loc_eng_msg_handlers_once, loc_eng_register_default_msg_handlers);
 
-            stateMachine->onRsrcEvent(RSRC_DENIED);
-        }
-        break;
+    loc_eng_msg_dispatch_entry* entry = loc_eng_msg_dispatch_entry_of(msgid);
+    if (NULL == entry) {
+        LOC_LOGE("%s: unsupported msgid = %d\n", __func__, msgid);
+        return NULL;
+    }
 
-        case LOC_ENG_MSG_ENGINE_DOWN:
-            loc_eng_handle_engine_down(*loc_eng_data_p);
-            break;
+    loc_eng_msg_handler old = entry->handler;
+    entry->handler = handler;
+    entry->enabled = true;
+    return old;
+}
 
-        case LOC_ENG_MSG_ENGINE_UP:
-            loc_eng_handle_engine_up(*loc_eng_data_p);
-            break;
+int loc_eng_enable_msg_handler(int msgid, bool enable)
+{
+    pthread_once(&loc_eng_msg_handlers_once, loc_eng_register_default_msg_handlers);
 
-        case LOC_ENG_MSG_REQUEST_NETWORK_POSIITON:
-        {
-            loc_eng_msg_request_network_position *nlprequestmsg = (loc_eng_msg_request_network_position*)msg;
-            //loc_eng_handle_request_network_position(nlprequestmsg );
-            LOC_LOGD("Received n/w position request from ULP.Request type %d Periodicity: %d\n",
-                     nlprequestmsg->networkPosRequest.request_type,
-                      nlprequestmsg->networkPosRequest.interval_ms);
-            if(loc_eng_data_p->ulp_network_callback != NULL)
-            {
-                loc_eng_data_p->ulp_network_callback((UlpNetworkRequestPos*)&(nlprequestmsg->networkPosRequest));
+    loc_eng_msg_dispatch_entry* entry = loc_eng_msg_dispatch_entry_of(msgid);
+    if (NULL == entry || NULL == entry->handler) {
+        LOC_LOGE("%s: no handler for msgid = %d\n", __func__, msgid);
+        return -1;
+    }
+
+    entry->enabled = enable;
+    return 0;
+}
+
+void loc_eng_set_msg_timing_hook(loc_eng_msg_timing_hook hook)
+{
+    loc_eng_msg_timing = hook;
+}
+
+static void loc_eng_msg_dispatch(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg)
+{
+    loc_eng_msg_dispatch_entry* entry = loc_eng_msg_dispatch_entry_of(msg->msgid);
+    if (NULL == entry || NULL == entry->handler) {
+        LOC_LOGE("unsupported msgid = %d\n", msg->msgid);
+    } else if (entry->enabled) {
+        entry->handler(loc_eng_data_p, msg);
+    } else {
+        LOC_LOGD("%s: handler disabled for msg_id = %s\n",
+                 __func__, loc_get_msg_name(msg->msgid));
+    }
+}
+
+/*===========================================================================
+FUNCTION loc_eng_deferred_action_thread
+
+DESCRIPTION
+   Main routine for the thread to execute loc_eng commands. Messages are
+   taken off the queue in batches, so a burst of reports costs one lock
+   round trip instead of one per message, and handed to the handler
+   registered for their msgid. A batch holds a single lane; while working
+   through a lower lane batch the HIGH lane is polled before each message,
+   so a STOP_FIX never waits behind more than one report handler.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_deferred_action_thread(void* arg)
+{
+    ENTRY_LOG();
+    loc_eng_msg *msg;
+    loc_eng_msg *msgs[LOC_ENG_MSG_BATCH_SIZE];
+    uint64_t sentNs[LOC_ENG_MSG_BATCH_SIZE];
+    uint64_t msgSentNs = 0;
+    size_t count = 0, next = 0;
+    msg_q_lane_type batchLane = eMSG_Q_LANE_HIGH;
+    static int cnt = 0;
+    LocEngContext* context = (LocEngContext*)arg;
+    int64_t lastStatsLog = loc_eng_msg_time_us();
+
+    // make sure we do not run in background scheduling group
+    set_sched_policy(gettid(), SP_FOREGROUND);
+
+    pthread_once(&loc_eng_msg_handlers_once, loc_eng_register_default_msg_handlers);
+
+    while (1)
+    {
+        msg = NULL;
+        if (next == count && 0 != context->overflow_pending &&
+            eMSG_Q_SUCCESS == msg_q_try_rcv_lane((void*)context->overflow_q, (void **) msgs,
+                                                 eMSG_Q_LANE_NORMAL, sentNs)) {
+            // what we could not queue to ourselves comes before the next batch
+            context->overflow_pending--;
+            count = 1;
+            next = 0;
+            batchLane = eMSG_Q_LANE_HIGH;
+        } else if (next == count) {
+            LOC_LOGD("%s:%d] %d listening ...\n", __func__, __LINE__, cnt++);
+
+            // we are only sending / receiving msg pointers
+            msq_q_err_type result = msg_q_rcv_batch((void*)context->deferred_q, (void **) msgs,
+                                                    LOC_ENG_MSG_BATCH_SIZE, &count, sentNs);
+            if (eMSG_Q_SUCCESS != result) {
+                LOC_LOGE("%s:%d] fail receiving msg: %s\n", __func__, __LINE__,
+                         loc_get_msg_q_status(result));
+                return;
             }
-            else
-                LOC_LOGE("Ulp Network call back not initialized");
+            next = 0;
+            batchLane = loc_eng_msg_lane(msgs[0]);
+        } else if (eMSG_Q_LANE_HIGH != batchLane &&
+                   eMSG_Q_SUCCESS != msg_q_try_rcv_lane((void*)context->deferred_q,
+                                                        (void**)&msg, eMSG_Q_LANE_HIGH,
+                                                        &msgSentNs)) {
+            msg = NULL;
+        }
+        // a control message queued meanwhile goes ahead of the rest of the batch
+        if (NULL == msg) {
+            msgSentNs = sentNs[next];
+            msg = msgs[next++];
         }
-        break;
 
-        case LOC_ENG_MSG_REQUEST_PHONE_CONTEXT:
-        {
-            loc_eng_msg_request_phone_context *contextReqMsg = (loc_eng_msg_request_phone_context*)msg;
-            LOC_LOGD("Received phone context request from ULP.context_type 0x%x,request_type 0x%x  ",
-                     contextReqMsg->contextRequest.context_type,contextReqMsg->contextRequest.request_type)
-            if(loc_eng_data_p->ulp_phone_context_req_cb != NULL)
-            {
-                loc_eng_data_p->ulp_phone_context_req_cb((UlpPhoneContextRequest*)&(contextReqMsg->contextRequest));
-            }
-            else
-                LOC_LOGE("Ulp Phone context request call back not initialized");
-            }
-        break;
+        loc_eng_data_s_type* loc_eng_data_p = (loc_eng_data_s_type*)msg->owner;
 
-        default:
-            LOC_LOGE("unsupported msgid = %d\n", msg->msgid);
-            break;
+        LOC_LOGD("%s:%d] received msg_id = %s context = %p\n",
+                 __func__, __LINE__, loc_get_msg_name(msg->msgid), loc_eng_data_p->context);
+
+        // need to ensure the instance data is valid
+        STATE_CHECK(NULL != loc_eng_data_p->context,
+                    "instance cleanup happened",
+                    delete msg; loc_eng_free_msgs((void**)&msgs[next], count - next); return);
+
+        int64_t dequeueTime = loc_eng_msg_time_us();
+
+        if (LOC_ENG_MSG_QUIT == msg->msgid) {
+            // rest of the batch is off the q, msg_q_destroy() won't free it
+            loc_eng_free_msgs((void**)&msgs[next], count - next);
+            loc_eng_stats_dump();
+
+            LocEngContext* context = (LocEngContext*)loc_eng_data_p->context;
+            pthread_mutex_lock(&(context->lock));
+            pthread_cond_signal(&(context->cond));
+            pthread_mutex_unlock(&(context->lock));
+            EXIT_LOG(%s, "LOC_ENG_MSG_QUIT, signal the main thread and return");
+            return;
         }
 
+        loc_eng_msg_dispatch(loc_eng_data_p, msg);
+
         if ( (msg->msgid == LOC_ENG_MSG_ATL_OPEN_FAILED)  |
              (msg->msgid == LOC_ENG_MSG_ATL_CLOSED)  |
              (msg->msgid == LOC_ENG_MSG_ATL_OPEN_SUCCESS) )
@@ -1842,12 +2328,102 @@ static void loc_eng_deferred_action_thread(void* arg)
             loc_eng_data_p->aiding_data_for_deletion = 0;
         }
 
+        // find out which messages wait long and which handlers stall the q
+        int64_t handledTime = loc_eng_msg_time_us();
+        loc_eng_msg_timing_hook timing = loc_eng_msg_timing;
+        if (NULL != timing) {
+            // msg_q stamps each message with the same clock when it is queued
+            timing(msg->msgid, dequeueTime - (int64_t)(msgSentNs / 1000),
+                   handledTime - dequeueTime);
+        }
+        if (handledTime - lastStatsLog >= LOC_ENG_STATS_LOG_INTERVAL_SEC * 1000000LL) {
+            loc_eng_stats_log_summary((void*)context->deferred_q);
+            lastStatsLog = handledTime;
+        }
+
         delete msg;
     }
 
     EXIT_LOG(%s, VOID_RET);
 }
 
+/*===========================================================================
+FUNCTION loc_eng_report_action_thread
+
+DESCRIPTION
+   Main routine for the thread delivering reports to the framework, when
+   REPORT_THREAD is set. It only runs the location, SV and NMEA callbacks
+   of the report copies loc_eng_deliver_report queues on report_q; the
+   handlers and all the state they keep stay on the deferred action thread.
+
+DEPENDENCIES
+   None
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_eng_report_action_thread(void* arg)
+{
+    ENTRY_LOG();
+    loc_eng_msg *msg;
+    loc_eng_msg *msgs[LOC_ENG_MSG_BATCH_SIZE];
+    size_t count = 0, next = 0;
+    LocEngContext* context = (LocEngContext*)arg;
+
+    // make sure we do not run in background scheduling group
+    set_sched_policy(gettid(), SP_FOREGROUND);
+
+    while (1)
+    {
+        if (next == count) {
+            msq_q_err_type result = msg_q_rcv_batch((void*)context->report_q, (void **) msgs,
+                                                    LOC_ENG_MSG_BATCH_SIZE, &count, NULL);
+            if (eMSG_Q_SUCCESS != result) {
+                LOC_LOGE("%s:%d] fail receiving msg: %s\n", __func__, __LINE__,
+                         loc_get_msg_q_status(result));
+                return;
+            }
+            next = 0;
+        }
+        msg = msgs[next++];
+
+        // QUIT is owned by the context, not by an instance
+        if (LOC_ENG_MSG_QUIT == msg->msgid) {
+            delete msg;
+            for (; next < count; next++) {
+                loc_eng_free_report(msgs[next]);
+            }
+
+            pthread_mutex_lock(&(context->lock));
+            context->report_action_done = true;
+            pthread_cond_broadcast(&(context->cond));
+            pthread_mutex_unlock(&(context->lock));
+            EXIT_LOG(%s, "LOC_ENG_MSG_QUIT, signal the main thread and return");
+            return;
+        }
+
+        loc_eng_data_s_type* loc_eng_data_p = (loc_eng_data_s_type*)msg->owner;
+
+        // need to ensure the instance data is valid
+        if (NULL == loc_eng_data_p->context) {
+            LOC_LOGE("%s: instance cleanup happened, dropping msg_id = %s",
+                     __func__, loc_get_msg_name(msg->msgid));
+            loc_eng_free_report(msg);
+            continue;
+        }
+
+        loc_eng_msg_deliver(loc_eng_data_p, msg);
+
+        loc_eng_free_report(msg);
+    }
+
+    EXIT_LOG(%s, VOID_RET);
+}
+
 /*===========================================================================
 FUNCTION loc_eng_ulp_init
 
@@ -2008,7 +2584,7 @@ int loc_eng_ulp_phone_context_settings_update(loc_eng_data_s_type &loc_eng_data,
     if(settings->context_type & ULP_PHONE_CONTEXT_BATTERY_CHARGING_STATE)
     {
         loc_eng_msg_ext_power_config *msg(new loc_eng_msg_ext_power_config(&loc_eng_data, settings->is_battery_charging));
-        msg_q_snd( (void*)((LocEngContext*)(loc_eng_data.context))->deferred_q, msg, loc_eng_free_msg);
+        loc_eng_msg_sender(&loc_eng_data, msg);
     }
 
     EXIT_LOG(%d, ret_val);
@@ -83,7 +83,16 @@ struct LocEngContext {
     // Data variables used by deferred action thread
     const void* deferred_q;
     const void* ulp_q;
+    // Control messages the deferred action thread sends itself while a
+    // bounded deferred_q is full; NULL unless DEFERRED_Q_RING_SIZE is set
+    const void* overflow_q;
+    int overflow_pending;
+    // Data variables used by report action thread, NULL / 0 unless
+    // REPORT_THREAD is set in gps.conf
+    const void* report_q;
     const pthread_t deferred_action_thread;
+    const pthread_t report_action_thread;
+    bool report_action_done;
     static LocEngContext* get(gps_create_thread threadCreator);
     void drop();
     static pthread_mutex_t lock;
@@ -94,6 +103,14 @@ private:
     LocEngContext(gps_create_thread threadCreator);
 };
 
+// Room for the generated sentences of one fix, see loc_eng_nmea_send
+#define LOC_ENG_NMEA_BURST_SIZE 4096
+#define LOC_ENG_NMEA_BURST_MAX_SENTENCES 32
+
+// PRNs 1-32 are GPS, 33-64 SBAS and 65-96 GLONASS
+#define LOC_ENG_SV_USED_MASK_WORDS 3
+#define LOC_ENG_SV_USED_MASK_GLONASS 2
+
 // Module data
 typedef struct
 {
@@ -136,10 +153,25 @@ typedef struct
 
     // For nmea generation
     boolean generateNmea;
-    uint32_t sv_used_mask;
+    // SVs used in the fix, PRN n at bit (n - 1) % 32 of word (n - 1) / 32
+    uint32_t sv_used_mask[LOC_ENG_SV_USED_MASK_WORDS];
     float hdop;
     float pdop;
     float vdop;
+    // UTC time of the last fix, formatted for nmea generation
+    time_t nmea_utc_sec;
+    time_t nmea_utc_day;
+    char nmea_hhmmss[12];
+    char nmea_ddmmyy[12];
+    // Reports seen, for the NMEA_*_DIVIDER settings
+    uint32_t nmea_sv_epoch;
+    uint32_t nmea_pos_epoch;
+    // Sentences held back for nmea_burst_cb
+    loc_nmea_burst_cb nmea_burst_cb;
+    int nmea_burst_length;
+    int nmea_burst_count;
+    int nmea_burst_offsets[LOC_ENG_NMEA_BURST_MAX_SENTENCES];
+    char nmea_burst[LOC_ENG_NMEA_BURST_SIZE];
 
     // Address buffers, for addressing setting before init
     int    supl_host_set;
@@ -179,6 +211,15 @@ typedef struct loc_gps_cfg_s
   unsigned long  SENSOR_USAGE;
   unsigned long  QUIPC_ENABLED;
   unsigned long  LPP_PROFILE;
+  unsigned long  DEFERRED_Q_RING_SIZE;
+  unsigned long  REPORT_THREAD;
+  char           TRACE_FILE[LOC_MAX_PARAM_STRING + 1];
+  unsigned long  NMEA_SENTENCE_MASK;
+  unsigned long  NMEA_GSV_DIVIDER;
+  unsigned long  NMEA_GSA_DIVIDER;
+  unsigned long  NMEA_VTG_DIVIDER;
+  unsigned long  NMEA_RMC_DIVIDER;
+  unsigned long  NMEA_GGA_DIVIDER;
   unsigned long  SENSOR_ALGORITHM_CONFIG_MASK;
   uint8_t        ACCEL_RANDOM_WALK_SPECTRAL_DENSITY_VALID;
   double         ACCEL_RANDOM_WALK_SPECTRAL_DENSITY;
@@ -259,6 +300,28 @@ int loc_eng_ulp_phone_context_init(loc_eng_data_s_type &loc_eng_data,
 int loc_eng_ulp_send_network_position(loc_eng_data_s_type &loc_eng_data,
                                              UlpNetworkPositionReport *position_report);
 int loc_eng_read_config(void);
+
+// Handles one kind of message taken off deferred_q, on the deferred
+// action thread
+typedef void (*loc_eng_msg_handler)(loc_eng_data_s_type* loc_eng_data_p,
+                                    loc_eng_msg* msg);
+// Called on the deferred action thread after each message, with how long
+// it waited since msg_q_snd, in deferred_q or overflow_q, and how long its
+// handler took
+typedef void (*loc_eng_msg_timing_hook)(int msgid, int64_t queue_us,
+                                        int64_t handler_us);
+
+// Handlers are looked up by msgid, so a handler can be swapped, or one
+// kind of message turned off, without touching the others. Changes should
+// be made before messages of that kind are sent. The default handlers are
+// in place before the first change is made.
+loc_eng_msg_handler loc_eng_register_msg_handler(int msgid,
+                                                 loc_eng_msg_handler handler);
+int loc_eng_enable_msg_handler(int msgid, bool enable);
+void loc_eng_set_msg_timing_hook(loc_eng_msg_timing_hook hook);
+// Runs the framework callback of a position, SV or NMEA report, on the
+// report action thread when REPORT_THREAD is set; the caller keeps msg
+void loc_eng_deliver_report(loc_eng_data_s_type* loc_eng_data_p, loc_eng_msg* msg);
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -47,6 +47,14 @@ static void deleteObj(void* data)
     delete (Subscriber*)data;
 }
 
+// This is given to linked_list_set_hash() as the key hash callback.
+// Subscribers that equal each other always share the same ID.
+// data -- an instance of Subscriber
+static uint32_t hashSubscriber(void* data)
+{
+    return (uint32_t)((Subscriber*)data)->ID;
+}
+
 // This is given to linked_list_search() as the comparison callback
 // when the state manchine needs to process for particular subscriber
 // fromCaller -- caller provides this obj
@@ -562,6 +570,7 @@ AgpsStateMachine::AgpsStateMachine(void (*servicer)(AGpsStatus* status),
     mEnforceSingleSubscriber(enforceSingleSubscriber)
 {
     linked_list_init(&mSubscribers);
+    linked_list_set_hash(mSubscribers, hashSubscriber);
 
     // setting up mReleasedState
     mStatePtr->mPendingState = new AgpsPendingState(this);
@@ -643,7 +652,17 @@ void AgpsStateMachine::onRsrcEvent(AgpsRsrcStatus event)
 
 void AgpsStateMachine::notifySubscribers(Notification& notification) const
 {
-    if (notification.postNotifyDelete) {
+    if (NULL != notification.rcver) {
+        // only the addressed subscriber would act on this, so
+        // look it up through the hash index instead of the walk.
+        // Like the walk below, a removed subscriber is handed back
+        // rather than deleted, since the caller may still hold it.
+        Subscriber* s = NULL;
+        linked_list_search_hash(mSubscribers, (void**)&s, notifySubscriber,
+                                (void*)&notification,
+                                (uint32_t)notification.rcver->ID,
+                                notification.postNotifyDelete);
+    } else if (notification.postNotifyDelete) {
         // just any non NULL value to get started
         Subscriber* s = (Subscriber*)~0;
         while (NULL != s) {
@@ -667,8 +686,9 @@ void AgpsStateMachine::addSubscriber(Subscriber* subscriber) const
 {
     Subscriber* s = NULL;
     Notification notification((const Subscriber*)subscriber);
-    linked_list_search(mSubscribers, (void**)&s,
-                       hasSubscriber, (void*)&notification, false);
+    linked_list_search_hash(mSubscribers, (void**)&s,
+                            hasSubscriber, (void*)&notification,
+                            (uint32_t)subscriber->ID, false);
 
     if (NULL == s) {
         linked_list_add(mSubscribers, subscriber->clone(), deleteObj);
@@ -719,8 +739,9 @@ bool AgpsStateMachine::unsubscribeRsrc(Subscriber *subscriber)
 {
     Subscriber* s = NULL;
     Notification notification((const Subscriber*)subscriber);
-    linked_list_search(mSubscribers, (void**)&s,
-                       hasSubscriber, (void*)&notification, false);
+    linked_list_search_hash(mSubscribers, (void**)&s,
+                            hasSubscriber, (void*)&notification,
+                            (uint32_t)subscriber->ID, false);
 
     if (NULL != s) {
         mStatePtr = mStatePtr->onRsrcEvent(RSRC_UNSUBSCRIBE, (void*)s);
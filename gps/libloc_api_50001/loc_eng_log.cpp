@@ -49,7 +49,7 @@ static int gps_status_num = sizeof(gps_status_name) / sizeof(loc_name_val_s_type
 /* Find Android GPS status name */
 const char* loc_get_gps_status_name(GpsStatusValue gps_status)
 {
-   return loc_get_name_from_val(gps_status_name, gps_status_num,
+   return loc_get_name_from_sorted(gps_status_name, gps_status_num,
          (long) gps_status);
 }
 
@@ -96,7 +96,12 @@ static loc_name_val_s_type loc_eng_msgs[] =
     NAME_VAL( LOC_ENG_MSG_EXT_POWER_CONFIG ),
     NAME_VAL( LOC_ENG_MSG_REQUEST_POSITION ),
     NAME_VAL( LOC_ENG_MSG_REQUEST_PHONE_CONTEXT ),
-    NAME_VAL( LOC_ENG_MSG_REQUEST_NETWORK_POSIITON ),
+    NAME_VAL( LOC_ENG_MSG_REQUEST_NETWORK_POSIITON )
+};
+static int loc_eng_msgs_num = sizeof(loc_eng_msgs) / sizeof(loc_name_val_s_type);
+
+static loc_name_val_s_type loc_eng_ulp_msgs[] =
+{
     NAME_VAL( ULP_MSG_UPDATE_CRITERIA ),
     NAME_VAL( ULP_MSG_START_FIX ),
     NAME_VAL( ULP_MSG_STOP_FIX ),
@@ -104,14 +109,35 @@ static loc_name_val_s_type loc_eng_msgs[] =
     NAME_VAL( ULP_MSG_INJECT_NETWORK_POSITION ),
     NAME_VAL( ULP_MSG_REPORT_QUIPC_POSITION ),
     NAME_VAL( ULP_MSG_REQUEST_COARSE_POSITION ),
-    NAME_VAL( LOC_ENG_MSG_LPP_CONFIG )
+    NAME_VAL( ULP_MSG_MONITOR )
 };
-static int loc_eng_msgs_num = sizeof(loc_eng_msgs) / sizeof(loc_name_val_s_type);
+static int loc_eng_ulp_msgs_num = sizeof(loc_eng_ulp_msgs) / sizeof(loc_name_val_s_type);
 
-/* Find Android GPS status name */
+static loc_name_val_s_type loc_eng_late_msgs[] =
+{
+    NAME_VAL( LOC_ENG_MSG_LPP_CONFIG ),
+    NAME_VAL( LOC_ENG_MSG_AGPS_MODE ),
+    NAME_VAL( LOC_ENG_MSG_XTRA_ENABLE ),
+    NAME_VAL( LOC_ENG_MSG_GLONASS_CONTROL ),
+    NAME_VAL( LOC_ENG_MSG_USE_SSL ),
+    NAME_VAL( LOC_ENG_MSG_CERT_TYPE ),
+    NAME_VAL( ULP_MSG_INJECT_RAW_COMMAND ),
+    NAME_VAL( LOC_ENG_MSG_FLUSH_NMEA )
+};
+static int loc_eng_late_msgs_num = sizeof(loc_eng_late_msgs) / sizeof(loc_name_val_s_type);
+
+/* Find message name; each table is one run of ids, so this is a direct index */
 const char* loc_get_msg_name(int id)
 {
-   return loc_get_name_from_val(loc_eng_msgs, loc_eng_msgs_num, (long) id);
+   if (id > ULP_MSG_LAST)
+   {
+      return loc_get_name_from_sorted(loc_eng_late_msgs, loc_eng_late_msgs_num, (long) id);
+   }
+   if (id >= ULP_MSG_UPDATE_CRITERIA)
+   {
+      return loc_get_name_from_sorted(loc_eng_ulp_msgs, loc_eng_ulp_msgs_num, (long) id);
+   }
+   return loc_get_name_from_sorted(loc_eng_msgs, loc_eng_msgs_num, (long) id);
 }
 
 
@@ -131,7 +157,7 @@ static int loc_eng_position_mode_num = sizeof(loc_eng_position_modes) / sizeof(l
 
 const char* loc_get_position_mode_name(GpsPositionMode mode)
 {
-    return loc_get_name_from_val(loc_eng_position_modes, loc_eng_position_mode_num, (long) mode);
+    return loc_get_name_from_sorted(loc_eng_position_modes, loc_eng_position_mode_num, (long) mode);
 }
 
 
@@ -145,7 +171,7 @@ static int loc_eng_position_recurrence_num = sizeof(loc_eng_position_recurrences
 
 const char* loc_get_position_recurrence_name(GpsPositionRecurrence recur)
 {
-    return loc_get_name_from_val(loc_eng_position_recurrences, loc_eng_position_recurrence_num, (long) recur);
+    return loc_get_name_from_sorted(loc_eng_position_recurrences, loc_eng_position_recurrence_num, (long) recur);
 }
 
 
@@ -179,13 +205,14 @@ static loc_name_val_s_type loc_eng_agps_types[] =
     NAME_VAL( AGPS_TYPE_ANY ),
     NAME_VAL( AGPS_TYPE_SUPL ),
     NAME_VAL( AGPS_TYPE_C2K ),
-    NAME_VAL( AGPS_TYPE_WWAN_ANY )
+    NAME_VAL( AGPS_TYPE_WWAN_ANY ),
+    NAME_VAL( AGPS_TYPE_WIFI )
 };
 static int loc_eng_agps_type_num = sizeof(loc_eng_agps_types) / sizeof(loc_name_val_s_type);
 
 const char* loc_get_agps_type_name(AGpsType type)
 {
-    return loc_get_name_from_val(loc_eng_agps_types, loc_eng_agps_type_num, (long) type);
+    return loc_get_name_from_sorted(loc_eng_agps_types, loc_eng_agps_type_num, (long) type);
 }
 
 
@@ -199,7 +226,7 @@ static int loc_eng_ni_type_num = sizeof(loc_eng_ni_types) / sizeof(loc_name_val_
 
 const char* loc_get_ni_type_name(GpsNiType type)
 {
-    return loc_get_name_from_val(loc_eng_ni_types, loc_eng_ni_type_num, (long) type);
+    return loc_get_name_from_sorted(loc_eng_ni_types, loc_eng_ni_type_num, (long) type);
 }
 
 
@@ -207,29 +234,29 @@ static loc_name_val_s_type loc_eng_ni_responses[] =
 {
     NAME_VAL( GPS_NI_RESPONSE_ACCEPT ),
     NAME_VAL( GPS_NI_RESPONSE_DENY ),
-    NAME_VAL( GPS_NI_RESPONSE_DENY )
+    NAME_VAL( GPS_NI_RESPONSE_NORESP )
 };
 static int loc_eng_ni_reponse_num = sizeof(loc_eng_ni_responses) / sizeof(loc_name_val_s_type);
 
 const char* loc_get_ni_response_name(GpsUserResponseType response)
 {
-    return loc_get_name_from_val(loc_eng_ni_responses, loc_eng_ni_reponse_num, (long) response);
+    return loc_get_name_from_sorted(loc_eng_ni_responses, loc_eng_ni_reponse_num, (long) response);
 }
 
 
 static loc_name_val_s_type loc_eng_ni_encodings[] =
 {
+    NAME_VAL( GPS_ENC_UNKNOWN ),
     NAME_VAL( GPS_ENC_NONE ),
     NAME_VAL( GPS_ENC_SUPL_GSM_DEFAULT ),
     NAME_VAL( GPS_ENC_SUPL_UTF8 ),
-    NAME_VAL( GPS_ENC_SUPL_UCS2 ),
-    NAME_VAL( GPS_ENC_UNKNOWN )
+    NAME_VAL( GPS_ENC_SUPL_UCS2 )
 };
 static int loc_eng_ni_encoding_num = sizeof(loc_eng_ni_encodings) / sizeof(loc_name_val_s_type);
 
 const char* loc_get_ni_encoding_name(GpsNiEncodingType encoding)
 {
-    return loc_get_name_from_val(loc_eng_ni_encodings, loc_eng_ni_encoding_num, (long) encoding);
+    return loc_get_name_from_sorted(loc_eng_ni_encodings, loc_eng_ni_encoding_num, (long) encoding);
 }
 
 
@@ -237,14 +264,14 @@ static loc_name_val_s_type loc_eng_agps_bears[] =
 {
     NAME_VAL( AGPS_APN_BEARER_INVALID ),
     NAME_VAL( AGPS_APN_BEARER_IPV4 ),
-    NAME_VAL( AGPS_APN_BEARER_IPV4 ),
+    NAME_VAL( AGPS_APN_BEARER_IPV6 ),
     NAME_VAL( AGPS_APN_BEARER_IPV4V6 )
 };
 static int loc_eng_agps_bears_num = sizeof(loc_eng_agps_bears) / sizeof(loc_name_val_s_type);
 
 const char* loc_get_agps_bear_name(AGpsBearerType bearer)
 {
-    return loc_get_name_from_val(loc_eng_agps_bears, loc_eng_agps_bears_num, (long) bearer);
+    return loc_get_name_from_sorted(loc_eng_agps_bears, loc_eng_agps_bears_num, (long) bearer);
 }
 
 static loc_name_val_s_type loc_eng_server_types[] =
@@ -258,7 +285,7 @@ static int loc_eng_server_types_num = sizeof(loc_eng_server_types) / sizeof(loc_
 
 const char* loc_get_server_type_name(LocServerType type)
 {
-    return loc_get_name_from_val(loc_eng_server_types, loc_eng_server_types_num, (long) type);
+    return loc_get_name_from_sorted(loc_eng_server_types, loc_eng_server_types_num, (long) type);
 }
 
 static loc_name_val_s_type loc_eng_position_sess_status_types[] =
@@ -271,7 +298,7 @@ static int loc_eng_position_sess_status_num = sizeof(loc_eng_position_sess_statu
 
 const char* loc_get_position_sess_status_name(enum loc_sess_status status)
 {
-    return loc_get_name_from_val(loc_eng_position_sess_status_types, loc_eng_position_sess_status_num, (long) status);
+    return loc_get_name_from_sorted(loc_eng_position_sess_status_types, loc_eng_position_sess_status_num, (long) status);
 }
 
 static loc_name_val_s_type loc_eng_agps_status_names[] =
@@ -286,5 +313,5 @@ static int loc_eng_agps_status_num = sizeof(loc_eng_agps_status_names) / sizeof(
 
 const char* loc_get_agps_status_name(AGpsStatusValue status)
 {
-    return loc_get_name_from_val(loc_eng_agps_status_names, loc_eng_agps_status_num, (long) status);
+    return loc_get_name_from_sorted(loc_eng_agps_status_names, loc_eng_agps_status_num, (long) status);
 }
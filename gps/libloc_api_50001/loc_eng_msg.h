@@ -33,6 +33,7 @@
 #include <hardware/gps.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include "log_util.h"
 #include "loc.h"
 #include <loc_eng_log.h>
@@ -141,19 +142,146 @@ typedef enum {
   LOC_ENG_IF_REQUEST_SENDER_ID_UNKNOWN
 } loc_if_req_sender_id_e_type;
 
+// Reference counted data buffer. Messages hold a reference to one rather
+// than a private copy of the data, so a producer can hand its buffer off,
+// or share it between messages, without another copy. The data is freed
+// once the last reference is dropped.
+struct LocEngBuffer {
+    char* data;
+    int length;
+    void (*release)(char* data);    // frees adopted data, NULL if inline
+    int refs;
+};
+
+// New buffer of len bytes, holding one reference, for the caller to fill in
+static inline LocEngBuffer* loc_eng_buf_alloc(int len)
+{
+    LocEngBuffer* buf = (LocEngBuffer*)malloc(sizeof(LocEngBuffer) + len);
+    if (NULL != buf) {
+        buf->data = (char*)(buf + 1);
+        buf->length = len;
+        buf->release = NULL;
+        buf->refs = 1;
+    }
+    return buf;
+}
+
+// New buffer holding one reference, with a copy of len bytes of data
+static inline LocEngBuffer* loc_eng_buf_copy(const char* data, int len)
+{
+    LocEngBuffer* buf = loc_eng_buf_alloc(len);
+    if (NULL != buf) {
+        memcpy(buf->data, data, len);
+    }
+    return buf;
+}
+
+// New buffer holding one reference, taking over data as is; release is
+// called on data when the last reference is dropped.
+static inline LocEngBuffer* loc_eng_buf_adopt(char* data, int len,
+                                              void (*release)(char* data))
+{
+    LocEngBuffer* buf = (LocEngBuffer*)malloc(sizeof(LocEngBuffer));
+    if (NULL != buf) {
+        buf->data = data;
+        buf->length = len;
+        buf->release = release;
+        buf->refs = 1;
+    } else if (NULL != release) {
+        release(data);
+    }
+    return buf;
+}
+
+// Data of a new inline buffer holding one reference, with a copy of len
+// bytes of data; NULL if it could not be allocated. For messages that keep
+// the data pointer ahead of the buffer in their layout.
+static inline char* loc_eng_buf_copy_data(const char* data, int len)
+{
+    LocEngBuffer* buf = loc_eng_buf_copy(data, len);
+    return NULL == buf ? NULL : buf->data;
+}
+
+// Buffer of data returned by loc_eng_buf_copy_data(), NULL for NULL
+static inline LocEngBuffer* loc_eng_buf_of_data(char* data)
+{
+    return NULL == data ? NULL : (LocEngBuffer*)data - 1;
+}
+
+static inline LocEngBuffer* loc_eng_buf_ref(LocEngBuffer* buf)
+{
+    if (NULL != buf) {
+        __atomic_add_fetch(&buf->refs, 1, __ATOMIC_RELAXED);
+    }
+    return buf;
+}
+
+static inline void loc_eng_buf_unref(LocEngBuffer* buf)
+{
+    if (NULL != buf && 0 == __atomic_sub_fetch(&buf->refs, 1, __ATOMIC_ACQ_REL)) {
+        if (NULL != buf->release) {
+            buf->release(buf->data);
+        }
+        free(buf);
+    }
+}
+
+/* Number of loc_eng_msg pool size classes, the last one being unpooled */
+#define LOC_ENG_MSG_POOL_CLASSES 7
+
+struct loc_eng_msg_pool_stats {
+    size_t block_size;      // 0 for messages too large to pool
+    size_t free;            // blocks held for reuse
+    unsigned long hits;     // allocations served from the pool
+    unsigned long misses;   // allocations that went to the heap
+};
+
+// Allocates size bytes from the size class pool the size falls in, or from
+// the global operator new once the pool is used up; NULL if the heap is out
+// of memory.
+void* loc_eng_msg_pool_alloc(size_t size);
+// Returns a block from loc_eng_msg_pool_alloc to its size class. Blocks
+// that did not come from a pool, e.g. messages prebuilt code allocated
+// with the global operator new, go to the global operator delete. Only the
+// address is looked at, nothing is read from the block.
+void loc_eng_msg_pool_free(void* ptr);
+// Fills in up to count size class stats; returns the number filled in.
+// The counts are per size class, not per message type: operator new is
+// only told the size.
+int loc_eng_msg_pool_get_stats(loc_eng_msg_pool_stats* stats, int count);
+
+// CLOCK_MONOTONIC time in microseconds, for timing messages
+static inline int64_t loc_eng_msg_time_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
 struct loc_eng_msg {
     const void* owner;
     const int msgid;
+    // Messages are allocated for every API call and modem report, so
+    // they come from size class pools rather than straight off the heap.
+    // delete finds the pool of a block by its address, not by size. With
+    // throw(), a new-expression skips the constructor and yields NULL when
+    // the heap is out of memory.
+    static void* operator new(size_t size) throw()
+    {
+        return loc_eng_msg_pool_alloc(size);
+    }
+    static void operator delete(void* ptr)
+    {
+        loc_eng_msg_pool_free(ptr);
+    }
     inline loc_eng_msg(void* instance, int id) :
         owner(instance), msgid(id)
     {
-        LOC_LOGV("creating msg %s", loc_get_msg_name(msgid));
-        LOC_LOGV("creating msg ox%x", msgid);
+        LOC_LOGV("creating msg %s ox%x", loc_get_msg_name(msgid), msgid);
     }
     virtual ~loc_eng_msg()
     {
-        LOC_LOGV("deleting msg %s", loc_get_msg_name(msgid));
-        LOC_LOGV("deleting msg ox%x", msgid);
+        LOC_LOGV("deleting msg %s ox%x", loc_get_msg_name(msgid), msgid);
     }
 };
 
@@ -376,18 +504,26 @@ struct loc_eng_msg_report_sv : public loc_eng_msg {
     const GpsSvStatus svStatus;
     const GpsLocationExtended locationExtended;
     const void* svExt;
-    inline loc_eng_msg_report_sv(void* instance, GpsSvStatus &sv, GpsLocationExtended &locExtended, void* ext) :
-        loc_eng_msg(instance, LOC_ENG_MSG_REPORT_SV), svStatus(sv), locationExtended(locExtended), svExt(ext)
-    {
-        LOC_LOGV("num sv: %d\n  ephemeris mask: %dxn  almanac mask: %x\n  used in fix mask: %x\n      sv: prn         snr       elevation      azimuth",
-                 svStatus.num_svs, svStatus.ephemeris_mask, svStatus.almanac_mask, svStatus.used_in_fix_mask);
-        for (int i = 0; i < svStatus.num_svs && i < GPS_MAX_SVS; i++) {
-            LOC_LOGV("   %d:   %d    %f    %f    %f\n  ",
-                     i,
-                     svStatus.sv_list[i].prn,
-                     svStatus.sv_list[i].snr,
-                     svStatus.sv_list[i].elevation,
-                     svStatus.sv_list[i].azimuth);
+    // GLONASS SVs used in the fix, bit 0 being PRN 65. It lives here rather
+    // than in GpsLocationExtended, which prebuilt adapters allocate
+    // themselves; only LocApiAdapter::reportSv() builds this message.
+    const uint32_t gloUsedInFixMask;
+    inline loc_eng_msg_report_sv(void* instance, GpsSvStatus &sv, GpsLocationExtended &locExtended, void* ext,
+                                 uint32_t gloUsedMask = 0) :
+        loc_eng_msg(instance, LOC_ENG_MSG_REPORT_SV), svStatus(sv), locationExtended(locExtended), svExt(ext),
+        gloUsedInFixMask(gloUsedMask)
+    {
+        if (LOC_LOG_UNLIKELY(LOC_LOG_ON(5))) {
+            LOC_LOGV("num sv: %d\n  ephemeris mask: %dxn  almanac mask: %x\n  used in fix mask: %x\n      sv: prn         snr       elevation      azimuth",
+                     svStatus.num_svs, svStatus.ephemeris_mask, svStatus.almanac_mask, svStatus.used_in_fix_mask);
+            for (int i = 0; i < svStatus.num_svs && i < GPS_MAX_SVS; i++) {
+                LOC_LOGV("   %d:   %d    %f    %f    %f\n  ",
+                         i,
+                         svStatus.sv_list[i].prn,
+                         svStatus.sv_list[i].snr,
+                         svStatus.sv_list[i].elevation,
+                         svStatus.sv_list[i].azimuth);
+            }
         }
     }
 };
@@ -404,19 +540,29 @@ struct loc_eng_msg_report_status : public loc_eng_msg {
 struct loc_eng_msg_report_nmea : public loc_eng_msg {
     char* const nmea;
     const int length;
+    LocEngBuffer* const buf;
     inline loc_eng_msg_report_nmea(void* instance,
                                    const char* data,
                                    int len) :
         loc_eng_msg(instance, LOC_ENG_MSG_REPORT_NMEA),
-        nmea(new char[len]), length(len)
+        nmea(loc_eng_buf_copy_data(data, len)),
+        length(NULL == nmea ? 0 : len),
+        buf(loc_eng_buf_of_data(nmea))
+    {
+        LOC_LOGV("length: %d\n  nmea: %p", length, nmea);
+    }
+    // takes its own reference to b, the caller keeps the one it holds
+    inline loc_eng_msg_report_nmea(void* instance, LocEngBuffer* b) :
+        loc_eng_msg(instance, LOC_ENG_MSG_REPORT_NMEA),
+        nmea(NULL == b ? NULL : b->data),
+        length(NULL == b ? 0 : b->length),
+        buf(loc_eng_buf_ref(b))
     {
-        memcpy((void*)nmea, (void*)data, len);
-        LOC_LOGV("length: %d\n  nmea: %p - %c%c%c",
-                 length, nmea, nmea[3], nmea[4], nmea[5]);
+        LOC_LOGV("length: %d\n  nmea: %p", length, nmea);
     }
     inline ~loc_eng_msg_report_nmea()
     {
-        delete[] nmea;
+        loc_eng_buf_unref(buf);
     }
 };
 
@@ -679,16 +825,27 @@ struct loc_eng_msg_set_server_url : public loc_eng_msg {
 struct loc_eng_msg_inject_xtra_data : public loc_eng_msg {
     char* const data;
     const int length;
+    LocEngBuffer* const buf;
     inline loc_eng_msg_inject_xtra_data(void* instance, char* d, int l) :
         loc_eng_msg(instance, LOC_ENG_MSG_INJECT_XTRA_DATA),
-        data(new char[l]), length(l)
+        data(loc_eng_buf_copy_data(d, l)),
+        length(NULL == data ? 0 : l),
+        buf(loc_eng_buf_of_data(data))
+    {
+        LOC_LOGV("length: %d\n  data: %p", length, data);
+    }
+    // takes its own reference to b, the caller keeps the one it holds
+    inline loc_eng_msg_inject_xtra_data(void* instance, LocEngBuffer* b) :
+        loc_eng_msg(instance, LOC_ENG_MSG_INJECT_XTRA_DATA),
+        data(NULL == b ? NULL : b->data),
+        length(NULL == b ? 0 : b->length),
+        buf(loc_eng_buf_ref(b))
     {
-        memcpy((void*)data, (void*)d, l);
         LOC_LOGV("length: %d\n  data: %p", length, data);
     }
     inline ~loc_eng_msg_inject_xtra_data()
     {
-        delete[] data;
+        loc_eng_buf_unref(buf);
     }
 };
 
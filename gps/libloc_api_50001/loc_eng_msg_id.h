@@ -134,6 +134,10 @@ enum loc_eng_msg_ids_t {
     // Message is sent by Android framework (GpsLocationProvider)
     // to inject the raw command
     ULP_MSG_INJECT_RAW_COMMAND,
+
+    // Message is sent by loc_eng_cleanup to deliver the NMEA sentences
+    // still held back for nmea_burst_cb
+    LOC_ENG_MSG_FLUSH_NMEA,
 };
 
 #ifdef __cplusplus
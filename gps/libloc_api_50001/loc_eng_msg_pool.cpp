@@ -0,0 +1,183 @@
+/* Copyright (c) 2011-2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_msg_pool"
+
+#include <new>
+#include <pthread.h>
+#include <stdint.h>
+#include "loc_eng_msg.h"
+
+/* Blocks in the slab of each size class, taken from the heap at its first use */
+#define LOC_ENG_MSG_POOL_SLAB_BLOCKS 32
+
+struct loc_eng_msg_pool_block {
+    loc_eng_msg_pool_block* next;
+};
+
+// A class hands out blocks of its one slab, and goes to the heap once all
+// of them are in use. Whether a block is from a slab is told by its address
+// alone: messages built by prebuilt code against an older loc_eng_msg.h come
+// from the global operator new and may still be deleted through the class
+// operator delete, so nothing may be read from around a block first.
+struct loc_eng_msg_pool_class {
+    const size_t block_size;
+    pthread_mutex_t lock;
+    char* slab;             // published once with release, never freed
+    loc_eng_msg_pool_block* free_list;
+    size_t free_count;
+    unsigned long hits;
+    unsigned long misses;
+};
+
+// block_size; 0 is the catch all class for messages too large to pool
+static loc_eng_msg_pool_class pool_classes[LOC_ENG_MSG_POOL_CLASSES] =
+{
+    { 64,   PTHREAD_MUTEX_INITIALIZER, NULL, NULL, 0, 0, 0 },
+    { 128,  PTHREAD_MUTEX_INITIALIZER, NULL, NULL, 0, 0, 0 },
+    { 256,  PTHREAD_MUTEX_INITIALIZER, NULL, NULL, 0, 0, 0 },
+    { 512,  PTHREAD_MUTEX_INITIALIZER, NULL, NULL, 0, 0, 0 },
+    { 1024, PTHREAD_MUTEX_INITIALIZER, NULL, NULL, 0, 0, 0 },
+    { 2048, PTHREAD_MUTEX_INITIALIZER, NULL, NULL, 0, 0, 0 },
+    { 0,    PTHREAD_MUTEX_INITIALIZER, NULL, NULL, 0, 0, 0 },
+};
+
+static int loc_eng_msg_pool_class_of(size_t size)
+{
+    int i;
+    for (i = 0; i < LOC_ENG_MSG_POOL_CLASSES - 1; i++) {
+        if (size <= pool_classes[i].block_size) {
+            break;
+        }
+    }
+    return i;
+}
+
+// Carves the slab of a class into its free list; called with the class lock
+// held, the first time the class is used
+static void loc_eng_msg_pool_fill(loc_eng_msg_pool_class* pool)
+{
+    char* slab = (char*)malloc(pool->block_size * LOC_ENG_MSG_POOL_SLAB_BLOCKS);
+    if (NULL == slab) {
+        LOC_LOGE("%s: unable to allocate the %d byte slab", __func__, (int)pool->block_size);
+        return;
+    }
+
+    for (int i = LOC_ENG_MSG_POOL_SLAB_BLOCKS - 1; i >= 0; i--) {
+        loc_eng_msg_pool_block* block = (loc_eng_msg_pool_block*)(slab + i * pool->block_size);
+        block->next = pool->free_list;
+        pool->free_list = block;
+    }
+    pool->free_count = LOC_ENG_MSG_POOL_SLAB_BLOCKS;
+    __atomic_store_n(&pool->slab, slab, __ATOMIC_RELEASE);
+}
+
+// The pooled class whose slab holds ptr, or NULL
+static loc_eng_msg_pool_class* loc_eng_msg_pool_owner_of(void* ptr)
+{
+    for (int i = 0; i < LOC_ENG_MSG_POOL_CLASSES - 1; i++) {
+        loc_eng_msg_pool_class* pool = &pool_classes[i];
+        char* slab = __atomic_load_n(&pool->slab, __ATOMIC_ACQUIRE);
+        if (NULL != slab && (char*)ptr >= slab &&
+            (char*)ptr < slab + pool->block_size * LOC_ENG_MSG_POOL_SLAB_BLOCKS) {
+            return pool;
+        }
+    }
+    return NULL;
+}
+
+void* loc_eng_msg_pool_alloc(size_t size)
+{
+    loc_eng_msg_pool_class* pool = &pool_classes[loc_eng_msg_pool_class_of(size)];
+    loc_eng_msg_pool_block* block = NULL;
+
+    pthread_mutex_lock(&pool->lock);
+    if (0 != pool->block_size && NULL == pool->slab) {
+        loc_eng_msg_pool_fill(pool);
+    }
+    block = pool->free_list;
+    if (NULL != block) {
+        pool->free_list = block->next;
+        pool->free_count--;
+        pool->hits++;
+    } else {
+        pool->misses++;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    if (NULL != block) {
+        return block;
+    }
+
+    // too large to pool, or the slab is all in use
+    void* ptr = ::operator new(size, std::nothrow);
+    if (NULL == ptr) {
+        LOC_LOGE("%s: unable to allocate %d bytes", __func__, (int)size);
+    }
+    return ptr;
+}
+
+void loc_eng_msg_pool_free(void* ptr)
+{
+    if (NULL == ptr) {
+        return;
+    }
+
+    loc_eng_msg_pool_class* pool = loc_eng_msg_pool_owner_of(ptr);
+    if (NULL == pool) {
+        // from the global operator new, be it ours or prebuilt code's
+        ::operator delete(ptr);
+        return;
+    }
+
+    loc_eng_msg_pool_block* block = (loc_eng_msg_pool_block*)ptr;
+    pthread_mutex_lock(&pool->lock);
+    block->next = pool->free_list;
+    pool->free_list = block;
+    pool->free_count++;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+int loc_eng_msg_pool_get_stats(loc_eng_msg_pool_stats* stats, int count)
+{
+    int i;
+
+    for (i = 0; i < count && i < LOC_ENG_MSG_POOL_CLASSES; i++) {
+        loc_eng_msg_pool_class* pool = &pool_classes[i];
+
+        pthread_mutex_lock(&pool->lock);
+        stats[i].block_size = pool->block_size;
+        stats[i].free = pool->free_count;
+        stats[i].hits = pool->hits;
+        stats[i].misses = pool->misses;
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    return i;
+}
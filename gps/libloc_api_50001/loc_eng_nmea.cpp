@@ -39,7 +39,9 @@
 FUNCTION    loc_eng_nmea_send
 
 DESCRIPTION
-   send out NMEA sentence
+   send out NMEA sentence. With a nmea_burst_cb, the sentence is instead
+   appended to the burst of the current fix, which loc_eng_nmea_flush
+   sends out. With REPORT_THREAD, nmea_cb runs on the report action thread.
 
 DEPENDENCIES
    NONE
@@ -53,48 +55,116 @@ SIDE EFFECTS
 ===========================================================================*/
 void loc_eng_nmea_send(char *pNmea, int length, loc_eng_data_s_type *loc_eng_data_p)
 {
-    struct timeval tv;
-    gettimeofday(&tv, (struct timezone *) NULL);
-    int64_t now = tv.tv_sec * 1000LL + tv.tv_usec / 1000;
+    if (NULL != loc_eng_data_p->nmea_burst_cb)
+    {
+        int size = strlen(pNmea);
+        if (loc_eng_data_p->nmea_burst_length + size > LOC_ENG_NMEA_BURST_SIZE ||
+            loc_eng_data_p->nmea_burst_count == LOC_ENG_NMEA_BURST_MAX_SENTENCES)
+        {
+            loc_eng_nmea_flush(loc_eng_data_p);
+        }
+        loc_eng_data_p->nmea_burst_offsets[loc_eng_data_p->nmea_burst_count++] =
+            loc_eng_data_p->nmea_burst_length;
+        memcpy(loc_eng_data_p->nmea_burst + loc_eng_data_p->nmea_burst_length, pNmea, size);
+        loc_eng_data_p->nmea_burst_length += size;
+        LOC_LOGD("NMEA <%s", pNmea);
+        return;
+    }
+
+    if (NULL != ((LocEngContext*)loc_eng_data_p->context)->report_q)
+    {
+        // nmea_cb runs on the report action thread, off a copy
+        loc_eng_msg_report_nmea msg(loc_eng_data_p, pNmea, length);
+        loc_eng_deliver_report(loc_eng_data_p, &msg);
+        LOC_LOGD("NMEA <%s", pNmea);
+        return;
+    }
+
+    int64_t now = loc_get_realtime_ms();
     CALLBACK_LOG_CALLFLOW("nmea_cb", %p, pNmea);
     loc_eng_data_p->nmea_cb(now, pNmea, length);
     LOC_LOGD("NMEA <%s", pNmea);
 }
 
 /*===========================================================================
-FUNCTION    loc_eng_nmea_put_checksum
+FUNCTION    loc_eng_nmea_flush
 
 DESCRIPTION
-   Generate NMEA sentences generated based on position report
+   Sends the sentences held back for nmea_burst_cb, if any, in one call
+   with one timestamp.
 
 DEPENDENCIES
    NONE
 
 RETURN VALUE
-   Total length of the nmea sentence
+   NONE
 
 SIDE EFFECTS
    N/A
 
 ===========================================================================*/
-int loc_eng_nmea_put_checksum(char *pNmea, int maxSize)
+void loc_eng_nmea_flush(loc_eng_data_s_type *loc_eng_data_p)
 {
+    if (NULL == loc_eng_data_p->nmea_burst_cb || 0 == loc_eng_data_p->nmea_burst_count)
+    {
+        return;
+    }
+
+    int64_t now = loc_get_realtime_ms();
+    CALLBACK_LOG_CALLFLOW("nmea_burst_cb", %d, loc_eng_data_p->nmea_burst_count);
+    loc_eng_data_p->nmea_burst_cb(now, loc_eng_data_p->nmea_burst,
+                                  loc_eng_data_p->nmea_burst_length,
+                                  loc_eng_data_p->nmea_burst_offsets,
+                                  loc_eng_data_p->nmea_burst_count);
+    loc_eng_data_p->nmea_burst_length = 0;
+    loc_eng_data_p->nmea_burst_count = 0;
+}
+
+static const char loc_eng_nmea_hex[] = "0123456789ABCDEF";
+
+// XOR of length bytes, folded from eight at a time
+static uint8_t loc_eng_nmea_xor(const char* data, int length)
+{
+    uint64_t word = 0;
     uint8_t checksum = 0;
-    int length = 0;
 
-    pNmea++; //skip the $
-    while (*pNmea != '\0')
+    for (; length >= (int)sizeof(word); length -= sizeof(word))
+    {
+        uint64_t w;
+        memcpy(&w, data, sizeof(w));
+        word ^= w;
+        data += sizeof(w);
+    }
+    while (length-- > 0)
     {
-        checksum ^= *pNmea++;
-        length++;
+        checksum ^= *data++;
     }
 
-    int checksumLength = snprintf(pNmea, maxSize,"*%02X\r\n", checksum);
-    return (length + checksumLength);
+    word ^= word >> 32;
+    word ^= word >> 16;
+    word ^= word >> 8;
+    return checksum ^ (uint8_t)word;
+}
+
+// Writes "*XX\r\n" and the terminator, cut short like snprintf when
+// maxSize is too small; returns the length of the whole field
+static int loc_eng_nmea_put_checksum_field(char* pNmea, int maxSize, uint8_t checksum)
+{
+    const char field[] = { '*', loc_eng_nmea_hex[checksum >> 4],
+                           loc_eng_nmea_hex[checksum & 0xF], '\r', '\n' };
+    int length = sizeof(field);
+
+    if (maxSize > 0)
+    {
+        int n = length < maxSize ? length : maxSize - 1;
+        memcpy(pNmea, field, n);
+        pNmea[n] = '\0';
+    }
+    return length;
 }
 
 /*===========================================================================
-FUNCTION    loc_eng_nmea_generate_pos
+FUNCTION    loc_eng_nmea_put_checksum
 
 DESCRIPTION
    Generate NMEA sentences generated based on position report
@@ -103,456 +173,786 @@ DEPENDENCIES
    NONE
 
 RETURN VALUE
-   0
+   Total length of the nmea sentence
 
 SIDE EFFECTS
    N/A
 
 ===========================================================================*/
-void loc_eng_nmea_generate_pos(loc_eng_data_s_type *loc_eng_data_p,
-                               const GpsLocation &location, const GpsLocationExtended &locationExtended)
+int loc_eng_nmea_put_checksum(char *pNmea, int maxSize)
 {
-    ENTRY_LOG();
+    int length = strlen(pNmea + 1); // skip the $
+    uint8_t checksum = loc_eng_nmea_xor(pNmea + 1, length);
+    pNmea += 1 + length;
+    maxSize -= 1 + length;
 
-    char sentence[NMEA_SENTENCE_MAX_LENGTH] = {0};
-    char* pMarker = sentence;
-    int lengthRemaining = sizeof(sentence);
-    int length = 0;
+    int checksumLength = loc_eng_nmea_put_checksum_field(pNmea, maxSize, checksum);
+    return (length + checksumLength);
+}
 
-    time_t utcTime(location.timestamp/1000);
-    tm * pTm = gmtime(&utcTime);
-    int utcYear = pTm->tm_year % 100; // 2 digit year
-    int utcMonth = pTm->tm_mon + 1; // tm_mon starts at zero
-    int utcDay = pTm->tm_mday;
-    int utcHours = pTm->tm_hour;
-    int utcMinutes = pTm->tm_min;
-    int utcSeconds = pTm->tm_sec;
+// Append-only sentence builder. Fields are written straight into the
+// sentence buffer; once a field does not fit, overflow is set and every
+// later put is dropped, so callers check once per sentence. The XOR of
+// everything appended is kept along the way, so the checksum costs
+// nothing once the sentence is done.
+struct loc_eng_nmea_sentence {
+    char* data;
+    int length;
+    int size;
+    bool overflow;
+    uint8_t checksum;
+};
+
+static inline void loc_eng_nmea_begin(loc_eng_nmea_sentence &s, char* buf, int size)
+{
+    s.data = buf;
+    s.length = 0;
+    s.size = size;
+    s.overflow = false;
+    s.checksum = 0;
+    buf[0] = '\0';
+}
 
-    // ------------------
-    // ------$GPGSA------
-    // ------------------
+// Keeps room for the terminator, which every put rewrites
+static inline bool loc_eng_nmea_reserve(loc_eng_nmea_sentence &s, int n)
+{
+    if (s.overflow || s.length + n >= s.size) {
+        s.overflow = true;
+        return false;
+    }
+    return true;
+}
 
-    uint32_t svUsedCount = 0;
-    uint32_t svUsedList[32] = {0};
-    uint32_t mask = loc_eng_data_p->sv_used_mask;
-    for (uint8_t i = 1; mask > 0 && svUsedCount < 32; i++)
-    {
-        if (mask & 1)
-            svUsedList[svUsedCount++] = i;
-        mask = mask >> 1;
+static inline void loc_eng_nmea_put_char(loc_eng_nmea_sentence &s, char c)
+{
+    if (loc_eng_nmea_reserve(s, 1)) {
+        s.data[s.length++] = c;
+        s.data[s.length] = '\0';
+        s.checksum ^= c;
     }
-    // clear the cache so they can't be used again
-    loc_eng_data_p->sv_used_mask = 0;
+}
 
-    char fixType;
-    if (svUsedCount == 0)
-        fixType = '1'; // no fix
-    else if (svUsedCount <= 3)
-        fixType = '2'; // 2D fix
-    else
-        fixType = '3'; // 3D fix
+static inline void loc_eng_nmea_put_str(loc_eng_nmea_sentence &s, const char* str, int len)
+{
+    if (loc_eng_nmea_reserve(s, len)) {
+        memcpy(s.data + s.length, str, len);
+        s.length += len;
+        s.checksum ^= loc_eng_nmea_xor(str, len);
+        s.data[s.length] = '\0';
+    }
+}
 
-    length = snprintf(pMarker, lengthRemaining, "$GPGSA,A,%c,", fixType);
+#define LOC_ENG_NMEA_PUT_LITERAL(s, str) loc_eng_nmea_put_str(s, str, sizeof(str) - 1)
 
-    if (length < 0 || length >= lengthRemaining)
-    {
-        LOC_LOGE("NMEA Error in string formatting");
+// Appends the checksum field; returns the same length as
+// loc_eng_nmea_put_checksum, or -1 if the sentence did not fit
+static int loc_eng_nmea_end(loc_eng_nmea_sentence &s)
+{
+    if (!loc_eng_nmea_reserve(s, 5)) {
+        return -1;
+    }
+    // the leading $ is not part of the checksum
+    uint8_t checksum = s.checksum ^ s.data[0];
+    int length = s.length - 1;
+    return length + loc_eng_nmea_put_checksum_field(s.data + s.length, s.size - s.length, checksum);
+}
+
+// Writes the len characters stored backwards in rev, after the sign and
+// the zero padding up to width, as printf's "%0*" does
+static void loc_eng_nmea_put_reversed(loc_eng_nmea_sentence &s, bool negative,
+                                      const char* rev, int len, int width)
+{
+    int pad = width - len - (negative ? 1 : 0);
+    if (pad < 0) {
+        pad = 0;
+    }
+    if (loc_eng_nmea_reserve(s, (negative ? 1 : 0) + pad + len)) {
+        char* p = s.data + s.length;
+        uint8_t checksum = 0;
+        if (negative) {
+            *p++ = '-';
+            checksum ^= '-';
+        }
+        if (pad & 1) {
+            checksum ^= '0';
+        }
+        while (pad-- > 0) {
+            *p++ = '0';
+        }
+        while (len > 0) {
+            *p++ = rev[--len];
+            checksum ^= *(p - 1);
+        }
+        s.checksum ^= checksum;
+        *p = '\0';
+        s.length = p - s.data;
+    }
+}
+
+// Same output as "%0<minDigits>d"
+static void loc_eng_nmea_put_int(loc_eng_nmea_sentence &s, int value, int minDigits)
+{
+    char rev[12];
+    int n = 0;
+    unsigned int u = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+    do {
+        rev[n++] = '0' + u % 10;
+        u /= 10;
+    } while (u > 0);
+    loc_eng_nmea_put_reversed(s, value < 0, rev, n, minDigits);
+}
+
+// Rounded product v * scale, with the exact error of the rounding in err.
+// v is split in two halves of 26 bits (Veltkamp), so with scale having
+// no more significant bits than that both partial products are exact and
+// the only rounding is in their sum, which TwoSum recovers.
+static inline double loc_eng_nmea_mul_exact(double v, double scale, double &err)
+{
+    double c = 134217729.0 * v; // 2^27 + 1
+    double hi = c - (c - v);
+    double lo = v - hi;
+    double ph = hi * scale;
+    double pl = lo * scale;
+    double t = ph + pl;
+    double b = t - ph;
+    err = (ph - (t - b)) + (pl - b);
+    return t;
+}
+
+// Same output as "%0<width>.<decimals>f" for decimals up to 6. The value
+// is scaled to a whole number of its last digit and rounded half to even
+// on the exact scaled value, as printf rounds, so the digits match
+// printf's to the last one.
+static void loc_eng_nmea_put_fixed(loc_eng_nmea_sentence &s, double value, int decimals, int width)
+{
+    static const double scales[] = { 1.0, 10.0, 100.0, 1000.0, 10000.0, 100000.0, 1000000.0 };
+    char rev[24];
+    int n = 0;
+
+    if (decimals < 0 || decimals > 6 || !(fabs(value) < 1e9)) {
+        // nan, inf and values no fix carries; leave them to printf
+        char field[48];
+        int len = snprintf(field, sizeof(field), "%0*.*f", width, decimals, value);
+        if (len < 0 || len >= (int)sizeof(field)) {
+            s.overflow = true;
+        } else {
+            loc_eng_nmea_put_str(s, field, len);
+        }
         return;
     }
-    pMarker += length;
-    lengthRemaining -= length;
+
+    double err;
+    double t = loc_eng_nmea_mul_exact(fabs(value), scales[decimals], err);
+    double whole = floor(t);
+    double frac = t - whole;
+    uint64_t units = (uint64_t)whole;
+    if (frac > 0.5 || (0.5 == frac && (err > 0 || (0 == err && (units & 1))))) {
+        units++;
+    }
+
+    for (int i = 0; i < decimals; i++) {
+        rev[n++] = '0' + units % 10;
+        units /= 10;
+    }
+    if (decimals > 0) {
+        rev[n++] = '.';
+    }
+    do {
+        rev[n++] = '0' + units % 10;
+        units /= 10;
+    } while (units > 0);
+    loc_eng_nmea_put_reversed(s, signbit(value), rev, n, width);
+}
+
+// Whether a sentence goes out on this epoch, going by NMEA_SENTENCE_MASK
+// and the sentence's divider in gps.conf
+static inline bool loc_eng_nmea_due(uint32_t sentence, unsigned long divider, uint32_t epoch)
+{
+    return (gps_conf.NMEA_SENTENCE_MASK & sentence) && (divider <= 1 || 0 == epoch % divider);
+}
+
+static inline bool loc_eng_nmea_is_glonass(int prn)
+{
+    return prn >= 65 && prn <= 96;
+}
+
+// Sends a $--GSA sentence for up to 12 of the svUsedCount svs in svUsedList
+static bool loc_eng_nmea_send_gsa(loc_eng_data_s_type *loc_eng_data_p, const char* talker,
+                                  char fixType, const uint32_t* svUsedList, uint32_t svUsedCount,
+                                  const GpsLocationExtended &locationExtended)
+{
+    char sentence[NMEA_SENTENCE_MAX_LENGTH] = {0};
+    loc_eng_nmea_sentence s;
+
+    loc_eng_nmea_begin(s, sentence, sizeof(sentence));
+    loc_eng_nmea_put_char(s, '$');
+    loc_eng_nmea_put_str(s, talker, 2);
+    LOC_ENG_NMEA_PUT_LITERAL(s, "GSA,A,");
+    loc_eng_nmea_put_char(s, fixType);
+    loc_eng_nmea_put_char(s, ',');
 
     for (uint8_t i = 0; i < 12; i++) // only the first 12 sv go in sentence
     {
         if (i < svUsedCount)
-            length = snprintf(pMarker, lengthRemaining, "%02d,", svUsedList[i]);
-        else
-            length = snprintf(pMarker, lengthRemaining, ",");
-
-        if (length < 0 || length >= lengthRemaining)
-        {
-            LOC_LOGE("NMEA Error in string formatting");
-            return;
-        }
-        pMarker += length;
-        lengthRemaining -= length;
+            loc_eng_nmea_put_int(s, svUsedList[i], 2);
+        loc_eng_nmea_put_char(s, ',');
     }
 
     if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_DOP)
     {   // dop is in locationExtended, (QMI)
-        length = snprintf(pMarker, lengthRemaining, "%.1f,%.1f,%.1f",
-                          locationExtended.pdop,
-                          locationExtended.hdop,
-                          locationExtended.vdop);
+        loc_eng_nmea_put_fixed(s, locationExtended.pdop, 1, 0);
+        loc_eng_nmea_put_char(s, ',');
+        loc_eng_nmea_put_fixed(s, locationExtended.hdop, 1, 0);
+        loc_eng_nmea_put_char(s, ',');
+        loc_eng_nmea_put_fixed(s, locationExtended.vdop, 1, 0);
     }
     else if (loc_eng_data_p->pdop > 0 && loc_eng_data_p->hdop > 0 && loc_eng_data_p->vdop > 0)
     {   // dop was cached from sv report (RPC)
-        length = snprintf(pMarker, lengthRemaining, "%.1f,%.1f,%.1f",
-                          loc_eng_data_p->pdop,
-                          loc_eng_data_p->hdop,
-                          loc_eng_data_p->vdop);
+        loc_eng_nmea_put_fixed(s, loc_eng_data_p->pdop, 1, 0);
+        loc_eng_nmea_put_char(s, ',');
+        loc_eng_nmea_put_fixed(s, loc_eng_data_p->hdop, 1, 0);
+        loc_eng_nmea_put_char(s, ',');
+        loc_eng_nmea_put_fixed(s, loc_eng_data_p->vdop, 1, 0);
     }
     else
     {   // no dop
-        length = snprintf(pMarker, lengthRemaining, ",,");
+        LOC_ENG_NMEA_PUT_LITERAL(s, ",,");
     }
 
-    length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
+    int length = loc_eng_nmea_end(s);
+    if (length < 0)
+    {
+        LOC_LOGE("NMEA Error in string formatting");
+        return false;
+    }
     loc_eng_nmea_send(sentence, length, loc_eng_data_p);
+    return true;
+}
 
-    // ------------------
-    // ------$GPVTG------
-    // ------------------
-
-    pMarker = sentence;
-    lengthRemaining = sizeof(sentence);
-
-    if (location.flags & GPS_LOCATION_HAS_BEARING)
+// Sends the $--GSV sentences for the svCount svs of svStatus that are, or
+// are not, GLONASS svs
+static bool loc_eng_nmea_send_gsv(loc_eng_data_s_type *loc_eng_data_p, const char* talker,
+                                  const GpsSvStatus &svStatus, bool glonass, int svCount)
+{
+    char sentence[NMEA_SENTENCE_MAX_LENGTH] = {0};
+    loc_eng_nmea_sentence s;
+    int sentenceCount = svCount / 4;
+    if (svCount % 4)
+        sentenceCount++;
+    int sentenceNumber = 1;
+    int svIndex = 0;
+
+    while (sentenceNumber <= sentenceCount)
     {
-        float magTrack = location.bearing;
-        if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_MAG_DEV)
+        loc_eng_nmea_begin(s, sentence, sizeof(sentence));
+        loc_eng_nmea_put_char(s, '$');
+        loc_eng_nmea_put_str(s, talker, 2);
+        LOC_ENG_NMEA_PUT_LITERAL(s, "GSV,");
+        loc_eng_nmea_put_int(s, sentenceCount, 1);
+        loc_eng_nmea_put_char(s, ',');
+        loc_eng_nmea_put_int(s, sentenceNumber, 1);
+        loc_eng_nmea_put_char(s, ',');
+        loc_eng_nmea_put_int(s, svCount, 2);
+
+        for (int i = 0; (svIndex < svStatus.num_svs) && (i < 4); svIndex++)
         {
-            float magTrack = location.bearing - locationExtended.magneticDeviation;
-            if (magTrack < 0.0)
-                magTrack += 360.0;
-            else if (magTrack > 360.0)
-                magTrack -= 360.0;
+            const GpsSvInfo &sv = svStatus.sv_list[svIndex];
+            if (loc_eng_nmea_is_glonass(sv.prn) != glonass)
+                continue;
+
+            loc_eng_nmea_put_char(s, ',');
+            loc_eng_nmea_put_int(s, sv.prn, 2);
+            loc_eng_nmea_put_char(s, ',');
+            loc_eng_nmea_put_int(s, (int)(0.5 + sv.elevation), 2); //float to int
+            loc_eng_nmea_put_char(s, ',');
+            loc_eng_nmea_put_int(s, (int)(0.5 + sv.azimuth), 3); //float to int
+            loc_eng_nmea_put_char(s, ',');
+
+            if (sv.snr > 0)
+            {
+                loc_eng_nmea_put_int(s, (int)(0.5 + sv.snr), 2); //float to int
+            }
+            i++;
         }
 
-        length = snprintf(pMarker, lengthRemaining, "$GPVTG,%.1lf,T,%.1lf,M,", location.bearing, magTrack);
-    }
-    else
-    {
-        length = snprintf(pMarker, lengthRemaining, "$GPVTG,,T,,M,");
+        int length = loc_eng_nmea_end(s);
+        if (length < 0)
+        {
+            LOC_LOGE("NMEA Error in string formatting");
+            return false;
+        }
+        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
+        sentenceNumber++;
     }
+    return true;
+}
 
-    if (length < 0 || length >= lengthRemaining)
+// Formats the UTC time and date of timestamp (ms) into the nmea_hhmmss and
+// nmea_ddmmyy fields of loc_eng_data_p. Fixes come in once a second or
+// faster, so the strings are only redone when the second changes, and the
+// calendar date, which needs gmtime_r, only when the day does.
+static bool loc_eng_nmea_utc(loc_eng_data_s_type *loc_eng_data_p, int64_t timestamp)
+{
+    time_t utcTime(timestamp/1000);
+    if ('\0' != loc_eng_data_p->nmea_hhmmss[0] && utcTime == loc_eng_data_p->nmea_utc_sec)
     {
-        LOC_LOGE("NMEA Error in string formatting");
-        return;
+        return true;
     }
-    pMarker += length;
-    lengthRemaining -= length;
 
-    if (location.flags & GPS_LOCATION_HAS_SPEED)
+    time_t utcDay = utcTime / 86400;
+    int secondOfDay = utcTime % 86400;
+    if (secondOfDay < 0)
     {
-        float speedKnots = location.speed * (3600.0/1852.0);
-        float speedKmPerHour = location.speed * 3.6;
-
-        length = snprintf(pMarker, lengthRemaining, "%.1lf,N,%.1lf,K,", speedKnots, speedKmPerHour);
-    }
-    else
-    {
-        length = snprintf(pMarker, lengthRemaining, ",N,,K,");
+        secondOfDay += 86400;
+        utcDay--;
     }
 
-    if (length < 0 || length >= lengthRemaining)
+    loc_eng_nmea_sentence s;
+    if ('\0' == loc_eng_data_p->nmea_ddmmyy[0] || utcDay != loc_eng_data_p->nmea_utc_day)
     {
-        LOC_LOGE("NMEA Error in string formatting");
-        return;
+        struct tm utcTm;
+        if (NULL == gmtime_r(&utcTime, &utcTm))
+        {
+            return false;
+        }
+        loc_eng_nmea_begin(s, loc_eng_data_p->nmea_ddmmyy, sizeof(loc_eng_data_p->nmea_ddmmyy));
+        loc_eng_nmea_put_int(s, utcTm.tm_mday, 2);
+        loc_eng_nmea_put_int(s, utcTm.tm_mon + 1, 2); // tm_mon starts at zero
+        int utcYear = utcTm.tm_year % 100; // 2 digit year
+        if (utcYear < 0)
+        {   // before 1900, keep the "%2.2d" zero padding after the sign
+            loc_eng_nmea_put_char(s, '-');
+            utcYear = -utcYear;
+        }
+        loc_eng_nmea_put_int(s, utcYear, 2);
+        loc_eng_data_p->nmea_utc_day = utcDay;
     }
-    pMarker += length;
-    lengthRemaining -= length;
 
-    if (!(location.flags & GPS_LOCATION_HAS_LAT_LONG))
-        length = snprintf(pMarker, lengthRemaining, "%c", 'N'); // N means no fix
-    else if (LOC_POSITION_MODE_STANDALONE == loc_eng_data_p->client_handle->getPositionMode().mode)
-        length = snprintf(pMarker, lengthRemaining, "%c", 'A'); // A means autonomous
-    else
-        length = snprintf(pMarker, lengthRemaining, "%c", 'D'); // D means differential
+    loc_eng_nmea_begin(s, loc_eng_data_p->nmea_hhmmss, sizeof(loc_eng_data_p->nmea_hhmmss));
+    loc_eng_nmea_put_int(s, secondOfDay / 3600, 2);
+    loc_eng_nmea_put_int(s, secondOfDay / 60 % 60, 2);
+    loc_eng_nmea_put_int(s, secondOfDay % 60, 2);
+    loc_eng_data_p->nmea_utc_sec = utcTime;
+    return true;
+}
 
-    length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-    loc_eng_nmea_send(sentence, length, loc_eng_data_p);
+/*===========================================================================
+FUNCTION    loc_eng_nmea_format_fixed
 
-    // ------------------
-    // ------$GPRMC------
-    // ------------------
+DESCRIPTION
+   Formats value the way the sentence builders do, as "%0*.*f" would with
+   width and decimals. Lets the sim check the builders against snprintf.
 
-    pMarker = sentence;
-    lengthRemaining = sizeof(sentence);
+DEPENDENCIES
+   NONE
 
-    length = snprintf(pMarker, lengthRemaining, "$GPRMC,%02d%02d%02d,A," ,
-                      utcHours, utcMinutes, utcSeconds);
+RETURN VALUE
+   Length written to buf, or -1 if it did not fit in size
 
-    if (length < 0 || length >= lengthRemaining)
-    {
-        LOC_LOGE("NMEA Error in string formatting");
-        return;
-    }
-    pMarker += length;
-    lengthRemaining -= length;
+SIDE EFFECTS
+   N/A
 
-    if (location.flags & GPS_LOCATION_HAS_LAT_LONG)
-    {
-        double latitude = location.latitude;
-        double longitude = location.longitude;
-        char latHemisphere;
-        char lonHemisphere;
-        double latMinutes;
-        double lonMinutes;
-
-        if (latitude > 0)
-        {
-            latHemisphere = 'N';
-        }
-        else
-        {
-            latHemisphere = 'S';
-            latitude *= -1.0;
-        }
+===========================================================================*/
+int loc_eng_nmea_format_fixed(char* buf, int size, double value, int decimals, int width)
+{
+    loc_eng_nmea_sentence s;
 
-        if (longitude < 0)
-        {
-            lonHemisphere = 'W';
-            longitude *= -1.0;
-        }
-        else
-        {
-            lonHemisphere = 'E';
-        }
+    loc_eng_nmea_begin(s, buf, size);
+    loc_eng_nmea_put_fixed(s, value, decimals, width);
+    return s.overflow ? -1 : s.length;
+}
 
-        latMinutes = fmod(latitude * 60.0 , 60.0);
-        lonMinutes = fmod(longitude * 60.0 , 60.0);
+/*===========================================================================
+FUNCTION    loc_eng_nmea_generate_pos
 
-        length = snprintf(pMarker, lengthRemaining, "%02d%09.6lf,%c,%03d%09.6lf,%c,",
-                          (uint8_t)floor(latitude), latMinutes, latHemisphere,
-                          (uint8_t)floor(longitude),lonMinutes, lonHemisphere);
-    }
-    else
-    {
-        length = snprintf(pMarker, lengthRemaining,",,,,");
-    }
+DESCRIPTION
+   Generate NMEA sentences generated based on position report
 
-    if (length < 0 || length >= lengthRemaining)
-    {
-        LOC_LOGE("NMEA Error in string formatting");
-        return;
-    }
-    pMarker += length;
-    lengthRemaining -= length;
+DEPENDENCIES
+   NONE
 
-    if (location.flags & GPS_LOCATION_HAS_SPEED)
-    {
-        float speedKnots = location.speed * (3600.0/1852.0);
-        length = snprintf(pMarker, lengthRemaining, "%.1lf,", speedKnots);
-    }
-    else
-    {
-        length = snprintf(pMarker, lengthRemaining, ",");
-    }
+RETURN VALUE
+   0
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_nmea_generate_pos(loc_eng_data_s_type *loc_eng_data_p,
+                               const GpsLocation &location, const GpsLocationExtended &locationExtended)
+{
+    ENTRY_LOG();
 
-    if (length < 0 || length >= lengthRemaining)
+    char sentence[NMEA_SENTENCE_MAX_LENGTH] = {0};
+    loc_eng_nmea_sentence s;
+    int length = 0;
+
+    uint32_t epoch = loc_eng_data_p->nmea_pos_epoch++;
+    bool gsaDue = loc_eng_nmea_due(LOC_ENG_NMEA_MASK_GSA, gps_conf.NMEA_GSA_DIVIDER, epoch);
+    bool vtgDue = loc_eng_nmea_due(LOC_ENG_NMEA_MASK_VTG, gps_conf.NMEA_VTG_DIVIDER, epoch);
+    bool rmcDue = loc_eng_nmea_due(LOC_ENG_NMEA_MASK_RMC, gps_conf.NMEA_RMC_DIVIDER, epoch);
+    bool ggaDue = loc_eng_nmea_due(LOC_ENG_NMEA_MASK_GGA, gps_conf.NMEA_GGA_DIVIDER, epoch);
+
+    if ((rmcDue || ggaDue) && !loc_eng_nmea_utc(loc_eng_data_p, location.timestamp))
     {
-        LOC_LOGE("NMEA Error in string formatting");
+        LOC_LOGE("NMEA Error in utc time %lld", (long long)location.timestamp);
         return;
     }
-    pMarker += length;
-    lengthRemaining -= length;
 
-    if (location.flags & GPS_LOCATION_HAS_BEARING)
+    // ------------------
+    // ------$GPGSA------
+    // ------------------
+
+    // once GLONASS is in the fix, each system gets its own $GNGSA
+    uint32_t gpsUsedCount = 0;
+    uint32_t gpsUsedList[64] = {0};
+    uint32_t gloUsedCount = 0;
+    uint32_t gloUsedList[32] = {0};
+    for (int word = 0; word < LOC_ENG_SV_USED_MASK_WORDS; word++)
     {
-        length = snprintf(pMarker, lengthRemaining, "%.1lf,", location.bearing);
+        uint32_t mask = loc_eng_data_p->sv_used_mask[word];
+        for (uint8_t i = 1 + 32 * word; mask > 0; i++)
+        {
+            if (mask & 1)
+            {
+                if (loc_eng_nmea_is_glonass(i))
+                    gloUsedList[gloUsedCount++] = i;
+                else
+                    gpsUsedList[gpsUsedCount++] = i;
+            }
+            mask = mask >> 1;
+        }
+        // clear the cache so they can't be used again
+        loc_eng_data_p->sv_used_mask[word] = 0;
     }
+    uint32_t svUsedCount = gpsUsedCount + gloUsedCount;
+    const char* talker = gloUsedCount > 0 ? "GN" : "GP";
+
+    char fixType;
+    if (svUsedCount == 0)
+        fixType = '1'; // no fix
+    else if (svUsedCount <= 3)
+        fixType = '2'; // 2D fix
     else
+        fixType = '3'; // 3D fix
+
+    if (gsaDue && (gpsUsedCount > 0 || gloUsedCount == 0))
     {
-        length = snprintf(pMarker, lengthRemaining, ",");
+        if (!loc_eng_nmea_send_gsa(loc_eng_data_p, talker, fixType,
+                                   gpsUsedList, gpsUsedCount, locationExtended))
+            return;
     }
-
-    if (length < 0 || length >= lengthRemaining)
+    if (gsaDue && gloUsedCount > 0)
     {
-        LOC_LOGE("NMEA Error in string formatting");
-        return;
+        if (!loc_eng_nmea_send_gsa(loc_eng_data_p, talker, fixType,
+                                   gloUsedList, gloUsedCount, locationExtended))
+            return;
     }
-    pMarker += length;
-    lengthRemaining -= length;
 
-    length = snprintf(pMarker, lengthRemaining, "%2.2d%2.2d%2.2d,",
-                      utcDay, utcMonth, utcYear);
+    // ------------------
+    // ------$GPVTG------
+    // ------------------
 
-    if (length < 0 || length >= lengthRemaining)
+    if (vtgDue)
     {
-        LOC_LOGE("NMEA Error in string formatting");
-        return;
-    }
-    pMarker += length;
-    lengthRemaining -= length;
+        loc_eng_nmea_begin(s, sentence, sizeof(sentence));
 
-    if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_MAG_DEV)
-    {
-        float magneticVariation = locationExtended.magneticDeviation;
-        char direction;
-        if (magneticVariation < 0.0)
+        if (location.flags & GPS_LOCATION_HAS_BEARING)
         {
-            direction = 'W';
-            magneticVariation *= -1.0;
+            float magTrack = location.bearing;
+            if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_MAG_DEV)
+            {
+                float magTrack = location.bearing - locationExtended.magneticDeviation;
+                if (magTrack < 0.0)
+                    magTrack += 360.0;
+                else if (magTrack > 360.0)
+                    magTrack -= 360.0;
+            }
+
+            loc_eng_nmea_put_char(s, '$');
+            loc_eng_nmea_put_str(s, talker, 2);
+            LOC_ENG_NMEA_PUT_LITERAL(s, "VTG,");
+            loc_eng_nmea_put_fixed(s, location.bearing, 1, 0);
+            LOC_ENG_NMEA_PUT_LITERAL(s, ",T,");
+            loc_eng_nmea_put_fixed(s, magTrack, 1, 0);
+            LOC_ENG_NMEA_PUT_LITERAL(s, ",M,");
         }
         else
         {
-            direction = 'E';
+            loc_eng_nmea_put_char(s, '$');
+            loc_eng_nmea_put_str(s, talker, 2);
+            LOC_ENG_NMEA_PUT_LITERAL(s, "VTG,,T,,M,");
         }
 
-        length = snprintf(pMarker, lengthRemaining, "%.1lf,%c,",
-                          magneticVariation, direction);
-    }
-    else
-    {
-        length = snprintf(pMarker, lengthRemaining, ",,");
-    }
+        if (location.flags & GPS_LOCATION_HAS_SPEED)
+        {
+            float speedKnots = location.speed * (3600.0/1852.0);
+            float speedKmPerHour = location.speed * 3.6;
 
-    if (length < 0 || length >= lengthRemaining)
-    {
-        LOC_LOGE("NMEA Error in string formatting");
-        return;
-    }
-    pMarker += length;
-    lengthRemaining -= length;
+            loc_eng_nmea_put_fixed(s, speedKnots, 1, 0);
+            LOC_ENG_NMEA_PUT_LITERAL(s, ",N,");
+            loc_eng_nmea_put_fixed(s, speedKmPerHour, 1, 0);
+            LOC_ENG_NMEA_PUT_LITERAL(s, ",K,");
+        }
+        else
+        {
+            LOC_ENG_NMEA_PUT_LITERAL(s, ",N,,K,");
+        }
 
-    if (!(location.flags & GPS_LOCATION_HAS_LAT_LONG))
-        length = snprintf(pMarker, lengthRemaining, "%c", 'N'); // N means no fix
-    else if (LOC_POSITION_MODE_STANDALONE == loc_eng_data_p->client_handle->getPositionMode().mode)
-        length = snprintf(pMarker, lengthRemaining, "%c", 'A'); // A means autonomous
-    else
-        length = snprintf(pMarker, lengthRemaining, "%c", 'D'); // D means differential
+        if (!(location.flags & GPS_LOCATION_HAS_LAT_LONG))
+            loc_eng_nmea_put_char(s, 'N'); // N means no fix
+        else if (LOC_POSITION_MODE_STANDALONE == loc_eng_data_p->client_handle->getPositionMode().mode)
+            loc_eng_nmea_put_char(s, 'A'); // A means autonomous
+        else
+            loc_eng_nmea_put_char(s, 'D'); // D means differential
 
-    length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-    loc_eng_nmea_send(sentence, length, loc_eng_data_p);
+        length = loc_eng_nmea_end(s);
+        if (length < 0)
+        {
+            LOC_LOGE("NMEA Error in string formatting");
+            return;
+        }
+        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
+    }
 
     // ------------------
-    // ------$GPGGA------
+    // ------$GPRMC------
     // ------------------
 
-    pMarker = sentence;
-    lengthRemaining = sizeof(sentence);
+    if (rmcDue)
+    {
+        loc_eng_nmea_begin(s, sentence, sizeof(sentence));
+        loc_eng_nmea_put_char(s, '$');
+        loc_eng_nmea_put_str(s, talker, 2);
+        LOC_ENG_NMEA_PUT_LITERAL(s, "RMC,");
+        loc_eng_nmea_put_str(s, loc_eng_data_p->nmea_hhmmss, strlen(loc_eng_data_p->nmea_hhmmss));
+        LOC_ENG_NMEA_PUT_LITERAL(s, ",A,");
+
+        if (location.flags & GPS_LOCATION_HAS_LAT_LONG)
+        {
+            double latitude = location.latitude;
+            double longitude = location.longitude;
+            char latHemisphere;
+            char lonHemisphere;
+            double latMinutes;
+            double lonMinutes;
+
+            if (latitude > 0)
+            {
+                latHemisphere = 'N';
+            }
+            else
+            {
+                latHemisphere = 'S';
+                latitude *= -1.0;
+            }
 
-    length = snprintf(pMarker, lengthRemaining, "$GPGGA,%02d%02d%02d," ,
-                      utcHours, utcMinutes, utcSeconds);
+            if (longitude < 0)
+            {
+                lonHemisphere = 'W';
+                longitude *= -1.0;
+            }
+            else
+            {
+                lonHemisphere = 'E';
+            }
 
-    if (length < 0 || length >= lengthRemaining)
-    {
-        LOC_LOGE("NMEA Error in string formatting");
-        return;
-    }
-    pMarker += length;
-    lengthRemaining -= length;
+            latMinutes = fmod(latitude * 60.0 , 60.0);
+            lonMinutes = fmod(longitude * 60.0 , 60.0);
+
+            loc_eng_nmea_put_int(s, (uint8_t)floor(latitude), 2);
+            loc_eng_nmea_put_fixed(s, latMinutes, 6, 9);
+            loc_eng_nmea_put_char(s, ',');
+            loc_eng_nmea_put_char(s, latHemisphere);
+            loc_eng_nmea_put_char(s, ',');
+            loc_eng_nmea_put_int(s, (uint8_t)floor(longitude), 3);
+            loc_eng_nmea_put_fixed(s, lonMinutes, 6, 9);
+            loc_eng_nmea_put_char(s, ',');
+            loc_eng_nmea_put_char(s, lonHemisphere);
+            loc_eng_nmea_put_char(s, ',');
+        }
+        else
+        {
+            LOC_ENG_NMEA_PUT_LITERAL(s, ",,,,");
+        }
 
-    if (location.flags & GPS_LOCATION_HAS_LAT_LONG)
-    {
-        double latitude = location.latitude;
-        double longitude = location.longitude;
-        char latHemisphere;
-        char lonHemisphere;
-        double latMinutes;
-        double lonMinutes;
-
-        if (latitude > 0)
+        if (location.flags & GPS_LOCATION_HAS_SPEED)
         {
-            latHemisphere = 'N';
+            float speedKnots = location.speed * (3600.0/1852.0);
+            loc_eng_nmea_put_fixed(s, speedKnots, 1, 0);
         }
-        else
+        loc_eng_nmea_put_char(s, ',');
+
+        if (location.flags & GPS_LOCATION_HAS_BEARING)
         {
-            latHemisphere = 'S';
-            latitude *= -1.0;
+            loc_eng_nmea_put_fixed(s, location.bearing, 1, 0);
         }
+        loc_eng_nmea_put_char(s, ',');
+
+        loc_eng_nmea_put_str(s, loc_eng_data_p->nmea_ddmmyy, strlen(loc_eng_data_p->nmea_ddmmyy));
+        loc_eng_nmea_put_char(s, ',');
 
-        if (longitude < 0)
+        if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_MAG_DEV)
         {
-            lonHemisphere = 'W';
-            longitude *= -1.0;
+            float magneticVariation = locationExtended.magneticDeviation;
+            char direction;
+            if (magneticVariation < 0.0)
+            {
+                direction = 'W';
+                magneticVariation *= -1.0;
+            }
+            else
+            {
+                direction = 'E';
+            }
+
+            loc_eng_nmea_put_fixed(s, magneticVariation, 1, 0);
+            loc_eng_nmea_put_char(s, ',');
+            loc_eng_nmea_put_char(s, direction);
+            loc_eng_nmea_put_char(s, ',');
         }
         else
         {
-            lonHemisphere = 'E';
+            LOC_ENG_NMEA_PUT_LITERAL(s, ",,");
         }
 
-        latMinutes = fmod(latitude * 60.0 , 60.0);
-        lonMinutes = fmod(longitude * 60.0 , 60.0);
+        if (!(location.flags & GPS_LOCATION_HAS_LAT_LONG))
+            loc_eng_nmea_put_char(s, 'N'); // N means no fix
+        else if (LOC_POSITION_MODE_STANDALONE == loc_eng_data_p->client_handle->getPositionMode().mode)
+            loc_eng_nmea_put_char(s, 'A'); // A means autonomous
+        else
+            loc_eng_nmea_put_char(s, 'D'); // D means differential
 
-        length = snprintf(pMarker, lengthRemaining, "%02d%09.6lf,%c,%03d%09.6lf,%c,",
-                          (uint8_t)floor(latitude), latMinutes, latHemisphere,
-                          (uint8_t)floor(longitude),lonMinutes, lonHemisphere);
-    }
-    else
-    {
-        length = snprintf(pMarker, lengthRemaining,",,,,");
+        length = loc_eng_nmea_end(s);
+        if (length < 0)
+        {
+            LOC_LOGE("NMEA Error in string formatting");
+            return;
+        }
+        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
     }
 
-    if (length < 0 || length >= lengthRemaining)
+    // ------------------
+    // ------$GPGGA------
+    // ------------------
+
+    if (ggaDue)
     {
-        LOC_LOGE("NMEA Error in string formatting");
-        return;
-    }
-    pMarker += length;
-    lengthRemaining -= length;
+        loc_eng_nmea_begin(s, sentence, sizeof(sentence));
+        loc_eng_nmea_put_char(s, '$');
+        loc_eng_nmea_put_str(s, talker, 2);
+        LOC_ENG_NMEA_PUT_LITERAL(s, "GGA,");
+        loc_eng_nmea_put_str(s, loc_eng_data_p->nmea_hhmmss, strlen(loc_eng_data_p->nmea_hhmmss));
+        loc_eng_nmea_put_char(s, ',');
+
+        if (location.flags & GPS_LOCATION_HAS_LAT_LONG)
+        {
+            double latitude = location.latitude;
+            double longitude = location.longitude;
+            char latHemisphere;
+            char lonHemisphere;
+            double latMinutes;
+            double lonMinutes;
+
+            if (latitude > 0)
+            {
+                latHemisphere = 'N';
+            }
+            else
+            {
+                latHemisphere = 'S';
+                latitude *= -1.0;
+            }
 
-    char gpsQuality;
-    if (!(location.flags & GPS_LOCATION_HAS_LAT_LONG))
-        gpsQuality = '0'; // 0 means no fix
-    else if (LOC_POSITION_MODE_STANDALONE == loc_eng_data_p->client_handle->getPositionMode().mode)
-        gpsQuality = '1'; // 1 means GPS fix
-    else
-        gpsQuality = '2'; // 2 means DGPS fix
+            if (longitude < 0)
+            {
+                lonHemisphere = 'W';
+                longitude *= -1.0;
+            }
+            else
+            {
+                lonHemisphere = 'E';
+            }
 
-    if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_DOP)
-    {   // dop is in locationExtended, (QMI)
-        length = snprintf(pMarker, lengthRemaining, "%c,%02d,%.1f,",
-                          gpsQuality, svUsedCount, locationExtended.hdop);
-    }
-    else if (loc_eng_data_p->pdop > 0 && loc_eng_data_p->hdop > 0 && loc_eng_data_p->vdop > 0)
-    {   // dop was cached from sv report (RPC)
-        length = snprintf(pMarker, lengthRemaining, "%c,%02d,%.1f,",
-                          gpsQuality, svUsedCount, loc_eng_data_p->hdop);
-    }
-    else
-    {   // no hdop
-        length = snprintf(pMarker, lengthRemaining, "%c,%02d,,",
-                          gpsQuality, svUsedCount);
-    }
+            latMinutes = fmod(latitude * 60.0 , 60.0);
+            lonMinutes = fmod(longitude * 60.0 , 60.0);
+
+            loc_eng_nmea_put_int(s, (uint8_t)floor(latitude), 2);
+            loc_eng_nmea_put_fixed(s, latMinutes, 6, 9);
+            loc_eng_nmea_put_char(s, ',');
+            loc_eng_nmea_put_char(s, latHemisphere);
+            loc_eng_nmea_put_char(s, ',');
+            loc_eng_nmea_put_int(s, (uint8_t)floor(longitude), 3);
+            loc_eng_nmea_put_fixed(s, lonMinutes, 6, 9);
+            loc_eng_nmea_put_char(s, ',');
+            loc_eng_nmea_put_char(s, lonHemisphere);
+            loc_eng_nmea_put_char(s, ',');
+        }
+        else
+        {
+            LOC_ENG_NMEA_PUT_LITERAL(s, ",,,,");
+        }
 
-    if (length < 0 || length >= lengthRemaining)
-    {
-        LOC_LOGE("NMEA Error in string formatting");
-        return;
-    }
-    pMarker += length;
-    lengthRemaining -= length;
+        char gpsQuality;
+        if (!(location.flags & GPS_LOCATION_HAS_LAT_LONG))
+            gpsQuality = '0'; // 0 means no fix
+        else if (LOC_POSITION_MODE_STANDALONE == loc_eng_data_p->client_handle->getPositionMode().mode)
+            gpsQuality = '1'; // 1 means GPS fix
+        else
+            gpsQuality = '2'; // 2 means DGPS fix
 
-    if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_ALTITUDE_MEAN_SEA_LEVEL)
-    {
-        length = snprintf(pMarker, lengthRemaining, "%.1lf,M,",
-                          locationExtended.altitudeMeanSeaLevel);
-    }
-    else
-    {
-        length = snprintf(pMarker, lengthRemaining,",,");
-    }
+        loc_eng_nmea_put_char(s, gpsQuality);
+        loc_eng_nmea_put_char(s, ',');
+        loc_eng_nmea_put_int(s, svUsedCount, 2);
+        loc_eng_nmea_put_char(s, ',');
+        if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_DOP)
+        {   // dop is in locationExtended, (QMI)
+            loc_eng_nmea_put_fixed(s, locationExtended.hdop, 1, 0);
+        }
+        else if (loc_eng_data_p->pdop > 0 && loc_eng_data_p->hdop > 0 && loc_eng_data_p->vdop > 0)
+        {   // dop was cached from sv report (RPC)
+            loc_eng_nmea_put_fixed(s, loc_eng_data_p->hdop, 1, 0);
+        }
+        loc_eng_nmea_put_char(s, ',');
 
-    if (length < 0 || length >= lengthRemaining)
-    {
-        LOC_LOGE("NMEA Error in string formatting");
-        return;
-    }
-    pMarker += length;
-    lengthRemaining -= length;
+        if (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_ALTITUDE_MEAN_SEA_LEVEL)
+        {
+            loc_eng_nmea_put_fixed(s, locationExtended.altitudeMeanSeaLevel, 1, 0);
+            LOC_ENG_NMEA_PUT_LITERAL(s, ",M,");
+        }
+        else
+        {
+            LOC_ENG_NMEA_PUT_LITERAL(s, ",,");
+        }
 
-    if ((location.flags & GPS_LOCATION_HAS_ALTITUDE) &&
-        (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_ALTITUDE_MEAN_SEA_LEVEL))
-    {
-        length = snprintf(pMarker, lengthRemaining, "%.1lf,M,,",
-                          location.altitude - locationExtended.altitudeMeanSeaLevel);
-    }
-    else
-    {
-        length = snprintf(pMarker, lengthRemaining,",,,");
-    }
+        if ((location.flags & GPS_LOCATION_HAS_ALTITUDE) &&
+            (locationExtended.flags & GPS_LOCATION_EXTENDED_HAS_ALTITUDE_MEAN_SEA_LEVEL))
+        {
+            loc_eng_nmea_put_fixed(s, location.altitude - locationExtended.altitudeMeanSeaLevel, 1, 0);
+            LOC_ENG_NMEA_PUT_LITERAL(s, ",M,,");
+        }
+        else
+        {
+            LOC_ENG_NMEA_PUT_LITERAL(s, ",,,");
+        }
 
-    length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-    loc_eng_nmea_send(sentence, length, loc_eng_data_p);
+        length = loc_eng_nmea_end(s);
+        if (length < 0)
+        {
+            LOC_LOGE("NMEA Error in string formatting");
+            return;
+        }
+        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
+    }
 
     // clear the dop cache so they can't be used again
     loc_eng_data_p->pdop = 0;
     loc_eng_data_p->hdop = 0;
     loc_eng_data_p->vdop = 0;
 
+    // the position sentences close the burst the sv report opened
+    loc_eng_nmea_flush(loc_eng_data_p);
+
     EXIT_LOG(%d, 0);
 }
 
@@ -575,111 +975,93 @@ SIDE EFFECTS
 
 ===========================================================================*/
 void loc_eng_nmea_generate_sv(loc_eng_data_s_type *loc_eng_data_p,
-                              const GpsSvStatus &svStatus, const GpsLocationExtended &locationExtended)
+                              const GpsSvStatus &svStatus, const GpsLocationExtended &locationExtended,
+                              uint32_t gloUsedInFixMask)
 {
     ENTRY_LOG();
 
     char sentence[NMEA_SENTENCE_MAX_LENGTH] = {0};
-    char* pMarker = sentence;
-    int lengthRemaining = sizeof(sentence);
     int length = 0;
 
+    // a new sv report starts the next fix; send what is left of the last
+    loc_eng_nmea_flush(loc_eng_data_p);
+
     // ------------------
     // ------$GPGSV------
     // ------------------
 
-    if (svStatus.num_svs <= 0)
+    uint32_t epoch = loc_eng_data_p->nmea_sv_epoch++;
+    bool gsvDue = loc_eng_nmea_due(LOC_ENG_NMEA_MASK_GSV, gps_conf.NMEA_GSV_DIVIDER, epoch);
+
+    if (gsvDue && svStatus.num_svs <= 0)
     {
         // no svs in view, so just send a blank $GPGSV sentence
         strlcpy(sentence, "$GPGSV,1,1,0,", sizeof(sentence));
         length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
         loc_eng_nmea_send(sentence, length, loc_eng_data_p);
     }
-    else
-    {
-        int svCount = svStatus.num_svs;
-        int sentenceCount = svCount / 4;
-        if (svStatus.num_svs % 4)
-            sentenceCount++;
-        int sentenceNumber = 1;
-        int svNumber = 1;
-
-        while (sentenceNumber <= sentenceCount)
+    else if (gsvDue)
+    {   // GLONASS svs go in their own $GLGSV sentences
+        int gloCount = 0;
+        for (int i = 0; i < svStatus.num_svs; i++)
         {
-            pMarker = sentence;
-            lengthRemaining = sizeof(sentence);
-
-            length = snprintf(pMarker, lengthRemaining, "$GPGSV,%d,%d,%02d",
-                          sentenceCount, sentenceNumber, svCount);
-
-            if (length < 0 || length >= lengthRemaining)
-            {
-                LOC_LOGE("NMEA Error in string formatting");
-                return;
-            }
-            pMarker += length;
-            lengthRemaining -= length;
+            if (loc_eng_nmea_is_glonass(svStatus.sv_list[i].prn))
+                gloCount++;
+        }
+        int gpsCount = svStatus.num_svs - gloCount;
 
-            for (int i=0; (svNumber <= svCount) && (i < 4); i++, svNumber++)
-            {
-                length = snprintf(pMarker, lengthRemaining,",%02d,%02d,%03d,",
-                                  svStatus.sv_list[svNumber-1].prn,
-                                  (int)(0.5 + svStatus.sv_list[svNumber-1].elevation), //float to int
-                                  (int)(0.5 + svStatus.sv_list[svNumber-1].azimuth)); //float to int
-
-                if (length < 0 || length >= lengthRemaining)
-                {
-                    LOC_LOGE("NMEA Error in string formatting");
-                    return;
-                }
-                pMarker += length;
-                lengthRemaining -= length;
-
-                if (svStatus.sv_list[svNumber-1].snr > 0)
-                {
-                    length = snprintf(pMarker, lengthRemaining,"%02d",
-                                     (int)(0.5 + svStatus.sv_list[svNumber-1].snr)); //float to int
-
-                    if (length < 0 || length >= lengthRemaining)
-                    {
-                        LOC_LOGE("NMEA Error in string formatting");
-                        return;
-                    }
-                    pMarker += length;
-                    lengthRemaining -= length;
-                }
-            }
+        if (gpsCount > 0 &&
+            !loc_eng_nmea_send_gsv(loc_eng_data_p, "GP", svStatus, false, gpsCount))
+            return;
+        if (gloCount > 0 &&
+            !loc_eng_nmea_send_gsv(loc_eng_data_p, "GL", svStatus, true, gloCount))
+            return;
+    }
 
+    if (svStatus.used_in_fix_mask == 0 && gloUsedInFixMask == 0)
+    {   // No sv used, so there will be no position report, so send
+        // blank NMEA sentences in its place
+        uint32_t posEpoch = loc_eng_data_p->nmea_pos_epoch++;
+        bool gsaDue = loc_eng_nmea_due(LOC_ENG_NMEA_MASK_GSA, gps_conf.NMEA_GSA_DIVIDER, posEpoch);
+        bool vtgDue = loc_eng_nmea_due(LOC_ENG_NMEA_MASK_VTG, gps_conf.NMEA_VTG_DIVIDER, posEpoch);
+        bool rmcDue = loc_eng_nmea_due(LOC_ENG_NMEA_MASK_RMC, gps_conf.NMEA_RMC_DIVIDER, posEpoch);
+        bool ggaDue = loc_eng_nmea_due(LOC_ENG_NMEA_MASK_GGA, gps_conf.NMEA_GGA_DIVIDER, posEpoch);
+
+        if (gsaDue)
+        {
+            strlcpy(sentence, "$GPGSA,A,1,,,,,,,,,,,,,,,", sizeof(sentence));
             length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
             loc_eng_nmea_send(sentence, length, loc_eng_data_p);
-            sentenceNumber++;
-
         }
-    }
-
-    if (svStatus.used_in_fix_mask == 0)
-    {   // No sv used, so there will be no position report, so send
-        // blank NMEA sentences
-        strlcpy(sentence, "$GPGSA,A,1,,,,,,,,,,,,,,,", sizeof(sentence));
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
 
-        strlcpy(sentence, "$GPVTG,,T,,M,,N,,K,N", sizeof(sentence));
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
+        if (vtgDue)
+        {
+            strlcpy(sentence, "$GPVTG,,T,,M,,N,,K,N", sizeof(sentence));
+            length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
+            loc_eng_nmea_send(sentence, length, loc_eng_data_p);
+        }
 
-        strlcpy(sentence, "$GPRMC,,V,,,,,,,,,,N", sizeof(sentence));
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
+        if (rmcDue)
+        {
+            strlcpy(sentence, "$GPRMC,,V,,,,,,,,,,N", sizeof(sentence));
+            length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
+            loc_eng_nmea_send(sentence, length, loc_eng_data_p);
+        }
 
-        strlcpy(sentence, "$GPGGA,,,,,,0,,,,,,,,", sizeof(sentence));
-        length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
-        loc_eng_nmea_send(sentence, length, loc_eng_data_p);
+        if (ggaDue)
+        {
+            strlcpy(sentence, "$GPGGA,,,,,,0,,,,,,,,", sizeof(sentence));
+            length = loc_eng_nmea_put_checksum(sentence, sizeof(sentence));
+            loc_eng_nmea_send(sentence, length, loc_eng_data_p);
+        }
+        loc_eng_nmea_flush(loc_eng_data_p);
     }
     else
     {   // cache the used in fix mask, as it will be needed to send $GPGSA
         // during the position report
-        loc_eng_data_p->sv_used_mask = svStatus.used_in_fix_mask;
+        loc_eng_data_p->sv_used_mask[0] = svStatus.used_in_fix_mask;
+        loc_eng_data_p->sv_used_mask[1] = 0;
+        loc_eng_data_p->sv_used_mask[LOC_ENG_SV_USED_MASK_GLONASS] = gloUsedInFixMask;
 
         // For RPC, the DOP are sent during sv report, so cache them
         // now to be sent during position report.
@@ -34,9 +34,20 @@
 
 #define NMEA_SENTENCE_MAX_LENGTH 200
 
+// Bits of NMEA_SENTENCE_MASK in gps.conf
+#define LOC_ENG_NMEA_MASK_GSV 0x01
+#define LOC_ENG_NMEA_MASK_GSA 0x02
+#define LOC_ENG_NMEA_MASK_VTG 0x04
+#define LOC_ENG_NMEA_MASK_RMC 0x08
+#define LOC_ENG_NMEA_MASK_GGA 0x10
+#define LOC_ENG_NMEA_MASK_ALL 0x1F
+
 void loc_eng_nmea_send(char *pNmea, int length, loc_eng_data_s_type *loc_eng_data_p);
+void loc_eng_nmea_flush(loc_eng_data_s_type *loc_eng_data_p);
 int loc_eng_nmea_put_checksum(char *pNmea, int maxSize);
-void loc_eng_nmea_generate_sv(loc_eng_data_s_type *loc_eng_data_p, const GpsSvStatus &svStatus, const GpsLocationExtended &locationExtended);
+int loc_eng_nmea_format_fixed(char* buf, int size, double value, int decimals, int width);
+void loc_eng_nmea_generate_sv(loc_eng_data_s_type *loc_eng_data_p, const GpsSvStatus &svStatus, const GpsLocationExtended &locationExtended,
+                              uint32_t gloUsedInFixMask);
 void loc_eng_nmea_generate_pos(loc_eng_data_s_type *loc_eng_data_p, const GpsLocation &location, const GpsLocationExtended &locationExtended);
 
 #endif // LOC_ENG_NMEA_H
@@ -0,0 +1,257 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_eng_stats"
+
+#include <pthread.h>
+#include <string.h>
+#include <loc_eng_msg_id.h>
+#include <loc_eng_stats.h>
+#include <msg_q.h>
+#include "log_util.h"
+#include "loc_eng_log.h"
+
+struct loc_eng_stats_hist {
+    uint32_t samples;
+    uint32_t count[LOC_ENG_STATS_BUCKETS];
+    int64_t total_us;
+    int64_t max_us;
+};
+
+struct loc_eng_stats_entry {
+    int msgid;                      // 0 until the first message is recorded
+    uint32_t handled;
+    loc_eng_stats_hist queue;       // enqueue to dequeue
+    loc_eng_stats_hist handler;     // time spent in the handler
+};
+
+// one entry for each of the three msgid ranges in loc_eng_msg_id.h
+#define LOC_ENG_STATS_ENG_SLOTS \
+    (LOC_ENG_MSG_REQUEST_NETWORK_POSIITON - LOC_ENG_MSG_QUIT + 1)
+#define LOC_ENG_STATS_ULP_SLOTS \
+    (ULP_MSG_MONITOR - ULP_MSG_UPDATE_CRITERIA + 1)
+#define LOC_ENG_STATS_EXT_SLOTS \
+    (LOC_ENG_MSG_FLUSH_NMEA - LOC_ENG_MSG_LPP_CONFIG + 1)
+#define LOC_ENG_STATS_SLOTS \
+    (LOC_ENG_STATS_ENG_SLOTS + LOC_ENG_STATS_ULP_SLOTS + LOC_ENG_STATS_EXT_SLOTS)
+
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static loc_eng_stats_entry stats[LOC_ENG_STATS_SLOTS];
+
+/*===========================================================================
+FUNCTION    loc_eng_stats_slot
+
+DESCRIPTION
+   Maps a msgid onto its entry in the stats table.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   The table index, -1 if the msgid is not a known one
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int loc_eng_stats_slot(int msgid)
+{
+    if (msgid >= LOC_ENG_MSG_QUIT &&
+        msgid <= LOC_ENG_MSG_REQUEST_NETWORK_POSIITON) {
+        return msgid - LOC_ENG_MSG_QUIT;
+    }
+    if (msgid >= ULP_MSG_UPDATE_CRITERIA && msgid <= ULP_MSG_MONITOR) {
+        return LOC_ENG_STATS_ENG_SLOTS + msgid - ULP_MSG_UPDATE_CRITERIA;
+    }
+    if (msgid >= LOC_ENG_MSG_LPP_CONFIG && msgid <= LOC_ENG_MSG_FLUSH_NMEA) {
+        return LOC_ENG_STATS_ENG_SLOTS + LOC_ENG_STATS_ULP_SLOTS +
+            msgid - LOC_ENG_MSG_LPP_CONFIG;
+    }
+    return -1;
+}
+
+static void loc_eng_stats_add(loc_eng_stats_hist &hist, int64_t us)
+{
+    int bucket = 0;
+
+    if (us < 0) {
+        us = 0;
+    }
+    while (bucket < LOC_ENG_STATS_BUCKETS - 1 && (us >> bucket) != 0) {
+        bucket++;
+    }
+
+    hist.samples++;
+    hist.count[bucket]++;
+    hist.total_us += us;
+    if (us > hist.max_us) {
+        hist.max_us = us;
+    }
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_stats_record
+
+DESCRIPTION
+   Records how long a message waited in its queue and how long its handler
+   took.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_stats_record(int msgid, int64_t queue_us, int64_t handler_us)
+{
+    int slot = loc_eng_stats_slot(msgid);
+    if (slot < 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&stats_lock);
+    loc_eng_stats_entry &entry = stats[slot];
+    entry.msgid = msgid;
+    entry.handled++;
+    loc_eng_stats_add(entry.queue, queue_us);
+    loc_eng_stats_add(entry.handler, handler_us);
+    pthread_mutex_unlock(&stats_lock);
+}
+
+static void loc_eng_stats_hist_str(const loc_eng_stats_hist &hist,
+                                   char* buf, int size)
+{
+    int len = 0;
+    buf[0] = '\0';
+    for (int i = 0; i < LOC_ENG_STATS_BUCKETS && len < size; i++) {
+        len += snprintf(buf + len, size - len, "%s%u", i ? " " : "", hist.count[i]);
+    }
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_stats_dump
+
+DESCRIPTION
+   Logs the queue latency and handler time histograms of every msgid
+   handled so far, one line each.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_stats_dump()
+{
+    char queueHist[LOC_ENG_STATS_BUCKETS * 11];
+    char handlerHist[LOC_ENG_STATS_BUCKETS * 11];
+
+    pthread_mutex_lock(&stats_lock);
+    LOC_LOGI("msg stats: histograms in log2 us buckets, from <1us to >=%dus",
+             1 << (LOC_ENG_STATS_BUCKETS - 2));
+    for (int i = 0; i < LOC_ENG_STATS_SLOTS; i++) {
+        const loc_eng_stats_entry &entry = stats[i];
+        if (0 == entry.handled) {
+            continue;
+        }
+
+        loc_eng_stats_hist_str(entry.queue, queueHist, sizeof(queueHist));
+        loc_eng_stats_hist_str(entry.handler, handlerHist, sizeof(handlerHist));
+        LOC_LOGI("msg stats: %s handled %u queue avg %lldus max %lldus [%s] "
+                 "handler avg %lldus max %lldus [%s]",
+                 loc_get_msg_name(entry.msgid), entry.handled,
+                 entry.queue.samples ? entry.queue.total_us / entry.queue.samples : 0LL,
+                 entry.queue.max_us, queueHist,
+                 entry.handler.total_us / entry.handler.samples,
+                 entry.handler.max_us, handlerHist);
+    }
+    pthread_mutex_unlock(&stats_lock);
+}
+
+/*===========================================================================
+FUNCTION    loc_eng_stats_log_summary
+
+DESCRIPTION
+   Logs one line naming the messages with the worst queue latency and
+   handler time so far, along with the depth of msg_q if one is given.
+
+DEPENDENCIES
+   NONE
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_eng_stats_log_summary(void* msg_q)
+{
+    uint32_t handled = 0;
+    int worstQueue = -1, worstHandler = -1;
+    int64_t worstQueueUs = 0, worstHandlerUs = 0;
+    msg_q_stats_type qStats;
+
+    pthread_mutex_lock(&stats_lock);
+    for (int i = 0; i < LOC_ENG_STATS_SLOTS; i++) {
+        const loc_eng_stats_entry &entry = stats[i];
+        handled += entry.handled;
+        if (entry.handled && entry.queue.max_us >= worstQueueUs) {
+            worstQueue = entry.msgid;
+            worstQueueUs = entry.queue.max_us;
+        }
+        if (entry.handled && entry.handler.max_us >= worstHandlerUs) {
+            worstHandler = entry.msgid;
+            worstHandlerUs = entry.handler.max_us;
+        }
+    }
+    pthread_mutex_unlock(&stats_lock);
+
+    memset(&qStats, 0, sizeof(qStats));
+    if (NULL != msg_q) {
+        msg_q_get_stats(msg_q, &qStats);
+    }
+
+    LOC_LOGI("msg stats: %u handled, worst queue %s %lldus, worst handler %s %lldus, "
+             "depth %u/%u/%u",
+             handled,
+             worstQueue < 0 ? "none" : loc_get_msg_name(worstQueue), worstQueueUs,
+             worstHandler < 0 ? "none" : loc_get_msg_name(worstHandler), worstHandlerUs,
+             qStats.depth[eMSG_Q_LANE_HIGH], qStats.depth[eMSG_Q_LANE_NORMAL],
+             qStats.depth[eMSG_Q_LANE_LOW]);
+}
@@ -0,0 +1,509 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_trace"
+
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <loc_eng_trace.h>
+#include "log_util.h"
+
+#define LOC_ENG_TRACE_RECORD_HEADER_SIZE 12
+#define LOC_ENG_TRACE_FILE_BUF_SIZE (64 * 1024)
+
+volatile int loc_eng_trace_active = 0;
+
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static FILE* trace_file = NULL;
+
+struct loc_eng_trace_writer {
+    uint8_t data[LOC_ENG_TRACE_MAX_PAYLOAD];
+    int length;
+    bool overflow;
+};
+
+struct loc_eng_trace_reader {
+    const uint8_t* data;
+    int length;
+    int offset;
+    bool underflow;
+};
+
+static void put_bytes(loc_eng_trace_writer &w, const void* p, int n)
+{
+    if (w.length + n > LOC_ENG_TRACE_MAX_PAYLOAD) {
+        w.overflow = true;
+        return;
+    }
+    memcpy(w.data + w.length, p, n);
+    w.length += n;
+}
+
+static void put_u64(loc_eng_trace_writer &w, uint64_t v, int n)
+{
+    uint8_t b[8];
+    for (int i = 0; i < n; i++) {
+        b[i] = (uint8_t)(v >> (8 * i));
+    }
+    put_bytes(w, b, n);
+}
+
+static inline void put_u16(loc_eng_trace_writer &w, uint16_t v) { put_u64(w, v, 2); }
+static inline void put_u32(loc_eng_trace_writer &w, uint32_t v) { put_u64(w, v, 4); }
+static inline void put_i32(loc_eng_trace_writer &w, int32_t v) { put_u64(w, (uint32_t)v, 4); }
+static inline void put_i64(loc_eng_trace_writer &w, int64_t v) { put_u64(w, (uint64_t)v, 8); }
+
+static void put_float(loc_eng_trace_writer &w, float v)
+{
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    put_u32(w, bits);
+}
+
+static void put_double(loc_eng_trace_writer &w, double v)
+{
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    put_u64(w, bits, 8);
+}
+
+static void put_string(loc_eng_trace_writer &w, const char* s, int max)
+{
+    int len = strnlen(s, max);
+    put_u16(w, len);
+    put_bytes(w, s, len);
+}
+
+static void get_bytes(loc_eng_trace_reader &r, void* p, int n)
+{
+    if (r.offset + n > r.length) {
+        r.underflow = true;
+        memset(p, 0, n);
+        return;
+    }
+    memcpy(p, r.data + r.offset, n);
+    r.offset += n;
+}
+
+static uint64_t get_u64(loc_eng_trace_reader &r, int n)
+{
+    uint8_t b[8];
+    uint64_t v = 0;
+    get_bytes(r, b, n);
+    for (int i = 0; i < n; i++) {
+        v |= (uint64_t)b[i] << (8 * i);
+    }
+    return v;
+}
+
+static inline uint16_t get_u16(loc_eng_trace_reader &r) { return (uint16_t)get_u64(r, 2); }
+static inline uint32_t get_u32(loc_eng_trace_reader &r) { return (uint32_t)get_u64(r, 4); }
+static inline int32_t get_i32(loc_eng_trace_reader &r) { return (int32_t)get_u64(r, 4); }
+static inline int64_t get_i64(loc_eng_trace_reader &r) { return (int64_t)get_u64(r, 8); }
+
+static float get_float(loc_eng_trace_reader &r)
+{
+    uint32_t bits = get_u32(r);
+    float v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+static double get_double(loc_eng_trace_reader &r)
+{
+    uint64_t bits = get_u64(r, 8);
+    double v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+// Always leaves s terminated, truncating to size - 1 characters
+static void get_string(loc_eng_trace_reader &r, char* s, int size)
+{
+    int len = get_u16(r);
+    int keep = len < size ? len : size - 1;
+    get_bytes(r, s, keep);
+    s[keep] = '\0';
+    r.offset += len - keep;
+    if (r.offset > r.length) {
+        r.underflow = true;
+    }
+}
+
+static inline void init_writer(loc_eng_trace_writer &w)
+{
+    w.length = 0;
+    w.overflow = false;
+}
+
+static inline void init_reader(loc_eng_trace_reader &r, const loc_eng_trace_record &record)
+{
+    r.data = record.data;
+    r.length = record.length;
+    r.offset = 0;
+    r.underflow = false;
+}
+
+static void write_record(enum loc_eng_trace_type type, const uint8_t* payload, int length)
+{
+    loc_eng_trace_writer header;
+    init_writer(header);
+    put_i64(header, loc_eng_msg_time_us());
+    put_u16(header, type);
+    put_u16(header, length);
+
+    pthread_mutex_lock(&trace_lock);
+    if (NULL != trace_file) {
+        if (1 != fwrite(header.data, header.length, 1, trace_file) ||
+            (length > 0 && 1 != fwrite(payload, length, 1, trace_file))) {
+            LOC_LOGE("%s: write failed, recording stopped: %s", __func__, strerror(errno));
+            loc_eng_trace_active = 0;
+            fclose(trace_file);
+            trace_file = NULL;
+        }
+    }
+    pthread_mutex_unlock(&trace_lock);
+}
+
+static void write_payload(enum loc_eng_trace_type type, const loc_eng_trace_writer &w)
+{
+    if (w.overflow) {
+        LOC_LOGE("%s: type %d payload too large, dropped", __func__, type);
+        return;
+    }
+    write_record(type, w.data, w.length);
+}
+
+bool loc_eng_trace_start(const char* path)
+{
+    loc_eng_trace_writer header;
+    bool started = false;
+
+    init_writer(header);
+    put_bytes(header, LOC_ENG_TRACE_MAGIC, 4);
+    put_u32(header, LOC_ENG_TRACE_VERSION);
+
+    pthread_mutex_lock(&trace_lock);
+    if (NULL != trace_file) {
+        LOC_LOGE("%s: already recording", __func__);
+    } else if (NULL == (trace_file = fopen(path, "wb"))) {
+        LOC_LOGE("%s: cannot open %s: %s", __func__, path, strerror(errno));
+    } else {
+        setvbuf(trace_file, NULL, _IOFBF, LOC_ENG_TRACE_FILE_BUF_SIZE);
+        if (1 != fwrite(header.data, header.length, 1, trace_file)) {
+            LOC_LOGE("%s: cannot write %s: %s", __func__, path, strerror(errno));
+            fclose(trace_file);
+            trace_file = NULL;
+        } else {
+            LOC_LOGI("%s: recording upcalls to %s", __func__, path);
+            loc_eng_trace_active = 1;
+            started = true;
+        }
+    }
+    pthread_mutex_unlock(&trace_lock);
+    return started;
+}
+
+void loc_eng_trace_stop()
+{
+    pthread_mutex_lock(&trace_lock);
+    loc_eng_trace_active = 0;
+    if (NULL != trace_file) {
+        fclose(trace_file);
+        trace_file = NULL;
+        LOC_LOGI("%s: recording stopped", __func__);
+    }
+    pthread_mutex_unlock(&trace_lock);
+}
+
+static void put_location_extended(loc_eng_trace_writer &w,
+                                  const GpsLocationExtended &locationExtended)
+{
+    put_u16(w, locationExtended.flags);
+    put_float(w, locationExtended.altitudeMeanSeaLevel);
+    put_float(w, locationExtended.pdop);
+    put_float(w, locationExtended.hdop);
+    put_float(w, locationExtended.vdop);
+    put_float(w, locationExtended.magneticDeviation);
+}
+
+static void get_location_extended(loc_eng_trace_reader &r,
+                                  GpsLocationExtended &locationExtended)
+{
+    memset(&locationExtended, 0, sizeof(locationExtended));
+    locationExtended.size = sizeof(locationExtended);
+    locationExtended.flags = get_u16(r);
+    locationExtended.altitudeMeanSeaLevel = get_float(r);
+    locationExtended.pdop = get_float(r);
+    locationExtended.hdop = get_float(r);
+    locationExtended.vdop = get_float(r);
+    locationExtended.magneticDeviation = get_float(r);
+}
+
+void loc_eng_trace_position(const GpsLocation &location,
+                            const GpsLocationExtended &locationExtended,
+                            enum loc_sess_status status,
+                            LocPosTechMask techMask)
+{
+    loc_eng_trace_writer w;
+    init_writer(w);
+    put_u16(w, location.flags);
+    put_u16(w, location.position_source);
+    put_double(w, location.latitude);
+    put_double(w, location.longitude);
+    put_double(w, location.altitude);
+    put_float(w, location.speed);
+    put_float(w, location.bearing);
+    put_float(w, location.accuracy);
+    put_i64(w, location.timestamp);
+    put_location_extended(w, locationExtended);
+    put_u16(w, status);
+    put_u32(w, techMask);
+    write_payload(LOC_ENG_TRACE_POSITION, w);
+}
+
+void loc_eng_trace_sv(const GpsSvStatus &svStatus,
+                      const GpsLocationExtended &locationExtended,
+                      uint32_t gloUsedInFixMask)
+{
+    loc_eng_trace_writer w;
+    int num = svStatus.num_svs;
+
+    if (num < 0) {
+        num = 0;
+    } else if (num > GPS_MAX_SVS) {
+        num = GPS_MAX_SVS;
+    }
+    init_writer(w);
+    put_u32(w, svStatus.ephemeris_mask);
+    put_u32(w, svStatus.almanac_mask);
+    put_u32(w, svStatus.used_in_fix_mask);
+    put_u16(w, num);
+    for (int i = 0; i < num; i++) {
+        const GpsSvInfo &sv = svStatus.sv_list[i];
+        put_i32(w, sv.prn);
+        put_float(w, sv.snr);
+        put_float(w, sv.elevation);
+        put_float(w, sv.azimuth);
+    }
+    put_location_extended(w, locationExtended);
+    put_u32(w, gloUsedInFixMask);
+    write_payload(LOC_ENG_TRACE_SV, w);
+}
+
+void loc_eng_trace_status(GpsStatusValue status)
+{
+    loc_eng_trace_writer w;
+    init_writer(w);
+    put_u16(w, status);
+    write_payload(LOC_ENG_TRACE_STATUS, w);
+}
+
+void loc_eng_trace_nmea(const char* nmea, int length)
+{
+    if (length < 0 || length > LOC_ENG_TRACE_MAX_PAYLOAD) {
+        LOC_LOGE("%s: %d byte sentence dropped", __func__, length);
+        return;
+    }
+    write_record(LOC_ENG_TRACE_NMEA, (const uint8_t*)nmea, length);
+}
+
+void loc_eng_trace_atl(enum loc_eng_trace_type type, int handle, AGpsType agpsType)
+{
+    loc_eng_trace_writer w;
+    init_writer(w);
+    put_i32(w, handle);
+    put_u16(w, (uint16_t)agpsType);
+    write_payload(type, w);
+}
+
+void loc_eng_trace_ni(const GpsNiNotification &notify)
+{
+    loc_eng_trace_writer w;
+    init_writer(w);
+    put_i32(w, notify.notification_id);
+    put_u32(w, notify.ni_type);
+    put_u32(w, notify.notify_flags);
+    put_i32(w, notify.timeout);
+    put_u32(w, notify.default_response);
+    put_u32(w, notify.requestor_id_encoding);
+    put_u32(w, notify.text_encoding);
+    put_string(w, notify.requestor_id, sizeof(notify.requestor_id));
+    put_string(w, notify.text, sizeof(notify.text));
+    put_string(w, notify.extras, sizeof(notify.extras));
+    write_payload(LOC_ENG_TRACE_REQUEST_NI, w);
+}
+
+void loc_eng_trace_event(enum loc_eng_trace_type type)
+{
+    write_record(type, NULL, 0);
+}
+
+FILE* loc_eng_trace_open(const char* path)
+{
+    uint8_t header[LOC_ENG_TRACE_FILE_HEADER_SIZE];
+    FILE* fp = fopen(path, "rb");
+
+    if (NULL == fp) {
+        LOC_LOGE("%s: cannot open %s: %s", __func__, path, strerror(errno));
+        return NULL;
+    }
+    if (1 != fread(header, sizeof(header), 1, fp) ||
+        0 != memcmp(header, LOC_ENG_TRACE_MAGIC, 4)) {
+        LOC_LOGD("%s: %s is not a trace", __func__, path);
+        fclose(fp);
+        return NULL;
+    }
+
+    uint32_t version = header[4] | header[5] << 8 | header[6] << 16 | (uint32_t)header[7] << 24;
+    if (LOC_ENG_TRACE_VERSION != version) {
+        LOC_LOGE("%s: %s has unsupported version", __func__, path);
+        fclose(fp);
+        return NULL;
+    }
+    return fp;
+}
+
+bool loc_eng_trace_read(FILE* fp, loc_eng_trace_record &record)
+{
+    loc_eng_trace_reader r;
+
+    if (1 != fread(record.data, LOC_ENG_TRACE_RECORD_HEADER_SIZE, 1, fp)) {
+        return false;
+    }
+    record.length = LOC_ENG_TRACE_RECORD_HEADER_SIZE;
+    init_reader(r, record);
+    record.timeUs = get_i64(r);
+    record.type = get_u16(r);
+    record.length = get_u16(r);
+
+    if (record.length > LOC_ENG_TRACE_MAX_PAYLOAD ||
+        (record.length > 0 && 1 != fread(record.data, record.length, 1, fp))) {
+        LOC_LOGE("%s: truncated record", __func__);
+        return false;
+    }
+    return true;
+}
+
+bool loc_eng_trace_decode_position(const loc_eng_trace_record &record,
+                                   GpsLocation &location,
+                                   GpsLocationExtended &locationExtended,
+                                   enum loc_sess_status &status,
+                                   LocPosTechMask &techMask)
+{
+    loc_eng_trace_reader r;
+    init_reader(r, record);
+    memset(&location, 0, sizeof(location));
+    location.size = sizeof(location);
+    location.flags = get_u16(r);
+    location.position_source = get_u16(r);
+    location.latitude = get_double(r);
+    location.longitude = get_double(r);
+    location.altitude = get_double(r);
+    location.speed = get_float(r);
+    location.bearing = get_float(r);
+    location.accuracy = get_float(r);
+    location.timestamp = get_i64(r);
+    get_location_extended(r, locationExtended);
+    status = (enum loc_sess_status)get_u16(r);
+    techMask = get_u32(r);
+    return LOC_ENG_TRACE_POSITION == record.type && !r.underflow;
+}
+
+bool loc_eng_trace_decode_sv(const loc_eng_trace_record &record,
+                             GpsSvStatus &svStatus,
+                             GpsLocationExtended &locationExtended,
+                             uint32_t &gloUsedInFixMask)
+{
+    loc_eng_trace_reader r;
+    init_reader(r, record);
+    memset(&svStatus, 0, sizeof(svStatus));
+    svStatus.size = sizeof(svStatus);
+    svStatus.ephemeris_mask = get_u32(r);
+    svStatus.almanac_mask = get_u32(r);
+    svStatus.used_in_fix_mask = get_u32(r);
+    svStatus.num_svs = get_u16(r);
+    if (svStatus.num_svs > GPS_MAX_SVS) {
+        return false;
+    }
+    for (int i = 0; i < svStatus.num_svs; i++) {
+        GpsSvInfo &sv = svStatus.sv_list[i];
+        sv.size = sizeof(sv);
+        sv.prn = get_i32(r);
+        sv.snr = get_float(r);
+        sv.elevation = get_float(r);
+        sv.azimuth = get_float(r);
+    }
+    get_location_extended(r, locationExtended);
+    // older records end before the GLONASS mask
+    gloUsedInFixMask = r.offset < r.length ? get_u32(r) : 0;
+    return LOC_ENG_TRACE_SV == record.type && !r.underflow;
+}
+
+bool loc_eng_trace_decode_status(const loc_eng_trace_record &record,
+                                 GpsStatusValue &status)
+{
+    loc_eng_trace_reader r;
+    init_reader(r, record);
+    status = (GpsStatusValue)get_u16(r);
+    return LOC_ENG_TRACE_STATUS == record.type && !r.underflow;
+}
+
+bool loc_eng_trace_decode_atl(const loc_eng_trace_record &record,
+                              int &handle, AGpsType &agpsType)
+{
+    loc_eng_trace_reader r;
+    init_reader(r, record);
+    handle = get_i32(r);
+    agpsType = (AGpsType)get_u16(r);
+    return (LOC_ENG_TRACE_REQUEST_ATL == record.type ||
+            LOC_ENG_TRACE_RELEASE_ATL == record.type) && !r.underflow;
+}
+
+bool loc_eng_trace_decode_ni(const loc_eng_trace_record &record,
+                             GpsNiNotification &notify)
+{
+    loc_eng_trace_reader r;
+    init_reader(r, record);
+    memset(&notify, 0, sizeof(notify));
+    notify.size = sizeof(notify);
+    notify.notification_id = get_i32(r);
+    notify.ni_type = (GpsNiType)get_u32(r);
+    notify.notify_flags = (GpsNiNotifyFlags)get_u32(r);
+    notify.timeout = get_i32(r);
+    notify.default_response = (GpsUserResponseType)get_u32(r);
+    notify.requestor_id_encoding = (GpsNiEncodingType)get_u32(r);
+    notify.text_encoding = (GpsNiEncodingType)get_u32(r);
+    get_string(r, notify.requestor_id, sizeof(notify.requestor_id));
+    get_string(r, notify.text, sizeof(notify.text));
+    get_string(r, notify.extras, sizeof(notify.extras));
+    return LOC_ENG_TRACE_REQUEST_NI == record.type && !r.underflow;
+}
@@ -0,0 +1,119 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef LOC_ENG_TRACE_H
+#define LOC_ENG_TRACE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <hardware/gps.h>
+#include <loc.h>
+#include <loc_eng_msg.h>
+
+// A trace file is a header, "LETR" and a 32 bit version, followed by one
+// record per LocApiAdapter upcall: a 64 bit CLOCK_MONOTONIC time in us, a 16
+// bit type and a 16 bit payload length, then the payload. Payloads are
+// packed field by field, little endian, so a trace taken on the phone
+// replays on a host whatever its struct layout.
+#define LOC_ENG_TRACE_MAGIC "LETR"
+#define LOC_ENG_TRACE_VERSION 1
+#define LOC_ENG_TRACE_FILE_HEADER_SIZE 8
+#define LOC_ENG_TRACE_MAX_PAYLOAD 8192
+
+enum loc_eng_trace_type {
+    LOC_ENG_TRACE_POSITION = 1,
+    LOC_ENG_TRACE_SV,
+    LOC_ENG_TRACE_STATUS,
+    LOC_ENG_TRACE_NMEA,
+    LOC_ENG_TRACE_REQUEST_XTRA_DATA,
+    LOC_ENG_TRACE_REQUEST_TIME,
+    LOC_ENG_TRACE_REQUEST_LOCATION,
+    LOC_ENG_TRACE_REQUEST_ATL,
+    LOC_ENG_TRACE_RELEASE_ATL,
+    LOC_ENG_TRACE_REQUEST_NI,
+    LOC_ENG_TRACE_ENGINE_DOWN,
+    LOC_ENG_TRACE_ENGINE_UP
+};
+
+struct loc_eng_trace_record {
+    int64_t timeUs;
+    uint16_t type;
+    uint16_t length;
+    uint8_t data[LOC_ENG_TRACE_MAX_PAYLOAD];
+};
+
+extern volatile int loc_eng_trace_active;
+
+// Cheap enough to test on every upcall; the loc_eng_trace_<upcall>
+// functions below are only worth calling when it is true.
+static inline bool loc_eng_trace_recording()
+{
+    return 0 != loc_eng_trace_active;
+}
+
+// Recording; one trace file at a time, shared by every adapter.
+bool loc_eng_trace_start(const char* path);
+void loc_eng_trace_stop();
+
+void loc_eng_trace_position(const GpsLocation &location,
+                            const GpsLocationExtended &locationExtended,
+                            enum loc_sess_status status,
+                            LocPosTechMask techMask);
+void loc_eng_trace_sv(const GpsSvStatus &svStatus,
+                      const GpsLocationExtended &locationExtended,
+                      uint32_t gloUsedInFixMask);
+void loc_eng_trace_status(GpsStatusValue status);
+void loc_eng_trace_nmea(const char* nmea, int length);
+void loc_eng_trace_atl(enum loc_eng_trace_type type, int handle, AGpsType agpsType);
+void loc_eng_trace_ni(const GpsNiNotification &notify);
+// Upcalls without arguments, e.g. LOC_ENG_TRACE_REQUEST_TIME
+void loc_eng_trace_event(enum loc_eng_trace_type type);
+
+// Reading; loc_eng_trace_open checks the header, and loc_eng_trace_read
+// returns false at the end of the trace or on a truncated record.
+FILE* loc_eng_trace_open(const char* path);
+bool loc_eng_trace_read(FILE* fp, loc_eng_trace_record &record);
+
+bool loc_eng_trace_decode_position(const loc_eng_trace_record &record,
+                                   GpsLocation &location,
+                                   GpsLocationExtended &locationExtended,
+                                   enum loc_sess_status &status,
+                                   LocPosTechMask &techMask);
+bool loc_eng_trace_decode_sv(const loc_eng_trace_record &record,
+                             GpsSvStatus &svStatus,
+                             GpsLocationExtended &locationExtended,
+                             uint32_t &gloUsedInFixMask);
+bool loc_eng_trace_decode_status(const loc_eng_trace_record &record,
+                                 GpsStatusValue &status);
+bool loc_eng_trace_decode_atl(const loc_eng_trace_record &record,
+                              int &handle, AGpsType &agpsType);
+bool loc_eng_trace_decode_ni(const loc_eng_trace_record &record,
+                             GpsNiNotification &notify);
+
+#endif // LOC_ENG_TRACE_H
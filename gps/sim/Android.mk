@@ -0,0 +1,85 @@
+ifneq ($(BUILD_TINY_ANDROID),true)
+# Host build of gps.utils and loc_eng driven by a fake LocApiAdapter that
+# replays recorded modem traces; see FakeLocApiAdapter.h for the format.
+
+LOCAL_PATH := $(call my-dir)
+
+LOC_SIM_CFLAGS := \
+    -fno-short-enums \
+    -D_ANDROID_ \
+    -DNEW_QC_GPS \
+    -DGPS_CONF_FILE=\"gps.conf\" \
+    -include $(LOCAL_PATH)/include/loc_sim_compat.h
+
+LOC_SIM_C_INCLUDES := \
+    $(LOCAL_PATH)/include \
+    $(LOCAL_PATH) \
+    $(LOCAL_PATH)/../utils \
+    $(LOCAL_PATH)/../libloc_api_50001 \
+    $(LOCAL_PATH)/../ulp/inc \
+    $(LOCAL_PATH)/../../include
+
+include $(CLEAR_VARS)
+
+LOCAL_MODULE := libloc_eng_sim
+
+LOCAL_MODULE_TAGS := optional
+
+LOCAL_SRC_FILES += \
+    ../utils/loc_log.cpp \
+    ../utils/loc_cfg.cpp \
+    ../utils/msg_q.c \
+    ../utils/linked_list.c \
+    ../utils/loc_log_ring.c
+
+LOCAL_SRC_FILES += \
+    ../libloc_api_50001/loc_eng_log.cpp \
+    ../libloc_api_50001/loc_eng_msg_pool.cpp \
+    ../libloc_api_50001/loc_eng_trace.cpp \
+    ../libloc_api_50001/LocApiAdapter.cpp \
+    ../libloc_api_50001/loc_eng.cpp \
+    ../libloc_api_50001/loc_eng_agps.cpp \
+    ../libloc_api_50001/loc_eng_xtra.cpp \
+    ../libloc_api_50001/loc_eng_ni.cpp \
+    ../libloc_api_50001/loc_eng_nmea.cpp \
+    ../libloc_api_50001/loc_eng_stats.cpp \
+    ../libloc_api_50001/loc_eng_dmn_conn.cpp \
+    ../libloc_api_50001/loc_eng_dmn_conn_handler.cpp \
+    ../libloc_api_50001/loc_eng_dmn_conn_thread_helper.c \
+    ../libloc_api_50001/loc_eng_dmn_conn_glue_msg.c \
+    ../libloc_api_50001/loc_eng_dmn_conn_glue_pipe.c
+
+LOCAL_CFLAGS += $(LOC_SIM_CFLAGS)
+
+LOCAL_C_INCLUDES := $(LOC_SIM_C_INCLUDES)
+
+include $(BUILD_HOST_STATIC_LIBRARY)
+
+# Host executables of the simulation, all linked against libloc_eng_sim
+# $(1): module name, $(2): sources
+define loc-sim-host-executable
+include $$(CLEAR_VARS)
+LOCAL_MODULE := $(1)
+LOCAL_MODULE_TAGS := optional
+LOCAL_STATIC_LIBRARIES := libloc_eng_sim
+LOCAL_SRC_FILES := $(2)
+LOCAL_CFLAGS += $$(LOC_SIM_CFLAGS)
+LOCAL_C_INCLUDES := $$(LOC_SIM_C_INCLUDES)
+LOCAL_LDLIBS += -lpthread -ldl -lrt
+include $$(BUILD_HOST_EXECUTABLE)
+endef
+
+$(eval $(call loc-sim-host-executable,loc_eng_sim,FakeLocApiAdapter.cpp loc_eng_sim.cpp))
+$(eval $(call loc-sim-host-executable,loc_eng_report_bench,FakeLocApiAdapter.cpp loc_eng_report_bench.cpp))
+$(eval $(call loc-sim-host-executable,loc_eng_nmea_test,FakeLocApiAdapter.cpp loc_eng_nmea_replay.cpp loc_eng_nmea_test.cpp))
+$(eval $(call loc-sim-host-executable,loc_eng_nmea_bench,FakeLocApiAdapter.cpp loc_eng_nmea_replay.cpp loc_eng_nmea_bench.cpp))
+$(eval $(call loc-sim-host-executable,loc_log_ring_test,loc_log_ring_test.cpp))
+$(eval $(call loc-sim-host-executable,loc_eng_buf_bench,loc_eng_buf_bench.cpp))
+$(eval $(call loc-sim-host-executable,linked_list_bench,linked_list_bench.cpp))
+$(eval $(call loc-sim-host-executable,loc_eng_nmea_checksum_bench,loc_eng_nmea_checksum_bench.cpp))
+$(eval $(call loc-sim-host-executable,loc_eng_log_name_bench,loc_eng_log_name_bench.cpp))
+$(eval $(call loc-sim-host-executable,loc_cfg_test,loc_cfg_diff.cpp loc_cfg_test.cpp))
+$(eval $(call loc-sim-host-executable,loc_cfg_bench,loc_cfg_diff.cpp loc_cfg_bench.cpp))
+$(eval $(call loc-sim-host-executable,loc_eng_coalesce_test,FakeLocApiAdapter.cpp loc_eng_coalesce_test.cpp))
+
+endif # not BUILD_TINY_ANDROID
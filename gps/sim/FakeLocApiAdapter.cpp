@@ -0,0 +1,503 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_sim_adapter"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <FakeLocApiAdapter.h>
+#include "log_util.h"
+
+#define FAKE_LOC_TRACE_LINE_MAX 512
+
+static bool parseSv(char* fields, GpsSvStatus &svStatus, uint32_t &gloUsedInFixMask)
+{
+    char* save = NULL;
+    char* tok;
+
+    svStatus.size = sizeof(svStatus);
+    tok = strtok_r(fields, " \t", &save);
+    for (int i = 0; i < 3; i++, tok = strtok_r(NULL, " \t", &save)) {
+        if (NULL == tok) {
+            return false;
+        }
+        uint32_t mask = (uint32_t)strtoul(tok, NULL, 0);
+        switch (i) {
+        case 0: svStatus.ephemeris_mask = mask; break;
+        case 1: svStatus.almanac_mask = mask; break;
+        default: svStatus.used_in_fix_mask = mask; break;
+        }
+    }
+    if (NULL != tok && 0 == strncmp(tok, "glo=", 4)) {
+        gloUsedInFixMask = (uint32_t)strtoul(tok + 4, NULL, 0);
+        tok = strtok_r(NULL, " \t", &save);
+    }
+
+    for (; NULL != tok && svStatus.num_svs < GPS_MAX_SVS;
+         tok = strtok_r(NULL, " \t", &save)) {
+        GpsSvInfo &sv = svStatus.sv_list[svStatus.num_svs];
+        sv.size = sizeof(sv);
+        if (4 != sscanf(tok, "%d:%f:%f:%f", &sv.prn, &sv.snr,
+                        &sv.elevation, &sv.azimuth)) {
+            return false;
+        }
+        svStatus.num_svs++;
+    }
+    return true;
+}
+
+static bool parseEvent(char* line, FakeLocEvent &event)
+{
+    char name[8];
+    int used = 0;
+
+    long long timeMs;
+
+    memset(&event, 0, sizeof(event));
+    if (2 != sscanf(line, "%lld %7s %n", &timeMs, name, &used)) {
+        return false;
+    }
+    event.timeUs = timeMs * 1000;
+    char* fields = line + used;
+
+    if (0 == strcmp(name, "POS")) {
+        GpsLocation &loc = event.location;
+        event.type = FAKE_LOC_EVENT_POSITION;
+        loc.size = sizeof(loc);
+        if (6 != sscanf(fields, "%lf %lf %lf %f %f %f", &loc.latitude, &loc.longitude,
+                        &loc.altitude, &loc.speed, &loc.bearing, &loc.accuracy)) {
+            return false;
+        }
+        loc.flags = GPS_LOCATION_HAS_LAT_LONG | GPS_LOCATION_HAS_ALTITUDE |
+                    GPS_LOCATION_HAS_SPEED | GPS_LOCATION_HAS_BEARING |
+                    GPS_LOCATION_HAS_ACCURACY;
+        loc.position_source = ULP_LOCATION_IS_FROM_GNSS;
+        event.locationExtended.size = sizeof(event.locationExtended);
+        event.sessionStatus = LOC_SESS_SUCCESS;
+        event.techMask = LOC_POS_TECH_MASK_SATELLITE;
+        return true;
+    } else if (0 == strcmp(name, "SV")) {
+        event.type = FAKE_LOC_EVENT_SV;
+        event.locationExtended.size = sizeof(event.locationExtended);
+        return parseSv(fields, event.svStatus, event.gloUsedInFixMask);
+    } else if (0 == strcmp(name, "STATUS")) {
+        int status;
+        event.type = FAKE_LOC_EVENT_STATUS;
+        if (1 != sscanf(fields, "%d", &status)) {
+            return false;
+        }
+        event.status = (GpsStatusValue)status;
+        return true;
+    } else if (0 == strcmp(name, "NMEA")) {
+        int len = strcspn(fields, "\r\n");
+        event.type = FAKE_LOC_EVENT_NMEA;
+        if (0 == len) {
+            return false;
+        }
+        // carry the line ending the modem would have sent
+        event.nmea = loc_eng_buf_alloc(len + 2);
+        if (NULL == event.nmea) {
+            return false;
+        }
+        memcpy(event.nmea->data, fields, len);
+        memcpy(event.nmea->data + len, "\r\n", 2);
+        return true;
+    } else if (0 == strcmp(name, "ATL")) {
+        int type;
+        event.type = FAKE_LOC_EVENT_ATL;
+        if (2 != sscanf(fields, "%d %d", &event.atlHandle, &type)) {
+            return false;
+        }
+        event.atlType = (AGpsType)type;
+        return true;
+    }
+    return false;
+}
+
+// Turns a binary trace record into an event; the nmea buffer it may fill in
+// holds a reference for the caller.
+static bool decodeRecord(const loc_eng_trace_record &record, FakeLocEvent &event)
+{
+    switch (record.type) {
+    case LOC_ENG_TRACE_POSITION:
+        event.type = FAKE_LOC_EVENT_POSITION;
+        return loc_eng_trace_decode_position(record, event.location, event.locationExtended,
+                                             event.sessionStatus, event.techMask);
+    case LOC_ENG_TRACE_SV:
+        event.type = FAKE_LOC_EVENT_SV;
+        return loc_eng_trace_decode_sv(record, event.svStatus, event.locationExtended,
+                                       event.gloUsedInFixMask);
+    case LOC_ENG_TRACE_STATUS:
+        event.type = FAKE_LOC_EVENT_STATUS;
+        return loc_eng_trace_decode_status(record, event.status);
+    case LOC_ENG_TRACE_NMEA:
+        event.type = FAKE_LOC_EVENT_NMEA;
+        event.nmea = loc_eng_buf_copy((const char*)record.data, record.length);
+        return NULL != event.nmea;
+    case LOC_ENG_TRACE_REQUEST_ATL:
+        event.type = FAKE_LOC_EVENT_ATL;
+        return loc_eng_trace_decode_atl(record, event.atlHandle, event.atlType);
+    case LOC_ENG_TRACE_RELEASE_ATL:
+        event.type = FAKE_LOC_EVENT_RELEASE_ATL;
+        return loc_eng_trace_decode_atl(record, event.atlHandle, event.atlType);
+    case LOC_ENG_TRACE_REQUEST_NI:
+        event.type = FAKE_LOC_EVENT_NI;
+        return loc_eng_trace_decode_ni(record, *event.ni);
+    case LOC_ENG_TRACE_REQUEST_XTRA_DATA:
+        event.type = FAKE_LOC_EVENT_XTRA_DATA;
+        return true;
+    case LOC_ENG_TRACE_REQUEST_TIME:
+        event.type = FAKE_LOC_EVENT_TIME;
+        return true;
+    case LOC_ENG_TRACE_REQUEST_LOCATION:
+        event.type = FAKE_LOC_EVENT_LOCATION;
+        return true;
+    case LOC_ENG_TRACE_ENGINE_DOWN:
+        event.type = FAKE_LOC_EVENT_ENGINE_DOWN;
+        return true;
+    case LOC_ENG_TRACE_ENGINE_UP:
+        event.type = FAKE_LOC_EVENT_ENGINE_UP;
+        return true;
+    }
+    return false;
+}
+
+FakeLocEvent* FakeLocApiAdapter::loadTrace(const char* path, int* count)
+{
+    FILE* fp = fopen(path, "r");
+    FakeLocEvent* events = NULL;
+    int size = 0, n = 0, lineNo = 0;
+    char line[FAKE_LOC_TRACE_LINE_MAX];
+
+    if (NULL == fp) {
+        LOC_LOGE("%s: cannot open %s: %s", __func__, path, strerror(errno));
+        return NULL;
+    }
+
+    while (NULL != fgets(line, sizeof(line), fp)) {
+        char* p = line;
+        lineNo++;
+        while (' ' == *p || '\t' == *p) {
+            p++;
+        }
+        if ('#' == *p || '\n' == *p || '\r' == *p || '\0' == *p) {
+            continue;
+        }
+        if (n == size) {
+            FakeLocEvent* grown;
+            size = size ? size * 2 : 64;
+            grown = (FakeLocEvent*)realloc(events, size * sizeof(FakeLocEvent));
+            if (NULL == grown) {
+                LOC_LOGE("%s: out of memory at line %d", __func__, lineNo);
+                break;
+            }
+            events = grown;
+        }
+        if (!parseEvent(p, events[n])) {
+            LOC_LOGW("%s: %s:%d: skipping malformed event", __func__, path, lineNo);
+            loc_eng_buf_unref(events[n].nmea);
+            continue;
+        }
+        if (n > 0 && events[n].timeUs < events[n-1].timeUs) {
+            events[n].timeUs = events[n-1].timeUs;
+        }
+        n++;
+    }
+    fclose(fp);
+
+    LOC_LOGD("%s: %d events from %s", __func__, n, path);
+    *count = n;
+    if (0 == n) {
+        free(events);
+        return NULL;
+    }
+    return events;
+}
+
+void FakeLocApiAdapter::freeTrace(FakeLocEvent* events, int count)
+{
+    if (NULL != events) {
+        for (int i = 0; i < count; i++) {
+            loc_eng_buf_unref(events[i].nmea);
+        }
+        free(events);
+    }
+}
+
+FakeLocApiAdapter::FakeLocApiAdapter(LocEng &locEng, FakeLocEvent* evts, int count,
+                                     FILE* fp, double spd, int lps) :
+    LocApiAdapter(locEng), events(evts), eventCount(count), trace(evts ? NULL : fp),
+    speed(spd < 0 ? 0 : spd), loops(lps < 1 ? 1 : lps), traceStartUs(-1),
+    replaying(false), stopRequested(false), replayDone(false),
+    atlOpened(0), atlClosed(0)
+{
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&cond, NULL);
+    memset(&current, 0, sizeof(current));
+    current.ni = &currentNi;
+    LOC_LOGD("FakeLocApiAdapter created, %s trace, speed %.2f, %d loops",
+             trace ? "binary" : "text", speed, loops);
+}
+
+FakeLocApiAdapter::~FakeLocApiAdapter()
+{
+    stopFix();
+    loc_eng_buf_unref(current.nmea);
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&lock);
+}
+
+void FakeLocApiAdapter::rewind()
+{
+    if (NULL != trace) {
+        fseek(trace, LOC_ENG_TRACE_FILE_HEADER_SIZE, SEEK_SET);
+        traceStartUs = -1;
+    }
+}
+
+FakeLocEvent* FakeLocApiAdapter::nextEvent(int index)
+{
+    if (NULL == trace) {
+        return index < eventCount ? &events[index] : NULL;
+    }
+
+    loc_eng_buf_unref(current.nmea);
+    current.nmea = NULL;
+    while (loc_eng_trace_read(trace, record)) {
+        if (!decodeRecord(record, current)) {
+            LOC_LOGW("%s: skipping record of type %d", __func__, record.type);
+            continue;
+        }
+        if (traceStartUs < 0) {
+            traceStartUs = record.timeUs;
+        }
+        current.timeUs = record.timeUs - traceStartUs;
+        return &current;
+    }
+    return NULL;
+}
+
+// Sleeps until deadlineUs on the loc_eng_msg_time_us() clock; returns
+// false if the replay was stopped in the meantime.
+bool FakeLocApiAdapter::waitUntil(int64_t deadlineUs)
+{
+    bool stopped;
+
+    pthread_mutex_lock(&lock);
+    while (!stopRequested) {
+        int64_t nowUs = loc_eng_msg_time_us();
+        if (nowUs >= deadlineUs) {
+            break;
+        }
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        int64_t wakeNs = (int64_t)ts.tv_nsec + (deadlineUs - nowUs) * 1000;
+        ts.tv_sec += wakeNs / 1000000000;
+        ts.tv_nsec = wakeNs % 1000000000;
+        pthread_cond_timedwait(&cond, &lock, &ts);
+    }
+    stopped = stopRequested;
+    pthread_mutex_unlock(&lock);
+    return !stopped;
+}
+
+void FakeLocApiAdapter::deliver(FakeLocEvent &event)
+{
+    switch (event.type) {
+    case FAKE_LOC_EVENT_POSITION:
+    {
+        // recorded fixes keep their own time, made up ones get the wall clock
+        GpsLocation location = event.location;
+        if (0 == location.timestamp) {
+            struct timeval tv;
+            gettimeofday(&tv, NULL);
+            location.timestamp = (GpsUtcTime)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+        }
+        reportPosition(location, event.locationExtended, NULL,
+                       event.sessionStatus, event.techMask);
+        break;
+    }
+    case FAKE_LOC_EVENT_SV:
+        reportSv(event.svStatus, event.locationExtended, NULL, event.gloUsedInFixMask);
+        break;
+    case FAKE_LOC_EVENT_STATUS:
+        reportStatus(event.status);
+        break;
+    case FAKE_LOC_EVENT_NMEA:
+        reportNmea(event.nmea);
+        break;
+    case FAKE_LOC_EVENT_ATL:
+        requestATL(event.atlHandle, event.atlType);
+        break;
+    case FAKE_LOC_EVENT_RELEASE_ATL:
+        releaseATL(event.atlHandle);
+        break;
+    case FAKE_LOC_EVENT_XTRA_DATA:
+        requestXtraData();
+        break;
+    case FAKE_LOC_EVENT_TIME:
+        requestTime();
+        break;
+    case FAKE_LOC_EVENT_LOCATION:
+        requestLocation();
+        break;
+    case FAKE_LOC_EVENT_NI:
+        requestNiNotify(*event.ni, NULL);
+        break;
+    case FAKE_LOC_EVENT_ENGINE_DOWN:
+        handleEngineDownEvent();
+        break;
+    case FAKE_LOC_EVENT_ENGINE_UP:
+        handleEngineUpEvent();
+        break;
+    }
+}
+
+void* FakeLocApiAdapter::replay(void* arg)
+{
+    FakeLocApiAdapter* adapter = (FakeLocApiAdapter*)arg;
+    bool running = true;
+
+    for (int loop = 0; running && loop < adapter->loops; loop++) {
+        int64_t startUs = loc_eng_msg_time_us();
+        FakeLocEvent* event;
+        adapter->rewind();
+        for (int i = 0; running && NULL != (event = adapter->nextEvent(i)); i++) {
+            if (adapter->speed > 0) {
+                running = adapter->waitUntil(startUs +
+                                             (int64_t)(event->timeUs / adapter->speed));
+            }
+            if (running) {
+                adapter->deliver(*event);
+            }
+        }
+    }
+
+    pthread_mutex_lock(&adapter->lock);
+    adapter->replayDone = true;
+    pthread_cond_broadcast(&adapter->cond);
+    pthread_mutex_unlock(&adapter->lock);
+    LOC_LOGD("%s: replay %s", __func__, running ? "finished" : "stopped");
+    return NULL;
+}
+
+void FakeLocApiAdapter::waitReplayDone()
+{
+    pthread_mutex_lock(&lock);
+    while (!replayDone) {
+        pthread_cond_wait(&cond, &lock);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+enum loc_api_adapter_err FakeLocApiAdapter::reinit()
+{
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err FakeLocApiAdapter::startFix()
+{
+    pthread_mutex_lock(&lock);
+    if (replaying) {
+        pthread_mutex_unlock(&lock);
+        return LOC_API_ADAPTER_ERR_SUCCESS;
+    }
+    stopRequested = false;
+    replayDone = false;
+    if (0 != pthread_create(&replayThread, NULL, replay, this)) {
+        pthread_mutex_unlock(&lock);
+        LOC_LOGE("%s: cannot start replay thread", __func__);
+        return LOC_API_ADAPTER_ERR_GENERAL_FAILURE;
+    }
+    replaying = true;
+    pthread_mutex_unlock(&lock);
+
+    reportStatus(GPS_STATUS_SESSION_BEGIN);
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err FakeLocApiAdapter::stopFix()
+{
+    pthread_mutex_lock(&lock);
+    if (!replaying) {
+        pthread_mutex_unlock(&lock);
+        return LOC_API_ADAPTER_ERR_SUCCESS;
+    }
+    stopRequested = true;
+    replaying = false;
+    pthread_cond_broadcast(&cond);
+    pthread_mutex_unlock(&lock);
+
+    pthread_join(replayThread, NULL);
+    reportStatus(GPS_STATUS_SESSION_END);
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err FakeLocApiAdapter::setPositionMode(const LocPosMode *posMode)
+{
+    if (NULL != posMode) {
+        fixCriteria = *posMode;
+    }
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err FakeLocApiAdapter::setSUPLVersion(uint32_t)
+{
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err FakeLocApiAdapter::setLPPConfig(uint32_t)
+{
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err FakeLocApiAdapter::setSensorControlConfig(int)
+{
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err FakeLocApiAdapter::atlOpenStatus(int handle, int is_succ, char*,
+                                                          AGpsBearerType,
+                                                          AGpsType)
+{
+    LOC_LOGD("%s: handle %d %s", __func__, handle, is_succ ? "opened" : "failed");
+    __atomic_add_fetch(&atlOpened, 1, __ATOMIC_RELAXED);
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
+
+enum loc_api_adapter_err FakeLocApiAdapter::atlCloseStatus(int handle, int)
+{
+    LOC_LOGD("%s: handle %d closed", __func__, handle);
+    __atomic_add_fetch(&atlClosed, 1, __ATOMIC_RELAXED);
+    return LOC_API_ADAPTER_ERR_SUCCESS;
+}
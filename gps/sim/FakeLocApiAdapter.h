@@ -0,0 +1,144 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef FAKE_LOC_API_ADAPTER_H
+#define FAKE_LOC_API_ADAPTER_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <LocApiAdapter.h>
+#include <loc_eng_trace.h>
+
+enum fake_loc_event_type {
+    FAKE_LOC_EVENT_POSITION,
+    FAKE_LOC_EVENT_SV,
+    FAKE_LOC_EVENT_STATUS,
+    FAKE_LOC_EVENT_NMEA,
+    FAKE_LOC_EVENT_ATL,
+    FAKE_LOC_EVENT_RELEASE_ATL,
+    FAKE_LOC_EVENT_XTRA_DATA,
+    FAKE_LOC_EVENT_TIME,
+    FAKE_LOC_EVENT_LOCATION,
+    FAKE_LOC_EVENT_NI,
+    FAKE_LOC_EVENT_ENGINE_DOWN,
+    FAKE_LOC_EVENT_ENGINE_UP
+};
+
+struct FakeLocEvent {
+    // microseconds since the start of the trace
+    int64_t timeUs;
+    enum fake_loc_event_type type;
+    GpsLocation location;
+    GpsLocationExtended locationExtended;
+    enum loc_sess_status sessionStatus;
+    LocPosTechMask techMask;
+    GpsSvStatus svStatus;
+    uint32_t gloUsedInFixMask;
+    GpsStatusValue status;
+    LocEngBuffer* nmea;
+    int atlHandle;
+    AGpsType atlType;
+    GpsNiNotification* ni;
+};
+
+// Stands in for the modem adapter in the host simulation build. Once a fix
+// is started it replays a trace of modem upcalls through the same
+// LocApiAdapter report calls the real adapters use. The trace is either a
+// binary one recorded on the phone with LocApiAdapter::startRecording,
+// streamed from the file as it replays, or a hand written text one, one
+// event per line:
+//
+//   # <ms since start> <event> <fields>
+//   0    STATUS 1
+//   0    POS  <lat> <lon> <alt> <speed> <bearing> <accuracy>
+//   0    SV   <eph mask> <alm mask> <used mask> [glo=<used mask>] <prn>:<snr>:<elev>:<azim> ...
+//   0    NMEA $GPGGA,...
+//   500  ATL  <handle> <agps type>
+//
+// speed scales the recorded pacing, so 1 replays at the original speed, 2
+// twice as fast and 0 as fast as the queues take it; loops repeats the trace
+// that many times.
+class FakeLocApiAdapter : public LocApiAdapter {
+    FakeLocEvent* events;
+    int eventCount;
+    FILE* trace;
+    double speed;
+    int loops;
+
+    // current event of a binary trace, and when its first record was taken
+    FakeLocEvent current;
+    GpsNiNotification currentNi;
+    loc_eng_trace_record record;
+    int64_t traceStartUs;
+
+    pthread_t replayThread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool replaying;
+    bool stopRequested;
+    bool replayDone;
+    int atlOpened;
+    int atlClosed;
+
+    static void* replay(void* arg);
+    void rewind();
+    FakeLocEvent* nextEvent(int index);
+    bool waitUntil(int64_t deadlineUs);
+    void deliver(FakeLocEvent &event);
+
+public:
+    // Replays events, or the binary trace from loc_eng_trace_open if events
+    // is NULL; either stays owned by the caller.
+    FakeLocApiAdapter(LocEng &locEng, FakeLocEvent* events, int eventCount,
+                      FILE* trace, double speed, int loops);
+    virtual ~FakeLocApiAdapter();
+
+    // Parses a text trace
+    static FakeLocEvent* loadTrace(const char* path, int* count);
+    static void freeTrace(FakeLocEvent* events, int count);
+
+    // Blocks until every loop of the trace has been replayed.
+    void waitReplayDone();
+    inline int getAtlOpened() const { return atlOpened; }
+    inline int getAtlClosed() const { return atlClosed; }
+
+    virtual enum loc_api_adapter_err reinit();
+    virtual enum loc_api_adapter_err startFix();
+    virtual enum loc_api_adapter_err stopFix();
+    virtual enum loc_api_adapter_err setPositionMode(const LocPosMode *posMode);
+    virtual enum loc_api_adapter_err setSUPLVersion(uint32_t version);
+    virtual enum loc_api_adapter_err setLPPConfig(uint32_t profile);
+    virtual enum loc_api_adapter_err setSensorControlConfig(int sensorUsage);
+    virtual enum loc_api_adapter_err atlOpenStatus(int handle, int is_succ, char* apn,
+                                                   AGpsBearerType bear, AGpsType agpsType);
+    virtual enum loc_api_adapter_err atlCloseStatus(int handle, int is_succ);
+};
+
+#endif // FAKE_LOC_API_ADAPTER_H
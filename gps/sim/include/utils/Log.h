@@ -0,0 +1,67 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+/* Host stand-in for the Android log header: log lines go to stderr. */
+#ifndef LOC_SIM_UTILS_LOG_H
+#define LOC_SIM_UTILS_LOG_H
+
+#include <stdio.h>
+
+#ifndef LOG_TAG
+#define LOG_TAG NULL
+#endif
+
+#define LOC_SIM_LOG(prio, ...) \
+    do { \
+        fprintf(stderr, "%c/%s: ", prio, LOG_TAG ? LOG_TAG : ""); \
+        fprintf(stderr, __VA_ARGS__); \
+        fputc('\n', stderr); \
+    } while (0)
+
+typedef enum {
+    ANDROID_LOG_VERBOSE = 2,
+    ANDROID_LOG_DEBUG,
+    ANDROID_LOG_INFO,
+    ANDROID_LOG_WARN,
+    ANDROID_LOG_ERROR
+} android_LogPriority;
+
+static inline int __android_log_write(int prio, const char* tag, const char* text)
+{
+    return fprintf(stderr, "%c/%s: %s\n", "??VDIWE"[prio >= 2 && prio <= 6 ? prio : 0],
+                   tag ? tag : "", text);
+}
+
+#define ALOGE(...) LOC_SIM_LOG('E', __VA_ARGS__)
+#define ALOGW(...) LOC_SIM_LOG('W', __VA_ARGS__)
+#define ALOGI(...) LOC_SIM_LOG('I', __VA_ARGS__)
+#define ALOGD(...) LOC_SIM_LOG('D', __VA_ARGS__)
+#define ALOGV(...) LOC_SIM_LOG('V', __VA_ARGS__)
+
+#endif // LOC_SIM_UTILS_LOG_H
@@ -0,0 +1,180 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <linked_list.h>
+#include "log_util.h"
+
+// Compares looking up and removing a keyed element through the
+// linked_list hash index with the linear linked_list_search, the way
+// AgpsStateMachine looks up its subscribers by ID, at 1, 16 and 256
+// elements. Both lists must find the same elements, or it fails.
+//
+//   linked_list_bench [-n lookups per size]
+
+struct linked_list_bench_sub {
+    int id;
+};
+
+static uint32_t linked_list_bench_hash(void* data)
+{
+    return (uint32_t)((linked_list_bench_sub*)data)->id;
+}
+
+static bool linked_list_bench_equal(void* data_0, void* data)
+{
+    return ((linked_list_bench_sub*)data_0)->id == ((linked_list_bench_sub*)data)->id;
+}
+
+static int64_t linked_list_bench_now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// Looks up the element with id in list, removing and adding it back if
+// churn is set, as a subscriber leaving and subscribing again would
+static linked_list_bench_sub* linked_list_bench_find(void* list, bool hashed,
+                                                     linked_list_bench_sub* key, bool churn)
+{
+    linked_list_bench_sub* found = NULL;
+    if (hashed) {
+        linked_list_search_hash(list, (void**)&found, linked_list_bench_equal, key,
+                                linked_list_bench_hash(key), churn);
+    } else {
+        linked_list_search(list, (void**)&found, linked_list_bench_equal, key, churn);
+    }
+    if (churn && NULL != found) {
+        linked_list_add(list, found, NULL);
+    }
+    return found;
+}
+
+// ns per lookup of n lookups over count elements, or -1 if the lists
+// disagree on what they found
+static double linked_list_bench_run(void* list, void* other, bool hashed,
+                                    int count, int n, bool churn)
+{
+    int64_t start = linked_list_bench_now_ns();
+    for (int i = 0; i < n; i++) {
+        // one in eight lookups is for a subscriber that is not there
+        linked_list_bench_sub key = { (int)((i * 2654435761u) % (count + count / 8 + 1)) };
+        linked_list_bench_sub* found = linked_list_bench_find(list, hashed, &key, churn);
+        if ((NULL == found) != (key.id >= count) ||
+            (NULL != found && found->id != key.id)) {
+            return -1;
+        }
+    }
+    double ns = (double)(linked_list_bench_now_ns() - start) / n;
+
+    // after the same churn, both lists must hold the same order
+    for (int i = 0; i < n; i++) {
+        linked_list_bench_sub key = { (int)((i * 2654435761u) % (count + count / 8 + 1)) };
+        linked_list_bench_find(other, !hashed, &key, churn);
+    }
+    for (;;) {
+        linked_list_bench_sub* a = NULL;
+        linked_list_bench_sub* b = NULL;
+        linked_list_remove(list, (void**)&a);
+        linked_list_remove(other, (void**)&b);
+        if (a != b) {
+            return -1;
+        }
+        if (NULL == a) {
+            break;
+        }
+    }
+    return ns;
+}
+
+int main(int argc, char** argv)
+{
+    static const int sizes[] = { 1, 16, 256 };
+    int lookups = 1000000;
+    int opt;
+    int failed = 0;
+
+    while (-1 != (opt = getopt(argc, argv, "n:"))) {
+        switch (opt) {
+        case 'n':
+            lookups = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-n lookups per size]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (lookups <= 0) {
+        fprintf(stderr, "%s: lookups must be positive\n", argv[0]);
+        return 1;
+    }
+
+    // errors only, as the list logs every add and search
+    loc_logger_init(1, 0);
+
+    for (unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int count = sizes[s];
+        linked_list_bench_sub* subs = new linked_list_bench_sub[count];
+        for (int i = 0; i < count; i++) {
+            subs[i].id = i;
+        }
+        double ns[2][2];
+        for (int churn = 0; churn < 2; churn++) {
+            for (int hashed = 0; hashed < 2; hashed++) {
+                void* list = NULL;
+                void* other = NULL;
+                linked_list_init(&list);
+                linked_list_init(&other);
+                linked_list_set_hash(hashed ? list : other, linked_list_bench_hash);
+                for (int i = 0; i < count; i++) {
+                    linked_list_add(list, &subs[i], NULL);
+                    linked_list_add(other, &subs[i], NULL);
+                }
+                ns[churn][hashed] = linked_list_bench_run(list, other, hashed, count,
+                                                          lookups, churn);
+                if (ns[churn][hashed] < 0) {
+                    failed = 1;
+                }
+                linked_list_destroy(&list);
+                linked_list_destroy(&other);
+            }
+        }
+        printf("%3d elements: lookup linear %.1f ns, hash %.1f ns; "
+               "remove+add linear %.1f ns, hash %.1f ns\n",
+               count, ns[0][0], ns[0][1], ns[1][0], ns[1][1]);
+        delete[] subs;
+    }
+
+    printf("%s\n", failed ? "FAIL" : "PASS");
+    return failed;
+}
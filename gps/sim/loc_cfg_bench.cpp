@@ -0,0 +1,133 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_cfg_bench"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <loc_cfg.h>
+#include <loc_cfg_diff.h>
+
+// Times loc_read_conf against the parser it replaced on a large synthetic
+// gps.conf, with a parameter table the size of loc_eng's. The two must
+// read the same values, or it fails. -w keeps the file it made.
+//
+//   loc_cfg_bench [-l lines] [-n reads] [-s seed] [-w conf file]
+
+static LocCfgDiffTable loc_cfg_bench_table;
+static LocCfgDiffTable loc_cfg_bench_ref;
+
+static int64_t loc_cfg_bench_now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int main(int argc, char** argv)
+{
+    int lines = 20000;
+    int reads = 50;
+    unsigned int seed = 1;
+    const char* keepPath = NULL;
+    int opt;
+
+    while (-1 != (opt = getopt(argc, argv, "l:n:s:w:"))) {
+        switch (opt) {
+        case 'l':
+            lines = atoi(optarg);
+            break;
+        case 'n':
+            reads = atoi(optarg);
+            break;
+        case 's':
+            seed = strtoul(optarg, NULL, 0);
+            break;
+        case 'w':
+            keepPath = optarg;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-l lines] [-n reads] [-s seed] [-w conf file]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (lines <= 0 || reads <= 0) {
+        fprintf(stderr, "%s: lines and reads must be positive\n", argv[0]);
+        return 1;
+    }
+
+    char tmpPath[] = "/tmp/loc_cfg_bench.XXXXXX";
+    const char* path = keepPath;
+    if (NULL == path) {
+        int fd = mkstemp(tmpPath);
+        if (fd < 0) {
+            fprintf(stderr, "%s: no temporary file\n", argv[0]);
+            return 1;
+        }
+        close(fd);
+        path = tmpPath;
+    }
+    FILE* file = fopen(path, "w");
+    if (NULL == file) {
+        fprintf(stderr, "%s: cannot write %s\n", argv[0], path);
+        return 1;
+    }
+    loc_cfg_diff_write_large(file, lines, &seed);
+    long bytes = ftell(file);
+    fclose(file);
+
+    loc_cfg_diff_table_init(loc_cfg_bench_table);
+    loc_cfg_diff_table_init(loc_cfg_bench_ref);
+
+    int64_t start = loc_cfg_bench_now_ns();
+    for (int i = 0; i < reads; i++) {
+        loc_cfg_diff_read_conf_ref(path, loc_cfg_bench_ref.entries, LOC_CFG_DIFF_ENTRIES);
+    }
+    int64_t refNs = loc_cfg_bench_now_ns() - start;
+
+    start = loc_cfg_bench_now_ns();
+    for (int i = 0; i < reads; i++) {
+        loc_read_conf(path, loc_cfg_bench_table.entries, LOC_CFG_DIFF_ENTRIES);
+    }
+    int64_t newNs = loc_cfg_bench_now_ns() - start;
+
+    if (NULL == keepPath) {
+        unlink(path);
+    }
+
+    int failed = loc_cfg_diff_compare(loc_cfg_bench_table, loc_cfg_bench_ref) >= 0;
+    printf("%d lines, %ld bytes, %d parameters: fgets+strtok_r %.2f ms, loc_read_conf %.2f ms per read\n",
+           lines, bytes, LOC_CFG_DIFF_ENTRIES,
+           refNs / 1e6 / reads, newNs / 1e6 / reads);
+    printf("%s\n", failed ? "FAIL" : "PASS");
+    return failed;
+}
@@ -0,0 +1,445 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_cfg_diff"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <loc_cfg_diff.h>
+#include "log_util.h"
+
+static const struct {
+    const char* name;
+    char type;
+} loc_cfg_diff_params[LOC_CFG_DIFF_ENTRIES] = {
+    { "INTERMEDIATE_POS", 'n' },
+    { "ACCURACY_THRES", 'n' },
+    { "ENABLE_WIPER", 'n' },
+    { "NMEA_PROVIDER", 'n' },
+    { "SUPL_VER", 'n' },
+    { "CAPABILITIES", 'n' },
+    { "GYRO_BIAS_RANDOM_WALK", 'f' },
+    { "ACCEL_RANDOM_WALK_SPECTRAL_DENSITY", 'f' },
+    { "ANGLE_RANDOM_WALK_SPECTRAL_DENSITY", 'f' },
+    { "RATE_RANDOM_WALK_SPECTRAL_DENSITY", 'f' },
+    { "VELOCITY_RANDOM_WALK_SPECTRAL_DENSITY", 'f' },
+    { "SENSOR_ACCEL_BATCHES_PER_SEC", 'n' },
+    { "SENSOR_ACCEL_SAMPLES_PER_BATCH", 'n' },
+    { "SENSOR_GYRO_BATCHES_PER_SEC", 'n' },
+    { "SENSOR_GYRO_SAMPLES_PER_BATCH", 'n' },
+    { "SENSOR_ACCEL_BATCHES_PER_SEC_HIGH", 'n' },
+    { "SENSOR_ACCEL_SAMPLES_PER_BATCH_HIGH", 'n' },
+    { "SENSOR_GYRO_BATCHES_PER_SEC_HIGH", 'n' },
+    { "SENSOR_GYRO_SAMPLES_PER_BATCH_HIGH", 'n' },
+    { "SENSOR_CONTROL_MODE", 'n' },
+    { "SENSOR_USAGE", 'n' },
+    { "SENSOR_ALGORITHM_CONFIG_MASK", 'n' },
+    { "QUIPC_ENABLED", 'n' },
+    { "LPP_PROFILE", 'n' },
+    { "DEFERRED_Q_RING_SIZE", 'n' },
+    { "REPORT_THREAD", 'n' },
+    { "TRACE_FILE", 's' },
+    { "NMEA_SENTENCE_MASK", 'n' },
+    { "NMEA_GSV_DIVIDER", 'n' },
+    { "NMEA_GSA_DIVIDER", 'n' },
+    { "NMEA_VTG_DIVIDER", 'n' },
+    { "NMEA_RMC_DIVIDER", 'n' },
+    { "NMEA_GGA_DIVIDER", 'n' },
+    // entries sharing a name must all be set
+    { "TRACE_FILE", 's' },
+    { "SUPL_VER", 'f' },
+    { "XTRA_SERVER_1", 's' },
+};
+
+// Names no table entry has, as a vendor gps.conf is full of
+static const char* const loc_cfg_diff_unknown[] = {
+    "NTP_SERVER", "XTRA_SERVER_2", "XTRA_SERVER_3", "SUPL_HOST", "SUPL_PORT",
+    "C2K_HOST", "C2K_PORT", "DEBUG_LEVEL_X", "supl_ver", "SUPL_VER_", "A",
+};
+
+void loc_cfg_diff_table_init(LocCfgDiffTable &table)
+{
+    memset(&table, 0, sizeof(table));
+    for (int i = 0; i < LOC_CFG_DIFF_ENTRIES; i++) {
+        loc_param_s_type& entry = table.entries[i];
+        LocCfgDiffValue& value = table.values[i];
+        strlcpy(entry.param_name, loc_cfg_diff_params[i].name, sizeof(entry.param_name));
+        entry.param_type = loc_cfg_diff_params[i].type;
+        switch (entry.param_type) {
+        case 'n':
+            entry.param_ptr = &value.number;
+            break;
+        case 'f':
+            entry.param_ptr = &value.real;
+            break;
+        default:
+            entry.param_ptr = value.string;
+        }
+        // some entries are not asked whether they were set
+        entry.param_set = (i % 3) ? &value.set : NULL;
+        value.number = -12345;
+        value.real = -1.5;
+        strlcpy(value.string, "unset", sizeof(value.string));
+        value.set = 0x5a;
+    }
+}
+
+int loc_cfg_diff_compare(const LocCfgDiffTable &a, const LocCfgDiffTable &b)
+{
+    for (int i = 0; i < LOC_CFG_DIFF_ENTRIES; i++) {
+        const LocCfgDiffValue& va = a.values[i];
+        const LocCfgDiffValue& vb = b.values[i];
+        if (va.number != vb.number || 0 != memcmp(&va.real, &vb.real, sizeof(va.real)) ||
+            0 != strcmp(va.string, vb.string) || va.set != vb.set) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* loc_read_conf and its helpers as they were, logging parameters aside */
+
+static void loc_cfg_diff_trim_space(char *org_string)
+{
+   char *scan_ptr, *write_ptr;
+   char *first_nonspace = NULL, *last_nonspace = NULL;
+
+   scan_ptr = write_ptr = org_string;
+
+   while (*scan_ptr)
+   {
+      if ( !isspace(*scan_ptr) && first_nonspace == NULL)
+      {
+         first_nonspace = scan_ptr;
+      }
+
+      if (first_nonspace != NULL)
+      {
+         *(write_ptr++) = *scan_ptr;
+         if ( !isspace(*scan_ptr))
+         {
+            last_nonspace = write_ptr;
+         }
+      }
+
+      scan_ptr++;
+   }
+
+   if (last_nonspace) { *last_nonspace = '\0'; }
+}
+
+typedef struct
+{
+   char* param_name;
+
+   char* param_str_value;
+   int param_int_value;
+   double param_double_value;
+} loc_cfg_diff_v_type;
+
+static void loc_cfg_diff_set_config_entry(loc_param_s_type* config_entry,
+                                          loc_cfg_diff_v_type* config_value)
+{
+   if (strcmp(config_entry->param_name, config_value->param_name) == 0 &&
+               config_entry->param_ptr)
+   {
+      switch (config_entry->param_type)
+      {
+      case 's':
+         if (strcmp(config_value->param_str_value, "NULL") == 0)
+         {
+            *((char*)config_entry->param_ptr) = '\0';
+         }
+         else {
+            strlcpy((char*) config_entry->param_ptr,
+                  config_value->param_str_value,
+                  LOC_MAX_PARAM_STRING + 1);
+         }
+
+         if(NULL != config_entry->param_set)
+         {
+            *(config_entry->param_set) = 1;
+         }
+         break;
+      case 'n':
+         *((int *)config_entry->param_ptr) = config_value->param_int_value;
+
+         if(NULL != config_entry->param_set)
+         {
+            *(config_entry->param_set) = 1;
+         }
+         break;
+      case 'f':
+         *((double *)config_entry->param_ptr) = config_value->param_double_value;
+
+         if(NULL != config_entry->param_set)
+         {
+            *(config_entry->param_set) = 1;
+         }
+         break;
+      default:
+         LOC_LOGE("%s: PARAM %s parameter type must be n, f, or s", __FUNCTION__, config_entry->param_name);
+      }
+   }
+}
+
+void loc_cfg_diff_read_conf_ref(const char* conf_file_name, loc_param_s_type* config_table,
+                                uint32_t table_length)
+{
+   FILE *gps_conf_fp = NULL;
+   char input_buf[LOC_MAX_PARAM_LINE];  /* declare a char array */
+   char *lasts;
+   loc_cfg_diff_v_type config_value;
+   uint32_t i;
+
+   if((gps_conf_fp = fopen(conf_file_name, "r")) == NULL)
+   {
+      return; /* no parameter file */
+   }
+
+   /* Clear all validity bits */
+   for(i = 0; NULL != config_table && i < table_length; i++)
+   {
+      if(NULL != config_table[i].param_set)
+      {
+         *(config_table[i].param_set) = 0;
+      }
+   }
+
+   while(fgets(input_buf, LOC_MAX_PARAM_LINE, gps_conf_fp) != NULL)
+   {
+      memset(&config_value, 0, sizeof(config_value));
+
+      /* Separate variable and value */
+      config_value.param_name = strtok_r(input_buf, "=", &lasts);
+      if (config_value.param_name == NULL) continue;       /* skip lines that do not contain "=" */
+      config_value.param_str_value = strtok_r(NULL, "=", &lasts);
+      if (config_value.param_str_value == NULL) continue;  /* skip lines that do not contain two operands */
+
+      /* Trim leading and trailing spaces */
+      loc_cfg_diff_trim_space(config_value.param_name);
+      loc_cfg_diff_trim_space(config_value.param_str_value);
+
+      /* Parse numerical value */
+      if (config_value.param_str_value[0] == '0' && tolower(config_value.param_str_value[1]) == 'x')
+      {
+         /* hex */
+         config_value.param_int_value = (int) strtol(&config_value.param_str_value[2], (char**) NULL, 16);
+      }
+      else {
+         config_value.param_double_value = (double) atof(config_value.param_str_value); /* float */
+         config_value.param_int_value = atoi(config_value.param_str_value); /* dec */
+      }
+
+      for(i = 0; NULL != config_table && i < table_length; i++)
+      {
+         loc_cfg_diff_set_config_entry(&config_table[i], &config_value);
+      }
+   }
+
+   fclose(gps_conf_fp);
+}
+
+/* Conf file writers */
+
+static int loc_cfg_diff_rand(unsigned int* seed, int n)
+{
+    return rand_r(seed) % n;
+}
+
+static void loc_cfg_diff_put_spaces(FILE* file, unsigned int* seed)
+{
+    static const char spaces[] = " \t\v\f";
+    int n = loc_cfg_diff_rand(seed, 4) ? 0 : 1 + loc_cfg_diff_rand(seed, 3);
+    while (n-- > 0) {
+        fputc(spaces[loc_cfg_diff_rand(seed, 4)], file);
+    }
+}
+
+// Printable text, spaces and the odd high byte, but no '=' or newline
+static void loc_cfg_diff_put_text(FILE* file, unsigned int* seed, int length)
+{
+    static const char chars[] = "abcXYZ_019 .,:/#-\t";
+    while (length-- > 0) {
+        if (0 == loc_cfg_diff_rand(seed, 40)) {
+            fputc(0xa0 + loc_cfg_diff_rand(seed, 0x40), file);
+        } else {
+            fputc(chars[loc_cfg_diff_rand(seed, sizeof(chars) - 1)], file);
+        }
+    }
+}
+
+static const char* loc_cfg_diff_name(unsigned int* seed)
+{
+    if (0 == loc_cfg_diff_rand(seed, 6)) {
+        return loc_cfg_diff_unknown[loc_cfg_diff_rand(
+            seed, sizeof(loc_cfg_diff_unknown) / sizeof(loc_cfg_diff_unknown[0]))];
+    }
+    return loc_cfg_diff_params[loc_cfg_diff_rand(seed, LOC_CFG_DIFF_ENTRIES)].name;
+}
+
+static void loc_cfg_diff_put_value(FILE* file, unsigned int* seed)
+{
+    switch (loc_cfg_diff_rand(seed, 10)) {
+    case 0:
+        fprintf(file, "%d", rand_r(seed) - RAND_MAX / 2);
+        break;
+    case 1:
+        fprintf(file, "%s%X", loc_cfg_diff_rand(seed, 2) ? "0x" : "0X", rand_r(seed));
+        break;
+    case 2:
+        fprintf(file, "%.*g", 1 + loc_cfg_diff_rand(seed, 17),
+                (rand_r(seed) - RAND_MAX / 2) / (1.0 + loc_cfg_diff_rand(seed, 100000)));
+        break;
+    case 3:
+        fprintf(file, "%de%d", loc_cfg_diff_rand(seed, 100), loc_cfg_diff_rand(seed, 20) - 10);
+        break;
+    case 4:
+        fputs("NULL", file);
+        break;
+    case 5:
+        fprintf(file, "%d", loc_cfg_diff_rand(seed, 10));
+        loc_cfg_diff_put_text(file, seed, loc_cfg_diff_rand(seed, 6));
+        break;
+    case 6:
+        // past the 79 bytes fgets reads
+        loc_cfg_diff_put_text(file, seed, 60 + loc_cfg_diff_rand(seed, 120));
+        break;
+    default:
+        loc_cfg_diff_put_text(file, seed, loc_cfg_diff_rand(seed, 30));
+    }
+}
+
+void loc_cfg_diff_write_random(FILE* file, int lines, unsigned int* seed)
+{
+    for (int line = 0; line < lines; line++) {
+        switch (loc_cfg_diff_rand(seed, 16)) {
+        case 0:
+            fputc('#', file);
+            loc_cfg_diff_put_text(file, seed, loc_cfg_diff_rand(seed, 70));
+            break;
+        case 1:
+            loc_cfg_diff_put_spaces(file, seed);
+            break;
+        case 2:
+            // no '='
+            fputs(loc_cfg_diff_name(seed), file);
+            loc_cfg_diff_put_text(file, seed, loc_cfg_diff_rand(seed, 10));
+            break;
+        case 3:
+            // no value, or nothing but spaces
+            fprintf(file, "%s=", loc_cfg_diff_name(seed));
+            loc_cfg_diff_put_spaces(file, seed);
+            break;
+        case 4:
+            // runs of '=' before, between and after
+            for (int n = loc_cfg_diff_rand(seed, 3); n > 0; n--) {
+                fputc('=', file);
+            }
+            fputs(loc_cfg_diff_name(seed), file);
+            for (int n = 1 + loc_cfg_diff_rand(seed, 3); n > 0; n--) {
+                fputc('=', file);
+            }
+            loc_cfg_diff_put_value(file, seed);
+            for (int n = loc_cfg_diff_rand(seed, 3); n > 0; n--) {
+                fputc('=', file);
+                loc_cfg_diff_put_value(file, seed);
+            }
+            break;
+        case 5:
+            // a NUL inside the line
+            fprintf(file, "%s=", loc_cfg_diff_name(seed));
+            loc_cfg_diff_put_value(file, seed);
+            fputc('\0', file);
+            loc_cfg_diff_put_value(file, seed);
+            break;
+        case 6:
+            // a name with spaces inside
+            fprintf(file, "%s %s=", loc_cfg_diff_name(seed), loc_cfg_diff_name(seed));
+            loc_cfg_diff_put_value(file, seed);
+            break;
+        default:
+            loc_cfg_diff_put_spaces(file, seed);
+            fputs(loc_cfg_diff_name(seed), file);
+            loc_cfg_diff_put_spaces(file, seed);
+            fputc('=', file);
+            loc_cfg_diff_put_spaces(file, seed);
+            loc_cfg_diff_put_value(file, seed);
+            loc_cfg_diff_put_spaces(file, seed);
+        }
+        if (line + 1 < lines || loc_cfg_diff_rand(seed, 2)) {
+            fputs(loc_cfg_diff_rand(seed, 8) ? "\n" : "\r\n", file);
+        }
+    }
+}
+
+void loc_cfg_diff_write_large(FILE* file, int lines, unsigned int* seed)
+{
+    static const char* const comments[] = {
+        "#Uncommenting these urls would only enable",
+        "#the power up auto injection and force injection(s).",
+        "#These urls are not required for the on demand injection.",
+        "# Error Estimate",
+        "# _SET = 1",
+        "# _CLEAR = 0",
+        "#Test",
+        "################################",
+        "##### AGPS server settings #####",
+    };
+
+    for (int line = 0; line < lines; line++) {
+        int kind = loc_cfg_diff_rand(seed, 10);
+        if (kind < 4) {
+            fputs(comments[loc_cfg_diff_rand(seed, sizeof(comments) / sizeof(comments[0]))], file);
+        } else if (kind < 5) {
+            // blank
+        } else if (kind < 7) {
+            fprintf(file, "%s=%s.example.com",
+                    loc_cfg_diff_unknown[loc_cfg_diff_rand(seed, 7)],
+                    loc_cfg_diff_rand(seed, 2) ? "xtra" : "supl");
+        } else {
+            int i = loc_cfg_diff_rand(seed, LOC_CFG_DIFF_ENTRIES);
+            switch (loc_cfg_diff_params[i].type) {
+            case 'n':
+                fprintf(file, loc_cfg_diff_rand(seed, 4) ? "%s = %d" : "%s = 0x%X",
+                        loc_cfg_diff_params[i].name, loc_cfg_diff_rand(seed, 0x10000));
+                break;
+            case 'f':
+                fprintf(file, "%s = %.6e", loc_cfg_diff_params[i].name,
+                        loc_cfg_diff_rand(seed, 100000) / 1e8);
+                break;
+            default:
+                fprintf(file, "%s = /data/misc/location/trace%d.bin",
+                        loc_cfg_diff_params[i].name, loc_cfg_diff_rand(seed, 100));
+            }
+        }
+        fputc('\n', file);
+    }
+}
@@ -0,0 +1,75 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef LOC_CFG_DIFF_H
+#define LOC_CFG_DIFF_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <loc_cfg.h>
+
+// Shared by the loc_read_conf test and benchmark: a copy of loc_read_conf
+// as it was before the mapped, indexed parser, a parameter table modelled
+// on the one loc_eng reads gps.conf with, and writers of conf files to
+// feed both.
+
+#define LOC_CFG_DIFF_ENTRIES 36
+
+struct LocCfgDiffValue {
+    int number;
+    double real;
+    char string[LOC_MAX_PARAM_STRING + 1];
+    uint8_t set;
+};
+
+// Table entries point into values, so each parser gets a table of its own
+struct LocCfgDiffTable {
+    loc_param_s_type entries[LOC_CFG_DIFF_ENTRIES];
+    LocCfgDiffValue values[LOC_CFG_DIFF_ENTRIES];
+};
+
+// Fills in the names and types, and every value with the same pattern
+void loc_cfg_diff_table_init(LocCfgDiffTable &table);
+// Index of the first entry whose value differs between a and b, or -1
+int loc_cfg_diff_compare(const LocCfgDiffTable &a, const LocCfgDiffTable &b);
+
+// loc_read_conf before the index, less the logging parameters
+void loc_cfg_diff_read_conf_ref(const char* conf_file_name,
+                                loc_param_s_type* config_table,
+                                uint32_t table_length);
+
+// Writes lines of random lines, mostly about the table's parameters but
+// with every oddity the parsers have to agree on: repeated '=', missing
+// values, spaces only values, lines longer than fgets reads, NULs, CRs
+// and no newline at the end
+void loc_cfg_diff_write_random(FILE* file, int lines, unsigned int* seed);
+// Writes lines of a gps.conf as a vendor would ship it: comment blocks,
+// blank lines, the table's parameters and parameters it does not know
+void loc_cfg_diff_write_large(FILE* file, int lines, unsigned int* seed);
+
+#endif // LOC_CFG_DIFF_H
@@ -0,0 +1,124 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_cfg_test"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <loc_cfg.h>
+#include <loc_cfg_diff.h>
+
+// Differential test of loc_read_conf: random conf files are read by it
+// and by the parser it replaced, and every parameter must come out the
+// same, set flags included. Two tables take turns, so the name index is
+// both rebuilt and reused. Ends with one large gps.conf-like file.
+//
+//   loc_cfg_test [-r rounds] [-l lines per file] [-s seed]
+
+static LocCfgDiffTable loc_cfg_test_tables[2];
+static LocCfgDiffTable loc_cfg_test_ref;
+
+// 0 if both parsers agree on path, read into table
+static int loc_cfg_test_read(const char* path, LocCfgDiffTable &table)
+{
+    loc_cfg_diff_table_init(table);
+    loc_cfg_diff_table_init(loc_cfg_test_ref);
+    loc_read_conf(path, table.entries, LOC_CFG_DIFF_ENTRIES);
+    loc_cfg_diff_read_conf_ref(path, loc_cfg_test_ref.entries, LOC_CFG_DIFF_ENTRIES);
+
+    int i = loc_cfg_diff_compare(table, loc_cfg_test_ref);
+    if (i >= 0) {
+        const LocCfgDiffValue& got = table.values[i];
+        const LocCfgDiffValue& want = loc_cfg_test_ref.values[i];
+        fprintf(stderr, "%s: %s differs: %d %g \"%s\" set %d, want %d %g \"%s\" set %d\n",
+                path, table.entries[i].param_name, got.number, got.real, got.string, got.set,
+                want.number, want.real, want.string, want.set);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    int rounds = 3000;
+    int lines = 40;
+    unsigned int seed = 1;
+    int opt;
+
+    while (-1 != (opt = getopt(argc, argv, "r:l:s:"))) {
+        switch (opt) {
+        case 'r':
+            rounds = atoi(optarg);
+            break;
+        case 'l':
+            lines = atoi(optarg);
+            break;
+        case 's':
+            seed = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-r rounds] [-l lines per file] [-s seed]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    char path[] = "/tmp/loc_cfg_test.XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        fprintf(stderr, "%s: no temporary file\n", argv[0]);
+        return 1;
+    }
+    close(fd);
+
+    int failed = 0;
+    for (int round = 0; round <= rounds; round++) {
+        FILE* file = fopen(path, "w");
+        if (NULL == file) {
+            failed++;
+            break;
+        }
+        if (round < rounds) {
+            loc_cfg_diff_write_random(file, lines, &seed);
+        } else {
+            loc_cfg_diff_write_large(file, 20000, &seed);
+        }
+        fclose(file);
+        if (0 != loc_cfg_test_read(path, loc_cfg_test_tables[round % 2])) {
+            fprintf(stderr, "round %d, seed %u\n", round, seed);
+            failed++;
+        }
+    }
+    unlink(path);
+
+    printf("%d random files of %d lines and one large file: %d differ\n", rounds, lines, failed);
+    printf("%s\n", failed ? "FAIL" : "PASS");
+    return failed ? 1 : 0;
+}
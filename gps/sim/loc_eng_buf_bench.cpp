@@ -0,0 +1,212 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_buf_bench"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <loc_eng.h>
+
+// Measures what a producer pays to turn a full 12 SV epoch of NMEA into
+// report messages at 1, 5 and 10 Hz: formatting each sentence into a
+// scratch buffer and having the message copy it, against formatting it
+// into a LocEngBuffer and handing that off. Then the same for an XTRA file
+// copied into a message, against shared with it. Only the producer side is
+// timed; the messages are deleted right away, as the handler would.
+//
+//   loc_eng_buf_bench [-s seconds per rate] [-x xtra KB]
+
+#define LOC_BUF_BENCH_SVS       12
+#define LOC_BUF_BENCH_SENTENCES (3 + (LOC_BUF_BENCH_SVS + 3) / 4)
+#define LOC_BUF_BENCH_XTRA_ROUNDS 1000
+
+static int loc_buf_bench_seconds = 3600;
+static volatile int loc_buf_bench_sink;
+
+static int64_t loc_buf_bench_now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int loc_buf_bench_checksum(char* sentence, int length, int size)
+{
+    uint8_t sum = 0;
+    for (int i = 1; i < length; i++) {
+        sum ^= (uint8_t)sentence[i];
+    }
+    return length + snprintf(sentence + length, size - length, "*%02X\r\n", sum);
+}
+
+// Formats sentence n of the epoch at fix into buf; returns its length
+static int loc_buf_bench_sentence(char* buf, int size, int fix, int n)
+{
+    int len;
+    int sec = fix % 60;
+    if (n < (LOC_BUF_BENCH_SVS + 3) / 4) {
+        int pages = (LOC_BUF_BENCH_SVS + 3) / 4;
+        len = snprintf(buf, size, "$GPGSV,%d,%d,%02d", pages, n + 1, LOC_BUF_BENCH_SVS);
+        for (int sv = n * 4; sv < LOC_BUF_BENCH_SVS && sv < n * 4 + 4; sv++) {
+            len += snprintf(buf + len, size - len, ",%02d,%02d,%03d,%02d",
+                            sv + 1, 10 + (sv * 7 + fix) % 80,
+                            (sv * 31 + fix) % 360, 20 + (sv * 3 + fix) % 30);
+        }
+    } else if (n == LOC_BUF_BENCH_SENTENCES - 3) {
+        len = snprintf(buf, size, "$GPGSA,A,3");
+        for (int sv = 0; sv < 12; sv++) {
+            len += snprintf(buf + len, size - len, ",%02d", sv + 1);
+        }
+        len += snprintf(buf + len, size - len, ",1.6,0.9,1.3");
+    } else if (n == LOC_BUF_BENCH_SENTENCES - 2) {
+        len = snprintf(buf, size,
+                       "$GPRMC,1200%02d.00,A,3725.319898,N,12205.327141,W,%.1f,%.1f,161026,,,A",
+                       sec, (fix % 20) * 0.1, (fix % 3600) * 0.1);
+    } else {
+        len = snprintf(buf, size,
+                       "$GPGGA,1200%02d.00,3725.319898,N,12205.327141,W,1,%02d,0.9,%.1f,M,-25.7,M,,",
+                       sec, LOC_BUF_BENCH_SVS, 12.0 + (fix % 50) * 0.1);
+    }
+    return loc_buf_bench_checksum(buf, len, size);
+}
+
+// One epoch, each sentence formatted into scratch and copied by the message
+static void loc_buf_bench_epoch_copy(int fix)
+{
+    char scratch[200];
+    for (int n = 0; n < LOC_BUF_BENCH_SENTENCES; n++) {
+        int len = loc_buf_bench_sentence(scratch, sizeof(scratch), fix, n);
+        loc_eng_msg_report_nmea* msg = new loc_eng_msg_report_nmea(NULL, scratch, len);
+        loc_buf_bench_sink += msg->length;
+        delete msg;
+    }
+}
+
+// One epoch, each sentence formatted into a buffer the message takes over
+static void loc_buf_bench_epoch_share(int fix)
+{
+    for (int n = 0; n < LOC_BUF_BENCH_SENTENCES; n++) {
+        LocEngBuffer* buf = loc_eng_buf_alloc(200);
+        if (NULL == buf) {
+            continue;
+        }
+        buf->length = loc_buf_bench_sentence(buf->data, 200, fix, n);
+        loc_eng_msg_report_nmea* msg = new loc_eng_msg_report_nmea(NULL, buf);
+        loc_eng_buf_unref(buf);
+        loc_buf_bench_sink += msg->length;
+        delete msg;
+    }
+}
+
+// ns per epoch of fn, over loc_buf_bench_seconds of fixes at hz
+static double loc_buf_bench_rate(void (*fn)(int), int hz)
+{
+    int epochs = loc_buf_bench_seconds * hz;
+    int64_t start = loc_buf_bench_now_ns();
+    for (int fix = 0; fix < epochs; fix++) {
+        fn(fix);
+    }
+    return (double)(loc_buf_bench_now_ns() - start) / epochs;
+}
+
+static void loc_buf_bench_xtra(int kb)
+{
+    int len = kb * 1024;
+    char* file = (char*)malloc(len);
+    if (NULL == file) {
+        return;
+    }
+    memset(file, 0xa5, len);
+
+    int64_t start = loc_buf_bench_now_ns();
+    for (int i = 0; i < LOC_BUF_BENCH_XTRA_ROUNDS; i++) {
+        loc_eng_msg_inject_xtra_data* msg = new loc_eng_msg_inject_xtra_data(NULL, file, len);
+        loc_buf_bench_sink += msg->length;
+        delete msg;
+    }
+    int64_t copyNs = loc_buf_bench_now_ns() - start;
+
+    LocEngBuffer* buf = loc_eng_buf_adopt(file, len, (void (*)(char*))free);
+    start = loc_buf_bench_now_ns();
+    for (int i = 0; i < LOC_BUF_BENCH_XTRA_ROUNDS; i++) {
+        loc_eng_msg_inject_xtra_data* msg = new loc_eng_msg_inject_xtra_data(NULL, buf);
+        loc_buf_bench_sink += msg->length;
+        delete msg;
+    }
+    int64_t shareNs = loc_buf_bench_now_ns() - start;
+    loc_eng_buf_unref(buf);
+
+    printf("%d KB XTRA message: copy %.1f us, share %.1f us\n", kb,
+           (double)copyNs / LOC_BUF_BENCH_XTRA_ROUNDS / 1000,
+           (double)shareNs / LOC_BUF_BENCH_XTRA_ROUNDS / 1000);
+}
+
+int main(int argc, char** argv)
+{
+    static const int rates[] = { 1, 5, 10 };
+    int xtraKb = 40;
+    int opt;
+
+    while (-1 != (opt = getopt(argc, argv, "s:x:"))) {
+        switch (opt) {
+        case 's':
+            loc_buf_bench_seconds = atoi(optarg);
+            break;
+        case 'x':
+            xtraKb = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-s seconds per rate] [-x xtra KB]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (loc_buf_bench_seconds <= 0 || xtraKb <= 0) {
+        fprintf(stderr, "%s: seconds and KB must be positive\n", argv[0]);
+        return 1;
+    }
+
+    // DEBUG_LEVEL from gps.conf, as logging every message would swamp the
+    // numbers
+    loc_eng_read_config();
+
+    printf("%d SVs, %d sentences per epoch, %d s of fixes per rate\n",
+           LOC_BUF_BENCH_SVS, LOC_BUF_BENCH_SENTENCES, loc_buf_bench_seconds);
+    for (unsigned i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+        double copyNs = loc_buf_bench_rate(loc_buf_bench_epoch_copy, rates[i]);
+        double shareNs = loc_buf_bench_rate(loc_buf_bench_epoch_share, rates[i]);
+        printf("%2d Hz: copy %.0f ns per epoch (%.1f us/s), share %.0f ns per epoch (%.1f us/s)\n",
+               rates[i], copyNs, copyNs * rates[i] / 1000, shareNs, shareNs * rates[i] / 1000);
+    }
+    loc_buf_bench_xtra(xtraKb);
+    return 0;
+}
@@ -0,0 +1,303 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_coalesce_test"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <loc_eng.h>
+#include <FakeLocApiAdapter.h>
+#include "log_util.h"
+
+// Sends an SV report and then a fix for every epoch while a slow
+// location_cb keeps deferred_q backed up, so that reports get replaced
+// while they wait. Whatever makes it through must come in epoch order, each
+// fix right after the SV report of its own epoch, and the GGA / GSA of each
+// fix must count the svs of that SV report.
+//
+// The SV report of epoch n has prn 1 and prn n + 2 in use; the fix of
+// epoch n is n steps north and comes half an interval after it, so the
+// deferred thread often finds a fix queued behind a newer SV report.
+//
+//   loc_eng_coalesce_test [-d cb delay ms] [-i epoch interval ms] [-e epochs]
+
+#define LOC_COALESCE_TEST_MAX_EPOCHS 30
+#define LOC_COALESCE_TEST_LAT 37.4219999
+#define LOC_COALESCE_TEST_LAT_STEP 0.0001
+
+static loc_eng_data_s_type loc_coalesce_test_data;
+static FakeLocApiAdapter* loc_coalesce_test_adapter;
+static FakeLocEvent loc_coalesce_test_events[2 * LOC_COALESCE_TEST_MAX_EPOCHS];
+static int loc_coalesce_test_cb_delay_ms = 50;
+static int loc_coalesce_test_interval_ms = 20;
+static int loc_coalesce_test_epochs = LOC_COALESCE_TEST_MAX_EPOCHS;
+
+// only touched by the deferred action thread, REPORT_THREAD is off
+static int loc_coalesce_test_sv_epoch = -1;
+static int loc_coalesce_test_fix_epoch = -1;
+static int loc_coalesce_test_svs;
+static int loc_coalesce_test_fixes;
+static int loc_coalesce_test_failures;
+
+static void loc_coalesce_test_fail(const char* what, int expected, int got)
+{
+    if (loc_coalesce_test_failures++ < 10) {
+        fprintf(stderr, "%s: expected %d, got %d\n", what, expected, got);
+    }
+}
+
+struct loc_coalesce_test_thread_arg {
+    void (*start)(void*);
+    void* arg;
+};
+
+static void* loc_coalesce_test_thread_start(void* p)
+{
+    loc_coalesce_test_thread_arg targ = *(loc_coalesce_test_thread_arg*)p;
+    free(p);
+    targ.start(targ.arg);
+    return NULL;
+}
+
+static pthread_t loc_coalesce_test_create_thread(const char*, void (*start)(void*), void* arg)
+{
+    pthread_t tid = 0;
+    loc_coalesce_test_thread_arg* targ =
+        (loc_coalesce_test_thread_arg*)malloc(sizeof(loc_coalesce_test_thread_arg));
+
+    if (NULL != targ) {
+        targ->start = start;
+        targ->arg = arg;
+        if (0 != pthread_create(&tid, NULL, loc_coalesce_test_thread_start, targ)) {
+            free(targ);
+            tid = 0;
+        }
+    }
+    return tid;
+}
+
+static void loc_coalesce_test_sv_status_cb(GpsSvStatus* sv_status, void*)
+{
+    int epoch = sv_status->sv_list[1].prn - 2;
+
+    loc_coalesce_test_svs++;
+    if (epoch <= loc_coalesce_test_sv_epoch || epoch <= loc_coalesce_test_fix_epoch) {
+        loc_coalesce_test_fail("sv report epoch after the last one",
+                               loc_coalesce_test_sv_epoch + 1, epoch);
+    }
+    loc_coalesce_test_sv_epoch = epoch;
+}
+
+// stands in for a framework that takes its time with every fix
+static void loc_coalesce_test_location_cb(GpsLocation* location, void*)
+{
+    int epoch = (int)((location->latitude - LOC_COALESCE_TEST_LAT) /
+                      LOC_COALESCE_TEST_LAT_STEP + 0.5);
+
+    loc_coalesce_test_fixes++;
+    if (epoch != loc_coalesce_test_sv_epoch || epoch <= loc_coalesce_test_fix_epoch) {
+        loc_coalesce_test_fail("fix epoch, that of the sv report before it",
+                               loc_coalesce_test_sv_epoch, epoch);
+    }
+    loc_coalesce_test_fix_epoch = epoch;
+    usleep(loc_coalesce_test_cb_delay_ms * 1000);
+}
+
+static void loc_coalesce_test_status_cb(GpsStatus*)
+{
+}
+
+// the fields of a sentence, split in place
+static int loc_coalesce_test_fields(char* sentence, char** fields, int max)
+{
+    int count = 0;
+    char* p = sentence;
+
+    while (count < max) {
+        fields[count++] = p;
+        p = strchr(p, ',');
+        if (NULL == p) {
+            break;
+        }
+        *p++ = '\0';
+    }
+    return count;
+}
+
+static void loc_coalesce_test_nmea_cb(GpsUtcTime, const char* nmea, int length)
+{
+    char sentence[128];
+    char* fields[20];
+
+    if (length >= (int)sizeof(sentence)) {
+        return;
+    }
+    memcpy(sentence, nmea, length);
+    sentence[length] = '\0';
+
+    if (0 == strncmp(sentence, "$GPGGA,", 7)) {
+        // $GPGGA,time,lat,N,lon,W,quality,svs in use,...
+        if (loc_coalesce_test_fields(sentence, fields, 20) > 7 && 2 != atoi(fields[7])) {
+            loc_coalesce_test_fail("svs in use in GGA", 2, atoi(fields[7]));
+        }
+    } else if (0 == strncmp(sentence, "$GPGSA,", 7)) {
+        // $GPGSA,A,fix type,prn,prn,...
+        if (loc_coalesce_test_fields(sentence, fields, 20) > 4 &&
+            (1 != atoi(fields[3]) || loc_coalesce_test_fix_epoch + 2 != atoi(fields[4]))) {
+            loc_coalesce_test_fail("second prn in GSA", loc_coalesce_test_fix_epoch + 2,
+                                   atoi(fields[4]));
+        }
+    }
+}
+
+static void loc_coalesce_test_wakelock_cb()
+{
+}
+
+static LocApiAdapter* loc_coalesce_test_get_adapter(LocEng &locEng)
+{
+    loc_coalesce_test_adapter = new FakeLocApiAdapter(locEng, loc_coalesce_test_events,
+                                                       2 * loc_coalesce_test_epochs,
+                                                       NULL, 1.0, 1);
+    return loc_coalesce_test_adapter;
+}
+
+static void loc_coalesce_test_make_events()
+{
+    memset(loc_coalesce_test_events, 0, sizeof(loc_coalesce_test_events));
+    for (int i = 0; i < loc_coalesce_test_epochs; i++) {
+        FakeLocEvent &sv = loc_coalesce_test_events[2 * i];
+        sv.timeUs = (int64_t)i * loc_coalesce_test_interval_ms * 1000;
+        sv.type = FAKE_LOC_EVENT_SV;
+        sv.svStatus.size = sizeof(GpsSvStatus);
+        sv.svStatus.num_svs = 2;
+        for (int j = 0; j < 2; j++) {
+            sv.svStatus.sv_list[j].size = sizeof(GpsSvInfo);
+            sv.svStatus.sv_list[j].prn = j ? i + 2 : 1;
+            sv.svStatus.sv_list[j].snr = 40;
+            sv.svStatus.sv_list[j].elevation = 45;
+            sv.svStatus.sv_list[j].azimuth = 90 * j;
+        }
+        sv.svStatus.used_in_fix_mask = 1 | (1 << (i + 1));
+        sv.svStatus.ephemeris_mask = sv.svStatus.used_in_fix_mask;
+        sv.svStatus.almanac_mask = sv.svStatus.used_in_fix_mask;
+
+        FakeLocEvent &fix = loc_coalesce_test_events[2 * i + 1];
+        fix.timeUs = sv.timeUs + loc_coalesce_test_interval_ms * 1000 / 2;
+        fix.type = FAKE_LOC_EVENT_POSITION;
+        fix.location.size = sizeof(GpsLocation);
+        fix.location.flags = GPS_LOCATION_HAS_LAT_LONG | GPS_LOCATION_HAS_ACCURACY;
+        fix.location.position_source = ULP_LOCATION_IS_FROM_GNSS;
+        fix.location.latitude = LOC_COALESCE_TEST_LAT + i * LOC_COALESCE_TEST_LAT_STEP;
+        fix.location.longitude = -122.0840575;
+        fix.location.accuracy = 5;
+        fix.sessionStatus = LOC_SESS_SUCCESS;
+        fix.techMask = LOC_POS_TECH_MASK_SATELLITE;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int opt;
+
+    while (-1 != (opt = getopt(argc, argv, "d:i:e:"))) {
+        switch (opt) {
+        case 'd':
+            loc_coalesce_test_cb_delay_ms = atoi(optarg);
+            break;
+        case 'i':
+            loc_coalesce_test_interval_ms = atoi(optarg);
+            break;
+        case 'e':
+            loc_coalesce_test_epochs = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-d cb delay ms] [-i epoch interval ms] [-e epochs]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (loc_coalesce_test_epochs < 1 || loc_coalesce_test_epochs > LOC_COALESCE_TEST_MAX_EPOCHS) {
+        fprintf(stderr, "%s: 1 to %d epochs\n", argv[0], LOC_COALESCE_TEST_MAX_EPOCHS);
+        return 1;
+    }
+
+    LocCallbacks callbacks = {loc_coalesce_test_location_cb, /* location_cb */
+                              loc_coalesce_test_status_cb, /* status_cb */
+                              loc_coalesce_test_sv_status_cb, /* sv_status_cb */
+                              loc_coalesce_test_nmea_cb, /* nmea_cb */
+                              NULL, /* set_capabilities_cb */
+                              loc_coalesce_test_wakelock_cb, /* acquire_wakelock_cb */
+                              loc_coalesce_test_wakelock_cb, /* release_wakelock_cb */
+                              loc_coalesce_test_create_thread, /* create_thread_cb */
+                              NULL, /* location_ext_parser */
+                              NULL, /* sv_ext_parser */
+                              NULL, /* request_utc_time_cb */
+                              NULL /* nmea_burst_cb */};
+    LocPosMode mode(LOC_POSITION_MODE_STANDALONE, GPS_POSITION_RECURRENCE_PERIODIC,
+                    MIN_POSSIBLE_FIX_INTERVAL, 0, 0, NULL, NULL);
+
+    loc_coalesce_test_make_events();
+    loc_eng_read_config();
+    // the callbacks run on the deferred action thread, behind deferred_q
+    gps_conf.REPORT_THREAD = 0;
+    LocApiAdapter::setLocApiAdapterFactory(loc_coalesce_test_get_adapter);
+
+    if (0 != loc_eng_init(loc_coalesce_test_data, &callbacks,
+                          LOC_API_ADAPTER_BIT_PARSED_POSITION_REPORT |
+                          LOC_API_ADAPTER_BIT_SATELLITE_REPORT |
+                          LOC_API_ADAPTER_BIT_STATUS_REPORT, NULL)) {
+        fprintf(stderr, "loc_eng_init failed\n");
+        return 1;
+    }
+    loc_eng_set_position_mode(loc_coalesce_test_data, mode);
+    loc_eng_start(loc_coalesce_test_data);
+
+    loc_coalesce_test_adapter->waitReplayDone();
+    // what is still queued takes a location_cb or two
+    usleep(4 * loc_coalesce_test_cb_delay_ms * 1000 + 100000);
+
+    loc_eng_stop(loc_coalesce_test_data);
+    loc_eng_cleanup(loc_coalesce_test_data);
+    usleep(100000);
+
+    printf("%d epochs, location_cb takes %d ms: %d sv reports, %d fixes, %d failures\n",
+           loc_coalesce_test_epochs, loc_coalesce_test_cb_delay_ms, loc_coalesce_test_svs,
+           loc_coalesce_test_fixes, loc_coalesce_test_failures);
+    // the latest epoch always makes it; with the backlog, not every one did
+    bool passed = 0 == loc_coalesce_test_failures &&
+                  loc_coalesce_test_epochs - 1 == loc_coalesce_test_fix_epoch &&
+                  loc_coalesce_test_fixes < loc_coalesce_test_epochs;
+    printf("%s\n", passed ? "PASS" : "FAIL");
+    return passed ? 0 : 1;
+}
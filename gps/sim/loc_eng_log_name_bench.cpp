@@ -0,0 +1,158 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <loc_eng.h>
+#include <loc_eng_log.h>
+#include "loc_log.h"
+#include "log_util.h"
+
+// Times loc_get_msg_name, which every loc_eng_msg constructor and
+// destructor logs with, against a linear loc_get_name_from_val over one
+// table holding all the message ids, the way it was looked up before.
+// Then a sparse table, binary searched by loc_get_name_from_sorted,
+// against the linear scan. The lookups must agree, or it fails.
+//
+//   loc_eng_log_name_bench [-n lookups]
+
+#define LOC_NAME_BENCH_MAX_ID   0x1000
+#define LOC_NAME_BENCH_SPARSE   64
+
+static loc_name_val_s_type loc_name_bench_msgs[LOC_NAME_BENCH_MAX_ID];
+static int loc_name_bench_msgs_num;
+static loc_name_val_s_type loc_name_bench_sparse[LOC_NAME_BENCH_SPARSE];
+static long loc_name_bench_ids[LOC_NAME_BENCH_MAX_ID];
+
+static int64_t loc_name_bench_now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// ns per lookup of n lookups of ids, which has count entries
+static double loc_name_bench_time(const char* (*lookup)(loc_name_val_s_type*, int, long),
+                                  loc_name_val_s_type* table, int table_size,
+                                  const long* ids, int count, int n)
+{
+    volatile size_t sink = 0;
+    int64_t start = loc_name_bench_now_ns();
+    for (int i = 0; i < n; i++) {
+        sink += (size_t)lookup(table, table_size, ids[(i * 2654435761u) % count]);
+    }
+    return (double)(loc_name_bench_now_ns() - start) / n;
+}
+
+// loc_get_msg_name with the signature of the table lookups
+static const char* loc_name_bench_msg_name(loc_name_val_s_type*, int, long id)
+{
+    return loc_get_msg_name((int)id);
+}
+
+int main(int argc, char** argv)
+{
+    int lookups = 2000000;
+    int opt;
+    int failed = 0;
+
+    while (-1 != (opt = getopt(argc, argv, "n:"))) {
+        switch (opt) {
+        case 'n':
+            lookups = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-n lookups]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (lookups <= 0) {
+        fprintf(stderr, "%s: lookups must be positive\n", argv[0]);
+        return 1;
+    }
+
+    // errors only, so nothing but the lookups is timed
+    loc_logger_init(1, 0);
+
+    // every named message id, in one table ordered by id
+    for (long id = 0; id < LOC_NAME_BENCH_MAX_ID; id++) {
+        const char* name = loc_get_msg_name((int)id);
+        if (0 != strcmp(name, UNKNOWN_STR)) {
+            loc_name_val_s_type& entry = loc_name_bench_msgs[loc_name_bench_msgs_num];
+            snprintf(entry.name, sizeof(entry.name), "%s", name);
+            entry.val = id;
+            loc_name_bench_ids[loc_name_bench_msgs_num++] = id;
+        }
+    }
+    for (long id = 0; id < LOC_NAME_BENCH_MAX_ID; id++) {
+        if (0 != strcmp(loc_get_msg_name((int)id),
+                        loc_get_name_from_val(loc_name_bench_msgs, loc_name_bench_msgs_num, id))) {
+            fprintf(stderr, "msg id 0x%lx: names differ\n", id);
+            failed = 1;
+        }
+    }
+
+    // a sparse enum, values spreading out like the NI and AGPS ones do
+    long sparseIds[LOC_NAME_BENCH_SPARSE];
+    for (int i = 0; i < LOC_NAME_BENCH_SPARSE; i++) {
+        loc_name_val_s_type& entry = loc_name_bench_sparse[i];
+        entry.val = (long)i * i - 8;
+        snprintf(entry.name, sizeof(entry.name), "SPARSE_%d", i);
+        sparseIds[i] = entry.val;
+    }
+    for (long v = -16; v < (long)LOC_NAME_BENCH_SPARSE * LOC_NAME_BENCH_SPARSE; v++) {
+        if (0 != strcmp(loc_get_name_from_sorted(loc_name_bench_sparse, LOC_NAME_BENCH_SPARSE, v),
+                        loc_get_name_from_val(loc_name_bench_sparse, LOC_NAME_BENCH_SPARSE, v))) {
+            fprintf(stderr, "sparse value %ld: names differ\n", v);
+            failed = 1;
+        }
+    }
+
+    double linearNs = loc_name_bench_time(loc_get_name_from_val, loc_name_bench_msgs,
+                                          loc_name_bench_msgs_num, loc_name_bench_ids,
+                                          loc_name_bench_msgs_num, lookups);
+    double msgNs = loc_name_bench_time(loc_name_bench_msg_name, NULL, 0, loc_name_bench_ids,
+                                       loc_name_bench_msgs_num, lookups);
+    printf("%d message ids: linear %.1f ns, loc_get_msg_name %.1f ns\n",
+           loc_name_bench_msgs_num, linearNs, msgNs);
+
+    linearNs = loc_name_bench_time(loc_get_name_from_val, loc_name_bench_sparse,
+                                   LOC_NAME_BENCH_SPARSE, sparseIds, LOC_NAME_BENCH_SPARSE, lookups);
+    double sortedNs = loc_name_bench_time(loc_get_name_from_sorted, loc_name_bench_sparse,
+                                          LOC_NAME_BENCH_SPARSE, sparseIds,
+                                          LOC_NAME_BENCH_SPARSE, lookups);
+    printf("%d sparse values: linear %.1f ns, binary search %.1f ns\n",
+           LOC_NAME_BENCH_SPARSE, linearNs, sortedNs);
+
+    printf("%s\n", failed ? "FAIL" : "PASS");
+    return failed;
+}
@@ -0,0 +1,137 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_nmea_bench"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <loc_eng.h>
+#include <loc_eng_nmea.h>
+#include <loc_eng_nmea_replay.h>
+
+// Measures how fast the NMEA generator turns the position and sv reports
+// of a trace into sentences, on one thread with nmea_cb doing nothing, and
+// what a fixed point field costs against snprintf "%0*.*f".
+//
+//   loc_eng_nmea_bench [-n loops] [trace]
+
+#define LOC_NMEA_BENCH_FIELDS 1000000
+
+static volatile int loc_nmea_bench_sentences;
+static volatile int loc_nmea_bench_bytes;
+
+static void loc_nmea_bench_nmea_cb(GpsUtcTime, const char*, int length)
+{
+    loc_nmea_bench_sentences++;
+    loc_nmea_bench_bytes += length;
+}
+
+static int64_t loc_nmea_bench_now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void loc_nmea_bench_fields()
+{
+    char field[64];
+    volatile int sink = 0;
+    double value = 3725.319898;
+
+    int64_t start = loc_nmea_bench_now_ns();
+    for (int i = 0; i < LOC_NMEA_BENCH_FIELDS; i++) {
+        sink += snprintf(field, sizeof(field), "%0*.*f", 11, 6, value + i * 1e-6);
+    }
+    int64_t printfNs = loc_nmea_bench_now_ns() - start;
+
+    start = loc_nmea_bench_now_ns();
+    for (int i = 0; i < LOC_NMEA_BENCH_FIELDS; i++) {
+        sink += loc_eng_nmea_format_fixed(field, sizeof(field), value + i * 1e-6, 6, 11);
+    }
+    int64_t fixedNs = loc_nmea_bench_now_ns() - start;
+
+    printf("%%011.6f field: snprintf %.1f ns, loc_eng_nmea_format_fixed %.1f ns\n",
+           (double)printfNs / LOC_NMEA_BENCH_FIELDS, (double)fixedNs / LOC_NMEA_BENCH_FIELDS);
+}
+
+int main(int argc, char** argv)
+{
+    const char* tracePath = "sample.trace";
+    int loops = 20000;
+    int opt;
+
+    while (-1 != (opt = getopt(argc, argv, "n:"))) {
+        switch (opt) {
+        case 'n':
+            loops = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-n loops] [trace]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (optind + 1 == argc) {
+        tracePath = argv[optind];
+    }
+
+    int count = 0;
+    FakeLocEvent* events = FakeLocApiAdapter::loadTrace(tracePath, &count);
+    if (NULL == events) {
+        fprintf(stderr, "%s: no events in %s\n", argv[0], tracePath);
+        return 1;
+    }
+
+    // DEBUG_LEVEL from gps.conf, as logging every sentence would swamp the
+    // numbers; the replay sets the sentence mask and dividers itself
+    loc_eng_read_config();
+
+    LocEngNmeaReplay replay;
+    int reports = 0;
+    loc_eng_nmea_replay_init(replay, loc_nmea_bench_nmea_cb);
+    int64_t start = loc_nmea_bench_now_ns();
+    for (int i = 0; i < loops; i++) {
+        reports += loc_eng_nmea_replay(replay, events, count);
+    }
+    int64_t elapsedNs = loc_nmea_bench_now_ns() - start;
+    loc_eng_nmea_replay_cleanup(replay);
+    FakeLocApiAdapter::freeTrace(events, count);
+
+    double seconds = elapsedNs / 1e9;
+    printf("%d reports, %d sentences, %d bytes in %.3f s: %.0f sentences/s, %.0f ns per sentence\n",
+           reports, loc_nmea_bench_sentences, loc_nmea_bench_bytes, seconds,
+           loc_nmea_bench_sentences / seconds,
+           loc_nmea_bench_sentences ? (double)elapsedNs / loc_nmea_bench_sentences : 0.0);
+    loc_nmea_bench_fields();
+    return 0;
+}
@@ -0,0 +1,168 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_checksum_bench"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <loc_eng.h>
+#include <loc_eng_nmea.h>
+
+// Times loc_eng_nmea_put_checksum, the rescanning path raw modem NMEA
+// still takes, against the byte at a time version with snprintf it
+// replaced, over the sentences of an NMEA log with their checksums cut
+// off. Both must give back the checksums in the log, or it fails. The
+// running checksum of the sentence builder has no rescan left to time on
+// its own; loc_eng_nmea_bench times the generator as a whole.
+//
+//   loc_eng_nmea_checksum_bench [-n rounds] [nmea log]
+
+#define LOC_CHECKSUM_BENCH_MAX_SENTENCES 4096
+
+struct loc_checksum_bench_sentence {
+    char body[NMEA_SENTENCE_MAX_LENGTH];    // "$..." without "*XX\r\n"
+    char expected[NMEA_SENTENCE_MAX_LENGTH];
+    int length;                             // of expected, less the $
+};
+
+static loc_checksum_bench_sentence loc_checksum_bench_sentences[LOC_CHECKSUM_BENCH_MAX_SENTENCES];
+static int loc_checksum_bench_count;
+
+// loc_eng_nmea_put_checksum as it was, one byte at a time and snprintf
+static int loc_checksum_bench_bytewise(char *pNmea, int maxSize)
+{
+    uint8_t checksum = 0;
+    int length = 0;
+
+    pNmea++; //skip the $
+    while (*pNmea != '\0')
+    {
+        checksum ^= *pNmea++;
+        length++;
+    }
+
+    int checksumLength = snprintf(pNmea, maxSize,"*%02X\r\n", checksum);
+    return (length + checksumLength);
+}
+
+static int64_t loc_checksum_bench_now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int loc_checksum_bench_load(const char* path)
+{
+    FILE* file = fopen(path, "r");
+    char line[NMEA_SENTENCE_MAX_LENGTH];
+
+    if (NULL == file) {
+        return -1;
+    }
+    while (loc_checksum_bench_count < LOC_CHECKSUM_BENCH_MAX_SENTENCES &&
+           NULL != fgets(line, sizeof(line), file)) {
+        char* star = strrchr(line, '*');
+        if ('$' != line[0] || NULL == star) {
+            continue;
+        }
+        loc_checksum_bench_sentence& s = loc_checksum_bench_sentences[loc_checksum_bench_count++];
+        strcpy(s.expected, line);
+        s.length = strlen(line) - 1;
+        memcpy(s.body, line, star - line);
+        s.body[star - line] = '\0';
+    }
+    fclose(file);
+    return loc_checksum_bench_count;
+}
+
+// ns per sentence of put over rounds of the log, copying the sentence in
+// included, or -1 on a wrong checksum
+static double loc_checksum_bench_run(int (*put)(char*, int), int rounds)
+{
+    char sentence[NMEA_SENTENCE_MAX_LENGTH];
+    volatile int sink = 0;
+
+    for (int i = 0; i < loc_checksum_bench_count; i++) {
+        const loc_checksum_bench_sentence& s = loc_checksum_bench_sentences[i];
+        strcpy(sentence, s.body);
+        if (put(sentence, sizeof(sentence)) != s.length || 0 != strcmp(sentence, s.expected)) {
+            fprintf(stderr, "checksum differs: %s", s.expected);
+            return -1;
+        }
+    }
+
+    int64_t start = loc_checksum_bench_now_ns();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < loc_checksum_bench_count; i++) {
+            strcpy(sentence, loc_checksum_bench_sentences[i].body);
+            sink += put(sentence, sizeof(sentence));
+        }
+    }
+    return (double)(loc_checksum_bench_now_ns() - start) /
+           ((int64_t)rounds * loc_checksum_bench_count);
+}
+
+int main(int argc, char** argv)
+{
+    const char* logPath = "sample.nmea";
+    int rounds = 2000;
+    int opt;
+
+    while (-1 != (opt = getopt(argc, argv, "n:"))) {
+        switch (opt) {
+        case 'n':
+            rounds = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-n rounds] [nmea log]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (optind + 1 == argc) {
+        logPath = argv[optind];
+    }
+    if (rounds <= 0 || loc_checksum_bench_load(logPath) <= 0) {
+        fprintf(stderr, "%s: no sentences in %s\n", argv[0], logPath);
+        return 1;
+    }
+
+    double bytewiseNs = loc_checksum_bench_run(loc_checksum_bench_bytewise, rounds);
+    double wordNs = loc_checksum_bench_run(loc_eng_nmea_put_checksum, rounds);
+    printf("%d sentences x %d: byte at a time %.1f ns, loc_eng_nmea_put_checksum %.1f ns\n",
+           loc_checksum_bench_count, rounds, bytewiseNs, wordNs);
+
+    int failed = bytewiseNs < 0 || wordNs < 0;
+    printf("%s\n", failed ? "FAIL" : "PASS");
+    return failed;
+}
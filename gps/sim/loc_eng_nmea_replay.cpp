@@ -0,0 +1,88 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_nmea_replay"
+
+#include <string.h>
+#include <loc_eng.h>
+#include <loc_eng_nmea.h>
+#include <loc_eng_nmea_replay.h>
+
+void loc_eng_nmea_replay_init(LocEngNmeaReplay &replay, gps_nmea_callback nmea_cb)
+{
+    memset(&replay, 0, sizeof(replay));
+    replay.data.context = replay.context;
+    replay.data.nmea_cb = nmea_cb;
+    replay.data.generateNmea = true;
+
+    LocPosMode standalone(LOC_POSITION_MODE_STANDALONE, GPS_POSITION_RECURRENCE_PERIODIC,
+                          MIN_POSSIBLE_FIX_INTERVAL, 0, 0, NULL, NULL);
+    replay.locEng = new LocEng(&replay.data, 0, NULL, NULL, NULL, NULL, NULL, NULL);
+    replay.adapter = new FakeLocApiAdapter(*replay.locEng, NULL, 0, NULL, 0, 1);
+    replay.adapter->setPositionMode(&standalone);
+    replay.data.client_handle = replay.adapter;
+
+    gps_conf.NMEA_SENTENCE_MASK = LOC_ENG_NMEA_MASK_ALL;
+    gps_conf.NMEA_GSV_DIVIDER = 1;
+    gps_conf.NMEA_GSA_DIVIDER = 1;
+    gps_conf.NMEA_VTG_DIVIDER = 1;
+    gps_conf.NMEA_RMC_DIVIDER = 1;
+    gps_conf.NMEA_GGA_DIVIDER = 1;
+}
+
+void loc_eng_nmea_replay_cleanup(LocEngNmeaReplay &replay)
+{
+    delete replay.adapter;
+    delete replay.locEng;
+    replay.adapter = NULL;
+    replay.locEng = NULL;
+    replay.data.client_handle = NULL;
+}
+
+int loc_eng_nmea_replay(LocEngNmeaReplay &replay, const FakeLocEvent* events, int count)
+{
+    int replayed = 0;
+
+    for (int i = 0; i < count; i++) {
+        const FakeLocEvent &event = events[i];
+        if (FAKE_LOC_EVENT_POSITION == event.type) {
+            GpsLocation location = event.location;
+            if (0 == location.timestamp) {
+                location.timestamp = LOC_ENG_NMEA_REPLAY_BASE_MS + event.timeUs / 1000;
+            }
+            loc_eng_nmea_generate_pos(&replay.data, location, event.locationExtended);
+            replayed++;
+        } else if (FAKE_LOC_EVENT_SV == event.type) {
+            loc_eng_nmea_generate_sv(&replay.data, event.svStatus, event.locationExtended,
+                                     event.gloUsedInFixMask);
+            replayed++;
+        }
+    }
+    return replayed;
+}
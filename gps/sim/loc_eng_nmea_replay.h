@@ -0,0 +1,57 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef LOC_ENG_NMEA_REPLAY_H
+#define LOC_ENG_NMEA_REPLAY_H
+
+#include <loc_eng.h>
+#include <FakeLocApiAdapter.h>
+
+// Feeds the position and sv events of a trace straight to the NMEA
+// generator, on the calling thread and without a session, so the output
+// only depends on the trace. Used by the NMEA test and benchmark.
+struct LocEngNmeaReplay {
+    loc_eng_data_s_type data;
+    // stands in for the LocEngContext, with no report_q
+    uint64_t context[(sizeof(LocEngContext) + 7) / 8];
+    // client_handle, only asked for the position mode
+    LocEng* locEng;
+    FakeLocApiAdapter* adapter;
+};
+
+// Fixes without a recorded time are stamped this many ms after the epoch
+// plus their time in the trace, 2025-10-16 12:00:00 UTC
+#define LOC_ENG_NMEA_REPLAY_BASE_MS 1760616000000LL
+
+// The generator takes the fixes as standalone ones
+void loc_eng_nmea_replay_init(LocEngNmeaReplay &replay, gps_nmea_callback nmea_cb);
+void loc_eng_nmea_replay_cleanup(LocEngNmeaReplay &replay);
+// Returns the number of events handed to the generator
+int loc_eng_nmea_replay(LocEngNmeaReplay &replay, const FakeLocEvent* events, int count);
+
+#endif // LOC_ENG_NMEA_REPLAY_H
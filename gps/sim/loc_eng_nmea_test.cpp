@@ -0,0 +1,321 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_nmea_test"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <loc_eng.h>
+#include <loc_eng_nmea.h>
+#include <loc_eng_nmea_replay.h>
+
+// Checks the generated NMEA two ways:
+//
+// - golden: the sentences generated for the position and sv events of a
+//   trace, then for rounds of the same events with every field varied,
+//   must match a golden file byte for byte. sample.nmea was taken from
+//   sample.trace with the default rounds, using the snprintf based
+//   generator that came before loc_eng_nmea_put_fixed and friends; -w
+//   rewrites the golden file.
+// - fuzz: loc_eng_nmea_format_fixed must give what snprintf "%0*.*f" gives
+//   over random values, widths and precisions, ties included.
+//
+//   loc_eng_nmea_test [-w] [-r rounds] [-f fuzz count] [-s seed] [trace golden]
+
+#define LOC_NMEA_TEST_OUT_SIZE (256 * 1024)
+#define LOC_NMEA_TEST_MAX_MISMATCHES 10
+
+static char loc_nmea_test_out[LOC_NMEA_TEST_OUT_SIZE];
+static int loc_nmea_test_out_length;
+static bool loc_nmea_test_out_overflow;
+
+// one sentence per line in the golden file
+static void loc_nmea_test_nmea_cb(GpsUtcTime, const char* nmea, int length)
+{
+    if (loc_nmea_test_out_length + length + 1 > LOC_NMEA_TEST_OUT_SIZE) {
+        loc_nmea_test_out_overflow = true;
+        return;
+    }
+    memcpy(loc_nmea_test_out + loc_nmea_test_out_length, nmea, length);
+    loc_nmea_test_out_length += length;
+    loc_nmea_test_out[loc_nmea_test_out_length++] = '\n';
+}
+
+// xorshift64*, so a seed always gives the same values
+static uint64_t loc_nmea_test_rand_state;
+
+static uint64_t loc_nmea_test_rand()
+{
+    loc_nmea_test_rand_state ^= loc_nmea_test_rand_state >> 12;
+    loc_nmea_test_rand_state ^= loc_nmea_test_rand_state << 25;
+    loc_nmea_test_rand_state ^= loc_nmea_test_rand_state >> 27;
+    return loc_nmea_test_rand_state * 2685821657736338717ULL;
+}
+
+static double loc_nmea_test_uniform()
+{
+    return (loc_nmea_test_rand() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Moves every field the sentences carry, taking the flags along so both
+// sides of each branch are seen; the sv reports get up to GPS_MAX_SVS svs
+// so $GPGSV runs to several sentences.
+static void loc_nmea_test_vary(FakeLocEvent &event, int round)
+{
+    if (FAKE_LOC_EVENT_POSITION == event.type) {
+        GpsLocation &loc = event.location;
+        GpsLocationExtended &ext = event.locationExtended;
+        loc.flags = GPS_LOCATION_HAS_LAT_LONG | (loc_nmea_test_rand() & 0x1e);
+        loc.latitude = (loc_nmea_test_uniform() - 0.5) * 180.0;
+        loc.longitude = (loc_nmea_test_uniform() - 0.5) * 360.0;
+        loc.altitude = (loc_nmea_test_uniform() - 0.1) * 9000.0;
+        loc.speed = loc_nmea_test_uniform() * 100.0;
+        loc.bearing = loc_nmea_test_uniform() * 360.0;
+        loc.accuracy = loc_nmea_test_uniform() * 500.0;
+        // a day and a bit apart, so the date moves too
+        loc.timestamp = LOC_ENG_NMEA_REPLAY_BASE_MS + (int64_t)round * 90061000LL +
+                        event.timeUs / 1000;
+        ext.flags = loc_nmea_test_rand() & (GPS_LOCATION_EXTENDED_HAS_DOP |
+                                            GPS_LOCATION_EXTENDED_HAS_ALTITUDE_MEAN_SEA_LEVEL |
+                                            GPS_LOCATION_EXTENDED_HAS_MAG_DEV);
+        ext.altitudeMeanSeaLevel = (loc_nmea_test_uniform() - 0.5) * 200.0;
+        ext.pdop = loc_nmea_test_uniform() * 20.0;
+        ext.hdop = loc_nmea_test_uniform() * 20.0;
+        ext.vdop = loc_nmea_test_uniform() * 20.0;
+        ext.magneticDeviation = (loc_nmea_test_uniform() - 0.5) * 40.0;
+    } else if (FAKE_LOC_EVENT_SV == event.type) {
+        GpsSvStatus &sv = event.svStatus;
+        sv.num_svs = loc_nmea_test_rand() % (GPS_MAX_SVS + 1);
+        sv.ephemeris_mask = (uint32_t)loc_nmea_test_rand();
+        sv.almanac_mask = (uint32_t)loc_nmea_test_rand();
+        sv.used_in_fix_mask = (uint32_t)loc_nmea_test_rand() & (uint32_t)loc_nmea_test_rand();
+        for (int i = 0; i < sv.num_svs; i++) {
+            sv.sv_list[i].size = sizeof(sv.sv_list[i]);
+            sv.sv_list[i].prn = 1 + loc_nmea_test_rand() % 32;
+            sv.sv_list[i].snr = loc_nmea_test_uniform() * 55.0;
+            sv.sv_list[i].elevation = loc_nmea_test_uniform() * 90.0;
+            sv.sv_list[i].azimuth = loc_nmea_test_uniform() * 360.0;
+        }
+        event.locationExtended.flags = loc_nmea_test_rand() & GPS_LOCATION_EXTENDED_HAS_DOP;
+        event.locationExtended.pdop = loc_nmea_test_uniform() * 20.0;
+        event.locationExtended.hdop = loc_nmea_test_uniform() * 20.0;
+        event.locationExtended.vdop = loc_nmea_test_uniform() * 20.0;
+    }
+}
+
+static bool loc_nmea_test_golden(const char* tracePath, const char* goldenPath, int rounds,
+                                 bool write)
+{
+    int count = 0;
+    FakeLocEvent* events = FakeLocApiAdapter::loadTrace(tracePath, &count);
+    if (NULL == events) {
+        fprintf(stderr, "golden: no events in %s\n", tracePath);
+        return false;
+    }
+
+    LocEngNmeaReplay replay;
+    loc_eng_nmea_replay_init(replay, loc_nmea_test_nmea_cb);
+    loc_eng_nmea_replay(replay, events, count);
+    // its own seed, so the golden file does not depend on -s
+    loc_nmea_test_rand_state = 0x474f4c44454eULL;
+    for (int round = 1; round <= rounds; round++) {
+        for (int i = 0; i < count; i++) {
+            loc_nmea_test_vary(events[i], round);
+        }
+        loc_eng_nmea_replay(replay, events, count);
+    }
+    loc_eng_nmea_replay_cleanup(replay);
+    FakeLocApiAdapter::freeTrace(events, count);
+    if (loc_nmea_test_out_overflow) {
+        fprintf(stderr, "golden: more than %d bytes of NMEA\n", LOC_NMEA_TEST_OUT_SIZE);
+        return false;
+    }
+
+    if (write) {
+        FILE* fp = fopen(goldenPath, "w");
+        if (NULL == fp ||
+            1 != fwrite(loc_nmea_test_out, loc_nmea_test_out_length, 1, fp)) {
+            fprintf(stderr, "golden: cannot write %s\n", goldenPath);
+            if (NULL != fp) {
+                fclose(fp);
+            }
+            return false;
+        }
+        fclose(fp);
+        printf("golden: wrote %d bytes to %s\n", loc_nmea_test_out_length, goldenPath);
+        return true;
+    }
+
+    static char golden[LOC_NMEA_TEST_OUT_SIZE];
+    FILE* fp = fopen(goldenPath, "r");
+    if (NULL == fp) {
+        fprintf(stderr, "golden: cannot open %s\n", goldenPath);
+        return false;
+    }
+    int goldenLength = fread(golden, 1, sizeof(golden), fp);
+    fclose(fp);
+
+    int common = goldenLength < loc_nmea_test_out_length ? goldenLength : loc_nmea_test_out_length;
+    int diff = 0;
+    while (diff < common && golden[diff] == loc_nmea_test_out[diff]) {
+        diff++;
+    }
+    if (diff == common && goldenLength == loc_nmea_test_out_length) {
+        printf("golden: %s matches %s, %d bytes\n", tracePath, goldenPath, goldenLength);
+        return true;
+    }
+
+    // show the line the outputs part at
+    int line = 1, start = 0;
+    for (int i = 0; i < diff; i++) {
+        if ('\n' == golden[i]) {
+            line++;
+            start = i + 1;
+        }
+    }
+    int goldenEnd = start, outEnd = start;
+    while (goldenEnd < goldenLength && '\n' != golden[goldenEnd]) goldenEnd++;
+    while (outEnd < loc_nmea_test_out_length && '\n' != loc_nmea_test_out[outEnd]) outEnd++;
+    fprintf(stderr, "golden: %s differs from %s at line %d\n  expected %.*s\n  got      %.*s\n",
+            tracePath, goldenPath, line, goldenEnd - start, golden + start,
+            outEnd - start, loc_nmea_test_out + start);
+    return false;
+}
+
+// Values of the kinds the sentences carry, and the edge cases of rounding
+static double loc_nmea_test_value(int decimals)
+{
+    static const double specials[] = { 0.0, -0.0, 0.5, -0.5, 1.5, 2.5, 0.05, 0.15,
+                                       999999999.5, -999999999.5, 1e9, -1e9,
+                                       INFINITY, -INFINITY, NAN };
+    double scale = pow(10.0, decimals);
+    double sign = (loc_nmea_test_rand() & 1) ? -1.0 : 1.0;
+    double v;
+
+    switch (loc_nmea_test_rand() % 7) {
+    case 0:
+        // any magnitude a fix may carry
+        return sign * loc_nmea_test_uniform() * pow(10.0, (int)(loc_nmea_test_rand() % 17) - 7);
+    case 1:
+        // a tie at the last digit, or the nearest doubles either side
+        v = (floor(loc_nmea_test_uniform() * 1e6) + 0.5) / scale;
+        switch (loc_nmea_test_rand() % 3) {
+        case 0: return sign * nextafter(v, 0.0);
+        case 1: return sign * nextafter(v, INFINITY);
+        }
+        return sign * v;
+    case 2:
+        // floats, as speed, bearing and the dops are
+        return (float)(sign * loc_nmea_test_uniform() * 1000.0);
+    case 3:
+        // degrees and minutes, as the lat and lon fields
+        return loc_nmea_test_uniform() * 60.0 + floor(loc_nmea_test_uniform() * 180.0) * 100.0;
+    case 4:
+        // exactly representable, so the tie is exact
+        return sign * (floor(loc_nmea_test_uniform() * 4096.0) + 0.5) / 1024.0;
+    case 5:
+        return specials[loc_nmea_test_rand() % (sizeof(specials) / sizeof(specials[0]))];
+    }
+    // whole numbers
+    return sign * floor(loc_nmea_test_uniform() * 1e6);
+}
+
+static bool loc_nmea_test_fuzz(int count)
+{
+    int mismatches = 0;
+
+    for (int i = 0; i < count; i++) {
+        // 7 decimals takes the snprintf fallback
+        int decimals = loc_nmea_test_rand() % 8;
+        int width = loc_nmea_test_rand() % 16;
+        double value = loc_nmea_test_value(decimals);
+        char expected[64], got[64];
+
+        int expectedLength = snprintf(expected, sizeof(expected), "%0*.*f", width, decimals, value);
+        int gotLength = loc_eng_nmea_format_fixed(got, sizeof(got), value, decimals, width);
+        if (gotLength != expectedLength || 0 != strcmp(expected, got)) {
+            if (mismatches++ < LOC_NMEA_TEST_MAX_MISMATCHES) {
+                fprintf(stderr, "fuzz: %.17g %%0%d.%df: expected \"%s\" got \"%s\"\n",
+                        value, width, decimals, expected, gotLength < 0 ? "<overflow>" : got);
+            }
+        }
+    }
+    printf("fuzz: %d of %d values differ from snprintf\n", mismatches, count);
+    return 0 == mismatches;
+}
+
+int main(int argc, char** argv)
+{
+    const char* tracePath = "sample.trace";
+    const char* goldenPath = "sample.nmea";
+    bool write = false;
+    int rounds = 16;
+    int fuzzCount = 1000000;
+    int opt;
+
+    uint64_t seed = 0x4c4f434e4d4541ULL;
+    while (-1 != (opt = getopt(argc, argv, "wr:f:s:"))) {
+        switch (opt) {
+        case 'w':
+            write = true;
+            break;
+        case 'r':
+            rounds = atoi(optarg);
+            break;
+        case 'f':
+            fuzzCount = atoi(optarg);
+            break;
+        case 's':
+            seed = strtoull(optarg, NULL, 0) | 1;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-w] [-r rounds] [-f fuzz count] [-s seed] [trace golden]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (optind + 2 == argc) {
+        tracePath = argv[optind];
+        goldenPath = argv[optind + 1];
+    } else if (optind != argc) {
+        fprintf(stderr, "usage: %s [-w] [-r rounds] [-f fuzz count] [-s seed] [trace golden]\n", argv[0]);
+        return 1;
+    }
+
+    bool passed = loc_nmea_test_golden(tracePath, goldenPath, rounds, write);
+    if (!write) {
+        loc_nmea_test_rand_state = seed;
+        passed = loc_nmea_test_fuzz(fuzzCount) && passed;
+    }
+    printf("%s\n", passed ? "PASS" : "FAIL");
+    return passed ? 0 : 1;
+}
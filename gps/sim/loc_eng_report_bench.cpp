@@ -0,0 +1,233 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_report_bench"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <loc_eng.h>
+#include <FakeLocApiAdapter.h>
+#include "log_util.h"
+
+// Measures how long control messages wait in deferred_q while a slow
+// location_cb is installed. loc_eng_cleanup() keeps the context, so each
+// run measures one setting; compare a run with -t, which sets
+// REPORT_THREAD, with one without.
+//
+//   loc_eng_report_bench [-t] [-d cb delay ms] [-i fix interval ms] [-n control msgs]
+
+#define LOC_BENCH_FIXES 20
+
+static loc_eng_data_s_type loc_bench_data;
+static FakeLocApiAdapter* loc_bench_adapter;
+static FakeLocEvent loc_bench_events[LOC_BENCH_FIXES];
+static int loc_bench_cb_delay_ms = 40;
+static int loc_bench_fix_interval_ms = 50;
+static int loc_bench_controls = 50;
+static int loc_bench_report_thread;
+
+static volatile int loc_bench_locations;
+static int loc_bench_control_count;
+static int64_t loc_bench_control_total_us;
+static int64_t loc_bench_control_max_us;
+
+struct loc_bench_thread_arg {
+    void (*start)(void*);
+    void* arg;
+};
+
+static void* loc_bench_thread_start(void* p)
+{
+    loc_bench_thread_arg targ = *(loc_bench_thread_arg*)p;
+    free(p);
+    targ.start(targ.arg);
+    return NULL;
+}
+
+static pthread_t loc_bench_create_thread(const char*, void (*start)(void*), void* arg)
+{
+    pthread_t tid = 0;
+    loc_bench_thread_arg* targ = (loc_bench_thread_arg*)malloc(sizeof(loc_bench_thread_arg));
+
+    if (NULL != targ) {
+        targ->start = start;
+        targ->arg = arg;
+        if (0 != pthread_create(&tid, NULL, loc_bench_thread_start, targ)) {
+            free(targ);
+            tid = 0;
+        }
+    }
+    return tid;
+}
+
+// stands in for a framework that takes its time with every fix
+static void loc_bench_location_cb(GpsLocation*, void*)
+{
+    loc_bench_locations++;
+    usleep(loc_bench_cb_delay_ms * 1000);
+}
+
+static void loc_bench_status_cb(GpsStatus*)
+{
+}
+
+static void loc_bench_sv_status_cb(GpsSvStatus*, void*)
+{
+}
+
+static void loc_bench_nmea_cb(GpsUtcTime, const char*, int)
+{
+}
+
+static void loc_bench_wakelock_cb()
+{
+}
+
+// runs on the deferred action thread, the only writer of the totals
+static void loc_bench_timing(int msgid, int64_t queue_us, int64_t)
+{
+    if (LOC_ENG_MSG_SET_POSITION_MODE == msgid) {
+        __atomic_add_fetch(&loc_bench_control_count, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&loc_bench_control_total_us, queue_us, __ATOMIC_RELAXED);
+        if (queue_us > __atomic_load_n(&loc_bench_control_max_us, __ATOMIC_RELAXED)) {
+            __atomic_store_n(&loc_bench_control_max_us, queue_us, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static LocApiAdapter* loc_bench_get_adapter(LocEng &locEng)
+{
+    // loops as long as the run may take, stopFix() ends the replay
+    loc_bench_adapter = new FakeLocApiAdapter(locEng, loc_bench_events, LOC_BENCH_FIXES,
+                                              NULL, 1.0, 1000000);
+    return loc_bench_adapter;
+}
+
+static void loc_bench_run()
+{
+    LocCallbacks callbacks = {loc_bench_location_cb, /* location_cb */
+                              loc_bench_status_cb, /* status_cb */
+                              loc_bench_sv_status_cb, /* sv_status_cb */
+                              loc_bench_nmea_cb, /* nmea_cb */
+                              NULL, /* set_capabilities_cb */
+                              loc_bench_wakelock_cb, /* acquire_wakelock_cb */
+                              loc_bench_wakelock_cb, /* release_wakelock_cb */
+                              loc_bench_create_thread, /* create_thread_cb */
+                              NULL, /* location_ext_parser */
+                              NULL, /* sv_ext_parser */
+                              NULL, /* request_utc_time_cb */
+                              NULL /* nmea_burst_cb */};
+    LocPosMode mode(LOC_POSITION_MODE_STANDALONE, GPS_POSITION_RECURRENCE_PERIODIC,
+                    MIN_POSSIBLE_FIX_INTERVAL, 0, 0, NULL, NULL);
+
+    // the context, and with it report_q, is created by loc_eng_init()
+    gps_conf.REPORT_THREAD = loc_bench_report_thread;
+
+    if (0 != loc_eng_init(loc_bench_data, &callbacks,
+                          LOC_API_ADAPTER_BIT_PARSED_POSITION_REPORT |
+                          LOC_API_ADAPTER_BIT_STATUS_REPORT, NULL)) {
+        fprintf(stderr, "loc_eng_init failed\n");
+        exit(1);
+    }
+    loc_eng_set_position_mode(loc_bench_data, mode);
+    loc_eng_start(loc_bench_data);
+
+    // control messages spread over the fixes, so some land while a
+    // location_cb is in progress
+    for (int i = 0; i < loc_bench_controls; i++) {
+        usleep((loc_bench_fix_interval_ms * 1000 * 7) / 5);
+        loc_eng_set_position_mode(loc_bench_data, mode);
+    }
+
+    loc_eng_stop(loc_bench_data);
+    loc_eng_cleanup(loc_bench_data);
+    // let the deferred thread get through the last control msg
+    usleep(2 * loc_bench_cb_delay_ms * 1000 + 100000);
+
+    int count = __atomic_load_n(&loc_bench_control_count, __ATOMIC_RELAXED);
+    int64_t total = __atomic_load_n(&loc_bench_control_total_us, __ATOMIC_RELAXED);
+    printf("REPORT_THREAD=%d: %d locations, %d control msgs queued avg %lld us max %lld us\n",
+           loc_bench_report_thread, loc_bench_locations, count,
+           count ? (long long)(total / count) : 0LL,
+           (long long)__atomic_load_n(&loc_bench_control_max_us, __ATOMIC_RELAXED));
+}
+
+int main(int argc, char** argv)
+{
+    int opt;
+
+    while (-1 != (opt = getopt(argc, argv, "td:i:n:"))) {
+        switch (opt) {
+        case 't':
+            loc_bench_report_thread = 1;
+            break;
+        case 'd':
+            loc_bench_cb_delay_ms = atoi(optarg);
+            break;
+        case 'i':
+            loc_bench_fix_interval_ms = atoi(optarg);
+            break;
+        case 'n':
+            loc_bench_controls = atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-t] [-d cb delay ms] [-i fix interval ms] "
+                    "[-n control msgs]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    memset(loc_bench_events, 0, sizeof(loc_bench_events));
+    for (int i = 0; i < LOC_BENCH_FIXES; i++) {
+        FakeLocEvent &event = loc_bench_events[i];
+        event.timeUs = (int64_t)i * loc_bench_fix_interval_ms * 1000;
+        event.type = FAKE_LOC_EVENT_POSITION;
+        event.location.size = sizeof(GpsLocation);
+        event.location.flags = GPS_LOCATION_HAS_LAT_LONG | GPS_LOCATION_HAS_ACCURACY;
+        event.location.position_source = ULP_LOCATION_IS_FROM_GNSS;
+        event.location.latitude = 37.4219999 + i * 0.00001;
+        event.location.longitude = -122.0840575;
+        event.location.accuracy = 5;
+        event.sessionStatus = LOC_SESS_SUCCESS;
+        event.techMask = LOC_POS_TECH_MASK_SATELLITE;
+    }
+
+    loc_eng_read_config();
+    LocApiAdapter::setLocApiAdapterFactory(loc_bench_get_adapter);
+    loc_eng_set_msg_timing_hook(loc_bench_timing);
+
+    printf("location_cb takes %d ms, a fix every %d ms\n",
+           loc_bench_cb_delay_ms, loc_bench_fix_interval_ms);
+    loc_bench_run();
+    return 0;
+}
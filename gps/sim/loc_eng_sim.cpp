@@ -0,0 +1,286 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_sim"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <loc_eng.h>
+#include <loc_eng_stats.h>
+#include <FakeLocApiAdapter.h>
+#include "log_util.h"
+
+static loc_eng_data_s_type loc_sim_data;
+static FakeLocApiAdapter* loc_sim_adapter;
+static FakeLocEvent* loc_sim_events;
+static int loc_sim_event_count;
+static FILE* loc_sim_trace;
+static const char* loc_sim_record_path;
+static double loc_sim_speed = 1.0;
+static int loc_sim_loops = 1;
+static bool loc_sim_verbose;
+static bool loc_sim_burst;
+
+static volatile int loc_sim_locations;
+static volatile int loc_sim_svs;
+static volatile int loc_sim_nmeas;
+static volatile int loc_sim_nmea_bursts;
+static volatile int loc_sim_statuses;
+static volatile int loc_sim_nis;
+
+struct loc_sim_thread_arg {
+    void (*start)(void*);
+    void* arg;
+};
+
+static void* loc_sim_thread_start(void* p)
+{
+    loc_sim_thread_arg targ = *(loc_sim_thread_arg*)p;
+    free(p);
+    targ.start(targ.arg);
+    return NULL;
+}
+
+static pthread_t loc_sim_create_thread(const char*, void (*start)(void*), void* arg)
+{
+    pthread_t tid = 0;
+    loc_sim_thread_arg* targ = (loc_sim_thread_arg*)malloc(sizeof(loc_sim_thread_arg));
+
+    if (NULL != targ) {
+        targ->start = start;
+        targ->arg = arg;
+        if (0 != pthread_create(&tid, NULL, loc_sim_thread_start, targ)) {
+            free(targ);
+            tid = 0;
+        }
+    }
+    return tid;
+}
+
+static void loc_sim_location_cb(GpsLocation* location, void*)
+{
+    loc_sim_locations++;
+    if (loc_sim_verbose) {
+        printf("location %.7f %.7f acc %.1f\n", location->latitude,
+               location->longitude, location->accuracy);
+    }
+}
+
+static void loc_sim_status_cb(GpsStatus* status)
+{
+    loc_sim_statuses++;
+    if (loc_sim_verbose) {
+        printf("status %d\n", status->status);
+    }
+}
+
+static void loc_sim_sv_status_cb(GpsSvStatus* sv_status, void*)
+{
+    loc_sim_svs++;
+    if (loc_sim_verbose) {
+        printf("sv %d in view\n", sv_status->num_svs);
+    }
+}
+
+static void loc_sim_nmea_cb(GpsUtcTime, const char* nmea, int length)
+{
+    loc_sim_nmeas++;
+    if (loc_sim_verbose) {
+        printf("%.*s", length, nmea);
+    }
+}
+
+static void loc_sim_nmea_burst_cb(GpsUtcTime, const char* nmea, int length,
+                                  const int* offsets, int count)
+{
+    loc_sim_nmea_bursts++;
+    loc_sim_nmeas += count;
+    if (loc_sim_verbose) {
+        for (int i = 0; i < count; i++) {
+            int end = i + 1 < count ? offsets[i + 1] : length;
+            printf("%d/%d %.*s", i + 1, count, end - offsets[i], nmea + offsets[i]);
+        }
+    }
+}
+
+static void loc_sim_wakelock_cb()
+{
+}
+
+// Plays the framework side of the ATL handshake: every data call the engine
+// asks for comes up at once, and goes down when released.
+static void loc_sim_agps_status_cb(AGpsStatus* status)
+{
+    switch (status->status) {
+    case GPS_REQUEST_AGPS_DATA_CONN:
+        loc_eng_agps_open(loc_sim_data, status->type, "loc_sim", AGPS_APN_BEARER_IPV4);
+        break;
+    case GPS_RELEASE_AGPS_DATA_CONN:
+        loc_eng_agps_closed(loc_sim_data, status->type);
+        break;
+    default:
+        break;
+    }
+}
+
+// Accepts every NI request on the user's behalf
+static void loc_sim_ni_notify_cb(GpsNiNotification* notification)
+{
+    loc_sim_nis++;
+    loc_eng_ni_respond(loc_sim_data, notification->notification_id, GPS_NI_RESPONSE_ACCEPT);
+}
+
+static LocApiAdapter* loc_sim_get_adapter(LocEng &locEng)
+{
+    loc_sim_adapter = new FakeLocApiAdapter(locEng, loc_sim_events, loc_sim_event_count,
+                                            loc_sim_trace, loc_sim_speed, loc_sim_loops);
+    return loc_sim_adapter;
+}
+
+static void loc_sim_usage(const char* name)
+{
+    fprintf(stderr,
+            "usage: %s [-s speed] [-n loops] [-r file] [-b] [-v] trace\n"
+            "  trace     binary trace recorded with TRACE_FILE, or a text one\n"
+            "  -s speed  replay pacing, 1 as recorded, 0 as fast as possible\n"
+            "  -n loops  number of times to replay the trace\n"
+            "  -r file   record the replayed upcalls to a binary trace\n"
+            "  -b        take generated NMEA one burst per fix\n"
+            "  -v        print every report delivered to the callbacks\n",
+            name);
+}
+
+int main(int argc, char** argv)
+{
+    int opt;
+
+    while (-1 != (opt = getopt(argc, argv, "s:n:r:bv"))) {
+        switch (opt) {
+        case 's':
+            loc_sim_speed = atof(optarg);
+            break;
+        case 'n':
+            loc_sim_loops = atoi(optarg);
+            break;
+        case 'r':
+            loc_sim_record_path = optarg;
+            break;
+        case 'b':
+            loc_sim_burst = true;
+            break;
+        case 'v':
+            loc_sim_verbose = true;
+            break;
+        default:
+            loc_sim_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind != argc - 1) {
+        loc_sim_usage(argv[0]);
+        return 1;
+    }
+
+    loc_sim_trace = loc_eng_trace_open(argv[optind]);
+    if (NULL == loc_sim_trace) {
+        loc_sim_events = FakeLocApiAdapter::loadTrace(argv[optind], &loc_sim_event_count);
+    }
+    if (NULL == loc_sim_trace && NULL == loc_sim_events) {
+        fprintf(stderr, "%s: no events in %s\n", argv[0], argv[optind]);
+        return 1;
+    }
+
+    LOC_API_ADAPTER_EVENT_MASK_T event =
+        LOC_API_ADAPTER_BIT_PARSED_POSITION_REPORT |
+        LOC_API_ADAPTER_BIT_SATELLITE_REPORT |
+        LOC_API_ADAPTER_BIT_LOCATION_SERVER_REQUEST |
+        LOC_API_ADAPTER_BIT_ASSISTANCE_DATA_REQUEST |
+        LOC_API_ADAPTER_BIT_IOCTL_REPORT |
+        LOC_API_ADAPTER_BIT_STATUS_REPORT |
+        LOC_API_ADAPTER_BIT_NMEA_1HZ_REPORT |
+        LOC_API_ADAPTER_BIT_NI_NOTIFY_VERIFY_REQUEST;
+    LocCallbacks callbacks = {loc_sim_location_cb, /* location_cb */
+                              loc_sim_status_cb, /* status_cb */
+                              loc_sim_sv_status_cb, /* sv_status_cb */
+                              loc_sim_nmea_cb, /* nmea_cb */
+                              NULL, /* set_capabilities_cb */
+                              loc_sim_wakelock_cb, /* acquire_wakelock_cb */
+                              loc_sim_wakelock_cb, /* release_wakelock_cb */
+                              loc_sim_create_thread, /* create_thread_cb */
+                              NULL, /* location_ext_parser */
+                              NULL, /* sv_ext_parser */
+                              NULL, /* request_utc_time_cb */
+                              loc_sim_burst ? loc_sim_nmea_burst_cb : NULL /* nmea_burst_cb */};
+    AGpsCallbacks agpsCallbacks = {loc_sim_agps_status_cb, loc_sim_create_thread};
+    GpsNiCallbacks niCallbacks = {loc_sim_ni_notify_cb, loc_sim_create_thread};
+
+    // gps.conf from the current directory, as get_gps_interface() reads it
+    loc_eng_read_config();
+    LocApiAdapter::setLocApiAdapterFactory(loc_sim_get_adapter);
+    if (0 != loc_eng_init(loc_sim_data, &callbacks, event, NULL)) {
+        fprintf(stderr, "%s: loc_eng_init failed\n", argv[0]);
+        return 1;
+    }
+    loc_eng_agps_init(loc_sim_data, &agpsCallbacks);
+    loc_eng_ni_init(loc_sim_data, &niCallbacks);
+
+    if (NULL != loc_sim_record_path && !LocApiAdapter::startRecording(loc_sim_record_path)) {
+        fprintf(stderr, "%s: cannot record to %s\n", argv[0], loc_sim_record_path);
+        return 1;
+    }
+
+    LocPosMode mode(LOC_POSITION_MODE_STANDALONE, GPS_POSITION_RECURRENCE_PERIODIC,
+                    MIN_POSSIBLE_FIX_INTERVAL, 0, 0, NULL, NULL);
+    loc_eng_set_position_mode(loc_sim_data, mode);
+    loc_eng_start(loc_sim_data);
+
+    // startFix runs on the deferred thread, so the replay may not be going
+    // yet; waitReplayDone only returns once it has run to the end.
+    loc_sim_adapter->waitReplayDone();
+
+    loc_eng_stop(loc_sim_data);
+    loc_eng_cleanup(loc_sim_data);
+    // let the deferred thread drain what the replay left queued
+    sleep(1);
+    LocApiAdapter::stopRecording();
+
+    printf("%d loops: %d locations, %d sv reports, %d nmea in %d bursts, %d status, %d ni, "
+           "%d atl opened, %d atl closed\n",
+           loc_sim_loops, loc_sim_locations, loc_sim_svs, loc_sim_nmeas, loc_sim_nmea_bursts,
+           loc_sim_statuses, loc_sim_nis, loc_sim_adapter->getAtlOpened(),
+           loc_sim_adapter->getAtlClosed());
+    loc_eng_stats_dump();
+    // with DEBUG_LOG_RING set, log lines still in the rings would be lost
+    loc_log_ring_flush();
+    return 0;
+}
@@ -0,0 +1,165 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#define LOG_NDDEBUG 0
+#define LOG_TAG "LocSvc_ring_test"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "log_util.h"
+#include "loc_log_ring.h"
+
+// Checks that loc_log_ring logs lines in the order they were logged across
+// threads. The threads pass a token around, each logging the turn it holds
+// before handing it on, so every line is logged after the one before it
+// has returned; the log must then read 0, 1, 2, ... with only the dropped
+// lines missing. Another thread drains throughout, so records are
+// published while it takes its snapshots.
+//
+//   loc_log_ring_test [-t threads] [-n turns] [-s ring slots]
+
+static int loc_ring_test_threads = 4;
+static int loc_ring_test_turns = 200000;
+static volatile int loc_ring_test_turn;
+
+static void* loc_ring_test_run(void* arg)
+{
+    int self = (int)(intptr_t)arg;
+
+    for (;;) {
+        int turn = __atomic_load_n(&loc_ring_test_turn, __ATOMIC_ACQUIRE);
+        if (turn >= loc_ring_test_turns) {
+            break;
+        }
+        if (turn % loc_ring_test_threads != self) {
+            sched_yield();
+            continue;
+        }
+        LOC_LOGE("turn %d", turn);
+        __atomic_store_n(&loc_ring_test_turn, turn + 1, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+// Drains far more often than the drainer does, so that snapshots of the
+// ring heads keep landing between one turn and the next
+static void* loc_ring_test_drain(void*)
+{
+    while (__atomic_load_n(&loc_ring_test_turn, __ATOMIC_ACQUIRE) < loc_ring_test_turns) {
+        loc_log_ring_flush();
+        sched_yield();
+    }
+    return NULL;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t slots = 4096;
+    pthread_t threads[64];
+    pthread_t drainer;
+    int opt;
+
+    while (-1 != (opt = getopt(argc, argv, "t:n:s:"))) {
+        switch (opt) {
+        case 't':
+            loc_ring_test_threads = atoi(optarg);
+            break;
+        case 'n':
+            loc_ring_test_turns = atoi(optarg);
+            break;
+        case 's':
+            slots = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-t threads] [-n turns] [-s ring slots]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (loc_ring_test_threads < 1 || loc_ring_test_threads > 64) {
+        fprintf(stderr, "%s: 1 to 64 threads\n", argv[0]);
+        return 1;
+    }
+
+    // the log goes to stderr in the sim; keep it to read back
+    FILE* log = tmpfile();
+    int savedStderr = dup(2);
+    if (NULL == log || savedStderr < 0) {
+        fprintf(stderr, "%s: cannot capture the log\n", argv[0]);
+        return 1;
+    }
+    fflush(stderr);
+    dup2(fileno(log), 2);
+
+    loc_log_ring_init(slots);
+    pthread_create(&drainer, NULL, loc_ring_test_drain, NULL);
+    for (int i = 0; i < loc_ring_test_threads; i++) {
+        pthread_create(&threads[i], NULL, loc_ring_test_run, (void*)(intptr_t)i);
+    }
+    for (int i = 0; i < loc_ring_test_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_join(drainer, NULL);
+    loc_log_ring_flush();
+
+    loc_log_ring_stats_type stats;
+    loc_log_ring_get_stats(&stats);
+    fflush(stderr);
+    dup2(savedStderr, 2);
+    close(savedStderr);
+
+    char line[256];
+    int last = -1, lines = 0, outOfOrder = 0;
+    rewind(log);
+    while (NULL != fgets(line, sizeof(line), log)) {
+        const char* p = strstr(line, "E/turn ");
+        if (NULL == p) {
+            continue;
+        }
+        int turn = atoi(p + 7);
+        if (turn <= last) {
+            if (outOfOrder++ < 10) {
+                fprintf(stderr, "turn %d logged after turn %d\n", turn, last);
+            }
+        }
+        last = turn;
+        lines++;
+    }
+    fclose(log);
+
+    printf("%d threads, %d turns: %d lines, %llu dropped, %d out of order\n",
+           loc_ring_test_threads, loc_ring_test_turns, lines,
+           (unsigned long long)stats.dropped, outOfOrder);
+    bool passed = 0 == outOfOrder &&
+                  (unsigned long long)lines + stats.dropped == (unsigned long long)loc_ring_test_turns;
+    printf("%s\n", passed ? "PASS" : "FAIL");
+    return passed ? 0 : 1;
+}
@@ -41,13 +41,370 @@ typedef struct list_element {
    struct list_element* prev;
    void* data_ptr;
    void (*dealloc_func)(void*);
+   uint64_t stamp;                  /* Caller's value from linked_list_add2 */
+   uint32_t hash;                   /* Key hash, only set for indexed lists */
 }list_element;
 
+/* Block of list elements handed out through the free list */
+typedef struct list_slab {
+   struct list_slab* next;
+   list_element elems[];
+}list_slab;
+
 typedef struct list_state {
    list_element* p_head;
    list_element* p_tail;
+   list_element* p_free;            /* Recycled elements, chained through next */
+   list_slab* p_slabs;              /* Every slab owned by this list */
+   size_t slab_size;                /* Number of elements added per slab grow */
+   linked_list_stats_type stats;
+   uint32_t (*hash_func)(void*);    /* Key hash of the data, NULL if not indexed */
+   list_element** p_index;          /* Open addressing index, linear probing */
+   size_t index_size;               /* Slots in p_index, always a power of two */
+   size_t index_count;              /* Elements held in p_index */
 } list_state;
 
+#define LINKED_LIST_MIN_SLAB_SIZE 16
+#define LINKED_LIST_MIN_INDEX_SIZE 16
+
+/*===========================================================================
+FUNCTION    linked_list_slab_grow
+
+DESCRIPTION
+   Allocates a slab of count elements and chains them onto the free list.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   0 on success, -1 if memory could not be allocated.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int linked_list_slab_grow(list_state* p_list, size_t count)
+{
+   size_t i;
+   list_slab* slab = (list_slab*)malloc(sizeof(list_slab) + count * sizeof(list_element));
+   if( slab == NULL )
+   {
+      return -1;
+   }
+
+   slab->next = p_list->p_slabs;
+   p_list->p_slabs = slab;
+
+   for( i = 0; i < count; i++ )
+   {
+      slab->elems[i].next = p_list->p_free;
+      p_list->p_free = &slab->elems[i];
+   }
+
+   p_list->stats.free += count;
+   p_list->stats.slab_grows++;
+
+   return 0;
+}
+
+/*===========================================================================
+FUNCTION    linked_list_elem_alloc
+
+DESCRIPTION
+   Takes an element off the free list, growing the list's slabs when it is
+   empty. Only the grow touches the heap.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   The element, NULL if memory could not be allocated.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static list_element* linked_list_elem_alloc(list_state* p_list)
+{
+   if( p_list->p_free == NULL &&
+       linked_list_slab_grow(p_list, p_list->slab_size) != 0 )
+   {
+      return NULL;
+   }
+
+   list_element* elem = p_list->p_free;
+   p_list->p_free = elem->next;
+
+   p_list->stats.free--;
+   p_list->stats.in_use++;
+   if( p_list->stats.in_use > p_list->stats.high_water )
+   {
+      p_list->stats.high_water = p_list->stats.in_use;
+   }
+
+   return elem;
+}
+
+/*===========================================================================
+FUNCTION    linked_list_elem_free
+
+DESCRIPTION
+   Returns an element to the free list for reuse.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void linked_list_elem_free(list_state* p_list, list_element* elem)
+{
+   elem->next = p_list->p_free;
+   p_list->p_free = elem;
+
+   p_list->stats.in_use--;
+   p_list->stats.free++;
+}
+
+/*===========================================================================
+FUNCTION    linked_list_index_home
+
+DESCRIPTION
+   Slot of an index of size slots that probing for key hash starts at. The
+   hash is mixed first: keys such as IDs handed out in sequence would
+   otherwise fill one long run of slots, which every erase has to scan.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   The slot.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static inline size_t linked_list_index_home(uint32_t hash, size_t size)
+{
+   hash ^= hash >> 16;
+   hash *= 0x7feb352d;
+   hash ^= hash >> 15;
+   hash *= 0x846ca68b;
+   hash ^= hash >> 16;
+   return hash & (size - 1);
+}
+
+/*===========================================================================
+FUNCTION    linked_list_index_rebuild
+
+DESCRIPTION
+   Reallocates the index with size slots and inserts every element of the
+   list into it. The index is kept at most half full so probes stay short.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   0 on success, -1 if memory could not be allocated.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int linked_list_index_rebuild(list_state* p_list, size_t size)
+{
+   list_element** index = (list_element**)calloc(size, sizeof(list_element*));
+   if( index == NULL )
+   {
+      return -1;
+   }
+
+   free(p_list->p_index);
+   p_list->p_index = index;
+   p_list->index_size = size;
+   p_list->index_count = 0;
+
+   list_element* elem;
+   for( elem = p_list->p_head; elem != NULL; elem = elem->next )
+   {
+      size_t i = linked_list_index_home(elem->hash, size);
+      while( index[i] != NULL )
+      {
+         i = (i + 1) & (size - 1);
+      }
+      index[i] = elem;
+      p_list->index_count++;
+   }
+
+   return 0;
+}
+
+/*===========================================================================
+FUNCTION    linked_list_index_insert
+
+DESCRIPTION
+   Hashes the data of elem and adds it to the index, if the list has one.
+   The index must already have room for it; see linked_list_index_reserve.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void linked_list_index_insert(list_state* p_list, list_element* elem)
+{
+   if( p_list->p_index == NULL )
+   {
+      return;
+   }
+
+   size_t mask = p_list->index_size - 1;
+   size_t i;
+
+   elem->hash = p_list->hash_func(elem->data_ptr);
+   for( i = linked_list_index_home(elem->hash, p_list->index_size);
+        p_list->p_index[i] != NULL; i = (i + 1) & mask );
+
+   p_list->p_index[i] = elem;
+   p_list->index_count++;
+}
+
+/*===========================================================================
+FUNCTION    linked_list_index_reserve
+
+DESCRIPTION
+   Makes sure the index can take one more element without going over half
+   full, doubling it if needed. Done before an element is linked in, so a
+   failure leaves the list untouched.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   0 on success, -1 if memory could not be allocated.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int linked_list_index_reserve(list_state* p_list)
+{
+   if( p_list->p_index == NULL ||
+       (p_list->index_count + 1) * 2 <= p_list->index_size )
+   {
+      return 0;
+   }
+
+   return linked_list_index_rebuild(p_list, p_list->index_size * 2);
+}
+
+/*===========================================================================
+FUNCTION    linked_list_index_erase
+
+DESCRIPTION
+   Takes elem out of the index, if the list has one. Later entries of the
+   same probe run are shifted back into the hole, so no tombstones are left
+   behind.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void linked_list_index_erase(list_state* p_list, list_element* elem)
+{
+   if( p_list->p_index == NULL )
+   {
+      return;
+   }
+
+   list_element** index = p_list->p_index;
+   size_t mask = p_list->index_size - 1;
+   size_t i, j;
+
+   for( i = linked_list_index_home(elem->hash, p_list->index_size);
+        index[i] != elem; i = (i + 1) & mask )
+   {
+      if( index[i] == NULL )
+      {
+         LOC_LOGE("%s: Element %p missing from index!\n", __FUNCTION__, elem);
+         return;
+      }
+   }
+
+   for( j = (i + 1) & mask; index[j] != NULL; j = (j + 1) & mask )
+   {
+      size_t home = linked_list_index_home(index[j]->hash, p_list->index_size);
+
+      /* Entry j may fill the hole at i only if its home slot is not
+         cyclically within (i, j] */
+      if( (j > i && (home <= i || home > j)) ||
+          (j < i && (home <= i && home > j)) )
+      {
+         index[i] = index[j];
+         i = j;
+      }
+   }
+
+   index[i] = NULL;
+   p_list->index_count--;
+}
+
+/*===========================================================================
+FUNCTION    linked_list_unlink
+
+DESCRIPTION
+   Removes elem from the list and the index, and recycles it. The data is
+   freed with the element's dealloc function if free_data is set.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void linked_list_unlink(list_state* p_list, list_element* elem, bool free_data)
+{
+   if (NULL == elem->prev) {
+     p_list->p_head = elem->next;
+   } else {
+     elem->prev->next = elem->next;
+   }
+
+   if (NULL == elem->next) {
+     p_list->p_tail = elem->prev;
+   } else {
+     elem->next->prev = elem->prev;
+   }
+
+   elem->prev = elem->next = NULL;
+
+   linked_list_index_erase(p_list, elem);
+
+   if (free_data && NULL != elem->dealloc_func) {
+       elem->dealloc_func(elem->data_ptr);
+   }
+   linked_list_elem_free(p_list, elem);
+}
+
 /* ----------------------- END INTERNAL FUNCTIONS ---------------------------------------- */
 
 /*===========================================================================
@@ -56,6 +413,16 @@ typedef struct list_state {
 
   ===========================================================================*/
 linked_list_err_type linked_list_init(void** list_data)
+{
+   return linked_list_init2(list_data, 0);
+}
+
+/*===========================================================================
+
+  FUNCTION:   linked_list_init2
+
+  ===========================================================================*/
+linked_list_err_type linked_list_init2(void** list_data, size_t reserve)
 {
    if( list_data == NULL )
    {
@@ -73,6 +440,16 @@ linked_list_err_type linked_list_init(void** list_data)
 
    tmp_list->p_head = NULL;
    tmp_list->p_tail = NULL;
+   tmp_list->p_free = NULL;
+   tmp_list->p_slabs = NULL;
+   tmp_list->slab_size = reserve > LINKED_LIST_MIN_SLAB_SIZE ? reserve : LINKED_LIST_MIN_SLAB_SIZE;
+
+   if( reserve > 0 && linked_list_slab_grow(tmp_list, reserve) != 0 )
+   {
+      LOC_LOGE("%s: Unable to reserve %u list elements!\n", __FUNCTION__, reserve);
+      free(tmp_list);
+      return eLINKED_LIST_FAILURE_GENERAL;
+   }
 
    *list_data = tmp_list;
 
@@ -96,6 +473,14 @@ linked_list_err_type linked_list_destroy(void** list_data)
 
    linked_list_flush(p_list);
 
+   while( p_list->p_slabs != NULL )
+   {
+      list_slab* tmp = p_list->p_slabs->next;
+      free(p_list->p_slabs);
+      p_list->p_slabs = tmp;
+   }
+
+   free(p_list->p_index);
    free(*list_data);
    *list_data = NULL;
 
@@ -108,6 +493,17 @@ linked_list_err_type linked_list_destroy(void** list_data)
 
   ===========================================================================*/
 linked_list_err_type linked_list_add(void* list_data, void *data_obj, void (*dealloc)(void*))
+{
+   return linked_list_add2(list_data, data_obj, dealloc, 0, NULL);
+}
+
+/*===========================================================================
+
+  FUNCTION:   linked_list_add2
+
+  ===========================================================================*/
+linked_list_err_type linked_list_add2(void* list_data, void *data_obj, void (*dealloc)(void*),
+                                      uint64_t stamp, void** elem_handle)
 {
    LOC_LOGD("%s: Adding to list data_obj = 0x%08X\n", __FUNCTION__, data_obj);
    if( list_data == NULL )
@@ -123,7 +519,11 @@ linked_list_err_type linked_list_add(void* list_data, void *data_obj, void (*dea
    }
 
    list_state* p_list = (list_state*)list_data;
-   list_element* elem = (list_element*)malloc(sizeof(list_element));
+   list_element* elem = NULL;
+   if( linked_list_index_reserve(p_list) == 0 )
+   {
+      elem = linked_list_elem_alloc(p_list);
+   }
    if( elem == NULL )
    {
       LOC_LOGE("%s: Memory allocation failed\n", __FUNCTION__);
@@ -135,6 +535,7 @@ linked_list_err_type linked_list_add(void* list_data, void *data_obj, void (*dea
    elem->next = NULL;
    elem->prev = NULL;
    elem->dealloc_func = dealloc;
+   elem->stamp = stamp;
 
    /* Replace head element */
    list_element* tmp = p_list->p_head;
@@ -151,6 +552,64 @@ linked_list_err_type linked_list_add(void* list_data, void *data_obj, void (*dea
       p_list->p_tail = p_list->p_head;
    }
 
+   linked_list_index_insert(p_list, elem);
+
+   if( elem_handle != NULL )
+   {
+      *elem_handle = elem;
+   }
+
+   return eLINKED_LIST_SUCCESS;
+}
+
+/*===========================================================================
+
+  FUNCTION:   linked_list_remove_elem
+
+  ===========================================================================*/
+linked_list_err_type linked_list_remove_elem(void* list_data, void* elem_handle,
+                                             void **data_obj)
+{
+   if( list_data == NULL || elem_handle == NULL )
+   {
+      LOC_LOGE("%s: Invalid list parameter!\n", __FUNCTION__);
+      return eLINKED_LIST_INVALID_HANDLE;
+   }
+
+   if( data_obj == NULL )
+   {
+      LOC_LOGE("%s: Invalid input parameter!\n", __FUNCTION__);
+      return eLINKED_LIST_INVALID_PARAMETER;
+   }
+
+   list_state* p_list = (list_state*)list_data;
+   list_element* elem = (list_element*)elem_handle;
+
+   if( elem->prev != NULL )
+   {
+      elem->prev->next = elem->next;
+   }
+   else
+   {
+      p_list->p_head = elem->next;
+   }
+
+   if( elem->next != NULL )
+   {
+      elem->next->prev = elem->prev;
+   }
+   else
+   {
+      p_list->p_tail = elem->prev;
+   }
+
+   *data_obj = elem->data_ptr;
+
+   linked_list_index_erase(p_list, elem);
+
+   /* Recycle list element */
+   linked_list_elem_free(p_list, elem);
+
    return eLINKED_LIST_SUCCESS;
 }
 
@@ -160,6 +619,16 @@ linked_list_err_type linked_list_add(void* list_data, void *data_obj, void (*dea
 
   ===========================================================================*/
 linked_list_err_type linked_list_remove(void* list_data, void **data_obj)
+{
+   return linked_list_remove2(list_data, data_obj, NULL);
+}
+
+/*===========================================================================
+
+  FUNCTION:   linked_list_remove2
+
+  ===========================================================================*/
+linked_list_err_type linked_list_remove2(void* list_data, void **data_obj, uint64_t* stamp)
 {
    LOC_LOGD("%s: Removing from list\n", __FUNCTION__);
    if( list_data == NULL )
@@ -196,9 +665,15 @@ linked_list_err_type linked_list_remove(void* list_data, void **data_obj)
 
    /* Copy data to output param */
    *data_obj = tmp->data_ptr;
+   if( stamp != NULL )
+   {
+      *stamp = tmp->stamp;
+   }
 
-   /* Free allocated list element */
-   free(tmp);
+   linked_list_index_erase(p_list, tmp);
+
+   /* Recycle list element */
+   linked_list_elem_free(p_list, tmp);
 
    return eLINKED_LIST_SUCCESS;
 }
@@ -248,14 +723,20 @@ linked_list_err_type linked_list_flush(void* list_data)
          p_list->p_head->dealloc_func(p_list->p_head->data_ptr);
       }
 
-      /* Free list element */
-      free(p_list->p_head);
+      /* Recycle list element */
+      linked_list_elem_free(p_list, p_list->p_head);
 
       p_list->p_head = tmp;
    }
 
    p_list->p_tail = NULL;
 
+   if( p_list->p_index != NULL )
+   {
+      memset(p_list->p_index, 0, p_list->index_size * sizeof(list_element*));
+      p_list->index_count = 0;
+   }
+
    return eLINKED_LIST_SUCCESS;
 }
 
@@ -295,26 +776,9 @@ linked_list_err_type linked_list_search(void* list_data, void **data_p,
        }
 
        if (rm_if_found) {
-         if (NULL == tmp->prev) {
-           p_list->p_head = tmp->next;
-         } else {
-           tmp->prev->next = tmp->next;
-         }
-
-         if (NULL == tmp->next) {
-           p_list->p_tail = tmp->prev;
-         } else {
-           tmp->next->prev = tmp->prev;
-         }
-
-         tmp->prev = tmp->next = NULL;
-
          // dealloc data if it is not copied out && caller
          // has given us a dealloc function pointer.
-         if (NULL == data_p && NULL != tmp->dealloc_func) {
-             tmp->dealloc_func(tmp->data_ptr);
-         }
-         free(tmp);
+         linked_list_unlink(p_list, tmp, NULL == data_p);
        }
 
        tmp = NULL;
@@ -326,3 +790,131 @@ linked_list_err_type linked_list_search(void* list_data, void **data_p,
    return eLINKED_LIST_SUCCESS;
 }
 
+/*===========================================================================
+
+  FUNCTION:   linked_list_set_hash
+
+  ===========================================================================*/
+linked_list_err_type linked_list_set_hash(void* list_data, uint32_t (*hash)(void* data))
+{
+   if( list_data == NULL )
+   {
+      LOC_LOGE("%s: Invalid list parameter!\n", __FUNCTION__);
+      return eLINKED_LIST_INVALID_HANDLE;
+   }
+
+   list_state* p_list = (list_state*)list_data;
+
+   free(p_list->p_index);
+   p_list->p_index = NULL;
+   p_list->index_size = 0;
+   p_list->index_count = 0;
+   p_list->hash_func = hash;
+
+   if( hash == NULL )
+   {
+      return eLINKED_LIST_SUCCESS;
+   }
+
+   size_t size = LINKED_LIST_MIN_INDEX_SIZE;
+   while( size < p_list->stats.in_use * 2 + 2 )
+   {
+      size *= 2;
+   }
+
+   list_element* elem;
+   for( elem = p_list->p_head; elem != NULL; elem = elem->next )
+   {
+      elem->hash = hash(elem->data_ptr);
+   }
+
+   if( linked_list_index_rebuild(p_list, size) != 0 )
+   {
+      LOC_LOGE("%s: Unable to allocate list index!\n", __FUNCTION__);
+      p_list->hash_func = NULL;
+      return eLINKED_LIST_FAILURE_GENERAL;
+   }
+
+   return eLINKED_LIST_SUCCESS;
+}
+
+/*===========================================================================
+
+  FUNCTION:   linked_list_search_hash
+
+  ===========================================================================*/
+linked_list_err_type linked_list_search_hash(void* list_data, void **data_p,
+                                             bool (*equal)(void* data_0, void* data),
+                                             void* data_0, uint32_t key_hash,
+                                             bool rm_if_found)
+{
+   if( list_data == NULL || NULL == equal )
+   {
+      LOC_LOGE("%s: Invalid list parameter! list_data %p equal %p\n",
+               __FUNCTION__, list_data, equal);
+      return eLINKED_LIST_INVALID_HANDLE;
+   }
+
+   list_state* p_list = (list_state*)list_data;
+   if( p_list->p_index == NULL )
+   {
+      return linked_list_search(list_data, data_p, equal, data_0, rm_if_found);
+   }
+
+   if( p_list->p_tail == NULL )
+   {
+      return eLINKED_LIST_UNAVAILABLE_RESOURCE;
+   }
+
+   if (NULL != data_p) {
+     *data_p = NULL;
+   }
+
+   size_t mask = p_list->index_size - 1;
+   size_t i;
+
+   for( i = linked_list_index_home(key_hash, p_list->index_size);
+        p_list->p_index[i] != NULL; i = (i + 1) & mask )
+   {
+      list_element* tmp = p_list->p_index[i];
+
+      if( tmp->hash == key_hash && (*equal)(data_0, tmp->data_ptr) )
+      {
+         if (NULL != data_p) {
+           *data_p = tmp->data_ptr;
+         }
+
+         if (rm_if_found) {
+           linked_list_unlink(p_list, tmp, NULL == data_p);
+         }
+         break;
+      }
+   }
+
+   return eLINKED_LIST_SUCCESS;
+}
+
+/*===========================================================================
+
+  FUNCTION:   linked_list_get_stats
+
+  ===========================================================================*/
+linked_list_err_type linked_list_get_stats(void* list_data, linked_list_stats_type* stats)
+{
+   if( list_data == NULL )
+   {
+      LOC_LOGE("%s: Invalid list parameter!\n", __FUNCTION__);
+      return eLINKED_LIST_INVALID_HANDLE;
+   }
+
+   if( stats == NULL )
+   {
+      LOC_LOGE("%s: Invalid input parameter!\n", __FUNCTION__);
+      return eLINKED_LIST_INVALID_PARAMETER;
+   }
+
+   *stats = ((list_state*)list_data)->stats;
+
+   return eLINKED_LIST_SUCCESS;
+}
+
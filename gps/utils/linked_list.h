@@ -33,6 +33,7 @@ extern "C" {
 #endif /* __cplusplus */
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 
 /** Linked List Return Codes */
@@ -52,6 +53,19 @@ typedef enum
      /**< Failed because an the supplied buffer was too small. */
 }linked_list_err_type;
 
+/** Linked List Element Allocator Statistics */
+typedef struct
+{
+  size_t in_use;
+     /**< Elements currently holding data. */
+  size_t free;
+     /**< Elements reserved and waiting to be reused. */
+  size_t high_water;
+     /**< Largest number of elements ever in use at once. */
+  size_t slab_grows;
+     /**< Number of times the list had to allocate more elements. */
+}linked_list_stats_type;
+
 /*===========================================================================
 FUNCTION    linked_list_init
 
@@ -72,6 +86,31 @@ SIDE EFFECTS
 ===========================================================================*/
 linked_list_err_type linked_list_init(void** list_data);
 
+/*===========================================================================
+FUNCTION    linked_list_init2
+
+DESCRIPTION
+   Initializes internal structures for linked list, reserving room for
+   reserve elements up front. Elements are recycled through a per list free
+   list, so the heap is only touched when the list outgrows what it has
+   reserved so far. linked_list_init() reserves nothing until the first add.
+
+   list_data: State of list to be initialized.
+   reserve:   Number of elements to allocate up front; also the minimum
+              number added each time the list needs to grow.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+linked_list_err_type linked_list_init2(void** list_data, size_t reserve);
+
 /*===========================================================================
 FUNCTION    linked_list_destroy
 
@@ -117,6 +156,59 @@ SIDE EFFECTS
 ===========================================================================*/
 linked_list_err_type linked_list_add(void* list_data, void *data_obj, void (*dealloc)(void*));
 
+/*===========================================================================
+FUNCTION    linked_list_add2
+
+DESCRIPTION
+   Adds an element to the head of the linked list like linked_list_add, and
+   hands back a handle to the element for linked_list_remove_elem.
+
+   p_list_data:  List to add data to the head of.
+   data_obj:     Pointer to data to add into list
+   dealloc:      Function used to deallocate memory for this element. Pass NULL
+                 if you do not want data deallocated during a flush operation
+   stamp:        Value kept with the element, handed back by
+                 linked_list_remove2; e.g. when it was added.
+   elem_handle:  Set to the handle of the new element. May be NULL.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+linked_list_err_type linked_list_add2(void* list_data, void *data_obj, void (*dealloc)(void*),
+                                      uint64_t stamp, void** elem_handle);
+
+/*===========================================================================
+FUNCTION    linked_list_remove_elem
+
+DESCRIPTION
+   Takes an element out of the list wherever it is, without deallocating its
+   data. The handle is only valid while its element is in the list; elements
+   are recycled once removed, so the caller must track that.
+
+   p_list_data:  List handle.
+   elem_handle:  Element handle returned by linked_list_add2.
+   data_obj:     Set to the data the element held; the caller now owns it.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+linked_list_err_type linked_list_remove_elem(void* list_data, void* elem_handle,
+                                             void **data_obj);
+
 /*===========================================================================
 FUNCTION    linked_list_remove
 
@@ -139,6 +231,29 @@ SIDE EFFECTS
 ===========================================================================*/
 linked_list_err_type linked_list_remove(void* list_data, void **data_obj);
 
+/*===========================================================================
+FUNCTION    linked_list_remove2
+
+DESCRIPTION
+   Retrieves data from the list tail like linked_list_remove, along with
+   the stamp it was added with by linked_list_add2 (0 by linked_list_add).
+
+   p_list_data:  List to remove the tail from.
+   data_obj:     Pointer to data removed from list
+   stamp:        Set to the stamp of the element. May be NULL.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+linked_list_err_type linked_list_remove2(void* list_data, void **data_obj, uint64_t* stamp);
+
 /*===========================================================================
 FUNCTION    linked_list_empty
 
@@ -210,6 +325,87 @@ linked_list_err_type linked_list_search(void* list_data, void **data_p,
                                         bool (*equal)(void* data_0, void* data),
                                         void* data_0, bool rm_if_found);
 
+/*===========================================================================
+FUNCTION    linked_list_set_hash
+
+DESCRIPTION
+   Gives the list a hash index over its elements, so that
+   linked_list_search_hash can find one without walking the list. The list
+   itself, and so the order elements are added and removed in, is unchanged.
+   Elements already in the list are indexed right away. Passing NULL drops
+   the index.
+
+   p_list_data:  List handle.
+   hash:         Function returning the key hash of an element's data. Data
+                 that an equal function may match must hash the same, and
+                 the hash must not change while the data is in the list.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+linked_list_err_type linked_list_set_hash(void* list_data, uint32_t (*hash)(void* data));
+
+/*===========================================================================
+FUNCTION    linked_list_search_hash
+
+DESCRIPTION
+   Searches for an element like linked_list_search, but only compares the
+   elements whose key hash is key_hash. Falls back to linked_list_search if
+   the list has no hash index. Should more than one element match, which
+   one is found is not defined.
+
+   p_list_data:  List handle.
+   data_p:       to be stored with the data found; NUll if no match.
+                 if data_p passed in as NULL, then no write to it.
+   equal:        Function ptr takes in a list element, and returns
+                 indication if this the one looking for.
+   data_0:       The data being compared against.
+   key_hash:     Key hash of the data being looked for.
+   rm_if_found:  Should data be removed if found?
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+linked_list_err_type linked_list_search_hash(void* list_data, void **data_p,
+                                             bool (*equal)(void* data_0, void* data),
+                                             void* data_0, uint32_t key_hash,
+                                             bool rm_if_found);
+
+/*===========================================================================
+FUNCTION    linked_list_get_stats
+
+DESCRIPTION
+   Retrieves the element allocator statistics of a list.
+
+   p_list_data:  List handle.
+   stats:        Filled with the current statistics.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+linked_list_err_type linked_list_get_stats(void* list_data, linked_list_stats_type* stats);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -37,6 +37,9 @@
 #include <ctype.h>
 #include <unistd.h>
 #include <time.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <loc_cfg.h>
 #include <log_util.h>
 
@@ -47,14 +50,16 @@
  *============================================================================*/
 
 /* Parameter data */
-static uint8_t DEBUG_LEVEL = 3;
-static uint8_t TIMESTAMP = 0;
+static uint32_t DEBUG_LEVEL = 3;
+static uint32_t TIMESTAMP = 0;
+static uint32_t LOG_RING = 0;
 
 /* Parameter spec table */
 static loc_param_s_type loc_parameter_table[] =
 {
   {"DEBUG_LEVEL",                    &DEBUG_LEVEL, NULL,                   'n'},
   {"TIMESTAMP",                      &TIMESTAMP,   NULL,                   'n'},
+  {"DEBUG_LOG_RING",                 &LOG_RING,    NULL,                   'n'},
 };
 
 int loc_param_num = sizeof(loc_parameter_table) / sizeof(loc_param_s_type);
@@ -216,6 +221,229 @@ void loc_set_config_entry(loc_param_s_type* config_entry, loc_param_v_type* conf
    }
 }
 
+/* Parameter name index: open addressing over both tables, by name hash */
+typedef struct
+{
+   uint32_t                      hash;
+   loc_param_s_type             *entry;   /* NULL: empty slot */
+} loc_param_slot_s_type;
+
+static pthread_mutex_t loc_param_index_lock = PTHREAD_MUTEX_INITIALIZER;
+static loc_param_slot_s_type *loc_param_index = NULL;
+static uint32_t loc_param_index_mask = 0;
+static loc_param_s_type *loc_param_index_table = NULL;   /* what it was built for */
+static uint32_t loc_param_index_length = 0;
+
+/* FNV-1a hash of a parameter name */
+static uint32_t loc_param_hash(const char *name, size_t length)
+{
+   uint32_t hash = 2166136261u;
+   size_t i;
+
+   for (i = 0; i < length; i++)
+   {
+      hash = (hash ^ (uint8_t) name[i]) * 16777619u;
+   }
+   return hash;
+}
+
+static void loc_param_index_add(loc_param_s_type *entry)
+{
+   uint32_t hash = loc_param_hash(entry->param_name, strlen(entry->param_name));
+   uint32_t i = hash & loc_param_index_mask;
+
+   while (NULL != loc_param_index[i].entry)
+   {
+      i = (i + 1) & loc_param_index_mask;
+   }
+   loc_param_index[i].hash = hash;
+   loc_param_index[i].entry = entry;
+}
+
+/*===========================================================================
+FUNCTION loc_param_index_build
+
+DESCRIPTION
+   Indexes config_table and the logging parameters by name, unless the
+   index already covers config_table. Entries sharing a name are all kept,
+   so each of them is still set. Callers hold loc_param_index_lock.
+
+PARAMETERS:
+   config_table: table passed to loc_read_conf
+   table_length: length of the configuration table
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   0 on success, -1 if the index could not be allocated
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static int loc_param_index_build(loc_param_s_type* config_table, uint32_t table_length)
+{
+   uint32_t count = (NULL != config_table ? table_length : 0) + loc_param_num;
+   uint32_t size = 8;
+   uint32_t i;
+
+   if (NULL != loc_param_index &&
+       loc_param_index_table == config_table && loc_param_index_length == table_length)
+   {
+      return 0;
+   }
+
+   /* At most half full, so probes stay short */
+   while (size < 2 * count)
+   {
+      size <<= 1;
+   }
+   free(loc_param_index);
+   loc_param_index = (loc_param_slot_s_type*) calloc(size, sizeof(loc_param_slot_s_type));
+   if (NULL == loc_param_index)
+   {
+      return -1;
+   }
+   loc_param_index_mask = size - 1;
+   loc_param_index_table = config_table;
+   loc_param_index_length = table_length;
+
+   for(i = 0; NULL != config_table && i < table_length; i++)
+   {
+      loc_param_index_add(&config_table[i]);
+   }
+   for(i = 0; i < (uint32_t) loc_param_num; i++)
+   {
+      loc_param_index_add(&loc_parameter_table[i]);
+   }
+   return 0;
+}
+
+/* Copies [begin, end) into out with the leading and trailing spaces removed.
+   Like trim_space, it leaves a string of nothing but spaces as it is. */
+static size_t loc_param_trim_copy(const char *begin, const char *end, char *out)
+{
+   const char *first = begin;
+   const char *last = end;
+
+   while (first < last && isspace((unsigned char) *first))
+   {
+      first++;
+   }
+   while (last > first && isspace((unsigned char) last[-1]))
+   {
+      last--;
+   }
+   if (first < last)
+   {
+      begin = first;
+      end = last;
+   }
+   memcpy(out, begin, end - begin);
+   out[end - begin] = '\0';
+   return end - begin;
+}
+
+/*===========================================================================
+FUNCTION loc_param_parse_line
+
+DESCRIPTION
+   Sets the parameters named by one line of the configuration file. The
+   line is split as strtok_r(line, "=") would: the name is the first run
+   of characters other than '=', the value the second, and a line with no
+   value is skipped.
+
+PARAMETERS:
+   line: first character of the line
+   end:  end of the line, past its newline if any
+
+DEPENDENCIES
+   loc_param_index_build
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static void loc_param_parse_line(const char *line, const char *end)
+{
+   char name[LOC_MAX_PARAM_LINE];
+   char value[LOC_MAX_PARAM_LINE];
+   const char *name_end, *value_begin, *value_end;
+   loc_param_v_type config_value;
+   size_t name_length;
+   uint32_t hash, i;
+   int parsed = 0;
+
+   /* A NUL ends the line for strtok_r, as it did for fgets */
+   const char *nul = (const char*) memchr(line, '\0', end - line);
+   if (NULL != nul)
+   {
+      end = nul;
+   }
+
+   while (line < end && '=' == *line)
+   {
+      line++;
+   }
+   name_end = line;
+   while (name_end < end && '=' != *name_end)
+   {
+      name_end++;
+   }
+   value_begin = name_end;
+   while (value_begin < end && '=' == *value_begin)
+   {
+      value_begin++;
+   }
+   value_end = value_begin;
+   while (value_end < end && '=' != *value_end)
+   {
+      value_end++;
+   }
+   if (line == name_end || value_begin == value_end)
+   {
+      return;
+   }
+
+   name_length = loc_param_trim_copy(line, name_end, name);
+   hash = loc_param_hash(name, name_length);
+
+   for (i = hash & loc_param_index_mask;
+        NULL != loc_param_index[i].entry;
+        i = (i + 1) & loc_param_index_mask)
+   {
+      if (loc_param_index[i].hash != hash)
+      {
+         continue;
+      }
+
+      if (!parsed)
+      {
+         memset(&config_value, 0, sizeof(config_value));
+         loc_param_trim_copy(value_begin, value_end, value);
+         config_value.param_name = name;
+         config_value.param_str_value = value;
+
+         /* Parse numerical value */
+         if (value[0] == '0' && tolower(value[1]) == 'x')
+         {
+            /* hex */
+            config_value.param_int_value = (int) strtol(&value[2], (char**) NULL, 16);
+         }
+         else {
+            config_value.param_double_value = (double) atof(value); /* float */
+            config_value.param_int_value = atoi(value); /* dec */
+         }
+         parsed = 1;
+      }
+
+      /* Compares the names, so a hash collision sets nothing */
+      loc_set_config_entry(loc_param_index[i].entry, &config_value);
+   }
+}
+
 /*===========================================================================
 FUNCTION loc_read_conf
 
@@ -224,6 +452,10 @@ DESCRIPTION
    the passed in configuration table. This table maps strings to values to
    set along with the type of each of these values.
 
+   The file is mapped and parsed in one pass. Names are looked up through
+   an index over the table, built on the first call and kept for as long
+   as the same table is passed in.
+
 PARAMETERS:
    conf_file_name: configuration file to read
    config_table: table definition of strings to places to store information
@@ -240,15 +472,15 @@ SIDE EFFECTS
 ===========================================================================*/
 void loc_read_conf(const char* conf_file_name, loc_param_s_type* config_table, uint32_t table_length)
 {
-   FILE *gps_conf_fp = NULL;
-   char input_buf[LOC_MAX_PARAM_LINE];  /* declare a char array */
-   char *lasts;
-   loc_param_v_type config_value;
+   int gps_conf_fd;
+   struct stat gps_conf_stat;
+   const char *buf = NULL;
+   const char *line, *end;
    uint32_t i;
 
    loc_default_parameters();
 
-   if((gps_conf_fp = fopen(conf_file_name, "r")) != NULL)
+   if((gps_conf_fd = open(conf_file_name, O_RDONLY)) >= 0)
    {
       LOC_LOGD("%s: using %s", __FUNCTION__, GPS_CONF_FILE);
    }
@@ -258,6 +490,24 @@ void loc_read_conf(const char* conf_file_name, loc_param_s_type* config_table, u
       return; /* no parameter file */
    }
 
+   if (0 != fstat(gps_conf_fd, &gps_conf_stat))
+   {
+      LOC_LOGE("%s: cannot stat %s", __FUNCTION__, GPS_CONF_FILE);
+      close(gps_conf_fd);
+      return;
+   }
+   if (gps_conf_stat.st_size > 0)
+   {
+      buf = (const char*) mmap(NULL, gps_conf_stat.st_size, PROT_READ, MAP_PRIVATE, gps_conf_fd, 0);
+      if (MAP_FAILED == buf)
+      {
+         LOC_LOGE("%s: cannot map %s", __FUNCTION__, GPS_CONF_FILE);
+         close(gps_conf_fd);
+         return;
+      }
+   }
+   close(gps_conf_fd);
+
    /* Clear all validity bits */
    for(i = 0; NULL != config_table && i < table_length; i++)
    {
@@ -267,44 +517,36 @@ void loc_read_conf(const char* conf_file_name, loc_param_s_type* config_table, u
       }
    }
 
-   while(fgets(input_buf, LOC_MAX_PARAM_LINE, gps_conf_fp) != NULL)
+   pthread_mutex_lock(&loc_param_index_lock);
+   if (0 != loc_param_index_build(config_table, table_length))
    {
-      memset(&config_value, 0, sizeof(config_value));
-
-      /* Separate variable and value */
-      config_value.param_name = strtok_r(input_buf, "=", &lasts);
-      if (config_value.param_name == NULL) continue;       /* skip lines that do not contain "=" */
-      config_value.param_str_value = strtok_r(NULL, "=", &lasts);
-      if (config_value.param_str_value == NULL) continue;  /* skip lines that do not contain two operands */
-
-      /* Trim leading and trailing spaces */
-      trim_space(config_value.param_name);
-      trim_space(config_value.param_str_value);
-
-      /* Parse numerical value */
-      if (config_value.param_str_value[0] == '0' && tolower(config_value.param_str_value[1]) == 'x')
-      {
-         /* hex */
-         config_value.param_int_value = (int) strtol(&config_value.param_str_value[2], (char**) NULL, 16);
-      }
-      else {
-         config_value.param_double_value = (double) atof(config_value.param_str_value); /* float */
-         config_value.param_int_value = atoi(config_value.param_str_value); /* dec */
-      }
-
-      for(i = 0; NULL != config_table && i < table_length; i++)
-      {
-         loc_set_config_entry(&config_table[i], &config_value);
-      }
-
-      for(i = 0; i < loc_param_num; i++)
+      LOC_LOGE("%s: cannot index the parameter table", __FUNCTION__);
+   }
+   else if (NULL != buf)
+   {
+      end = buf + gps_conf_stat.st_size;
+      for (line = buf; line < end; )
       {
-         loc_set_config_entry(&loc_parameter_table[i], &config_value);
+         /* Lines longer than fgets took at once still go in pieces */
+         const char *limit = end - line > LOC_MAX_PARAM_LINE - 1 ?
+                             line + LOC_MAX_PARAM_LINE - 1 : end;
+         const char *next = (const char*) memchr(line, '\n', limit - line);
+         next = NULL != next ? next + 1 : limit;
+         loc_param_parse_line(line, next);
+         line = next;
       }
    }
+   pthread_mutex_unlock(&loc_param_index_lock);
 
-   fclose(gps_conf_fp);
+   if (NULL != buf)
+   {
+      munmap((void*) buf, gps_conf_stat.st_size);
+   }
 
    /* Initialize logging mechanism with parsed data */
    loc_logger_init(DEBUG_LEVEL, TIMESTAMP);
+   if (LOG_RING > 0)
+   {
+      loc_log_ring_init(LOG_RING);
+   }
 }
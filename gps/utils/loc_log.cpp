@@ -31,6 +31,8 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <sys/time.h>
 #include "loc_log.h"
 #include "msg_q.h"
@@ -50,6 +52,22 @@ const char ENTRY_TAG[]  = "Entering";
 /* Logging Mechanism */
 loc_logger_s_type loc_logger;
 
+/* Coarse clocks return the time of the last tick without entering the kernel */
+#ifndef CLOCK_REALTIME_COARSE
+#define CLOCK_REALTIME_COARSE 5
+#endif
+
+/* HH:MM:SS of the last second a time string was made for. seq is odd while
+   it is being updated; a reader that sees seq change formats it itself. */
+typedef struct
+{
+   uint32_t             seq;
+   time_t               sec;
+   char                 hms[12];
+} loc_hms_cache_s_type;
+
+static loc_hms_cache_s_type loc_local_hms;
+
 /* Get names from value */
 const char* loc_get_name_from_mask(loc_name_val_s_type table[], int table_size, long mask)
 {
@@ -78,6 +96,44 @@ const char* loc_get_name_from_val(loc_name_val_s_type table[], int table_size, l
    return UNKNOWN_STR;
 }
 
+/* Get names from value, for tables sorted by value */
+const char* loc_get_name_from_sorted(loc_name_val_s_type table[], int table_size, long value)
+{
+   int lo = 0;
+   int hi = table_size - 1;
+   long i;
+
+   if (table_size <= 0)
+   {
+      return UNKNOWN_STR;
+   }
+
+   /* Consecutive values put value at its offset from the first one */
+   i = value - table[0].val;
+   if (i >= 0 && i < table_size && table[i].val == value)
+   {
+      return table[i].name;
+   }
+
+   while (lo <= hi)
+   {
+      int mid = lo + (hi - lo) / 2;
+      if (table[mid].val == value)
+      {
+         return table[mid].name;
+      }
+      if (table[mid].val < value)
+      {
+         lo = mid + 1;
+      }
+      else
+      {
+         hi = mid - 1;
+      }
+   }
+   return UNKNOWN_STR;
+}
+
 static loc_name_val_s_type loc_msg_q_status[] =
 {
     NAME_VAL( eMSG_Q_SUCCESS ),
@@ -85,7 +141,8 @@ static loc_name_val_s_type loc_msg_q_status[] =
     NAME_VAL( eMSG_Q_INVALID_PARAMETER ),
     NAME_VAL( eMSG_Q_INVALID_HANDLE ),
     NAME_VAL( eMSG_Q_UNAVAILABLE_RESOURCE ),
-    NAME_VAL( eMSG_Q_INSUFFICIENT_BUFFER )
+    NAME_VAL( eMSG_Q_INSUFFICIENT_BUFFER ),
+    NAME_VAL( eMSG_Q_TIMEOUT )
 };
 static int loc_msg_q_status_num = sizeof(loc_msg_q_status) / sizeof(loc_name_val_s_type);
 
@@ -101,6 +158,103 @@ const char* log_succ_fail_string(int is_succ)
 }
 
 
+/*===========================================================================
+FUNCTION loc_get_realtime_coarse
+
+DESCRIPTION
+   Reads the wall clock from CLOCK_REALTIME_COARSE, which is good to a
+   scheduler tick and does not need a system call. Falls back to
+   CLOCK_REALTIME on kernels without coarse clocks.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static void loc_get_realtime_coarse(struct timespec* now)
+{
+   if (0 != clock_gettime(CLOCK_REALTIME_COARSE, now))
+   {
+      clock_gettime(CLOCK_REALTIME, now);
+   }
+}
+
+/*===========================================================================
+FUNCTION loc_get_hms
+
+DESCRIPTION
+   Formats the local HH:MM:SS of sec into hms, a buffer of at least 12
+   bytes, reusing the string made for the previous call within the same
+   second, as localtime_r is costly.
+
+   cache: Cache of the last second formatted.
+   sec:   Time to format.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+static void loc_get_hms(loc_hms_cache_s_type* cache, time_t sec, char* hms)
+{
+   uint32_t seq = __atomic_load_n(&cache->seq, __ATOMIC_ACQUIRE);
+
+   if (0 == (seq & 1) && __atomic_load_n(&cache->sec, __ATOMIC_RELAXED) == sec)
+   {
+      memcpy(hms, cache->hms, sizeof(cache->hms));
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if (__atomic_load_n(&cache->seq, __ATOMIC_RELAXED) == seq)
+      {
+         return;
+      }
+   }
+
+   struct tm now_tm;
+   localtime_r(&sec, &now_tm);
+   strftime(hms, 12, "%H:%M:%S", &now_tm);
+
+   /* Whoever gets in first updates the cache; the others just go on */
+   if (0 == (seq & 1) &&
+       __atomic_compare_exchange_n(&cache->seq, &seq, seq + 1, 0,
+                                   __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+   {
+      __atomic_store_n(&cache->sec, sec, __ATOMIC_RELAXED);
+      memcpy(cache->hms, hms, sizeof(cache->hms));
+      __atomic_store_n(&cache->seq, seq + 2, __ATOMIC_RELEASE);
+   }
+}
+
+/*===========================================================================
+FUNCTION loc_get_realtime_ms
+
+DESCRIPTION
+   Wall clock time in milliseconds, as handed to the framework with
+   reports. Read from the coarse clock, so it is good to a scheduler tick.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Milliseconds since the epoch
+
+SIDE EFFECTS
+   N/A
+===========================================================================*/
+int64_t loc_get_realtime_ms(void)
+{
+   struct timespec now;
+   loc_get_realtime_coarse(&now);
+   return now.tv_sec * 1000LL + now.tv_nsec / 1000000;
+}
+
 /*===========================================================================
 
 FUNCTION loc_get_time
@@ -117,15 +271,13 @@ RETURN VALUE
 ===========================================================================*/
 char *loc_get_time(char *time_string, unsigned long buf_size)
 {
-   struct timeval now;     /* sec and usec     */
-   struct tm now_tm;       /* broken-down time */
-   char hms_string[80];    /* HH:MM:SS         */
+   struct timespec now;    /* sec and nsec     */
+   char hms_string[12];    /* HH:MM:SS         */
 
-   gettimeofday(&now, NULL);
-   localtime_r(&now.tv_sec, &now_tm);
+   loc_get_realtime_coarse(&now);
+   loc_get_hms(&loc_local_hms, now.tv_sec, hms_string);
 
-   strftime(hms_string, sizeof hms_string, "%H:%M:%S", &now_tm);
-   snprintf(time_string, buf_size, "%s.%03d", hms_string, (int) (now.tv_usec / 1000));
+   snprintf(time_string, buf_size, "%s.%03d", hms_string, (int) (now.tv_nsec / 1000000));
 
    return time_string;
 }
@@ -157,7 +309,8 @@ void loc_logger_init(unsigned long debug, unsigned long timestamp)
 FUNCTION get_timestamp
 
 DESCRIPTION
-   Generates a timestamp using the current system time
+   Generates a timestamp using the current system time. The microseconds
+   come from CLOCK_REALTIME, as the coarse clock is only good to a tick.
 
 DEPENDENCIES
    N/A
@@ -170,14 +323,13 @@ SIDE EFFECTS
 ===========================================================================*/
 char * get_timestamp(char *str, unsigned long buf_size)
 {
-  struct timeval tv;
-  struct timezone tz;
+  struct timespec ts;
   int hh, mm, ss;
-  gettimeofday(&tv, &tz);
-  hh = tv.tv_sec/3600%24;
-  mm = (tv.tv_sec%3600)/60;
-  ss = tv.tv_sec%60;
-  snprintf(str, buf_size, "%02d:%02d:%02d.%06ld", hh, mm, ss, tv.tv_usec);
+  clock_gettime(CLOCK_REALTIME, &ts);
+  hh = ts.tv_sec/3600%24;
+  mm = (ts.tv_sec%3600)/60;
+  ss = ts.tv_sec%60;
+  snprintf(str, buf_size, "%02d:%02d:%02d.%06ld", hh, mm, ss, ts.tv_nsec / 1000);
   return str;
 }
 
@@ -36,6 +36,7 @@ extern "C"
 #endif
 
 #include <ctype.h>
+#include <stdint.h>
 
 typedef struct
 {
@@ -53,12 +54,18 @@ typedef struct
 /* Get names from value */
 const char* loc_get_name_from_mask(loc_name_val_s_type table[], int table_size, long mask);
 const char* loc_get_name_from_val(loc_name_val_s_type table[], int table_size, long value);
+/* Get names from value, for tables sorted by value. A table listing a run of
+   consecutive values is indexed directly, any other is binary searched. */
+const char* loc_get_name_from_sorted(loc_name_val_s_type table[], int table_size, long value);
 const char* loc_get_msg_q_status(int status);
 
 extern const char* log_succ_fail_string(int is_succ);
 
 extern char *loc_get_time(char *time_string, unsigned long buf_size);
 
+/* Wall clock time in milliseconds, from the coarse clock */
+extern int64_t loc_get_realtime_ms(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,747 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#include "loc_log_ring.h"
+
+#define LOG_TAG "LocSvc_utils_log"
+#include "log_util.h"
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#define LOC_LOG_RING_MIN_SLOTS 2
+#define LOC_LOG_RING_MAX_SLOTS (1 << 16)
+#define LOC_LOG_RING_MAX_ARGS 16
+#define LOC_LOG_RING_STR_SIZE 256
+#define LOC_LOG_RING_SPEC_SIZE 32
+#define LOC_LOG_RING_LINE_SIZE 1024
+#define LOC_LOG_RING_DRAIN_MS 50
+
+/* How the argument of a conversion is held in a record */
+typedef enum {
+   LOC_LOG_ARG_NONE,                /* %%, takes no argument */
+   LOC_LOG_ARG_INT,
+   LOC_LOG_ARG_LONG,
+   LOC_LOG_ARG_LLONG,
+   LOC_LOG_ARG_SIZE,
+   LOC_LOG_ARG_INTMAX,
+   LOC_LOG_ARG_PTRDIFF,
+   LOC_LOG_ARG_PTR,
+   LOC_LOG_ARG_DOUBLE,
+   LOC_LOG_ARG_STR,                 /* Offset of the copy in the record */
+   LOC_LOG_ARG_BAD                  /* Cannot be deferred */
+} loc_log_arg_kind;
+
+typedef union loc_log_arg {
+   uint64_t u;
+   double d;
+} loc_log_arg;
+
+typedef struct loc_log_record {
+   uint64_t seq;                    /* Order taken in, across all threads */
+   const char* tag;
+   const char* fmt;                 /* NULL if str holds the formatted line */
+   int prio;
+   uint32_t nargs;
+   loc_log_arg args[LOC_LOG_RING_MAX_ARGS];
+   char str[LOC_LOG_RING_STR_SIZE]; /* Copies of the %s arguments */
+} loc_log_record;
+
+typedef struct loc_log_ring {
+   struct loc_log_ring* next;       /* Guarded by loc_log_rings_lock */
+   loc_log_record* records;         /* Power of two long */
+   uint32_t mask;                   /* Number of records - 1 */
+   uint32_t head;                   /* Next record written by the owner */
+   uint32_t tail;                   /* Next record read by the drainer */
+   uint32_t drain_to;               /* Head as seen by the current drain */
+   uint64_t claim;                  /* 0, or 1 + a seq no higher than that
+                                       of the record being put */
+   uint32_t dropped;                /* Written by the owner */
+   uint32_t dropped_reported;       /* Part of dropped already reported */
+   int dead;                        /* Owner has exited */
+} loc_log_ring;
+
+static pthread_key_t loc_log_ring_key;
+static uint32_t loc_log_ring_slots;
+static uint64_t loc_log_ring_seq;
+static uint64_t loc_log_ring_dropped;
+static uint32_t loc_log_ring_threads;
+static loc_log_ring* loc_log_rings;
+/* Guards the list of rings and starting up */
+static pthread_mutex_t loc_log_rings_lock = PTHREAD_MUTEX_INITIALIZER;
+/* Only one thread drains at a time */
+static pthread_mutex_t loc_log_drain_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*===========================================================================
+FUNCTION    loc_log_ring_scan
+
+DESCRIPTION
+   Parses the printf conversion spec starting right after its '%'.
+
+   p:     First character after the '%'.
+   kind:  Set to how the argument of the conversion is held.
+   stars: Set to the number of '*' int arguments that precede it.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   The first character after the spec.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static const char* loc_log_ring_scan(const char* p, loc_log_arg_kind* kind, int* stars)
+{
+   char mod = 0;
+   int precision = 0;
+
+   *stars = 0;
+   if ('%' == *p)
+   {
+      *kind = LOC_LOG_ARG_NONE;
+      return p + 1;
+   }
+
+   while ('-' == *p || '+' == *p || ' ' == *p || '#' == *p || '0' == *p || '\'' == *p)
+   {
+      p++;
+   }
+   if ('*' == *p)
+   {
+      (*stars)++;
+      p++;
+   }
+   while ('0' <= *p && *p <= '9')
+   {
+      p++;
+   }
+   if ('.' == *p)
+   {
+      precision = 1;
+      p++;
+      if ('*' == *p)
+      {
+         (*stars)++;
+         p++;
+      }
+      while ('0' <= *p && *p <= '9')
+      {
+         p++;
+      }
+   }
+
+   switch (*p)
+   {
+   case 'h':
+      mod = 'h';
+      if ('h' == *++p)
+      {
+         p++;
+      }
+      break;
+   case 'l':
+      mod = 'l';
+      if ('l' == *++p)
+      {
+         mod = 'q';
+         p++;
+      }
+      break;
+   case 'q':
+   case 'L':
+   case 'z':
+   case 'j':
+   case 't':
+      mod = *p++;
+      break;
+   }
+
+   switch (*p)
+   {
+   case 'd':
+   case 'i':
+   case 'u':
+   case 'o':
+   case 'x':
+   case 'X':
+      switch (mod)
+      {
+      case 'l': *kind = LOC_LOG_ARG_LONG; break;
+      case 'q': *kind = LOC_LOG_ARG_LLONG; break;
+      case 'z': *kind = LOC_LOG_ARG_SIZE; break;
+      case 'j': *kind = LOC_LOG_ARG_INTMAX; break;
+      case 't': *kind = LOC_LOG_ARG_PTRDIFF; break;
+      case 'L': *kind = LOC_LOG_ARG_BAD; break;
+      default:  *kind = LOC_LOG_ARG_INT; break;
+      }
+      break;
+   case 'c':
+      *kind = 0 == mod ? LOC_LOG_ARG_INT : LOC_LOG_ARG_BAD;
+      break;
+   case 'p':
+      *kind = LOC_LOG_ARG_PTR;
+      break;
+   case 'f':
+   case 'F':
+   case 'e':
+   case 'E':
+   case 'g':
+   case 'G':
+   case 'a':
+   case 'A':
+      *kind = 'L' == mod ? LOC_LOG_ARG_BAD : LOC_LOG_ARG_DOUBLE;
+      break;
+   case 's':
+      /* A precision may mean the string is not terminated */
+      *kind = 0 == mod && !precision ? LOC_LOG_ARG_STR : LOC_LOG_ARG_BAD;
+      break;
+   case '\0':
+      *kind = LOC_LOG_ARG_BAD;
+      return p;
+   default:
+      /* %n and anything not understood */
+      *kind = LOC_LOG_ARG_BAD;
+      break;
+   }
+   return p + 1;
+}
+
+/*===========================================================================
+FUNCTION    loc_log_ring_capture
+
+DESCRIPTION
+   Stores the arguments of fmt in a record, copying strings into it.
+
+   rec: Record to fill.
+   fmt: Format of the log line.
+   ap:  Its arguments.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   1 if the record holds all the arguments, 0 if the line has to be
+   formatted right away instead.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int loc_log_ring_capture(loc_log_record* rec, const char* fmt, va_list ap)
+{
+   const char* p = fmt;
+   uint32_t n = 0;
+   size_t used = 0;
+
+   while (NULL != (p = strchr(p, '%')))
+   {
+      loc_log_arg_kind kind;
+      int stars;
+      const char* spec = p;
+
+      p = loc_log_ring_scan(p + 1, &kind, &stars);
+      if (LOC_LOG_ARG_NONE == kind)
+      {
+         continue;
+      }
+      if (LOC_LOG_ARG_BAD == kind ||
+          p - spec >= LOC_LOG_RING_SPEC_SIZE ||
+          n + stars + 1 > LOC_LOG_RING_MAX_ARGS)
+      {
+         return 0;
+      }
+
+      while (stars-- > 0)
+      {
+         rec->args[n++].u = (uint64_t) va_arg(ap, int);
+      }
+
+      switch (kind)
+      {
+      case LOC_LOG_ARG_INT:
+         rec->args[n++].u = (uint64_t) va_arg(ap, int);
+         break;
+      case LOC_LOG_ARG_LONG:
+         rec->args[n++].u = (uint64_t) va_arg(ap, long);
+         break;
+      case LOC_LOG_ARG_LLONG:
+         rec->args[n++].u = (uint64_t) va_arg(ap, long long);
+         break;
+      case LOC_LOG_ARG_SIZE:
+         rec->args[n++].u = (uint64_t) va_arg(ap, size_t);
+         break;
+      case LOC_LOG_ARG_INTMAX:
+         rec->args[n++].u = (uint64_t) va_arg(ap, intmax_t);
+         break;
+      case LOC_LOG_ARG_PTRDIFF:
+         rec->args[n++].u = (uint64_t) va_arg(ap, ptrdiff_t);
+         break;
+      case LOC_LOG_ARG_PTR:
+         rec->args[n++].u = (uint64_t) (uintptr_t) va_arg(ap, void*);
+         break;
+      case LOC_LOG_ARG_DOUBLE:
+         rec->args[n++].d = va_arg(ap, double);
+         break;
+      case LOC_LOG_ARG_STR:
+      {
+         const char* str = va_arg(ap, const char*);
+         size_t len;
+
+         if (NULL == str)
+         {
+            str = "(null)";
+         }
+         len = strlen(str);
+         if (used + len + 1 > sizeof(rec->str))
+         {
+            return 0;
+         }
+         memcpy(rec->str + used, str, len + 1);
+         rec->args[n++].u = used;
+         used += len + 1;
+         break;
+      }
+      default:
+         return 0;
+      }
+   }
+
+   rec->fmt = fmt;
+   rec->nargs = n;
+   return 1;
+}
+
+/* Formats one argument, passing the '*' arguments along */
+#define LOC_LOG_RING_PRINT(VAL)                                              \
+   (0 == stars ? snprintf(out, room, spec, VAL) :                            \
+    1 == stars ? snprintf(out, room, spec, star[0], VAL) :                   \
+    snprintf(out, room, spec, star[0], star[1], VAL))
+
+/*===========================================================================
+FUNCTION    loc_log_ring_format
+
+DESCRIPTION
+   Formats a record into a log line.
+
+   rec:  Record to format.
+   line: Buffer for the line.
+   size: Size of line.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_log_ring_format(const loc_log_record* rec, char* line, size_t size)
+{
+   const char* p = rec->fmt;
+   size_t len = 0;
+   uint32_t n = 0;
+
+   if (NULL == p)
+   {
+      snprintf(line, size, "%s", rec->str);
+      return;
+   }
+
+   while (len + 1 < size)
+   {
+      const char* pct = strchr(p, '%');
+      size_t lit = NULL != pct ? (size_t) (pct - p) : strlen(p);
+      loc_log_arg_kind kind;
+      int stars, star[2] = {0, 0};
+      char spec[LOC_LOG_RING_SPEC_SIZE];
+      const loc_log_arg* arg;
+      char* out;
+      size_t room;
+      int written = 0;
+      int i;
+
+      if (lit > size - 1 - len)
+      {
+         lit = size - 1 - len;
+      }
+      memcpy(line + len, p, lit);
+      len += lit;
+      if (NULL == pct || len + 1 >= size)
+      {
+         break;
+      }
+
+      p = loc_log_ring_scan(pct + 1, &kind, &stars);
+      if (LOC_LOG_ARG_NONE == kind)
+      {
+         line[len++] = '%';
+         continue;
+      }
+      memcpy(spec, pct, p - pct);
+      spec[p - pct] = '\0';
+      for (i = 0; i < stars; i++)
+      {
+         star[i] = (int) rec->args[n++].u;
+      }
+      arg = &rec->args[n++];
+      out = line + len;
+      room = size - len;
+
+      switch (kind)
+      {
+      case LOC_LOG_ARG_INT:
+         written = LOC_LOG_RING_PRINT((int) arg->u);
+         break;
+      case LOC_LOG_ARG_LONG:
+         written = LOC_LOG_RING_PRINT((long) arg->u);
+         break;
+      case LOC_LOG_ARG_LLONG:
+         written = LOC_LOG_RING_PRINT((long long) arg->u);
+         break;
+      case LOC_LOG_ARG_SIZE:
+         written = LOC_LOG_RING_PRINT((size_t) arg->u);
+         break;
+      case LOC_LOG_ARG_INTMAX:
+         written = LOC_LOG_RING_PRINT((intmax_t) arg->u);
+         break;
+      case LOC_LOG_ARG_PTRDIFF:
+         written = LOC_LOG_RING_PRINT((ptrdiff_t) arg->u);
+         break;
+      case LOC_LOG_ARG_PTR:
+         written = LOC_LOG_RING_PRINT((void*) (uintptr_t) arg->u);
+         break;
+      case LOC_LOG_ARG_DOUBLE:
+         written = LOC_LOG_RING_PRINT(arg->d);
+         break;
+      case LOC_LOG_ARG_STR:
+         written = LOC_LOG_RING_PRINT(rec->str + arg->u);
+         break;
+      default:
+         break;
+      }
+
+      if (written > 0)
+      {
+         len += (size_t) written < room ? (size_t) written : room - 1;
+      }
+   }
+   line[len] = '\0';
+}
+
+/*===========================================================================
+FUNCTION    loc_log_ring_drain
+
+DESCRIPTION
+   Logs the records taken so far, oldest first across all the rings, then
+   frees the rings of the threads that have exited. Records that a lower
+   seq still being put would have to precede are left for the next drain. Callers hold
+   loc_log_drain_lock.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void loc_log_ring_drain(void)
+{
+   char line[LOC_LOG_RING_LINE_SIZE];
+   loc_log_ring* rings;
+   loc_log_ring* ring;
+   loc_log_ring** link;
+   uint64_t watermark;
+
+   /* Rings are only ever added at the front, and only freed here */
+   pthread_mutex_lock(&loc_log_rings_lock);
+   rings = loc_log_rings;
+   pthread_mutex_unlock(&loc_log_rings_lock);
+
+   /* Only records below the watermark are logged. Every seq below it was
+      handed out before this drain began, and the record holding it is
+      either in a snapshot head or still being put, which lowers the
+      watermark to it. The rest wait for the next drain, so a record is
+      never logged ahead of one with a lower seq. */
+   watermark = __atomic_load_n(&loc_log_ring_seq, __ATOMIC_SEQ_CST);
+   for (ring = rings; NULL != ring; ring = ring->next)
+   {
+      uint64_t claim = __atomic_load_n(&ring->claim, __ATOMIC_SEQ_CST);
+      if (0 != claim && claim - 1 < watermark)
+      {
+         watermark = claim - 1;
+      }
+      ring->drain_to = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+   }
+
+   for (;;)
+   {
+      loc_log_ring* oldest = NULL;
+      const loc_log_record* rec = NULL;
+
+      for (ring = rings; NULL != ring; ring = ring->next)
+      {
+         if (ring->tail != ring->drain_to)
+         {
+            const loc_log_record* next = &ring->records[ring->tail & ring->mask];
+            if (next->seq < watermark && (NULL == rec || next->seq < rec->seq))
+            {
+               oldest = ring;
+               rec = next;
+            }
+         }
+      }
+      if (NULL == oldest)
+      {
+         break;
+      }
+
+      loc_log_ring_format(rec, line, sizeof(line));
+      __android_log_write(rec->prio, rec->tag, line);
+      __atomic_store_n(&oldest->tail, oldest->tail + 1, __ATOMIC_RELEASE);
+   }
+
+   for (ring = rings; NULL != ring; ring = ring->next)
+   {
+      uint32_t dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+      if (dropped != ring->dropped_reported)
+      {
+         snprintf(line, sizeof(line), "W/%u log records dropped, ring of %u full",
+                  dropped - ring->dropped_reported, ring->mask + 1);
+         __android_log_write(ANDROID_LOG_WARN, LOG_TAG, line);
+         ring->dropped_reported = dropped;
+      }
+   }
+
+   pthread_mutex_lock(&loc_log_rings_lock);
+   link = &loc_log_rings;
+   while (NULL != (ring = *link))
+   {
+      if (__atomic_load_n(&ring->dead, __ATOMIC_ACQUIRE) &&
+          ring->tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE))
+      {
+         *link = ring->next;
+         loc_log_ring_threads--;
+         free(ring->records);
+         free(ring);
+      }
+      else
+      {
+         link = &ring->next;
+      }
+   }
+   pthread_mutex_unlock(&loc_log_rings_lock);
+}
+
+static void* loc_log_ring_drainer(void* arg)
+{
+   const struct timespec period = {0, LOC_LOG_RING_DRAIN_MS * 1000000L};
+
+   (void) arg;
+   for (;;)
+   {
+      nanosleep(&period, NULL);
+      pthread_mutex_lock(&loc_log_drain_lock);
+      loc_log_ring_drain();
+      pthread_mutex_unlock(&loc_log_drain_lock);
+   }
+   return NULL;
+}
+
+/* Thread exit: leave the ring for the drainer to empty and free */
+static void loc_log_ring_release(void* data)
+{
+   loc_log_ring* ring = (loc_log_ring*) data;
+   __atomic_store_n(&ring->dead, 1, __ATOMIC_RELEASE);
+}
+
+/*===========================================================================
+FUNCTION    loc_log_ring_get
+
+DESCRIPTION
+   Finds the ring of the calling thread, making it on first use.
+
+DEPENDENCIES
+   loc_log_ring_init
+
+RETURN VALUE
+   The ring, or NULL if it could not be allocated.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static loc_log_ring* loc_log_ring_get(void)
+{
+   loc_log_ring* ring = (loc_log_ring*) pthread_getspecific(loc_log_ring_key);
+
+   if (NULL == ring)
+   {
+      ring = (loc_log_ring*) calloc(1, sizeof(loc_log_ring));
+      if (NULL == ring)
+      {
+         return NULL;
+      }
+      ring->records = (loc_log_record*) malloc(loc_log_ring_slots * sizeof(loc_log_record));
+      if (NULL == ring->records)
+      {
+         free(ring);
+         return NULL;
+      }
+      ring->mask = loc_log_ring_slots - 1;
+
+      pthread_mutex_lock(&loc_log_rings_lock);
+      ring->next = loc_log_rings;
+      loc_log_rings = ring;
+      loc_log_ring_threads++;
+      pthread_mutex_unlock(&loc_log_rings_lock);
+
+      pthread_setspecific(loc_log_ring_key, ring);
+   }
+   return ring;
+}
+
+void loc_log_ring_put(int prio, const char* tag, const char* fmt, ...)
+{
+   loc_log_ring* ring = loc_log_ring_get();
+   loc_log_record* rec;
+   uint32_t head;
+   va_list ap;
+
+   if (NULL == ring)
+   {
+      char line[LOC_LOG_RING_LINE_SIZE];
+      va_start(ap, fmt);
+      vsnprintf(line, sizeof(line), fmt, ap);
+      va_end(ap);
+      __android_log_write(prio, tag, line);
+      return;
+   }
+
+   head = ring->head;
+   if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) > ring->mask)
+   {
+      __atomic_store_n(&ring->dropped, ring->dropped + 1, __ATOMIC_RELAXED);
+      __atomic_add_fetch(&loc_log_ring_dropped, 1, __ATOMIC_RELAXED);
+      return;
+   }
+
+   /* The claim goes up before the seq is taken, and comes down after the
+      record is published; see loc_log_ring_drain */
+   __atomic_store_n(&ring->claim,
+                    __atomic_load_n(&loc_log_ring_seq, __ATOMIC_RELAXED) + 1,
+                    __ATOMIC_SEQ_CST);
+   rec = &ring->records[head & ring->mask];
+   rec->seq = __atomic_fetch_add(&loc_log_ring_seq, 1, __ATOMIC_SEQ_CST);
+   va_start(ap, fmt);
+   if (!loc_log_ring_capture(rec, fmt, ap))
+   {
+      va_end(ap);
+      va_start(ap, fmt);
+      vsnprintf(rec->str, sizeof(rec->str), fmt, ap);
+      rec->fmt = NULL;
+   }
+   va_end(ap);
+   rec->prio = prio;
+   rec->tag = tag;
+
+   __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+   __atomic_store_n(&ring->claim, 0, __ATOMIC_RELEASE);
+}
+
+int loc_log_ring_init(uint32_t slots)
+{
+   pthread_t drainer;
+   int result = 0;
+
+   pthread_mutex_lock(&loc_log_rings_lock);
+   if (!loc_logger.RING)
+   {
+      loc_log_ring_slots = LOC_LOG_RING_MIN_SLOTS;
+      while (loc_log_ring_slots < slots && loc_log_ring_slots < LOC_LOG_RING_MAX_SLOTS)
+      {
+         loc_log_ring_slots <<= 1;
+      }
+
+      if (0 != pthread_key_create(&loc_log_ring_key, loc_log_ring_release))
+      {
+         result = -1;
+      }
+      else if (0 != pthread_create(&drainer, NULL, loc_log_ring_drainer, NULL))
+      {
+         pthread_key_delete(loc_log_ring_key);
+         result = -1;
+      }
+      else
+      {
+         pthread_detach(drainer);
+         __atomic_store_n(&loc_logger.RING, 1, __ATOMIC_RELEASE);
+      }
+   }
+   pthread_mutex_unlock(&loc_log_rings_lock);
+
+   if (0 != result)
+   {
+      LOC_LOGE("%s: Unable to start the log drainer!\n", __FUNCTION__);
+   }
+   else
+   {
+      LOC_LOGI("%s: %u records per thread\n", __FUNCTION__, loc_log_ring_slots);
+   }
+   return result;
+}
+
+void loc_log_ring_flush(void)
+{
+   if (__atomic_load_n(&loc_logger.RING, __ATOMIC_ACQUIRE))
+   {
+      pthread_mutex_lock(&loc_log_drain_lock);
+      loc_log_ring_drain();
+      pthread_mutex_unlock(&loc_log_drain_lock);
+   }
+}
+
+void loc_log_ring_get_stats(loc_log_ring_stats_type* stats)
+{
+   pthread_mutex_lock(&loc_log_rings_lock);
+   stats->threads = loc_log_ring_threads;
+   pthread_mutex_unlock(&loc_log_rings_lock);
+   stats->recorded = __atomic_load_n(&loc_log_ring_seq, __ATOMIC_RELAXED);
+   stats->dropped = __atomic_load_n(&loc_log_ring_dropped, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,149 @@
+/* Copyright (c) 2012, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+#ifndef __LOC_LOG_RING_H__
+#define __LOC_LOG_RING_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include <stdint.h>
+
+/** Log Ring Statistics */
+typedef struct
+{
+  uint32_t threads;
+     /**< Threads that currently own a ring. */
+  uint64_t recorded;
+     /**< Records taken since the rings were started. */
+  uint64_t dropped;
+     /**< Records lost because their thread's ring was full. */
+}loc_log_ring_stats_type;
+
+/*===========================================================================
+FUNCTION    loc_log_ring_init
+
+DESCRIPTION
+   Starts deferred logging. From then on the LOC_LOG* macros no longer
+   format on the calling thread: each thread gets a ring of its own, which
+   only it writes to, and a record holds the format string pointer and the
+   raw arguments. A drainer thread formats the records in the order their
+   LOC_LOG* calls were entered, across threads, and hands them to the
+   Android log. A record is held back while one that was entered earlier is
+   still being written, and goes out with the next drain. Calling it again
+   once started does nothing.
+
+   %s arguments are copied into the record, since they may be gone by the
+   time it is drained. A record that does not fit, or uses a conversion the
+   ring cannot hold, is formatted right away into the record instead.
+
+   slots: Number of records each thread's ring holds, rounded up to a
+          power of two. A thread logging into a full ring loses the record;
+          the drainer reports how many were lost.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   0 on success, -1 if the drainer could not be started.
+
+SIDE EFFECTS
+   Sets loc_logger.RING.
+
+===========================================================================*/
+int loc_log_ring_init(uint32_t slots);
+
+/*===========================================================================
+FUNCTION    loc_log_ring_put
+
+DESCRIPTION
+   Records a log line in the calling thread's ring. Used by the LOC_LOG*
+   macros while loc_logger.RING is set; not meant to be called directly.
+
+   prio: Android log priority of the line.
+   tag:  Log tag; must be a string literal or otherwise outlive the ring.
+   fmt:  printf style format; must be a string literal.
+
+DEPENDENCIES
+   loc_log_ring_init
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_log_ring_put(int prio, const char* tag, const char* fmt, ...)
+   __attribute__((format(printf, 3, 4)));
+
+/*===========================================================================
+FUNCTION    loc_log_ring_flush
+
+DESCRIPTION
+   Drains every ring on the calling thread, without waiting for the
+   drainer. Meant for shutdown, so the last records are not lost.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_log_ring_flush(void);
+
+/*===========================================================================
+FUNCTION    loc_log_ring_get_stats
+
+DESCRIPTION
+   Retrieves the counters of deferred logging.
+
+   stats: Filled with the current statistics.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+void loc_log_ring_get_stats(loc_log_ring_stats_type* stats);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __LOC_LOG_RING_H__ */
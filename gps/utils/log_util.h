@@ -44,6 +44,7 @@ typedef struct loc_logger_s
 {
   unsigned long  DEBUG_LEVEL;
   unsigned long  TIMESTAMP;
+  unsigned long  RING;         /* Lines go through loc_log_ring */
 } loc_logger_s_type;
 
 /*=============================================================================
@@ -74,39 +75,66 @@ extern char* get_timestamp(char* str, unsigned long buf_size);
 
 
 #include <utils/Log.h>
+#include "loc_log_ring.h"
+
+/* Highest level compiled in. LOC_LOG* macros above it compile to nothing,
+ * arguments included; a build can lower it with -DLOC_LOG_MAX_LEVEL=3. */
+#ifndef LOC_LOG_MAX_LEVEL
+#define LOC_LOG_MAX_LEVEL 5
+#endif
+
+#define LOC_LOG_UNLIKELY(x) __builtin_expect(!!(x), 0)
 
 #ifndef DEBUG_DMN_LOC_API
 
+/* Whether LOC_LOG* at this level logs anything. Work done only to be
+ * logged, such as a loop over a report, belongs behind it too. */
+#define LOC_LOG_ON(level) \
+   (LOC_LOG_MAX_LEVEL >= (level) && \
+    (loc_logger.DEBUG_LEVEL >= (level) || loc_logger.DEBUG_LEVEL <= 0))
+
+/* Logs one line, or records it for the drainer once loc_log_ring is on */
+#define LOC_LOG_OUT(ALOG, PRIO, ...) \
+   if (loc_logger.RING) { loc_log_ring_put(PRIO, LOG_TAG, __VA_ARGS__); } \
+   else { ALOG(__VA_ARGS__); }
+
 /* LOGGING MACROS */
-#define LOC_LOGE(...) ALOGE("E/" __VA_ARGS__)
+#define LOC_LOGE(...) \
+do { LOC_LOG_OUT(ALOGE, ANDROID_LOG_ERROR, "E/" __VA_ARGS__) } while (0)
 
 #define LOC_LOGW(...) \
-if (loc_logger.DEBUG_LEVEL >= 2) { ALOGE("W/" __VA_ARGS__); } \
-else if (loc_logger.DEBUG_LEVEL <= 0) { ALOGW("W/" __VA_ARGS__); }
+do { if (LOC_LOG_ON(2)) { \
+   if (loc_logger.DEBUG_LEVEL >= 2) { LOC_LOG_OUT(ALOGE, ANDROID_LOG_ERROR, "W/" __VA_ARGS__) } \
+   else { LOC_LOG_OUT(ALOGW, ANDROID_LOG_WARN, "W/" __VA_ARGS__) } } } while (0)
 
 #define LOC_LOGI(...) \
-if (loc_logger.DEBUG_LEVEL >= 3) { ALOGE("I/" __VA_ARGS__); } \
-else if (loc_logger.DEBUG_LEVEL <= 0) { ALOGI("W/" __VA_ARGS__); }
+do { if (LOC_LOG_ON(3)) { \
+   if (loc_logger.DEBUG_LEVEL >= 3) { LOC_LOG_OUT(ALOGE, ANDROID_LOG_ERROR, "I/" __VA_ARGS__) } \
+   else { LOC_LOG_OUT(ALOGI, ANDROID_LOG_INFO, "W/" __VA_ARGS__) } } } while (0)
 
 #define LOC_LOGD(...) \
-if (loc_logger.DEBUG_LEVEL >= 4) { ALOGE("D/" __VA_ARGS__); } \
-else if (loc_logger.DEBUG_LEVEL <= 0) { ALOGD("W/" __VA_ARGS__); }
+do { if (LOC_LOG_UNLIKELY(LOC_LOG_ON(4))) { \
+   if (loc_logger.DEBUG_LEVEL >= 4) { LOC_LOG_OUT(ALOGE, ANDROID_LOG_ERROR, "D/" __VA_ARGS__) } \
+   else { LOC_LOG_OUT(ALOGD, ANDROID_LOG_DEBUG, "W/" __VA_ARGS__) } } } while (0)
 
 #define LOC_LOGV(...) \
-if (loc_logger.DEBUG_LEVEL >= 5) { ALOGE("V/" __VA_ARGS__); } \
-else if (loc_logger.DEBUG_LEVEL <= 0) { ALOGV("W/" __VA_ARGS__); }
+do { if (LOC_LOG_UNLIKELY(LOC_LOG_ON(5))) { \
+   if (loc_logger.DEBUG_LEVEL >= 5) { LOC_LOG_OUT(ALOGE, ANDROID_LOG_ERROR, "V/" __VA_ARGS__) } \
+   else { LOC_LOG_OUT(ALOGV, ANDROID_LOG_VERBOSE, "W/" __VA_ARGS__) } } } while (0)
 
 #else /* DEBUG_DMN_LOC_API */
 
+#define LOC_LOG_ON(level) (LOC_LOG_MAX_LEVEL >= (level))
+
 #define LOC_LOGE(...) ALOGE("E/" __VA_ARGS__)
 
-#define LOC_LOGW(...) ALOGW("W/" __VA_ARGS__)
+#define LOC_LOGW(...) do { if (LOC_LOG_ON(2)) { ALOGW("W/" __VA_ARGS__); } } while (0)
 
-#define LOC_LOGI(...) ALOGI("I/" __VA_ARGS__)
+#define LOC_LOGI(...) do { if (LOC_LOG_ON(3)) { ALOGI("I/" __VA_ARGS__); } } while (0)
 
-#define LOC_LOGD(...) ALOGD("D/" __VA_ARGS__)
+#define LOC_LOGD(...) do { if (LOC_LOG_ON(4)) { ALOGD("D/" __VA_ARGS__); } } while (0)
 
-#define LOC_LOGV(...) ALOGV("V/" __VA_ARGS__)
+#define LOC_LOGV(...) do { if (LOC_LOG_ON(5)) { ALOGV("V/" __VA_ARGS__); } } while (0)
 
 #endif /* DEBUG_DMN_LOC_API */
 
@@ -115,9 +143,10 @@ else if (loc_logger.DEBUG_LEVEL <= 0) { ALOGV("W/" __VA_ARGS__); }
  *                          LOGGING IMPROVEMENT MACROS
  *
  *============================================================================*/
-#define LOG_(LOC_LOG, ID, WHAT, SPEC, VAL)                                    \
+#define LOG_(LOC_LOG, LEVEL, ID, WHAT, SPEC, VAL)                             \
     do {                                                                      \
-        if (loc_logger.TIMESTAMP) {                                           \
+        if (!LOC_LOG_ON(LEVEL)) {                                             \
+        } else if (loc_logger.TIMESTAMP) {                                    \
             char ts[32];                                                      \
             LOC_LOG("[%s] %s %s line %d " #SPEC,                              \
                      get_timestamp(ts, sizeof(ts)), ID, WHAT, __LINE__, VAL); \
@@ -128,8 +157,8 @@ else if (loc_logger.DEBUG_LEVEL <= 0) { ALOGV("W/" __VA_ARGS__); }
     } while(0)
 
 
-#define LOG_I(ID, WHAT, SPEC, VAL) LOG_(LOC_LOGI, ID, WHAT, SPEC, VAL)
-#define LOG_V(ID, WHAT, SPEC, VAL) LOG_(LOC_LOGV, ID, WHAT, SPEC, VAL)
+#define LOG_I(ID, WHAT, SPEC, VAL) LOG_(LOC_LOGI, 3, ID, WHAT, SPEC, VAL)
+#define LOG_V(ID, WHAT, SPEC, VAL) LOG_(LOC_LOGV, 5, ID, WHAT, SPEC, VAL)
 
 #define ENTRY_LOG() LOG_V(ENTRY_TAG, __func__, %s, "")
 #define EXIT_LOG(SPEC, VAL) LOG_V(EXIT_TAG, __func__, SPEC, VAL)
@@ -34,12 +34,61 @@
 #include "linked_list.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
 #include <pthread.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#define MSG_Q_RING_MIN_CAPACITY 2
+#define MSG_Q_RING_MAX_CAPACITY (1 << 16)
+#define MSG_Q_COALESCE_SLOTS 8
+
+typedef struct msg_q_ring_slot {
+   uint32_t seq;                    /* Position this slot is ready for */
+   void* data_ptr;
+   void (*dealloc_func)(void*);
+   uint64_t sent_ns;                /* msg_q_now_ns() when the message was queued */
+} msg_q_ring_slot;
+
+typedef struct msg_q_ring {
+   msg_q_ring_slot* slots;          /* Preallocated slots, power of two long */
+   uint32_t mask;                   /* Number of slots - 1 */
+   uint32_t enqueue_pos;            /* Next position claimed by a producer */
+   uint32_t dequeue_pos;            /* Next position read by the consumer */
+} msg_q_ring;
+
+typedef struct msg_q_coalesce_slot {
+   msg_q_coalesce_key_type key;
+   void* elem_handle;               /* Element holding the msg, NULL if slot is free */
+   void* data_ptr;
+   void (*dealloc_func)(void*);
+   int lane;
+   /* Queued msg of key.needs_id this one builds on, which goes with it;
+      elem handle NULL if none or already received */
+   void* pinned_handle;
+   void* pinned_data;
+   void (*pinned_dealloc)(void*);
+} msg_q_coalesce_slot;
 
 typedef struct msg_q {
-   void* msg_list;                  /* Linked list to store information */
+   msg_q_backend_type backend;      /* Storage used by this message queue */
+   void* msg_list[eMSG_Q_LANE_MAX]; /* Linked list to store information, per lane */
+   uint32_t list_depth[eMSG_Q_LANE_MAX]; /* Messages in each list, also read without the lock */
    pthread_cond_t  list_cond;       /* Condition variable for waiting on msg queue */
    pthread_mutex_t list_mutex;      /* Mutex for exclusive access to message queue */
+   msg_q_ring ring[eMSG_Q_LANE_MAX]; /* Lock-free storage for eMSG_Q_BACKEND_RING */
+   int futex_word;                  /* Bumped by ring producers to wake waiters */
+   int sleepers;                    /* Number of ring consumers parked on futex_word */
+   int space_word;                  /* Bumped by ring consumers to wake blocked senders */
+   int space_waiters;               /* Number of ring producers parked on space_word */
+   uint32_t sent[eMSG_Q_LANE_MAX];  /* Messages accepted by each lane */
+   msg_q_lane_type (*lane_func)(void*); /* Picks the lane for msg_q_snd */
+   msg_q_coalesce_type (*coalesce_func)(void*, msg_q_coalesce_key_type*);
+   msg_q_coalesce_slot coalesce[MSG_Q_COALESCE_SLOTS]; /* Replaceable msgs still queued */
+   uint32_t coalesced[eMSG_Q_LANE_MAX]; /* Messages dropped by coalescing */
    int unblocked;                   /* Has this message queue been unblocked? */
 } msg_q;
 
@@ -82,6 +131,884 @@ static msq_q_err_type convert_linked_list_err_type(linked_list_err_type linked_l
    }
 }
 
+/*===========================================================================
+FUNCTION    msg_q_futex
+
+DESCRIPTION
+   Thin wrapper around the futex system call, which has no libc entry point.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Result of the system call.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int msg_q_futex(int* uaddr, int op, int val)
+{
+   return syscall(__NR_futex, uaddr, op, val, NULL, NULL, 0);
+}
+
+/*===========================================================================
+FUNCTION    msg_q_futex_wait_until
+
+DESCRIPTION
+   Waits on a futex word until it is woken, the word no longer holds val, or
+   the absolute CLOCK_MONOTONIC deadline passes. A NULL deadline waits
+   forever.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   0 when woken, -1 with errno set otherwise (ETIMEDOUT on deadline).
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int msg_q_futex_wait_until(int* uaddr, int val, const struct timespec* deadline)
+{
+   /* FUTEX_WAIT_BITSET takes an absolute CLOCK_MONOTONIC timeout */
+   return syscall(__NR_futex, uaddr, FUTEX_WAIT_BITSET_PRIVATE, val, deadline,
+                  NULL, FUTEX_BITSET_MATCH_ANY);
+}
+
+/*===========================================================================
+FUNCTION    msg_q_now_ns
+
+DESCRIPTION
+   CLOCK_MONOTONIC time in nanoseconds, as every message is stamped with
+   when it is queued.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Current time in nanoseconds.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static inline uint64_t msg_q_now_ns(void)
+{
+   struct timespec now;
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/*===========================================================================
+FUNCTION    msg_q_deadline
+
+DESCRIPTION
+   Converts a relative timeout into an absolute CLOCK_MONOTONIC deadline.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void msg_q_deadline(struct timespec* deadline, uint64_t timeout_ns)
+{
+   clock_gettime(CLOCK_MONOTONIC, deadline);
+   deadline->tv_sec += timeout_ns / 1000000000ULL;
+   deadline->tv_nsec += timeout_ns % 1000000000ULL;
+   if( deadline->tv_nsec >= 1000000000L )
+   {
+      deadline->tv_sec++;
+      deadline->tv_nsec -= 1000000000L;
+   }
+}
+
+/*===========================================================================
+FUNCTION    msg_q_ring_init
+
+DESCRIPTION
+   Allocates the slots of a ring and marks each of them free for the first
+   lap. This is the only allocation the ring backend ever does.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   0 on success, -1 if memory could not be allocated.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int msg_q_ring_init(msg_q_ring* ring, uint32_t capacity)
+{
+   uint32_t size = MSG_Q_RING_MIN_CAPACITY;
+   uint32_t i;
+
+   while( size < capacity && size < MSG_Q_RING_MAX_CAPACITY )
+   {
+      size <<= 1;
+   }
+
+   ring->slots = (msg_q_ring_slot*)calloc(size, sizeof(msg_q_ring_slot));
+   if( ring->slots == NULL )
+   {
+      return -1;
+   }
+
+   for( i = 0; i < size; i++ )
+   {
+      ring->slots[i].seq = i;
+   }
+
+   ring->mask = size - 1;
+   ring->enqueue_pos = 0;
+   ring->dequeue_pos = 0;
+
+   return 0;
+}
+
+/*===========================================================================
+FUNCTION    msg_q_ring_push
+
+DESCRIPTION
+   Claims the next free slot with a compare-and-swap on the enqueue position
+   and publishes the message into it. Safe to call from any number of
+   producers concurrently.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   1 if the message was stored, 0 if the ring is full.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int msg_q_ring_push(msg_q_ring* ring, void* msg_obj, void (*dealloc)(void*))
+{
+   uint32_t pos = __atomic_load_n(&ring->enqueue_pos, __ATOMIC_RELAXED);
+
+   for( ;; )
+   {
+      msg_q_ring_slot* slot = &ring->slots[pos & ring->mask];
+      uint32_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+      int32_t diff = (int32_t)(seq - pos);
+
+      if( diff == 0 )
+      {
+         if( __atomic_compare_exchange_n(&ring->enqueue_pos, &pos, pos + 1, 1,
+                                         __ATOMIC_RELAXED, __ATOMIC_RELAXED) )
+         {
+            slot->data_ptr = msg_obj;
+            slot->dealloc_func = dealloc;
+            slot->sent_ns = msg_q_now_ns();
+            __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+            return 1;
+         }
+         /* pos was reloaded by the failed compare-and-swap */
+      }
+      else if( diff < 0 )
+      {
+         /* Slot still holds a message from the previous lap */
+         return 0;
+      }
+      else
+      {
+         pos = __atomic_load_n(&ring->enqueue_pos, __ATOMIC_RELAXED);
+      }
+   }
+}
+
+/*===========================================================================
+FUNCTION    msg_q_ring_pop
+
+DESCRIPTION
+   Takes the oldest published message out of the ring and hands its slot
+   back to the producers for the next lap. dealloc and sent_ns may be NULL.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   1 if a message was retrieved, 0 if the ring is empty.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int msg_q_ring_pop(msg_q_ring* ring, void** msg_obj, void (**dealloc)(void*),
+                          uint64_t* sent_ns)
+{
+   uint32_t pos = __atomic_load_n(&ring->dequeue_pos, __ATOMIC_RELAXED);
+
+   for( ;; )
+   {
+      msg_q_ring_slot* slot = &ring->slots[pos & ring->mask];
+      uint32_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+      int32_t diff = (int32_t)(seq - (pos + 1));
+
+      if( diff == 0 )
+      {
+         /* Normally uncontended, but keeps msg_q_flush() safe against the consumer */
+         if( __atomic_compare_exchange_n(&ring->dequeue_pos, &pos, pos + 1, 1,
+                                         __ATOMIC_RELAXED, __ATOMIC_RELAXED) )
+         {
+            *msg_obj = slot->data_ptr;
+            if( dealloc != NULL )
+            {
+               *dealloc = slot->dealloc_func;
+            }
+            if( sent_ns != NULL )
+            {
+               *sent_ns = slot->sent_ns;
+            }
+            __atomic_store_n(&slot->seq, pos + ring->mask + 1, __ATOMIC_RELEASE);
+            return 1;
+         }
+      }
+      else if( diff < 0 )
+      {
+         return 0;
+      }
+      else
+      {
+         pos = __atomic_load_n(&ring->dequeue_pos, __ATOMIC_RELAXED);
+      }
+   }
+}
+
+/*===========================================================================
+FUNCTION    msg_q_ring_pop_lanes
+
+DESCRIPTION
+   Takes the oldest message of the highest priority non-empty lane, and
+   stores that lane into msg_lane unless it is NULL.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   1 if a message was retrieved, 0 if every lane is empty.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int msg_q_ring_pop_lanes(msg_q* p_msg_q, void** msg_obj, void (**dealloc)(void*),
+                                uint64_t* sent_ns, int* msg_lane)
+{
+   int lane;
+
+   for( lane = 0; lane < eMSG_Q_LANE_MAX; lane++ )
+   {
+      if( msg_q_ring_pop(&p_msg_q->ring[lane], msg_obj, dealloc, sent_ns) )
+      {
+         if( msg_lane != NULL )
+         {
+            *msg_lane = lane;
+         }
+         return 1;
+      }
+   }
+
+   return 0;
+}
+
+/*===========================================================================
+FUNCTION    msg_q_ring_wake
+
+DESCRIPTION
+   Wakes consumers parked in msg_q_ring_rcv. Producers only pay for the
+   system call when somebody is actually sleeping.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void msg_q_ring_wake(msg_q* p_msg_q, int all)
+{
+   /* Order the slot publication before the sleepers check */
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+   if( all || __atomic_load_n(&p_msg_q->sleepers, __ATOMIC_SEQ_CST) > 0 )
+   {
+      __atomic_add_fetch(&p_msg_q->futex_word, 1, __ATOMIC_SEQ_CST);
+      msg_q_futex(&p_msg_q->futex_word, FUTEX_WAKE_PRIVATE, all ? INT_MAX : 1);
+   }
+}
+
+/*===========================================================================
+FUNCTION    msg_q_ring_space_wake
+
+DESCRIPTION
+   Wakes producers parked in msg_q_snd_wait on a full lane. Consumers only
+   pay for the system call when somebody is actually waiting for room.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void msg_q_ring_space_wake(msg_q* p_msg_q, int all)
+{
+   /* Order the slot release before the space_waiters check */
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+   if( all || __atomic_load_n(&p_msg_q->space_waiters, __ATOMIC_SEQ_CST) > 0 )
+   {
+      __atomic_add_fetch(&p_msg_q->space_word, 1, __ATOMIC_SEQ_CST);
+      /* Waiters may be blocked on different lanes, let them all retry */
+      msg_q_futex(&p_msg_q->space_word, FUTEX_WAKE_PRIVATE, INT_MAX);
+   }
+}
+
+/*===========================================================================
+FUNCTION    msg_q_ring_rcv
+
+DESCRIPTION
+   Receive for the ring backend. The consumer announces itself in sleepers
+   before re-checking the ring, so a producer publishing in between either
+   is seen by the re-check or bumps futex_word and makes FUTEX_WAIT return
+   immediately.
+
+   timeout_ns: < 0 waits forever, 0 never waits, > 0 waits at most that long.
+   msg_lane:   If not NULL, receives the lane the message came from.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static msq_q_err_type msg_q_ring_rcv(msg_q* p_msg_q, void** msg_obj, uint64_t* sent_ns,
+                                     int64_t timeout_ns, int* msg_lane)
+{
+   struct timespec deadline;
+
+   if( timeout_ns > 0 )
+   {
+      msg_q_deadline(&deadline, (uint64_t)timeout_ns);
+   }
+
+   for( ;; )
+   {
+      if( __atomic_load_n(&p_msg_q->unblocked, __ATOMIC_ACQUIRE) )
+      {
+         LOC_LOGE("%s: Message queue has been unblocked.\n", __FUNCTION__);
+         return eMSG_Q_UNAVAILABLE_RESOURCE;
+      }
+
+      if( msg_q_ring_pop_lanes(p_msg_q, msg_obj, NULL, sent_ns, msg_lane) )
+      {
+         return eMSG_Q_SUCCESS;
+      }
+
+      if( timeout_ns == 0 )
+      {
+         return eMSG_Q_TIMEOUT;
+      }
+
+      int word = __atomic_load_n(&p_msg_q->futex_word, __ATOMIC_SEQ_CST);
+      __atomic_add_fetch(&p_msg_q->sleepers, 1, __ATOMIC_SEQ_CST);
+
+      if( !msg_q_ring_pop_lanes(p_msg_q, msg_obj, NULL, sent_ns, msg_lane) )
+      {
+         int timed_out = 0;
+         if( !__atomic_load_n(&p_msg_q->unblocked, __ATOMIC_SEQ_CST) )
+         {
+            timed_out = msg_q_futex_wait_until(&p_msg_q->futex_word, word,
+                                               timeout_ns > 0 ? &deadline : NULL) != 0 &&
+                        errno == ETIMEDOUT;
+         }
+         __atomic_sub_fetch(&p_msg_q->sleepers, 1, __ATOMIC_SEQ_CST);
+
+         if( timed_out )
+         {
+            /* Last look, a message may have landed right at the deadline */
+            return msg_q_ring_pop_lanes(p_msg_q, msg_obj, NULL, sent_ns, msg_lane) ? eMSG_Q_SUCCESS : eMSG_Q_TIMEOUT;
+         }
+         continue;
+      }
+
+      __atomic_sub_fetch(&p_msg_q->sleepers, 1, __ATOMIC_SEQ_CST);
+      return eMSG_Q_SUCCESS;
+   }
+}
+
+/*===========================================================================
+FUNCTION    msg_q_ring_flush
+
+DESCRIPTION
+   Drains the ring, deallocating messages as requested by their senders.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void msg_q_ring_flush(msg_q_ring* ring)
+{
+   void* msg_obj;
+   void (*dealloc)(void*);
+
+   while( msg_q_ring_pop(ring, &msg_obj, &dealloc, NULL) )
+   {
+      if( dealloc != NULL )
+      {
+         dealloc(msg_obj);
+      }
+   }
+}
+
+/*===========================================================================
+FUNCTION    msg_q_list_empty
+
+DESCRIPTION
+   Tells whether every lane of a list backed queue is empty. Must be called
+   with list_mutex held.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   1 if the queue is empty, 0 otherwise.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static int msg_q_list_empty(msg_q* p_msg_q)
+{
+   int lane;
+
+   for( lane = 0; lane < eMSG_Q_LANE_MAX; lane++ )
+   {
+      if( p_msg_q->list_depth[lane] > 0 )
+      {
+         return 0;
+      }
+   }
+
+   return 1;
+}
+
+/*===========================================================================
+FUNCTION    msg_q_coalesce_find
+
+DESCRIPTION
+   Looks up the queued replaceable message of a lane matching key. Must be
+   called with list_mutex held.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   The slot tracking the message, NULL if there is none.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static msg_q_coalesce_slot* msg_q_coalesce_find(msg_q* p_msg_q,
+                                                const msg_q_coalesce_key_type* key, int lane)
+{
+   int i;
+
+   for( i = 0; i < MSG_Q_COALESCE_SLOTS; i++ )
+   {
+      msg_q_coalesce_slot* slot = &p_msg_q->coalesce[i];
+      if( slot->elem_handle != NULL && slot->lane == lane &&
+          slot->key.owner == key->owner && slot->key.id == key->id )
+      {
+         return slot;
+      }
+   }
+
+   return NULL;
+}
+
+/*===========================================================================
+FUNCTION    msg_q_coalesce_track
+
+DESCRIPTION
+   Remembers a freshly queued replaceable message. If every slot is taken
+   the message is simply not replaceable. Must be called with list_mutex
+   held.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void msg_q_coalesce_track(msg_q* p_msg_q, const msg_q_coalesce_key_type* key,
+                                 int lane, void* elem_handle, void* data_ptr,
+                                 void (*dealloc)(void*))
+{
+   void* pinned_handle = NULL;
+   void* pinned_data = NULL;
+   void (*pinned_dealloc)(void*) = NULL;
+   int i;
+
+   /* The msg this one builds on must not be replaced from behind it; it
+      goes along with this one instead */
+   for( i = 0; i < MSG_Q_COALESCE_SLOTS && key->needs_id != -1; i++ )
+   {
+      msg_q_coalesce_slot* slot = &p_msg_q->coalesce[i];
+      if( slot->elem_handle != NULL && slot->lane == lane &&
+          slot->key.owner == key->owner && slot->key.id == key->needs_id )
+      {
+         pinned_handle = slot->elem_handle;
+         pinned_data = slot->data_ptr;
+         pinned_dealloc = slot->dealloc_func;
+         slot->elem_handle = NULL;
+      }
+   }
+
+   for( i = 0; i < MSG_Q_COALESCE_SLOTS; i++ )
+   {
+      msg_q_coalesce_slot* slot = &p_msg_q->coalesce[i];
+      if( slot->elem_handle == NULL )
+      {
+         slot->key = *key;
+         slot->elem_handle = elem_handle;
+         slot->data_ptr = data_ptr;
+         slot->dealloc_func = dealloc;
+         slot->lane = lane;
+         slot->pinned_handle = pinned_handle;
+         slot->pinned_data = pinned_data;
+         slot->pinned_dealloc = pinned_dealloc;
+         return;
+      }
+   }
+}
+
+/*===========================================================================
+FUNCTION    msg_q_coalesce_forget
+
+DESCRIPTION
+   Stops tracking the replaceable messages of a lane; all of them if
+   data_ptr is NULL, otherwise only the one holding data_ptr, be it tracked
+   or pinned. Must be called with list_mutex held.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void msg_q_coalesce_forget(msg_q* p_msg_q, int lane, void* data_ptr)
+{
+   int i;
+
+   for( i = 0; i < MSG_Q_COALESCE_SLOTS; i++ )
+   {
+      msg_q_coalesce_slot* slot = &p_msg_q->coalesce[i];
+      if( slot->elem_handle != NULL && slot->lane == lane )
+      {
+         if( data_ptr == NULL || slot->data_ptr == data_ptr )
+         {
+            slot->elem_handle = NULL;
+         }
+         else if( slot->pinned_handle != NULL && slot->pinned_data == data_ptr )
+         {
+            slot->pinned_handle = NULL;
+         }
+      }
+   }
+}
+
+/*===========================================================================
+FUNCTION    msg_q_list_depth_add
+
+DESCRIPTION
+   Changes the depth of one lane of a list backed queue. The depth is
+   written atomically so that msg_q_try_rcv_lane can find an empty lane
+   without taking list_mutex. Must be called with list_mutex held.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static inline void msg_q_list_depth_add(msg_q* p_msg_q, int lane, int delta)
+{
+   __atomic_store_n(&p_msg_q->list_depth[lane], p_msg_q->list_depth[lane] + delta,
+                    __ATOMIC_RELAXED);
+}
+
+/*===========================================================================
+FUNCTION    msg_q_list_remove
+
+DESCRIPTION
+   Removes the oldest message of one lane of a list backed queue. Must be
+   called with list_mutex held.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at linked list error codes.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static linked_list_err_type msg_q_list_remove_lane(msg_q* p_msg_q, int lane, void** msg_obj,
+                                                   uint64_t* sent_ns)
+{
+   if( p_msg_q->list_depth[lane] == 0 )
+   {
+      return eLINKED_LIST_UNAVAILABLE_RESOURCE;
+   }
+
+   msg_q_list_depth_add(p_msg_q, lane, -1);
+   linked_list_err_type rv = linked_list_remove2(p_msg_q->msg_list[lane], msg_obj, sent_ns);
+   if( rv == eLINKED_LIST_SUCCESS )
+   {
+      /* Its element is recycled, so it can no longer be replaced */
+      msg_q_coalesce_forget(p_msg_q, lane, *msg_obj);
+   }
+   return rv;
+}
+
+/*===========================================================================
+FUNCTION    msg_q_list_remove
+
+DESCRIPTION
+   Removes the oldest message of the highest priority non-empty lane of a
+   list backed queue, and stores that lane into msg_lane unless it is NULL.
+   Must be called with list_mutex held.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at linked list error codes.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static linked_list_err_type msg_q_list_remove(msg_q* p_msg_q, void** msg_obj, uint64_t* sent_ns,
+                                              int* msg_lane)
+{
+   int lane;
+
+   for( lane = 0; lane < eMSG_Q_LANE_MAX; lane++ )
+   {
+      if( p_msg_q->list_depth[lane] > 0 )
+      {
+         if( msg_lane != NULL )
+         {
+            *msg_lane = lane;
+         }
+         return msg_q_list_remove_lane(p_msg_q, lane, msg_obj, sent_ns);
+      }
+   }
+
+   return eLINKED_LIST_UNAVAILABLE_RESOURCE;
+}
+
+/*===========================================================================
+FUNCTION    msg_q_list_destroy
+
+DESCRIPTION
+   Releases the lane lists of a list backed queue.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void msg_q_list_destroy(msg_q* p_msg_q)
+{
+   int lane;
+
+   for( lane = 0; lane < eMSG_Q_LANE_MAX; lane++ )
+   {
+      if( p_msg_q->msg_list[lane] != NULL )
+      {
+         linked_list_destroy(&p_msg_q->msg_list[lane]);
+      }
+   }
+}
+
+/*===========================================================================
+FUNCTION    msg_q_ring_destroy
+
+DESCRIPTION
+   Releases the lane rings of a ring backed queue, deallocating the messages
+   still in them.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   None
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static void msg_q_ring_destroy(msg_q* p_msg_q)
+{
+   int lane;
+
+   for( lane = 0; lane < eMSG_Q_LANE_MAX; lane++ )
+   {
+      if( p_msg_q->ring[lane].slots != NULL )
+      {
+         msg_q_ring_flush(&p_msg_q->ring[lane]);
+         free(p_msg_q->ring[lane].slots);
+         p_msg_q->ring[lane].slots = NULL;
+      }
+   }
+}
+
+/*===========================================================================
+FUNCTION    msg_q_rcv_timeout
+
+DESCRIPTION
+   Common implementation of msg_q_rcv, msg_q_try_rcv and msg_q_timed_rcv.
+
+   timeout_ns: < 0 waits forever, 0 never waits, > 0 waits at most that long.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+static msq_q_err_type msg_q_rcv_timeout(void* msg_q_data, void** msg_obj, int64_t timeout_ns)
+{
+   msq_q_err_type rv;
+   if( msg_q_data == NULL )
+   {
+      LOC_LOGE("%s: Invalid msg_q_data parameter!\n", __FUNCTION__);
+      return eMSG_Q_INVALID_HANDLE;
+   }
+
+   if( msg_obj == NULL )
+   {
+      LOC_LOGE("%s: Invalid msg_obj parameter!\n", __FUNCTION__);
+      return eMSG_Q_INVALID_PARAMETER;
+   }
+
+   msg_q* p_msg_q = (msg_q*)msg_q_data;
+
+   LOC_LOGD("%s: Waiting on message\n", __FUNCTION__);
+
+   if( p_msg_q->backend == eMSG_Q_BACKEND_RING )
+   {
+      rv = msg_q_ring_rcv(p_msg_q, msg_obj, NULL, timeout_ns, NULL);
+      if( rv == eMSG_Q_SUCCESS )
+      {
+         msg_q_ring_space_wake(p_msg_q, 0);
+      }
+
+      LOC_LOGD("%s: Received message 0x%08X rv = %d\n", __FUNCTION__, *msg_obj, rv);
+
+      return rv;
+   }
+
+   pthread_mutex_lock(&p_msg_q->list_mutex);
+
+   if( p_msg_q->unblocked )
+   {
+      LOC_LOGE("%s: Message queue has been unblocked.\n", __FUNCTION__);
+      pthread_mutex_unlock(&p_msg_q->list_mutex);
+      return eMSG_Q_UNAVAILABLE_RESOURCE;
+   }
+
+   struct timespec deadline;
+   int timed_out = (timeout_ns == 0);
+
+   if( timeout_ns > 0 )
+   {
+      msg_q_deadline(&deadline, (uint64_t)timeout_ns);
+   }
+
+   /* Wait for data in the message queue */
+   while( msg_q_list_empty(p_msg_q) && !p_msg_q->unblocked && !timed_out )
+   {
+      if( timeout_ns < 0 )
+      {
+         pthread_cond_wait(&p_msg_q->list_cond, &p_msg_q->list_mutex);
+      }
+      else
+      {
+         timed_out = pthread_cond_timedwait(&p_msg_q->list_cond, &p_msg_q->list_mutex,
+                                            &deadline) == ETIMEDOUT;
+      }
+   }
+
+   if( timed_out && !p_msg_q->unblocked && msg_q_list_empty(p_msg_q) )
+   {
+      rv = eMSG_Q_TIMEOUT;
+   }
+   else
+   {
+      rv = convert_linked_list_err_type(msg_q_list_remove(p_msg_q, msg_obj, NULL, NULL));
+   }
+
+   pthread_mutex_unlock(&p_msg_q->list_mutex);
+
+   LOC_LOGD("%s: Received message 0x%08X rv = %d\n", __FUNCTION__, *msg_obj, rv);
+
+   return rv;
+}
+
 /* ----------------------- END INTERNAL FUNCTIONS ---------------------------------------- */
 
 /*===========================================================================
@@ -90,6 +1017,17 @@ static msq_q_err_type convert_linked_list_err_type(linked_list_err_type linked_l
 
   ===========================================================================*/
 msq_q_err_type msg_q_init(void** msg_q_data)
+{
+   return msg_q_init2(msg_q_data, eMSG_Q_BACKEND_LIST, 0);
+}
+
+/*===========================================================================
+
+  FUNCTION:   msg_q_init2
+
+  ===========================================================================*/
+msq_q_err_type msg_q_init2(void** msg_q_data, msg_q_backend_type backend,
+                           uint32_t capacity)
 {
    if( msg_q_data == NULL )
    {
@@ -97,7 +1035,14 @@ msq_q_err_type msg_q_init(void** msg_q_data)
       return eMSG_Q_INVALID_PARAMETER;
    }
 
+   if( backend != eMSG_Q_BACKEND_LIST && backend != eMSG_Q_BACKEND_RING )
+   {
+      LOC_LOGE("%s: Invalid backend %d!\n", __FUNCTION__, backend);
+      return eMSG_Q_INVALID_PARAMETER;
+   }
+
    msg_q* tmp_msg_q;
+   int lane;
    tmp_msg_q = (msg_q*)calloc(1, sizeof(msg_q));
    if( tmp_msg_q == NULL )
    {
@@ -105,25 +1050,59 @@ msq_q_err_type msg_q_init(void** msg_q_data)
       return eMSG_Q_FAILURE_GENERAL;
    }
 
-   if( linked_list_init(&tmp_msg_q->msg_list) != 0 )
+   tmp_msg_q->backend = backend;
+
+   if( backend == eMSG_Q_BACKEND_RING )
+   {
+      for( lane = 0; lane < eMSG_Q_LANE_MAX; lane++ )
+      {
+         if( msg_q_ring_init(&tmp_msg_q->ring[lane], capacity) != 0 )
+         {
+            LOC_LOGE("%s: Unable to allocate ring of %u slots!\n", __FUNCTION__, capacity);
+            msg_q_ring_destroy(tmp_msg_q);
+            free(tmp_msg_q);
+            return eMSG_Q_FAILURE_GENERAL;
+         }
+      }
+
+      tmp_msg_q->unblocked = 0;
+
+      *msg_q_data = tmp_msg_q;
+
+      return eMSG_Q_SUCCESS;
+   }
+
+   for( lane = 0; lane < eMSG_Q_LANE_MAX; lane++ )
    {
-      LOC_LOGE("%s: Unable to initialize storage list!\n", __FUNCTION__);
-      free(tmp_msg_q);
-      return eMSG_Q_FAILURE_GENERAL;
+      if( linked_list_init2(&tmp_msg_q->msg_list[lane], capacity) != 0 )
+      {
+         LOC_LOGE("%s: Unable to initialize storage list!\n", __FUNCTION__);
+         msg_q_list_destroy(tmp_msg_q);
+         free(tmp_msg_q);
+         return eMSG_Q_FAILURE_GENERAL;
+      }
    }
 
    if( pthread_mutex_init(&tmp_msg_q->list_mutex, NULL) != 0 )
    {
       LOC_LOGE("%s: Unable to initialize list mutex!\n", __FUNCTION__);
-      linked_list_destroy(&tmp_msg_q->msg_list);
+      msg_q_list_destroy(tmp_msg_q);
       free(tmp_msg_q);
       return eMSG_Q_FAILURE_GENERAL;
    }
 
-   if( pthread_cond_init(&tmp_msg_q->list_cond, NULL) != 0 )
+   /* Timed receives must not be disturbed by wall clock changes */
+   pthread_condattr_t cond_attr;
+   pthread_condattr_init(&cond_attr);
+   pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+
+   int cond_rv = pthread_cond_init(&tmp_msg_q->list_cond, &cond_attr);
+   pthread_condattr_destroy(&cond_attr);
+
+   if( cond_rv != 0 )
    {
       LOC_LOGE("%s: Unable to initialize msg q cond var!\n", __FUNCTION__);
-      linked_list_destroy(&tmp_msg_q->msg_list);
+      msg_q_list_destroy(tmp_msg_q);
       pthread_mutex_destroy(&tmp_msg_q->list_mutex);
       free(tmp_msg_q);
       return eMSG_Q_FAILURE_GENERAL;
@@ -151,9 +1130,16 @@ msq_q_err_type msg_q_destroy(void** msg_q_data)
 
    msg_q* p_msg_q = (msg_q*)*msg_q_data;
 
-   linked_list_destroy(&p_msg_q->msg_list);
-   pthread_mutex_destroy(&p_msg_q->list_mutex);
-   pthread_cond_destroy(&p_msg_q->list_cond);
+   if( p_msg_q->backend == eMSG_Q_BACKEND_RING )
+   {
+      msg_q_ring_destroy(p_msg_q);
+   }
+   else
+   {
+      msg_q_list_destroy(p_msg_q);
+      pthread_mutex_destroy(&p_msg_q->list_mutex);
+      pthread_cond_destroy(&p_msg_q->list_cond);
+   }
 
    p_msg_q->unblocked = 0;
 
@@ -169,6 +1155,36 @@ msq_q_err_type msg_q_destroy(void** msg_q_data)
 
   ===========================================================================*/
 msq_q_err_type msg_q_snd(void* msg_q_data, void* msg_obj, void (*dealloc)(void*))
+{
+   if( msg_q_data == NULL )
+   {
+      LOC_LOGE("%s: Invalid msg_q_data parameter!\n", __FUNCTION__);
+      return eMSG_Q_INVALID_HANDLE;
+   }
+   if( msg_obj == NULL )
+   {
+      LOC_LOGE("%s: Invalid msg_obj parameter!\n", __FUNCTION__);
+      return eMSG_Q_INVALID_PARAMETER;
+   }
+
+   msg_q* p_msg_q = (msg_q*)msg_q_data;
+   msg_q_lane_type lane = eMSG_Q_LANE_NORMAL;
+
+   if( p_msg_q->lane_func != NULL )
+   {
+      lane = p_msg_q->lane_func(msg_obj);
+   }
+
+   return msg_q_snd_lane(msg_q_data, msg_obj, dealloc, lane);
+}
+
+/*===========================================================================
+
+  FUNCTION:   msg_q_snd_lane
+
+  ===========================================================================*/
+msq_q_err_type msg_q_snd_lane(void* msg_q_data, void* msg_obj, void (*dealloc)(void*),
+                              msg_q_lane_type lane)
 {
    msq_q_err_type rv;
    if( msg_q_data == NULL )
@@ -181,9 +1197,39 @@ msq_q_err_type msg_q_snd(void* msg_q_data, void* msg_obj, void (*dealloc)(void*)
       LOC_LOGE("%s: Invalid msg_obj parameter!\n", __FUNCTION__);
       return eMSG_Q_INVALID_PARAMETER;
    }
+   if( lane < eMSG_Q_LANE_HIGH || lane >= eMSG_Q_LANE_MAX )
+   {
+      LOC_LOGE("%s: Invalid lane %d!\n", __FUNCTION__, lane);
+      return eMSG_Q_INVALID_PARAMETER;
+   }
 
    msg_q* p_msg_q = (msg_q*)msg_q_data;
 
+   if( p_msg_q->backend == eMSG_Q_BACKEND_RING )
+   {
+      LOC_LOGD("%s: Sending message with handle = 0x%08X\n", __FUNCTION__, msg_obj);
+
+      if( __atomic_load_n(&p_msg_q->unblocked, __ATOMIC_ACQUIRE) )
+      {
+         LOC_LOGE("%s: Message queue has been unblocked.\n", __FUNCTION__);
+         return eMSG_Q_UNAVAILABLE_RESOURCE;
+      }
+
+      if( !msg_q_ring_push(&p_msg_q->ring[lane], msg_obj, dealloc) )
+      {
+         LOC_LOGE("%s: Message queue lane %d is full.\n", __FUNCTION__, lane);
+         return eMSG_Q_UNAVAILABLE_RESOURCE;
+      }
+
+      __atomic_add_fetch(&p_msg_q->sent[lane], 1, __ATOMIC_RELAXED);
+
+      msg_q_ring_wake(p_msg_q, 0);
+
+      LOC_LOGD("%s: Finished Sending message with handle = 0x%08X\n", __FUNCTION__, msg_obj);
+
+      return eMSG_Q_SUCCESS;
+   }
+
    pthread_mutex_lock(&p_msg_q->list_mutex);
    LOC_LOGD("%s: Sending message with handle = 0x%08X\n", __FUNCTION__, msg_obj);
 
@@ -194,24 +1240,186 @@ msq_q_err_type msg_q_snd(void* msg_q_data, void* msg_obj, void (*dealloc)(void*)
       return eMSG_Q_UNAVAILABLE_RESOURCE;
    }
 
-   rv = convert_linked_list_err_type(linked_list_add(p_msg_q->msg_list, msg_obj, dealloc));
+   msg_q_coalesce_type coalesce = eMSG_Q_COALESCE_NONE;
+   msg_q_coalesce_key_type key;
+   void* elem_handle = NULL;
+   void* stale_obj[2] = { NULL, NULL };
+   void (*stale_dealloc[2])(void*) = { NULL, NULL };
+   int i;
+
+   if( p_msg_q->coalesce_func != NULL )
+   {
+      coalesce = p_msg_q->coalesce_func(msg_obj, &key);
+   }
+
+   if( coalesce == eMSG_Q_COALESCE_BARRIER )
+   {
+      /* Nothing queued before the barrier may jump over it */
+      msg_q_coalesce_forget(p_msg_q, lane, NULL);
+   }
+
+   rv = convert_linked_list_err_type(linked_list_add2(p_msg_q->msg_list[lane], msg_obj, dealloc,
+                                                      msg_q_now_ns(), &elem_handle));
+   if( rv == eMSG_Q_SUCCESS )
+   {
+      msg_q_list_depth_add(p_msg_q, lane, 1);
+      p_msg_q->sent[lane]++;
+
+      if( coalesce == eMSG_Q_COALESCE_REPLACE )
+      {
+         msg_q_coalesce_slot* slot = msg_q_coalesce_find(p_msg_q, &key, lane);
+         if( slot != NULL )
+         {
+            /* The new msg is queued at the back, so it stays behind
+               everything that came before it; the stale msg leaves its
+               place, along with what it pinned */
+            linked_list_remove_elem(p_msg_q->msg_list[lane], slot->elem_handle, &stale_obj[0]);
+            stale_dealloc[0] = slot->dealloc_func;
+            msg_q_list_depth_add(p_msg_q, lane, -1);
+            p_msg_q->coalesced[lane]++;
+            if( slot->pinned_handle != NULL )
+            {
+               linked_list_remove_elem(p_msg_q->msg_list[lane], slot->pinned_handle,
+                                       &stale_obj[1]);
+               stale_dealloc[1] = slot->pinned_dealloc;
+               msg_q_list_depth_add(p_msg_q, lane, -1);
+               p_msg_q->coalesced[lane]++;
+            }
+            slot->elem_handle = NULL;
+         }
+         msg_q_coalesce_track(p_msg_q, &key, lane, elem_handle, msg_obj, dealloc);
+      }
+   }
 
    /* Show data is in the message queue. */
    pthread_cond_signal(&p_msg_q->list_cond);
 
    pthread_mutex_unlock(&p_msg_q->list_mutex);
 
+   for( i = 0; i < 2; i++ )
+   {
+      if( stale_obj[i] != NULL )
+      {
+         LOC_LOGD("%s: Message 0x%08X replaced 0x%08X\n", __FUNCTION__, msg_obj, stale_obj[i]);
+         if( stale_dealloc[i] != NULL )
+         {
+            stale_dealloc[i](stale_obj[i]);
+         }
+      }
+   }
+
    LOC_LOGD("%s: Finished Sending message with handle = 0x%08X\n", __FUNCTION__, msg_obj);
 
    return rv;
 }
 
+/*===========================================================================
+
+  FUNCTION:   msg_q_snd_wait
+
+  ===========================================================================*/
+msq_q_err_type msg_q_snd_wait(void* msg_q_data, void* msg_obj, void (*dealloc)(void*))
+{
+   if( msg_q_data == NULL )
+   {
+      LOC_LOGE("%s: Invalid msg_q_data parameter!\n", __FUNCTION__);
+      return eMSG_Q_INVALID_HANDLE;
+   }
+   if( msg_obj == NULL )
+   {
+      LOC_LOGE("%s: Invalid msg_obj parameter!\n", __FUNCTION__);
+      return eMSG_Q_INVALID_PARAMETER;
+   }
+
+   msg_q* p_msg_q = (msg_q*)msg_q_data;
+
+   if( p_msg_q->backend != eMSG_Q_BACKEND_RING )
+   {
+      /* The lists grow as needed, nothing to wait for */
+      return msg_q_snd(msg_q_data, msg_obj, dealloc);
+   }
+
+   msg_q_lane_type lane = eMSG_Q_LANE_NORMAL;
+
+   if( p_msg_q->lane_func != NULL )
+   {
+      lane = p_msg_q->lane_func(msg_obj);
+   }
+   if( lane < eMSG_Q_LANE_HIGH || lane >= eMSG_Q_LANE_MAX )
+   {
+      LOC_LOGE("%s: Invalid lane %d!\n", __FUNCTION__, lane);
+      return eMSG_Q_INVALID_PARAMETER;
+   }
+
+   LOC_LOGD("%s: Sending message with handle = 0x%08X\n", __FUNCTION__, msg_obj);
+
+   for( ;; )
+   {
+      if( __atomic_load_n(&p_msg_q->unblocked, __ATOMIC_ACQUIRE) )
+      {
+         LOC_LOGE("%s: Message queue has been unblocked.\n", __FUNCTION__);
+         return eMSG_Q_UNAVAILABLE_RESOURCE;
+      }
+
+      int pushed = msg_q_ring_push(&p_msg_q->ring[lane], msg_obj, dealloc);
+
+      if( !pushed )
+      {
+         /* Same handshake as msg_q_ring_rcv: announce, re-check, then sleep */
+         int word = __atomic_load_n(&p_msg_q->space_word, __ATOMIC_SEQ_CST);
+         __atomic_add_fetch(&p_msg_q->space_waiters, 1, __ATOMIC_SEQ_CST);
+
+         pushed = msg_q_ring_push(&p_msg_q->ring[lane], msg_obj, dealloc);
+         if( !pushed && !__atomic_load_n(&p_msg_q->unblocked, __ATOMIC_SEQ_CST) )
+         {
+            LOC_LOGD("%s: Message queue lane %d is full, waiting\n", __FUNCTION__, lane);
+            msg_q_futex_wait_until(&p_msg_q->space_word, word, NULL);
+         }
+         __atomic_sub_fetch(&p_msg_q->space_waiters, 1, __ATOMIC_SEQ_CST);
+      }
+
+      if( pushed )
+      {
+         break;
+      }
+   }
+
+   __atomic_add_fetch(&p_msg_q->sent[lane], 1, __ATOMIC_RELAXED);
+
+   msg_q_ring_wake(p_msg_q, 0);
+
+   LOC_LOGD("%s: Finished Sending message with handle = 0x%08X\n", __FUNCTION__, msg_obj);
+
+   return eMSG_Q_SUCCESS;
+}
+
 /*===========================================================================
 
   FUNCTION:   msg_q_rcv
 
   ===========================================================================*/
 msq_q_err_type msg_q_rcv(void* msg_q_data, void** msg_obj)
+{
+   return msg_q_rcv_timeout(msg_q_data, msg_obj, -1);
+}
+
+/*===========================================================================
+
+  FUNCTION:   msg_q_try_rcv
+
+  ===========================================================================*/
+msq_q_err_type msg_q_try_rcv(void* msg_q_data, void** msg_obj)
+{
+   return msg_q_rcv_timeout(msg_q_data, msg_obj, 0);
+}
+
+/*===========================================================================
+
+  FUNCTION:   msg_q_try_rcv_lane
+
+  ===========================================================================*/
+msq_q_err_type msg_q_try_rcv_lane(void* msg_q_data, void** msg_obj, msg_q_lane_type lane,
+                                  uint64_t* sent_ns)
 {
    msq_q_err_type rv;
    if( msg_q_data == NULL )
@@ -220,15 +1428,119 @@ msq_q_err_type msg_q_rcv(void* msg_q_data, void** msg_obj)
       return eMSG_Q_INVALID_HANDLE;
    }
 
-   if( msg_obj == NULL )
+   if( msg_obj == NULL || lane < 0 || lane >= eMSG_Q_LANE_MAX )
    {
-      LOC_LOGE("%s: Invalid msg_obj parameter!\n", __FUNCTION__);
+      LOC_LOGE("%s: Invalid parameter!\n", __FUNCTION__);
       return eMSG_Q_INVALID_PARAMETER;
    }
 
    msg_q* p_msg_q = (msg_q*)msg_q_data;
 
-   LOC_LOGD("%s: Waiting on message\n", __FUNCTION__);
+   if( p_msg_q->backend == eMSG_Q_BACKEND_RING )
+   {
+      if( __atomic_load_n(&p_msg_q->unblocked, __ATOMIC_ACQUIRE) )
+      {
+         return eMSG_Q_UNAVAILABLE_RESOURCE;
+      }
+      if( !msg_q_ring_pop(&p_msg_q->ring[lane], msg_obj, NULL, sent_ns) )
+      {
+         return eMSG_Q_TIMEOUT;
+      }
+      msg_q_ring_space_wake(p_msg_q, 0);
+      return eMSG_Q_SUCCESS;
+   }
+
+   /* Polled between the messages of a batch, and the lane is mostly
+      empty: skip the lock then. A message queued just now is seen on the
+      next poll. */
+   if( __atomic_load_n(&p_msg_q->list_depth[lane], __ATOMIC_RELAXED) == 0 )
+   {
+      return eMSG_Q_TIMEOUT;
+   }
+
+   pthread_mutex_lock(&p_msg_q->list_mutex);
+
+   if( p_msg_q->unblocked )
+   {
+      rv = eMSG_Q_UNAVAILABLE_RESOURCE;
+   }
+   else if( p_msg_q->list_depth[lane] == 0 )
+   {
+      rv = eMSG_Q_TIMEOUT;
+   }
+   else
+   {
+      rv = convert_linked_list_err_type(msg_q_list_remove_lane(p_msg_q, lane, msg_obj, sent_ns));
+   }
+
+   pthread_mutex_unlock(&p_msg_q->list_mutex);
+
+   return rv;
+}
+
+/*===========================================================================
+
+  FUNCTION:   msg_q_timed_rcv
+
+  ===========================================================================*/
+msq_q_err_type msg_q_timed_rcv(void* msg_q_data, void** msg_obj, uint64_t timeout_ns)
+{
+   if( timeout_ns > INT64_MAX )
+   {
+      timeout_ns = INT64_MAX;
+   }
+   return msg_q_rcv_timeout(msg_q_data, msg_obj, (int64_t)timeout_ns);
+}
+
+/*===========================================================================
+
+  FUNCTION:   msg_q_rcv_batch
+
+  ===========================================================================*/
+msq_q_err_type msg_q_rcv_batch(void* msg_q_data, void** msg_objs, size_t max_count,
+                               size_t* count, uint64_t* sent_ns)
+{
+   msq_q_err_type rv;
+   if( msg_q_data == NULL )
+   {
+      LOC_LOGE("%s: Invalid msg_q_data parameter!\n", __FUNCTION__);
+      return eMSG_Q_INVALID_HANDLE;
+   }
+
+   if( msg_objs == NULL || count == NULL || max_count == 0 )
+   {
+      LOC_LOGE("%s: Invalid msg_objs parameter!\n", __FUNCTION__);
+      return eMSG_Q_INVALID_PARAMETER;
+   }
+
+   msg_q* p_msg_q = (msg_q*)msg_q_data;
+
+   int lane = 0;
+   *count = 0;
+
+   LOC_LOGD("%s: Waiting on messages\n", __FUNCTION__);
+
+   if( p_msg_q->backend == eMSG_Q_BACKEND_RING )
+   {
+      rv = msg_q_ring_rcv(p_msg_q, &msg_objs[0], sent_ns, -1, &lane);
+      if( rv == eMSG_Q_SUCCESS )
+      {
+         *count = 1;
+         /* Stay in the first message's lane, a higher lane message that
+            shows up meanwhile must not queue up behind the batch */
+         while( *count < max_count &&
+                msg_q_ring_pop(&p_msg_q->ring[lane], &msg_objs[*count], NULL,
+                               sent_ns != NULL ? &sent_ns[*count] : NULL) )
+         {
+            (*count)++;
+         }
+         msg_q_ring_space_wake(p_msg_q, 0);
+      }
+
+      LOC_LOGD("%s: Received %u messages rv = %d\n", __FUNCTION__, *count, rv);
+
+      return rv;
+   }
 
    pthread_mutex_lock(&p_msg_q->list_mutex);
 
@@ -240,16 +1552,29 @@ msq_q_err_type msg_q_rcv(void* msg_q_data, void** msg_obj)
    }
 
    /* Wait for data in the message queue */
-   while( linked_list_empty(p_msg_q->msg_list) && !p_msg_q->unblocked )
+   while( msg_q_list_empty(p_msg_q) && !p_msg_q->unblocked )
    {
       pthread_cond_wait(&p_msg_q->list_cond, &p_msg_q->list_mutex);
    }
 
-   rv = convert_linked_list_err_type(linked_list_remove(p_msg_q->msg_list, msg_obj));
+   rv = convert_linked_list_err_type(msg_q_list_remove(p_msg_q, &msg_objs[0], sent_ns, &lane));
+   if( rv == eMSG_Q_SUCCESS )
+   {
+      *count = 1;
+      /* Take whatever else is already queued in the same lane without
+         giving up the lock */
+      while( *count < max_count &&
+             msg_q_list_remove_lane(p_msg_q, lane, &msg_objs[*count],
+                                    sent_ns != NULL ? &sent_ns[*count] : NULL) ==
+             eLINKED_LIST_SUCCESS )
+      {
+         (*count)++;
+      }
+   }
 
    pthread_mutex_unlock(&p_msg_q->list_mutex);
 
-   LOC_LOGD("%s: Received message 0x%08X rv = %d\n", __FUNCTION__, *msg_obj, rv);
+   LOC_LOGD("%s: Received %u messages rv = %d\n", __FUNCTION__, *count, rv);
 
    return rv;
 }
@@ -261,7 +1586,8 @@ msq_q_err_type msg_q_rcv(void* msg_q_data, void** msg_obj)
   ===========================================================================*/
 msq_q_err_type msg_q_flush(void* msg_q_data)
 {
-   msq_q_err_type rv;
+   msq_q_err_type rv = eMSG_Q_SUCCESS;
+   int lane;
    if ( msg_q_data == NULL )
    {
       LOC_LOGE("%s: Invalid msg_q_data parameter!\n", __FUNCTION__);
@@ -272,10 +1598,28 @@ msq_q_err_type msg_q_flush(void* msg_q_data)
 
    LOC_LOGD("%s: Flushing Message Queue\n", __FUNCTION__);
 
+   if( p_msg_q->backend == eMSG_Q_BACKEND_RING )
+   {
+      for( lane = 0; lane < eMSG_Q_LANE_MAX; lane++ )
+      {
+         msg_q_ring_flush(&p_msg_q->ring[lane]);
+      }
+      msg_q_ring_space_wake(p_msg_q, 0);
+
+      LOC_LOGD("%s: Message Queue flushed\n", __FUNCTION__);
+
+      return eMSG_Q_SUCCESS;
+   }
+
    pthread_mutex_lock(&p_msg_q->list_mutex);
 
-   /* Remove all elements from the list */
-   rv = convert_linked_list_err_type(linked_list_flush(p_msg_q->msg_list));
+   /* Remove all elements from the lists */
+   for( lane = 0; lane < eMSG_Q_LANE_MAX && rv == eMSG_Q_SUCCESS; lane++ )
+   {
+      rv = convert_linked_list_err_type(linked_list_flush(p_msg_q->msg_list[lane]));
+      __atomic_store_n(&p_msg_q->list_depth[lane], 0, __ATOMIC_RELAXED);
+      msg_q_coalesce_forget(p_msg_q, lane, NULL);
+   }
 
    pthread_mutex_unlock(&p_msg_q->list_mutex);
 
@@ -298,6 +1642,26 @@ msq_q_err_type msg_q_unblock(void* msg_q_data)
    }
 
    msg_q* p_msg_q = (msg_q*)msg_q_data;
+
+   if( p_msg_q->backend == eMSG_Q_BACKEND_RING )
+   {
+      if( __atomic_exchange_n(&p_msg_q->unblocked, 1, __ATOMIC_SEQ_CST) )
+      {
+         LOC_LOGE("%s: Message queue has been unblocked.\n", __FUNCTION__);
+         return eMSG_Q_UNAVAILABLE_RESOURCE;
+      }
+
+      LOC_LOGD("%s: Unblocking Message Queue\n", __FUNCTION__);
+
+      /* Allow all the waiters to wake up */
+      msg_q_ring_wake(p_msg_q, 1);
+      msg_q_ring_space_wake(p_msg_q, 1);
+
+      LOC_LOGD("%s: Message Queue unblocked\n", __FUNCTION__);
+
+      return eMSG_Q_SUCCESS;
+   }
+
    pthread_mutex_lock(&p_msg_q->list_mutex);
 
    if( p_msg_q->unblocked )
@@ -320,3 +1684,101 @@ msq_q_err_type msg_q_unblock(void* msg_q_data)
 
    return eMSG_Q_SUCCESS;
 }
+
+/*===========================================================================
+
+  FUNCTION:   msg_q_set_lane_func
+
+  ===========================================================================*/
+msq_q_err_type msg_q_set_lane_func(void* msg_q_data, msg_q_lane_type (*lane_func)(void*))
+{
+   if ( msg_q_data == NULL )
+   {
+      LOC_LOGE("%s: Invalid msg_q_data parameter!\n", __FUNCTION__);
+      return eMSG_Q_INVALID_HANDLE;
+   }
+
+   ((msg_q*)msg_q_data)->lane_func = lane_func;
+
+   return eMSG_Q_SUCCESS;
+}
+
+/*===========================================================================
+
+  FUNCTION:   msg_q_set_coalesce_func
+
+  ===========================================================================*/
+msq_q_err_type msg_q_set_coalesce_func(void* msg_q_data,
+                                       msg_q_coalesce_type (*coalesce_func)(void*, msg_q_coalesce_key_type*))
+{
+   if ( msg_q_data == NULL )
+   {
+      LOC_LOGE("%s: Invalid msg_q_data parameter!\n", __FUNCTION__);
+      return eMSG_Q_INVALID_HANDLE;
+   }
+
+   msg_q* p_msg_q = (msg_q*)msg_q_data;
+
+   if( p_msg_q->backend == eMSG_Q_BACKEND_RING )
+   {
+      /* Ring slots are owned by the consumer once published */
+      LOC_LOGE("%s: Coalescing is not supported by the ring backend!\n", __FUNCTION__);
+      return eMSG_Q_INVALID_PARAMETER;
+   }
+
+   p_msg_q->coalesce_func = coalesce_func;
+
+   return eMSG_Q_SUCCESS;
+}
+
+/*===========================================================================
+
+  FUNCTION:   msg_q_get_stats
+
+  ===========================================================================*/
+msq_q_err_type msg_q_get_stats(void* msg_q_data, msg_q_stats_type* stats)
+{
+   int lane;
+   if ( msg_q_data == NULL )
+   {
+      LOC_LOGE("%s: Invalid msg_q_data parameter!\n", __FUNCTION__);
+      return eMSG_Q_INVALID_HANDLE;
+   }
+
+   if( stats == NULL )
+   {
+      LOC_LOGE("%s: Invalid stats parameter!\n", __FUNCTION__);
+      return eMSG_Q_INVALID_PARAMETER;
+   }
+
+   msg_q* p_msg_q = (msg_q*)msg_q_data;
+
+   if( p_msg_q->backend == eMSG_Q_BACKEND_RING )
+   {
+      for( lane = 0; lane < eMSG_Q_LANE_MAX; lane++ )
+      {
+         msg_q_ring* ring = &p_msg_q->ring[lane];
+         /* A snapshot; producers and the consumer keep running */
+         stats->depth[lane] = __atomic_load_n(&ring->enqueue_pos, __ATOMIC_RELAXED) -
+                              __atomic_load_n(&ring->dequeue_pos, __ATOMIC_RELAXED);
+         stats->sent[lane] = __atomic_load_n(&p_msg_q->sent[lane], __ATOMIC_RELAXED);
+         stats->coalesced[lane] = 0;
+      }
+
+      return eMSG_Q_SUCCESS;
+   }
+
+   pthread_mutex_lock(&p_msg_q->list_mutex);
+
+   for( lane = 0; lane < eMSG_Q_LANE_MAX; lane++ )
+   {
+      stats->depth[lane] = p_msg_q->list_depth[lane];
+      stats->sent[lane] = p_msg_q->sent[lane];
+      stats->coalesced[lane] = p_msg_q->coalesced[lane];
+   }
+
+   pthread_mutex_unlock(&p_msg_q->list_mutex);
+
+   return eMSG_Q_SUCCESS;
+}
+
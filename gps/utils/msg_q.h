@@ -34,6 +34,7 @@ extern "C" {
 #endif /* __cplusplus */
 
 #include <stdlib.h>
+#include <stdint.h>
 
 /** Linked List Return Codes */
 typedef enum
@@ -50,8 +51,67 @@ typedef enum
      /**< Failed because an there were not enough resources. */
   eMSG_Q_INSUFFICIENT_BUFFER                 = -5,
      /**< Failed because an the supplied buffer was too small. */
+  eMSG_Q_TIMEOUT                             = -6,
+     /**< Failed because no message arrived before the timeout. */
 }msq_q_err_type;
 
+/** Message Queue Storage Backends */
+typedef enum
+{
+  eMSG_Q_BACKEND_LIST                        = 0,
+     /**< Unbounded linked list guarded by a mutex and condition variable. */
+  eMSG_Q_BACKEND_RING                        = 1,
+     /**< Bounded lock-free multi-producer/single-consumer ring buffer. */
+}msg_q_backend_type;
+
+/** Message Queue Priority Lanes, served in this order */
+typedef enum
+{
+  eMSG_Q_LANE_HIGH                           = 0,
+     /**< Control traffic that must overtake everything else. */
+  eMSG_Q_LANE_NORMAL                         = 1,
+     /**< Default lane. */
+  eMSG_Q_LANE_LOW                            = 2,
+     /**< Bulk reports. */
+  eMSG_Q_LANE_MAX
+}msg_q_lane_type;
+
+/** Message Queue Coalescing Actions */
+typedef enum
+{
+  eMSG_Q_COALESCE_NONE                       = 0,
+     /**< Queue the message normally. */
+  eMSG_Q_COALESCE_REPLACE                    = 1,
+     /**< Queue at the back, dropping the queued, not yet received message
+          with the same key. */
+  eMSG_Q_COALESCE_BARRIER                    = 2,
+     /**< Queue normally; messages queued before it can no longer be replaced. */
+}msg_q_coalesce_type;
+
+/** Message Queue Coalescing Key */
+typedef struct
+{
+  const void* owner;
+     /**< Instance the message belongs to. */
+  int id;
+     /**< Kind of message, usually its message id. */
+  int needs_id;
+     /**< Kind of message this one builds on, or -1. The queued, not yet
+          received one of that kind is no longer replaced on its own, but
+          dropped along with this message when it is replaced. */
+}msg_q_coalesce_key_type;
+
+/** Message Queue Statistics */
+typedef struct
+{
+  uint32_t depth[eMSG_Q_LANE_MAX];
+     /**< Messages waiting in each lane. */
+  uint32_t sent[eMSG_Q_LANE_MAX];
+     /**< Messages accepted by each lane since initialization. */
+  uint32_t coalesced[eMSG_Q_LANE_MAX];
+     /**< Messages dropped because a newer one replaced them. */
+}msg_q_stats_type;
+
 /*===========================================================================
 FUNCTION    msg_q_init
 
@@ -72,6 +132,39 @@ SIDE EFFECTS
 ===========================================================================*/
 msq_q_err_type msg_q_init(void** msg_q_data);
 
+/*===========================================================================
+FUNCTION    msg_q_init2
+
+DESCRIPTION
+   Initializes internal structures for message queue using the requested
+   storage backend. msg_q_init() is equivalent to requesting
+   eMSG_Q_BACKEND_LIST.
+
+   The ring backend never takes a lock nor allocates memory once
+   initialized: producers claim slots with an atomic compare-and-swap and
+   the consumer only enters the kernel (futex) when the ring is empty.
+   Sending to a full ring fails with eMSG_Q_UNAVAILABLE_RESOURCE. Each lane
+   has a ring of its own.
+
+   msg_q_data: State of message queue to be initialized.
+   backend:    Storage backend to use.
+   capacity:   Number of slots of each lane's ring, rounded up to a power
+               of two. For the list backend, the number of list elements to
+               reserve up front per lane; the lists still grow past it.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+msq_q_err_type msg_q_init2(void** msg_q_data, msg_q_backend_type backend,
+                           uint32_t capacity);
+
 /*===========================================================================
 FUNCTION    msg_q_destroy
 
@@ -117,6 +210,62 @@ SIDE EFFECTS
 ===========================================================================*/
 msq_q_err_type msg_q_snd(void* msg_q_data, void* msg_obj, void (*dealloc)(void*));
 
+/*===========================================================================
+FUNCTION    msg_q_snd_wait
+
+DESCRIPTION
+   Sends data to the message queue like msg_q_snd, but when the lane of a
+   ring backed queue is full, waits until the receiver makes room instead of
+   failing. Must not be called from the thread receiving from msg_q_data if
+   the lane can fill up, that thread would wait for itself.
+
+   msg_q_data: Message Queue to add the element to.
+   msgp:       Pointer to data to add into message queue.
+   dealloc:    Function used to deallocate memory for this element. Pass NULL
+               if you do not want data deallocated during a flush operation
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   eMSG_Q_UNAVAILABLE_RESOURCE if the queue is unblocked while waiting.
+   Otherwise look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+msq_q_err_type msg_q_snd_wait(void* msg_q_data, void* msg_obj, void (*dealloc)(void*));
+
+/*===========================================================================
+FUNCTION    msg_q_snd_lane
+
+DESCRIPTION
+   Sends data to the given lane of the message queue. Receivers always take
+   the oldest message of the highest priority non-empty lane, so messages of
+   different lanes may be received out of order. msg_q_snd() uses the lane
+   chosen by the function set with msg_q_set_lane_func(), or
+   eMSG_Q_LANE_NORMAL if there is none.
+
+   msg_q_data: Message Queue to add the element to.
+   msgp:       Pointer to data to add into message queue.
+   dealloc:    Function used to deallocate memory for this element. Pass NULL
+               if you do not want data deallocated during a flush operation
+   lane:       Lane to queue the message on.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+msq_q_err_type msg_q_snd_lane(void* msg_q_data, void* msg_obj, void (*dealloc)(void*),
+                              msg_q_lane_type lane);
+
 /*===========================================================================
 FUNCTION    msg_q_rcv
 
@@ -139,6 +288,112 @@ SIDE EFFECTS
 ===========================================================================*/
 msq_q_err_type msg_q_rcv(void* msg_q_data, void** msg_obj);
 
+/*===========================================================================
+FUNCTION    msg_q_try_rcv
+
+DESCRIPTION
+   Retrieves data from the message queue like msg_q_rcv, but returns
+   eMSG_Q_TIMEOUT right away instead of blocking if the queue is empty.
+
+   msg_q_data: Message Queue to copy data from into msgp.
+   msg_obj:    Pointer to space to copy msg_q contents to.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+msq_q_err_type msg_q_try_rcv(void* msg_q_data, void** msg_obj);
+
+/*===========================================================================
+FUNCTION    msg_q_try_rcv_lane
+
+DESCRIPTION
+   Retrieves the oldest message of one lane without blocking. Lets a
+   consumer working through a batch of a lower lane look for newly queued
+   higher priority messages in between. An empty lane is found without
+   taking the queue lock, so polling between every message stays cheap.
+
+   msg_q_data: Message Queue to copy data from into msgp.
+   msg_obj:    Pointer to space to copy msg_q contents to.
+   lane:       Lane to take the message from.
+   sent_ns:    Set to the CLOCK_MONOTONIC time in ns the message was
+               queued at. May be NULL.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   eMSG_Q_TIMEOUT if the lane is empty.
+   Otherwise look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+msq_q_err_type msg_q_try_rcv_lane(void* msg_q_data, void** msg_obj, msg_q_lane_type lane,
+                                  uint64_t* sent_ns);
+
+/*===========================================================================
+FUNCTION    msg_q_timed_rcv
+
+DESCRIPTION
+   Retrieves data from the message queue like msg_q_rcv, waiting at most
+   timeout_ns nanoseconds for a message. The timeout is measured against
+   CLOCK_MONOTONIC, so wall clock adjustments do not affect it.
+
+   msg_q_data: Message Queue to copy data from into msgp.
+   msg_obj:    Pointer to space to copy msg_q contents to.
+   timeout_ns: Maximum time to wait, in nanoseconds.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   eMSG_Q_TIMEOUT if no message arrived in time.
+   Otherwise look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+msq_q_err_type msg_q_timed_rcv(void* msg_q_data, void** msg_obj, uint64_t timeout_ns);
+
+/*===========================================================================
+FUNCTION    msg_q_rcv_batch
+
+DESCRIPTION
+   Retrieves up to max_count messages from the message queue, oldest first.
+   Blocks like msg_q_rcv until at least one message is available, then takes
+   whatever else is already queued in the same lane without blocking again,
+   so a burst costs a single lock acquisition. A batch never spans lanes, so
+   a higher priority message queued meanwhile is not stuck behind it.
+
+   msg_q_data: Message Queue to copy data from into msg_objs.
+   msg_objs:   Array of at least max_count pointers to copy msg_q contents to.
+   max_count:  Maximum number of messages to retrieve.
+   count:      Number of messages stored into msg_objs.
+   sent_ns:    Array of at least max_count, set to the CLOCK_MONOTONIC time
+               in ns each message was queued at. May be NULL.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+msq_q_err_type msg_q_rcv_batch(void* msg_q_data, void** msg_objs, size_t max_count,
+                               size_t* count, uint64_t* sent_ns);
+
 /*===========================================================================
 FUNCTION    msg_q_flush
 
@@ -182,6 +437,85 @@ SIDE EFFECTS
 ===========================================================================*/
 msq_q_err_type msg_q_unblock(void* msg_q_data);
 
+/*===========================================================================
+FUNCTION    msg_q_set_lane_func
+
+DESCRIPTION
+   Installs the function msg_q_snd() uses to pick the lane of each message,
+   so senders need not know about lanes. Must be called before the message
+   queue is shared with other threads.
+
+   msg_q_data: Message queue to classify messages for.
+   lane_func:  Returns the lane for a message; NULL sends everything to
+               eMSG_Q_LANE_NORMAL.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+msq_q_err_type msg_q_set_lane_func(void* msg_q_data, msg_q_lane_type (*lane_func)(void*));
+
+/*===========================================================================
+FUNCTION    msg_q_set_coalesce_func
+
+DESCRIPTION
+   Enables coalescing. msg_q_snd() and msg_q_snd_lane() ask coalesce_func
+   what to do with each message. A message the function marks
+   eMSG_Q_COALESCE_REPLACE is queued at the back of its lane, and the
+   queued, not yet received message of the same lane and key is taken out
+   and deallocated right away; the new one stays behind everything queued
+   before it. A message the new one builds on, by needs_id of its key, is
+   not replaced on its own from then on, but goes when the new one is
+   replaced. So with an SV and a position report taking turns, a backlog
+   holds at most the latest of each, in the order they came in, and a
+   position report is never handled without its SV report. Only a few keys are
+   tracked at a time. Must be called before the message queue is shared with
+   other threads. Not supported by the ring backend.
+
+   msg_q_data:    Message queue to coalesce messages in.
+   coalesce_func: Fills in the key of a message and returns the action to
+                  take; NULL disables coalescing.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+msq_q_err_type msg_q_set_coalesce_func(void* msg_q_data,
+                                       msg_q_coalesce_type (*coalesce_func)(void*, msg_q_coalesce_key_type*));
+
+/*===========================================================================
+FUNCTION    msg_q_get_stats
+
+DESCRIPTION
+   Retrieves a snapshot of the per lane statistics of the message queue.
+
+   msg_q_data: Message queue to report on.
+   stats:      Filled with the current statistics.
+
+DEPENDENCIES
+   N/A
+
+RETURN VALUE
+   Look at error codes above.
+
+SIDE EFFECTS
+   N/A
+
+===========================================================================*/
+msq_q_err_type msg_q_get_stats(void* msg_q_data, msg_q_stats_type* stats);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */